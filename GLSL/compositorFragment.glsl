@@ -0,0 +1,38 @@
+#version 410 core
+
+//Must match OpenGLLayerCompositor::maxLayers
+#define MAX_LAYERS 16
+
+in vec2 outputPosition;
+
+//Layers in drawing order, bottom first; see OpenGLLayerCompositor
+uniform sampler2D layerTextures[MAX_LAYERS];
+uniform mat3 layerTransforms[MAX_LAYERS];
+uniform float layerOpacities[MAX_LAYERS];
+uniform int layerCount;
+
+out vec4 fragColor;
+
+void main()
+{
+    vec3 color = vec3(0.0);
+
+    for(int i = 0; i < MAX_LAYERS; i++)
+    {
+        //The loop index is dynamically uniform, as indexing a sampler array requires
+        if(i >= layerCount)
+            break;
+
+        vec2 layerTexCoord = (layerTransforms[i] * vec3(outputPosition, 1.0)).xy;
+
+        if(any(lessThan(layerTexCoord, vec2(0.0))) || any(greaterThan(layerTexCoord, vec2(1.0))))
+            continue;
+
+        //Explicit level, as implicit derivatives are undefined in non-uniform control flow
+        vec4 layer = textureLod(layerTextures[i], layerTexCoord, 0.0);
+
+        color = mix(color, layer.rgb, layer.a * layerOpacities[i]);
+    }
+
+    fragColor = vec4(color, 1.0);
+}
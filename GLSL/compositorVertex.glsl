@@ -0,0 +1,19 @@
+#version 410 core
+
+//Output size in pixels; layer transforms work in output pixels
+uniform vec2 outputSize;
+
+out vec2 outputPosition;
+
+//Two triangles covering the output, no vertex buffer needed
+const vec2 corners[6] = vec2[6](vec2(0.0, 0.0), vec2(1.0, 0.0), vec2(1.0, 1.0),
+                                vec2(0.0, 0.0), vec2(1.0, 1.0), vec2(0.0, 1.0));
+
+void main()
+{
+    vec2 corner = corners[gl_VertexID];
+
+    gl_Position = vec4(corner * 2.0 - 1.0, 0.0, 1.0);
+
+    outputPosition = corner * outputSize;
+}
@@ -0,0 +1,13 @@
+#version 410 core
+
+in vec2 quadTexCoord;
+in vec4 quadColor;
+
+uniform sampler2D quadTexture;
+
+out vec4 fragColor;
+
+void main()
+{
+    fragColor = texture(quadTexture, quadTexCoord) * quadColor;
+}
@@ -0,0 +1,28 @@
+#version 410 core
+
+//Unit quad corner, per vertex
+layout(location = 0) in vec2 corner;
+
+//Per instance; see OpenGLQuadBatch::OpenGLQuad
+layout(location = 1) in vec4 rect;
+layout(location = 2) in vec4 texRect;
+layout(location = 3) in vec4 color;
+
+//Streamed by OpenGLQuadBatch at binding point 0
+layout(std140) uniform QuadUniforms
+{
+    vec2 targetSize;
+};
+
+out vec2 quadTexCoord;
+out vec4 quadColor;
+
+void main()
+{
+    vec2 position = rect.xy + corner * rect.zw;
+
+    gl_Position = vec4(position / targetSize * 2.0 - 1.0, 0.0, 1.0);
+
+    quadTexCoord = texRect.xy + corner * texRect.zw;
+    quadColor = color;
+}
@@ -0,0 +1,27 @@
+#version 410 core
+
+in vec2 planeTexCoord;
+
+//Luma, then either interleaved UV (NV12 / P010) or separate U and V planes (I420)
+uniform sampler2D yPlane;
+uniform sampler2D uPlane;
+uniform sampler2D vPlane;
+
+uniform bool interleavedChroma;
+
+//rgb = colorMatrix * (yuv - colorOffset); see OpenGLRenderer::getColorConversion
+uniform mat3 colorMatrix;
+uniform vec3 colorOffset;
+
+out vec4 fragColor;
+
+void main()
+{
+    vec3 yuv;
+
+    yuv.x = texture(yPlane, planeTexCoord).r;
+    yuv.yz = interleavedChroma ? texture(uPlane, planeTexCoord).rg
+                               : vec2(texture(uPlane, planeTexCoord).r, texture(vPlane, planeTexCoord).r);
+
+    fragColor = vec4(clamp(colorMatrix * (yuv - colorOffset), 0.0, 1.0), 1.0);
+}
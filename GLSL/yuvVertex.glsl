@@ -0,0 +1,14 @@
+#version 410 core
+
+//Full screen strip drawn by OpenGLInputSource
+layout(location = 0) in vec2 vertex;
+layout(location = 1) in vec2 texCoord;
+
+out vec2 planeTexCoord;
+
+void main()
+{
+    gl_Position = vec4(vertex, 0.0, 1.0);
+
+    planeTexCoord = texCoord;
+}
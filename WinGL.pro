@@ -23,20 +23,79 @@ DEFINES += QT_DEPRECATED_WARNINGS
 # You can also select to disable deprecated APIs only up to a certain version of Qt.
 #DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
 
-LIBS += -lUser32 -lOpenGL32 -lGdi32 -lKernel32
-
 SOURCES += \
         main.cpp \
         mainwindow.cpp \
+    openglframeappender.cpp \
+    openglframefile.cpp \
+    openglframemailbox.cpp \
+    openglframereader.cpp \
+    openglframereplay.cpp \
+    openglframescheduler.cpp \
+    openglframewriter.cpp \
+    openglinputsource.cpp \
+    opengllayercompositor.cpp \
+    openglnativebackend.cpp \
     openglnativerenderwindow.cpp \
+    opengloutputcache.cpp \
+    opengloutputring.cpp \
+    openglpixelkernels.cpp \
+    openglpresenterpool.cpp \
+    openglprofiler.cpp \
+    openglprogramcache.cpp \
+    openglquadbatch.cpp \
     openglrenderer.cpp \
-    openglrendersurface.cpp
+    openglrendergraph.cpp \
+    openglrendersurface.cpp \
+    openglresolutiongovernor.cpp \
+    openglstatecache.cpp \
+    openglstreambuffer.cpp \
+    opengltexturepool.cpp \
+    opengltransformsystem.cpp \
+    openglvideowall.cpp
 
 HEADERS += \
         mainwindow.h \
+    openglframeappender.h \
+    openglframefile.h \
+    openglframemailbox.h \
+    openglframereader.h \
+    openglframereplay.h \
+    openglframescheduler.h \
+    openglframewriter.h \
+    openglinputsource.h \
+    opengllayercompositor.h \
+    openglnativebackend.h \
     openglnativerenderwindow.h \
+    opengloutputcache.h \
+    opengloutputring.h \
+    openglpixelkernels.h \
+    openglpresenterpool.h \
+    openglprofiler.h \
+    openglprogramcache.h \
+    openglquadbatch.h \
     openglrenderer.h \
-    openglrendersurface.h
+    openglrendergraph.h \
+    openglrendersurface.h \
+    openglresolutiongovernor.h \
+    openglstatecache.h \
+    openglstreambuffer.h \
+    opengltexturepool.h \
+    opengltransformsystem.h \
+    openglvideowall.h
+
+# Native output backend: WGL windows on Windows, headless EGL pbuffers elsewhere
+win32 {
+    LIBS += -lUser32 -lOpenGL32 -lGdi32 -lKernel32
+
+    SOURCES += openglwglbackend.cpp
+    HEADERS += openglwglbackend.h
+} else {
+    LIBS += -lEGL
+
+    SOURCES += opengleglbackend.cpp
+    HEADERS += opengleglbackend.h
+}
 
 FORMS += \
         mainwindow.ui
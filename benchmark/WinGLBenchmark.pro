@@ -0,0 +1,127 @@
+#-------------------------------------------------
+#
+# Headless benchmark for the WinGL render pipeline
+#
+# Runs OpenGLRenderSurface and the display passes without MainWindow on
+# Qt's offscreen platform, e.g.
+#
+#   QT_QPA_PLATFORM=offscreen LIBGL_ALWAYS_SOFTWARE=1 ./WinGLBenchmark --buffers 1,2,3
+#   ./WinGLBenchmark --readback --width 3840 --height 2160
+#   ./WinGLBenchmark --mode upload --format rgba8,rgba16f,rgba32f --buffers 3
+#   ./WinGLBenchmark --mode upload --format rgba8,nv12,i420,p010 --buffers 3
+#   ./WinGLBenchmark --mode pacing --fps 24,30,59.94,60,120 --buffers 2
+#   ./WinGLBenchmark --profile --displays 1,4 --trace pipeline.json
+#   ./WinGLBenchmark --cache --displays 8 --output-sizes 1920x1080,960x540 --profile
+#   ./WinGLBenchmark --effects 8 --buffers 2
+#   ./WinGLBenchmark --mode resize --resizes-per-frame 8 --displays 2
+#   ./WinGLBenchmark --mode startup --displays 1,4 --effects 4 --buffers 2
+#   ./WinGLBenchmark --mode mailbox --consumer-delay 20 --buffers 3
+#   ./WinGLBenchmark --mode present --displays 1,4,16 --swap-delay 16.7 --buffers 3 --frames 300
+#   ./WinGLBenchmark --present copy,sample,blit --displays 4 --paints-per-frame 4 --skip-unchanged --profile
+#   ./WinGLBenchmark --mode quads --quads 100000 --quad-textures 8 --buffers 2 [--unsorted]
+#   ./WinGLBenchmark --mode transforms --transforms 10000,100000,1000000 --buffers 1
+#   ./WinGLBenchmark --mode kernels --width 3840 --height 2160 --frames 100
+#   ./WinGLBenchmark --mode offline --frames 300 --output-dir frames --buffers 2
+#   ./WinGLBenchmark --mode replay --format rgba8,nv12 --frames 600 --buffers 3
+#   ./WinGLBenchmark --mode governor --width 3840 --height 2160 --effects 16 --displays 1
+#   ./WinGLBenchmark --mode wall --wall 4x2 --bezel 40 --tile-size 1024,2048,4096 --width 3840 --height 2160 --buffers 2
+#   ./WinGLBenchmark --mode layers --layers 2,4,8 --buffers 3 --frames 600
+#
+# --native presents through OpenGLNativeRenderWindow; on Linux its EGL backend
+# shares with the producer, so Qt must run on an EGL platform there. The
+# benchmark then defaults to QT_QPA_PLATFORM=minimalegl instead of offscreen;
+# eglfs, wayland-egl or xcb with QT_XCB_GL_INTEGRATION=xcb_egl work as well.
+# Any other platform aborts when the first native display is created
+#
+#-------------------------------------------------
+
+QT       += core gui
+QT       += opengl openglextensions
+
+CONFIG   += console
+CONFIG   -= app_bundle
+
+TARGET = WinGLBenchmark
+TEMPLATE = app
+
+DEFINES += QT_DEPRECATED_WARNINGS
+
+INCLUDEPATH += .. .
+
+SOURCES += \
+        main.cpp \
+    openglbenchmark.cpp \
+    openglbenchmarkdisplay.cpp \
+    ../openglframeappender.cpp \
+    ../openglframefile.cpp \
+    ../openglframemailbox.cpp \
+    ../openglframereader.cpp \
+    ../openglframereplay.cpp \
+    ../openglframescheduler.cpp \
+    ../openglframewriter.cpp \
+    ../openglinputsource.cpp \
+    ../opengllayercompositor.cpp \
+    ../openglnativebackend.cpp \
+    ../openglnativerenderwindow.cpp \
+    ../opengloutputcache.cpp \
+    ../opengloutputring.cpp \
+    ../openglpixelkernels.cpp \
+    ../openglpresenterpool.cpp \
+    ../openglprofiler.cpp \
+    ../openglprogramcache.cpp \
+    ../openglquadbatch.cpp \
+    ../openglrenderer.cpp \
+    ../openglrendergraph.cpp \
+    ../openglrendersurface.cpp \
+    ../openglresolutiongovernor.cpp \
+    ../openglstatecache.cpp \
+    ../openglstreambuffer.cpp \
+    ../opengltexturepool.cpp \
+    ../opengltransformsystem.cpp \
+    ../openglvideowall.cpp
+
+HEADERS += \
+    openglbenchmark.h \
+    openglbenchmarkdisplay.h \
+    ../openglframeappender.h \
+    ../openglframefile.h \
+    ../openglframemailbox.h \
+    ../openglframereader.h \
+    ../openglframereplay.h \
+    ../openglframescheduler.h \
+    ../openglframewriter.h \
+    ../openglinputsource.h \
+    ../opengllayercompositor.h \
+    ../openglnativebackend.h \
+    ../openglnativerenderwindow.h \
+    ../opengloutputcache.h \
+    ../opengloutputring.h \
+    ../openglpixelkernels.h \
+    ../openglpresenterpool.h \
+    ../openglprofiler.h \
+    ../openglprogramcache.h \
+    ../openglquadbatch.h \
+    ../openglrenderer.h \
+    ../openglrendergraph.h \
+    ../openglrendersurface.h \
+    ../openglresolutiongovernor.h \
+    ../openglstatecache.h \
+    ../openglstreambuffer.h \
+    ../opengltexturepool.h \
+    ../opengltransformsystem.h \
+    ../openglvideowall.h
+
+win32 {
+    LIBS += -lUser32 -lOpenGL32 -lGdi32 -lKernel32
+
+    SOURCES += ../openglwglbackend.cpp
+    HEADERS += ../openglwglbackend.h
+} else {
+    LIBS += -lEGL
+
+    SOURCES += ../opengleglbackend.cpp
+    HEADERS += ../opengleglbackend.h
+}
+
+RESOURCES += \
+    ../resources.qrc
@@ -0,0 +1,347 @@
+#include <openglbenchmark.h>
+
+#include <QGuiApplication>
+#include <QCommandLineParser>
+#include <QSurfaceFormat>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#define OPENGL_MAJOR_VERSION 4
+#define OPENGL_MINOR_VERSION 1
+#define OPENGL_SWAP_INTERVAL 0
+#define OPENGL_SWAP_BEHAVIOUR 0
+
+//Parses a comma separated list of positive integers such as "1,2,3"
+static std::vector<unsigned int> parseList(const QString& value)
+{
+    std::vector<unsigned int> list;
+
+    foreach(const QString& item, value.split(QString(",")))
+    {
+        bool ok = false;
+        unsigned int number = item.toUInt(&ok);
+        if(ok && number > 0)
+            list.push_back(number);
+    }
+
+    return list;
+}
+
+//Parses a comma separated list of sizes such as "1920x1080,960x540"
+static std::vector<std::pair<unsigned int,unsigned int>> parseSizes(const QString& value)
+{
+    std::vector<std::pair<unsigned int,unsigned int>> sizes;
+
+    foreach(const QString& item, value.split(QString(",")))
+    {
+        QStringList dimensions = item.split(QString("x"));
+        if(dimensions.size() != 2)
+            continue;
+
+        unsigned int width = dimensions.at(0).toUInt();
+        unsigned int height = dimensions.at(1).toUInt();
+        if(width > 0 && height > 0)
+            sizes.push_back(std::make_pair(width, height));
+    }
+
+    return sizes;
+}
+
+int main(int argc, char *argv[])
+{
+    //Run headless on Mesa's software rasterizer unless the caller says otherwise. Native displays share
+    //the producer's context, which outside of Windows has to be an EGL one, so they need an EGL platform
+    bool nativeDisplays = false;
+    for(int i = 1; i < argc; i++)
+        nativeDisplays = nativeDisplays || std::strcmp(argv[i], "--native") == 0;
+
+    if(qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM"))
+    {
+#ifdef Q_OS_WIN
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+#else
+        qputenv("QT_QPA_PLATFORM", nativeDisplays ? "minimalegl" : "offscreen");
+#endif
+    }
+    if(qEnvironmentVariableIsEmpty("LIBGL_ALWAYS_SOFTWARE"))
+        qputenv("LIBGL_ALWAYS_SOFTWARE", "1");
+    if(qEnvironmentVariableIsEmpty("GALLIUM_DRIVER"))
+        qputenv("GALLIUM_DRIVER", "llvmpipe");
+
+    //Same global format as the application, without vsync
+    QSurfaceFormat format;
+    format.setDepthBufferSize(32);
+    format.setStencilBufferSize(8);
+
+    format.setRedBufferSize(8);
+    format.setGreenBufferSize(8);
+    format.setBlueBufferSize(8);
+    format.setAlphaBufferSize(8);
+
+    format.setSwapBehavior(QSurfaceFormat::SwapBehavior(OPENGL_SWAP_BEHAVIOUR));
+
+    format.setSwapInterval(OPENGL_SWAP_INTERVAL);
+
+    format.setVersion(OPENGL_MAJOR_VERSION,
+                      OPENGL_MINOR_VERSION);
+
+    format.setProfile(QSurfaceFormat::CoreProfile);
+
+    QSurfaceFormat::setDefaultFormat(format);
+
+    QGuiApplication::setAttribute(Qt::AA_ShareOpenGLContexts);
+
+    QGuiApplication a(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QString("Headless WinGL render pipeline benchmark"));
+    parser.addHelpOption();
+
+    QCommandLineOption modeOption(QString("mode"), QString("Benchmarks to run, comma separated: pipeline, upload, pacing, resize, startup, mailbox, present, quads, transforms, kernels, offline, replay, governor, wall, layers."), QString("list"), QString("pipeline"));
+    QCommandLineOption widthOption(QString("width"), QString("Render width."), QString("pixels"), QString("1920"));
+    QCommandLineOption heightOption(QString("height"), QString("Render height."), QString("pixels"), QString("1080"));
+    QCommandLineOption formatOption(QString("format"), QString("Texture formats, comma separated: rgba8, bgra8, rgb10a2, rgba16f, rgba32f, r8; planar nv12, i420, p010 for upload runs."), QString("list"), QString("rgba8"));
+    QCommandLineOption displaysOption(QString("displays"), QString("Display counts, comma separated."), QString("list"), QString("1"));
+    QCommandLineOption buffersOption(QString("buffers"), QString("Output / upload ring depths, comma separated."), QString("list"), QString("1,2,3"));
+    QCommandLineOption nativeOption(QString("native"), QString("Present through OpenGLNativeRenderWindow (WGL / EGL backend)."));
+    QCommandLineOption resizesOption(QString("resizes-per-frame"), QString("Resize requests per frame in resize runs."), QString("count"), QString("8"));
+    QCommandLineOption effectsOption(QString("effects"), QString("Pass-through effects chained after the producer's triangle."), QString("count"), QString("0"));
+    QCommandLineOption cacheOption(QString("cache"), QString("Feed displays through OpenGLOutputCache so each presents in a single pass."));
+    QCommandLineOption outputSizesOption(QString("output-sizes"), QString("Display sizes assigned round robin, comma separated WxH (default: render size)."), QString("list"));
+    QCommandLineOption readbackOption(QString("readback"), QString("Read every frame back to the CPU through pixel buffer objects."));
+    QCommandLineOption orphanOption(QString("orphan"), QString("Upload through orphaned buffers even if persistent mapping is available."));
+    QCommandLineOption profileOption(QString("profile"), QString("Time every pass on the GPU with timer queries."));
+    QCommandLineOption traceOption(QString("trace"), QString("Write a Chrome trace of the profiled passes per run (implies --profile)."), QString("file"));
+    QCommandLineOption programCacheOption(QString("program-cache"), QString("Program binary directory used by startup runs (default: under the temp path)."), QString("directory"));
+    QCommandLineOption startupRunsOption(QString("startup-runs"), QString("Startups per configuration in startup runs."), QString("count"), QString("5"));
+    QCommandLineOption consumerDelayOption(QString("consumer-delay"), QString("Time a slowed consumer spends per frame in mailbox runs."), QString("ms"), QString("20"));
+    QCommandLineOption presenterThreadsOption(QString("presenter-threads"), QString("Presentation threads in present runs (0: one per display)."), QString("count"), QString("0"));
+    QCommandLineOption swapDelayOption(QString("swap-delay"), QString("Time each display's swap blocks in present runs."), QString("ms"), QString("0"));
+    QCommandLineOption presentOption(QString("present"), QString("Display present modes, comma separated: copy, sample, blit."), QString("list"), QString("copy"));
+    QCommandLineOption skipUnchangedOption(QString("skip-unchanged"), QString("Displays skip paints that have no new frame."));
+    QCommandLineOption paintsOption(QString("paints-per-frame"), QString("Display paints per producer frame, as WM_PAINT can arrive faster than frames."), QString("count"), QString("1"));
+    QCommandLineOption quadsOption(QString("quads"), QString("Overlay quads per frame in quads runs."), QString("count"), QString("100000"));
+    QCommandLineOption quadTexturesOption(QString("quad-textures"), QString("Textures the overlay quads are spread over."), QString("count"), QString("8"));
+    QCommandLineOption unsortedOption(QString("unsorted"), QString("Draw overlay quads in submission order instead of sorting by program / texture."));
+    QCommandLineOption transformsOption(QString("transforms"), QString("Object counts for transforms runs, comma separated."), QString("list"), QString("10000,100000,1000000"));
+    QCommandLineOption outputDirectoryOption(QString("output-dir"), QString("Directory offline and replay runs write frames to (default: under the temp path, removed afterwards)."), QString("directory"));
+    QCommandLineOption wallOption(QString("wall"), QString("Displays of the video wall in wall runs, CxR."), QString("size"), QString("4x2"));
+    QCommandLineOption bezelOption(QString("bezel"), QString("Canvas pixels hidden between neighbouring displays in wall runs."), QString("pixels"), QString("0"));
+    QCommandLineOption tileSizeOption(QString("tile-size"), QString("Tile sizes for wall runs, comma separated."), QString("list"), QString("1024,2048"));
+    QCommandLineOption layersOption(QString("layers"), QString("Producer counts for layers runs, comma separated."), QString("list"), QString("2,4,8"));
+    QCommandLineOption fpsOption(QString("fps"), QString("Target frame rates for pacing runs, comma separated."), QString("list"), QString("24,30,59.94,60,120"));
+    QCommandLineOption framesOption(QString("frames"), QString("Measured frames per run."), QString("count"), QString("600"));
+    QCommandLineOption warmupOption(QString("warmup"), QString("Unmeasured frames per run."), QString("count"), QString("60"));
+
+    parser.addOption(modeOption);
+    parser.addOption(widthOption);
+    parser.addOption(heightOption);
+    parser.addOption(formatOption);
+    parser.addOption(displaysOption);
+    parser.addOption(buffersOption);
+    parser.addOption(nativeOption);
+    parser.addOption(resizesOption);
+    parser.addOption(effectsOption);
+    parser.addOption(cacheOption);
+    parser.addOption(outputSizesOption);
+    parser.addOption(readbackOption);
+    parser.addOption(orphanOption);
+    parser.addOption(profileOption);
+    parser.addOption(traceOption);
+    parser.addOption(programCacheOption);
+    parser.addOption(startupRunsOption);
+    parser.addOption(consumerDelayOption);
+    parser.addOption(presenterThreadsOption);
+    parser.addOption(swapDelayOption);
+    parser.addOption(presentOption);
+    parser.addOption(skipUnchangedOption);
+    parser.addOption(paintsOption);
+    parser.addOption(quadsOption);
+    parser.addOption(quadTexturesOption);
+    parser.addOption(unsortedOption);
+    parser.addOption(transformsOption);
+    parser.addOption(outputDirectoryOption);
+    parser.addOption(wallOption);
+    parser.addOption(bezelOption);
+    parser.addOption(tileSizeOption);
+    parser.addOption(layersOption);
+    parser.addOption(fpsOption);
+    parser.addOption(framesOption);
+    parser.addOption(warmupOption);
+
+    parser.process(a);
+
+    OpenGLBenchmark::OpenGLBenchmarkSpecs benchmarkSpecs;
+    benchmarkSpecs.renderSpecs = OpenGLRenderer::OpenGLRenderSpecs
+    {
+            OpenGLRenderer::OpenGLTextureSpecs
+            {
+            parser.value(widthOption).toUInt(),
+            parser.value(heightOption).toUInt(),
+            4,
+            GL_TEXTURE_2D,
+            GL_RGBA8,
+            GL_RGBA,
+            GL_UNSIGNED_BYTE,
+            OpenGLRenderer::OpenGLPlanesPacked,
+            OpenGLRenderer::OpenGLColorBT601,
+            false
+            },
+            60.0
+    };
+    benchmarkSpecs.numDisplays = 1;
+    benchmarkSpecs.numOutputBuffers = 1;
+    benchmarkSpecs.nativeDisplays = parser.isSet(nativeOption);
+    benchmarkSpecs.resizesPerFrame = parser.value(resizesOption).toUInt();
+    benchmarkSpecs.numEffects = parser.value(effectsOption).toUInt();
+    benchmarkSpecs.outputCache = parser.isSet(cacheOption);
+    benchmarkSpecs.outputSizes = parseSizes(parser.value(outputSizesOption));
+    benchmarkSpecs.readback = parser.isSet(readbackOption);
+    benchmarkSpecs.orphanUploads = parser.isSet(orphanOption);
+    benchmarkSpecs.traceFileName = parser.value(traceOption);
+    benchmarkSpecs.profile = parser.isSet(profileOption) || !benchmarkSpecs.traceFileName.isEmpty();
+    benchmarkSpecs.programCacheDirectory = parser.value(programCacheOption);
+    benchmarkSpecs.numStartupRuns = parser.value(startupRunsOption).toUInt();
+    benchmarkSpecs.consumerDelay = parser.value(consumerDelayOption).toDouble();
+    benchmarkSpecs.numPresenterThreads = parser.value(presenterThreadsOption).toUInt();
+    benchmarkSpecs.swapDelay = parser.value(swapDelayOption).toDouble();
+    benchmarkSpecs.skipUnchanged = parser.isSet(skipUnchangedOption);
+    benchmarkSpecs.paintsPerFrame = std::max(parser.value(paintsOption).toUInt(), 1u);
+    benchmarkSpecs.numQuads = parser.value(quadsOption).toUInt();
+    benchmarkSpecs.numQuadTextures = parser.value(quadTexturesOption).toUInt();
+    benchmarkSpecs.unsortedQuads = parser.isSet(unsortedOption);
+    benchmarkSpecs.numTransforms = 0;
+    benchmarkSpecs.outputDirectory = parser.value(outputDirectoryOption);
+    benchmarkSpecs.wallColumns = 4;
+    benchmarkSpecs.wallRows = 2;
+    benchmarkSpecs.wallBezel = parser.value(bezelOption).toUInt();
+    benchmarkSpecs.tileSize = 0;
+    benchmarkSpecs.numLayers = 0;
+    benchmarkSpecs.numWarmupFrames = parser.value(warmupOption).toUInt();
+    benchmarkSpecs.numFrames = parser.value(framesOption).toUInt();
+
+    if(benchmarkSpecs.renderSpecs.frameType.width == 0 || benchmarkSpecs.renderSpecs.frameType.height == 0)
+    {
+        std::fprintf(stderr, "Invalid render size\n");
+        return 1;
+    }
+
+    std::vector<std::pair<unsigned int,unsigned int>> wallSize = parseSizes(parser.value(wallOption));
+    if(wallSize.empty())
+    {
+        std::fprintf(stderr, "Invalid wall size\n");
+        return 1;
+    }
+
+    benchmarkSpecs.wallColumns = wallSize.front().first;
+    benchmarkSpecs.wallRows = wallSize.front().second;
+
+    //Runs whose checks fail are still printed; the exit code reports them
+    bool passed = true;
+
+    foreach(const QString& mode, parser.value(modeOption).split(QString(",")))
+    {
+        foreach(const QString& formatName, parser.value(formatOption).split(QString(",")))
+        {
+            if(!OpenGLBenchmark::textureSpecsFromName(formatName, benchmarkSpecs.renderSpecs.frameType))
+            {
+                std::fprintf(stderr, "Unknown format %s\n", formatName.toLatin1().constData());
+                return 1;
+            }
+            benchmarkSpecs.formatName = formatName;
+
+            foreach(const QString& presentName, parser.value(presentOption).split(QString(",")))
+            {
+                if(!OpenGLBenchmark::presentModeFromName(presentName, benchmarkSpecs.presentMode))
+                {
+                    std::fprintf(stderr, "Unknown present mode %s\n", presentName.toLatin1().constData());
+                    return 1;
+                }
+                benchmarkSpecs.presentModeName = presentName;
+
+                foreach(unsigned int numDisplays, parseList(parser.value(displaysOption)))
+                {
+                    foreach(unsigned int numBuffers, parseList(parser.value(buffersOption)))
+                    {
+                        benchmarkSpecs.numDisplays = numDisplays;
+                        benchmarkSpecs.numOutputBuffers = numBuffers;
+
+                        OpenGLBenchmark benchmark(benchmarkSpecs);
+
+                        if(mode == QString("pipeline"))
+                            passed = benchmark.printResults(mode, benchmark.runPipeline()) && passed;
+                        else if(mode == QString("upload"))
+                            passed = benchmark.printResults(mode, benchmark.runUpload()) && passed;
+                        else if(mode == QString("resize"))
+                            passed = benchmark.printResults(mode, benchmark.runResize()) && passed;
+                        else if(mode == QString("startup"))
+                            passed = benchmark.printResults(mode, benchmark.runStartup()) && passed;
+                        else if(mode == QString("mailbox"))
+                            passed = benchmark.printResults(mode, benchmark.runMailbox()) && passed;
+                        else if(mode == QString("present"))
+                            passed = benchmark.printResults(mode, benchmark.runPresent()) && passed;
+                        else if(mode == QString("quads"))
+                            passed = benchmark.printResults(mode, benchmark.runQuads()) && passed;
+                        else if(mode == QString("kernels"))
+                            passed = benchmark.printResults(mode, benchmark.runKernels()) && passed;
+                        else if(mode == QString("offline"))
+                            passed = benchmark.printResults(mode, benchmark.runOffline()) && passed;
+                        else if(mode == QString("replay"))
+                            passed = benchmark.printResults(mode, benchmark.runReplay()) && passed;
+                        else if(mode == QString("governor"))
+                            passed = benchmark.printResults(mode, benchmark.runGovernor()) && passed;
+                        else if(mode == QString("wall"))
+                        {
+                            foreach(unsigned int tileSize, parseList(parser.value(tileSizeOption)))
+                            {
+                                benchmarkSpecs.tileSize = tileSize;
+
+                                OpenGLBenchmark wallBenchmark(benchmarkSpecs);
+                                passed = wallBenchmark.printResults(mode, wallBenchmark.runWall()) && passed;
+                            }
+                        }
+                        else if(mode == QString("layers"))
+                        {
+                            foreach(unsigned int numLayers, parseList(parser.value(layersOption)))
+                            {
+                                benchmarkSpecs.numLayers = numLayers;
+
+                                OpenGLBenchmark layersBenchmark(benchmarkSpecs);
+                                passed = layersBenchmark.printResults(mode, layersBenchmark.runLayers()) && passed;
+                            }
+                        }
+                        else if(mode == QString("transforms"))
+                        {
+                            foreach(unsigned int numTransforms, parseList(parser.value(transformsOption)))
+                            {
+                                benchmarkSpecs.numTransforms = numTransforms;
+
+                                OpenGLBenchmark transformBenchmark(benchmarkSpecs);
+                                passed = transformBenchmark.printResults(mode, transformBenchmark.runTransforms()) && passed;
+                            }
+                        }
+                        else if(mode == QString("pacing"))
+                        {
+                            foreach(const QString& fps, parser.value(fpsOption).split(QString(",")))
+                            {
+                                benchmarkSpecs.renderSpecs.frameRate = fps.toDouble();
+
+                                OpenGLBenchmark pacingBenchmark(benchmarkSpecs);
+                                passed = pacingBenchmark.printResults(mode, pacingBenchmark.runPacing()) && passed;
+                            }
+                        }
+                        else
+                        {
+                            std::fprintf(stderr, "Unknown mode %s\n", mode.toLatin1().constData());
+                            return 1;
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    return passed ? 0 : 1;
+}
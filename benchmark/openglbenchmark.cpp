@@ -0,0 +1,2214 @@
+#include "openglbenchmark.h"
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QEventLoop>
+#include <QThread>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <thread>
+
+//Count every heap allocation so we can report allocations per frame
+static std::atomic<unsigned long long> numAllocations(0);
+
+void* operator new(std::size_t size)
+{
+    numAllocations.fetch_add(1, std::memory_order_relaxed);
+
+    void* ptr = std::malloc(size ? size : 1);
+    if(!ptr)
+        throw std::bad_alloc();
+
+    return ptr;
+}
+
+void* operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+
+OpenGLBenchmark::OpenGLBenchmark(OpenGLBenchmark::OpenGLBenchmarkSpecs specs) :
+    benchmarkSpecs(specs)
+{
+
+}
+
+OpenGLBenchmark::~OpenGLBenchmark()
+{
+
+}
+
+bool OpenGLBenchmark::presentModeFromName(const QString &name, OpenGLRenderer::OpenGLPresentMode &mode)
+{
+    if(name == QString("copy"))
+        mode = OpenGLRenderer::OpenGLPresentCopy;
+    else if(name == QString("sample"))
+        mode = OpenGLRenderer::OpenGLPresentSample;
+    else if(name == QString("blit"))
+        mode = OpenGLRenderer::OpenGLPresentBlit;
+    else
+        return false;
+
+    return true;
+}
+
+bool OpenGLBenchmark::textureSpecsFromName(const QString &name, OpenGLRenderer::OpenGLTextureSpecs &specs)
+{
+    specs.target = GL_TEXTURE_2D;
+    specs.planeLayout = OpenGLRenderer::OpenGLPlanesPacked;
+    specs.colorMatrix = OpenGLRenderer::OpenGLColorBT709;
+    specs.fullRange = false;
+
+    if(name == QString("rgba8"))
+    {
+        specs.channels = 4;
+        specs.internalFormat = GL_RGBA8;
+        specs.format = GL_RGBA;
+        specs.dataType = GL_UNSIGNED_BYTE;
+    }
+    else if(name == QString("bgra8"))
+    {
+        specs.channels = 4;
+        specs.internalFormat = GL_RGBA8;
+        specs.format = GL_BGRA;
+        specs.dataType = GL_UNSIGNED_BYTE;
+    }
+    else if(name == QString("rgb10a2"))
+    {
+        specs.channels = 4;
+        specs.internalFormat = GL_RGB10_A2;
+        specs.format = GL_RGBA;
+        specs.dataType = GL_UNSIGNED_INT_2_10_10_10_REV;
+    }
+    else if(name == QString("rgba16f"))
+    {
+        specs.channels = 4;
+        specs.internalFormat = GL_RGBA16F;
+        specs.format = GL_RGBA;
+        specs.dataType = GL_HALF_FLOAT;
+    }
+    else if(name == QString("rgba32f"))
+    {
+        specs.channels = 4;
+        specs.internalFormat = GL_RGBA32F;
+        specs.format = GL_RGBA;
+        specs.dataType = GL_FLOAT;
+    }
+    else if(name == QString("r8"))
+    {
+        specs.channels = 1;
+        specs.internalFormat = GL_R8;
+        specs.format = GL_RED;
+        specs.dataType = GL_UNSIGNED_BYTE;
+    }
+    else if(name == QString("nv12") || name == QString("i420"))
+    {
+        //Planar, limited range BT.709 like most HD video; the format fields describe the luma plane
+        specs.channels = 1;
+        specs.internalFormat = GL_R8;
+        specs.format = GL_RED;
+        specs.dataType = GL_UNSIGNED_BYTE;
+        specs.planeLayout = (name == QString("nv12")) ? OpenGLRenderer::OpenGLPlanesNV12 : OpenGLRenderer::OpenGLPlanesI420;
+    }
+    else if(name == QString("p010"))
+    {
+        //10 bit HDR video is BT.2020
+        specs.channels = 1;
+        specs.internalFormat = GL_R16;
+        specs.format = GL_RED;
+        specs.dataType = GL_UNSIGNED_SHORT;
+        specs.planeLayout = OpenGLRenderer::OpenGLPlanesP010;
+        specs.colorMatrix = OpenGLRenderer::OpenGLColorBT2020;
+    }
+    else
+    {
+        return false;
+    }
+
+    return true;
+}
+
+unsigned long long OpenGLBenchmark::allocationCount()
+{
+    return numAllocations.load(std::memory_order_relaxed);
+}
+
+OpenGLBenchmark::OpenGLBenchmarkResults OpenGLBenchmark::runPipeline()
+{
+    //Producer and displays all live on this thread so the loop is not paced by any timer or event queue
+    OpenGLRenderSurface* producer = new OpenGLRenderSurface(nullptr,
+                                                            nullptr,
+                                                            benchmarkSpecs.renderSpecs,
+                                                            QSurfaceFormat::defaultFormat(),
+                                                            nullptr,
+                                                            benchmarkSpecs.numOutputBuffers);
+
+    //Count frames and bytes landing on the CPU; touch the data so the mapping is really read
+    unsigned long long readbackFrames = 0;
+    unsigned long long readbackBytes = 0;
+    volatile unsigned char readbackSink = 0;
+
+    if(benchmarkSpecs.readback)
+    {
+        producer->setReadbackEnabled(true);
+        QObject::connect(producer,&OpenGLRenderSurface::frameRead,[&](const unsigned char* data, size_t size, unsigned long long, OpenGLRenderer::OpenGLTextureSpecs)
+        {
+            readbackFrames++;
+            readbackBytes += size;
+            readbackSink = data[size / 2];
+        });
+    }
+
+    std::vector<OpenGLBenchmarkDisplay*> displays;
+    std::vector<OpenGLNativeRenderWindow*> nativeDisplays;
+
+    OpenGLOutputCache* cache = nullptr;
+    if(benchmarkSpecs.outputCache)
+    {
+        cache = new OpenGLOutputCache(nullptr,
+                                      nullptr,
+                                      benchmarkSpecs.renderSpecs,
+                                      QSurfaceFormat::defaultFormat(),
+                                      producer->getOpenGLContext(),
+                                      benchmarkSpecs.numOutputBuffers);
+        QObject::connect(producer,&OpenGLRenderSurface::frameReady,cache,&OpenGLOutputCache::setFrame,Qt::DirectConnection);
+
+        if(benchmarkSpecs.profile)
+            cache->setProfilingEnabled(true, QString("output cache"));
+    }
+
+    createDisplays(producer, cache, displays, nativeDisplays);
+
+    std::vector<const OpenGLRenderer*> renderers{producer};
+    if(cache)
+        renderers.push_back(cache);
+    renderers.insert(renderers.end(), displays.begin(), displays.end());
+    renderers.insert(renderers.end(), nativeDisplays.begin(), nativeDisplays.end());
+
+    if(benchmarkSpecs.profile)
+        producer->setProfilingEnabled(true, QString("producer"));
+
+    for(unsigned int i = 0; i < benchmarkSpecs.numEffects; i++)
+        producer->addEffect(QString(":/GLSL/passFragment.glsl"));
+
+    unsigned long long readbackFramesBegin = 0;
+    unsigned long long readbackBytesBegin = 0;
+
+    unsigned long long presentedBegin = 0;
+    unsigned long long skippedBegin = 0;
+
+    auto sumDisplayCounts = [&](unsigned long long& presented, unsigned long long& skipped)
+    {
+        presented = skipped = 0;
+
+        foreach(OpenGLBenchmarkDisplay* display, displays)
+        {
+            presented += display->getPresentedFrameCount();
+            skipped += display->getSkippedFrameCount();
+        }
+
+        foreach(OpenGLNativeRenderWindow* display, nativeDisplays)
+            skipped += display->getSkippedFrameCount();
+    };
+
+    OpenGLStateCache::OpenGLStateCacheStats stateBegin{};
+
+    auto sumStateCacheStats = [&]()
+    {
+        OpenGLStateCache::OpenGLStateCacheStats sum{};
+
+        for(const OpenGLRenderer* renderer : renderers)
+        {
+            OpenGLStateCache::OpenGLStateCacheStats stats = renderer->getStateCacheStats();
+
+            sum.issuedCalls += stats.issuedCalls;
+            sum.elidedCalls += stats.elidedCalls;
+            sum.contextSwitches += stats.contextSwitches;
+            sum.elidedContextSwitches += stats.elidedContextSwitches;
+        }
+
+        return sum;
+    };
+
+    OpenGLBenchmarkResults results = measure([&]()
+    {
+        producer->renderFrame();
+
+        for(unsigned int paint = 0; paint < benchmarkSpecs.paintsPerFrame; paint++)
+        {
+            foreach(OpenGLBenchmarkDisplay* display, displays)
+                display->renderFrame();
+        }
+
+        if(!nativeDisplays.empty())
+            QCoreApplication::processEvents();
+    },
+    [&]()
+    {
+        readbackFramesBegin = readbackFrames;
+        readbackBytesBegin = readbackBytes;
+
+        sumDisplayCounts(presentedBegin, skippedBegin);
+        stateBegin = sumStateCacheStats();
+
+        //Profilers are created during warmup; drop what they have gathered so far
+        for(const OpenGLRenderer* renderer : renderers)
+        {
+            if(renderer->getProfiler())
+                renderer->getProfiler()->resetStats();
+        }
+    },
+    [&]()
+    {
+        //Drain the GPU so queued work is part of the measured time
+        if(producer->getOpenGLContext()->makeCurrent(producer))
+        {
+            producer->glFinish();
+            producer->getOpenGLContext()->doneCurrent();
+        }
+    });
+
+    if(benchmarkSpecs.readback)
+    {
+        double seconds = benchmarkSpecs.numFrames / std::max(results.framesPerSecond, 1e-9);
+
+        results.metrics.push_back(std::make_pair(QString("readback_fps"), (readbackFrames - readbackFramesBegin) / seconds));
+        results.metrics.push_back(std::make_pair(QString("readback_mb_per_s"), (readbackBytes - readbackBytesBegin) / (1024.0 * 1024.0) / seconds));
+        results.metrics.push_back(std::make_pair(QString("readback_dropped"), static_cast<double>(producer->getDroppedReadbackFrames())));
+    }
+
+    if(benchmarkSpecs.numEffects > 0)
+    {
+        OpenGLRenderGraph::OpenGLRenderGraphStats graphStats = producer->getRenderGraphStats();
+
+        results.metrics.push_back(std::make_pair(QString("graph_passes"), static_cast<double>(graphStats.passes)));
+        results.metrics.push_back(std::make_pair(QString("graph_transients"), static_cast<double>(graphStats.transientTextures)));
+        results.metrics.push_back(std::make_pair(QString("graph_textures"), static_cast<double>(graphStats.physicalTextures)));
+        results.metrics.push_back(std::make_pair(QString("graph_transient_mb"), graphStats.transientBytes / (1024.0 * 1024.0)));
+        results.metrics.push_back(std::make_pair(QString("graph_allocated_mb"), graphStats.allocatedBytes / (1024.0 * 1024.0)));
+    }
+
+    unsigned long long presented, skipped;
+    sumDisplayCounts(presented, skipped);
+
+    results.metrics.push_back(std::make_pair(QString("display_presents"), static_cast<double>(presented - presentedBegin)));
+    results.metrics.push_back(std::make_pair(QString("display_skipped"), static_cast<double>(skipped - skippedBegin)));
+
+    //Per measured frame, summed over every renderer in the pipeline
+    OpenGLStateCache::OpenGLStateCacheStats stateEnd = sumStateCacheStats();
+    double frames = std::max(benchmarkSpecs.numFrames, 1u);
+
+    results.metrics.push_back(std::make_pair(QString("gl_calls_issued"), (stateEnd.issuedCalls - stateBegin.issuedCalls) / frames));
+    results.metrics.push_back(std::make_pair(QString("gl_calls_elided"), (stateEnd.elidedCalls - stateBegin.elidedCalls) / frames));
+    results.metrics.push_back(std::make_pair(QString("context_switches"), (stateEnd.contextSwitches - stateBegin.contextSwitches) / frames));
+    results.metrics.push_back(std::make_pair(QString("context_switches_elided"), (stateEnd.elidedContextSwitches - stateBegin.elidedContextSwitches) / frames));
+
+    if(cache)
+    {
+        results.metrics.push_back(std::make_pair(QString("cache_sizes"), static_cast<double>(cache->getOutputSizeCount())));
+        results.metrics.push_back(std::make_pair(QString("cache_scaled"), static_cast<double>(cache->getScaledOutputCount())));
+    }
+
+    if(benchmarkSpecs.profile)
+        addProfileMetrics(results, renderers, QString("pipeline"));
+
+    foreach(OpenGLBenchmarkDisplay* display, displays)
+        delete display;
+
+    foreach(OpenGLNativeRenderWindow* display, nativeDisplays)
+        delete display;
+
+    if(cache)
+        delete cache;
+
+    delete producer;
+
+    return results;
+}
+
+OpenGLBenchmark::OpenGLBenchmarkResults OpenGLBenchmark::runUpload()
+{
+    const OpenGLRenderer::OpenGLTextureSpecs& frameSpecs = benchmarkSpecs.renderSpecs.frameType;
+
+    OpenGLInputSource* source = new OpenGLInputSource(nullptr,
+                                                      nullptr,
+                                                      benchmarkSpecs.renderSpecs,
+                                                      QSurfaceFormat::defaultFormat(),
+                                                      nullptr,
+                                                      benchmarkSpecs.numOutputBuffers);
+    source->setPersistentMapping(!benchmarkSpecs.orphanUploads);
+
+    //One CPU frame with a non-constant pattern, uploaded over and over
+    std::vector<unsigned char> frame(OpenGLRenderer::getFrameSize(frameSpecs));
+    for(size_t i = 0; i < frame.size(); i++)
+        frame[i] = static_cast<unsigned char>(i * 31);
+
+    unsigned long long uploadedFrames = 0;
+    unsigned long long uploadedFramesBegin = 0;
+    unsigned long long droppedFramesBegin = 0;
+
+    OpenGLBenchmarkResults results = measure([&]()
+    {
+        if(source->uploadFrame(frame.data(), frameSpecs))
+            uploadedFrames++;
+    },
+    [&]()
+    {
+        uploadedFramesBegin = uploadedFrames;
+        droppedFramesBegin = source->getDroppedFrameCount();
+    },
+    [&]()
+    {
+        if(source->getOpenGLContext()->makeCurrent(source))
+        {
+            source->glFinish();
+            source->getOpenGLContext()->doneCurrent();
+        }
+    });
+
+    double seconds = benchmarkSpecs.numFrames / std::max(results.framesPerSecond, 1e-9);
+    double uploaded = static_cast<double>(uploadedFrames - uploadedFramesBegin);
+
+    results.metrics.push_back(std::make_pair(QString("upload_fps"), uploaded / seconds));
+    results.metrics.push_back(std::make_pair(QString("upload_mb_per_s"), uploaded * frame.size() / (1024.0 * 1024.0) / seconds));
+    results.metrics.push_back(std::make_pair(QString("upload_dropped"), static_cast<double>(source->getDroppedFrameCount() - droppedFramesBegin)));
+    results.metrics.push_back(std::make_pair(QString("persistent"), source->isPersistentlyMapped() ? 1.0 : 0.0));
+
+    //Bytes moved per frame against the same frame as RGBA8, which is what decoded video costs without planar upload
+    double rgbaFrameSize = static_cast<double>(frameSpecs.width) * frameSpecs.height * 4;
+
+    results.metrics.push_back(std::make_pair(QString("frame_bytes"), static_cast<double>(frame.size())));
+    results.metrics.push_back(std::make_pair(QString("rgba_ratio"), rgbaFrameSize / frame.size()));
+    results.metrics.push_back(std::make_pair(QString("rgba_saved_mb_per_s"), uploaded * (rgbaFrameSize - frame.size()) / (1024.0 * 1024.0) / seconds));
+
+    delete source;
+
+    return results;
+}
+
+OpenGLBenchmark::OpenGLBenchmarkResults OpenGLBenchmark::runResize()
+{
+    OpenGLRenderSurface* producer = new OpenGLRenderSurface(nullptr,
+                                                            nullptr,
+                                                            benchmarkSpecs.renderSpecs,
+                                                            QSurfaceFormat::defaultFormat(),
+                                                            nullptr,
+                                                            benchmarkSpecs.numOutputBuffers);
+
+    std::vector<OpenGLBenchmarkDisplay*> displays;
+    std::vector<OpenGLNativeRenderWindow*> nativeDisplays;
+
+    createDisplays(producer, nullptr, displays, nativeDisplays);
+
+    std::vector<OpenGLRenderer*> renderers{producer};
+    renderers.insert(renderers.end(), displays.begin(), displays.end());
+    renderers.insert(renderers.end(), nativeDisplays.begin(), nativeDisplays.end());
+
+    //Triangle wave between full and half size; sizes repeat every period so a pool can recycle them
+    const unsigned int period = 64;
+    unsigned int step = 0;
+
+    auto dragSize = [period](unsigned int i, unsigned int full)
+    {
+        unsigned int phase = i % (2 * period);
+        unsigned int t = (phase < period) ? phase : (2 * period - phase);
+
+        return full - (full / 2) * t / period;
+    };
+
+    unsigned long long requestsBegin = 0;
+    unsigned long long resizesBegin = 0;
+    unsigned long long hitsBegin = 0;
+    unsigned long long missesBegin = 0;
+
+    auto sumCounts = [&](unsigned long long& requests, unsigned long long& resizes, unsigned long long& hits, unsigned long long& misses)
+    {
+        requests = resizes = hits = misses = 0;
+
+        for(const OpenGLRenderer* renderer : renderers)
+        {
+            requests += renderer->getResizeRequestCount();
+            resizes += renderer->getResizeCount();
+            hits += renderer->getTexturePoolStats().hits;
+            misses += renderer->getTexturePoolStats().misses;
+        }
+    };
+
+    OpenGLBenchmarkResults results = measure([&]()
+    {
+        for(unsigned int i = 0; i < benchmarkSpecs.resizesPerFrame; i++, step++)
+        {
+            unsigned int width = dragSize(step, benchmarkSpecs.renderSpecs.frameType.width);
+            unsigned int height = dragSize(step, benchmarkSpecs.renderSpecs.frameType.height);
+
+            for(OpenGLRenderer* renderer : renderers)
+                renderer->resize(width, height);
+        }
+
+        producer->renderFrame();
+
+        foreach(OpenGLBenchmarkDisplay* display, displays)
+            display->renderFrame();
+
+        if(!nativeDisplays.empty())
+            QCoreApplication::processEvents();
+    },
+    [&]()
+    {
+        sumCounts(requestsBegin, resizesBegin, hitsBegin, missesBegin);
+    },
+    [&]()
+    {
+        if(producer->getOpenGLContext()->makeCurrent(producer))
+        {
+            producer->glFinish();
+            producer->getOpenGLContext()->doneCurrent();
+        }
+    });
+
+    unsigned long long requests, resizes, hits, misses;
+    sumCounts(requests, resizes, hits, misses);
+
+    size_t poolBytes = 0;
+    for(const OpenGLRenderer* renderer : renderers)
+        poolBytes += renderer->getTexturePoolStats().bytes;
+
+    results.metrics.push_back(std::make_pair(QString("resize_requests"), static_cast<double>(requests - requestsBegin)));
+    results.metrics.push_back(std::make_pair(QString("resizes"), static_cast<double>(resizes - resizesBegin)));
+    results.metrics.push_back(std::make_pair(QString("pool_hits"), static_cast<double>(hits - hitsBegin)));
+    results.metrics.push_back(std::make_pair(QString("pool_misses"), static_cast<double>(misses - missesBegin)));
+    results.metrics.push_back(std::make_pair(QString("pool_mb"), poolBytes / (1024.0 * 1024.0)));
+
+    foreach(OpenGLBenchmarkDisplay* display, displays)
+        delete display;
+
+    foreach(OpenGLNativeRenderWindow* display, nativeDisplays)
+        delete display;
+
+    delete producer;
+
+    return results;
+}
+
+OpenGLBenchmark::OpenGLBenchmarkResults OpenGLBenchmark::runStartup()
+{
+    QString directory = benchmarkSpecs.programCacheDirectory.isEmpty() ? QDir::tempPath() + QString("/WinGLBenchmark/programs") :
+                                                                         benchmarkSpecs.programCacheDirectory;
+
+    //Every run gets a new share group, so programs only carry over between runs through the disk
+    auto startup = [&]()
+    {
+        std::chrono::time_point<std::chrono::high_resolution_clock> t_start = std::chrono::high_resolution_clock::now();
+
+        OpenGLRenderSurface* producer = new OpenGLRenderSurface(nullptr,
+                                                                nullptr,
+                                                                benchmarkSpecs.renderSpecs,
+                                                                QSurfaceFormat::defaultFormat(),
+                                                                nullptr,
+                                                                benchmarkSpecs.numOutputBuffers);
+
+        for(unsigned int i = 0; i < benchmarkSpecs.numEffects; i++)
+            producer->addEffect(QString(":/GLSL/passFragment.glsl"));
+
+        std::vector<OpenGLBenchmarkDisplay*> displays;
+        std::vector<OpenGLNativeRenderWindow*> nativeDisplays;
+
+        createDisplays(producer, nullptr, displays, nativeDisplays);
+
+        producer->renderFrame();
+
+        foreach(OpenGLBenchmarkDisplay* display, displays)
+            display->renderFrame();
+
+        if(!nativeDisplays.empty())
+            QCoreApplication::processEvents();
+
+        if(producer->getOpenGLContext()->makeCurrent(producer))
+        {
+            producer->glFinish();
+            producer->getOpenGLContext()->doneCurrent();
+        }
+
+        std::chrono::duration<double,std::milli> t_startup = std::chrono::high_resolution_clock::now() - t_start;
+
+        foreach(OpenGLBenchmarkDisplay* display, displays)
+            delete display;
+
+        foreach(OpenGLNativeRenderWindow* display, nativeDisplays)
+            delete display;
+
+        delete producer;
+
+        return t_startup.count();
+    };
+
+    auto meanOf = [](const std::vector<double>& times)
+    {
+        double sum = 0.0;
+        for(double time : times)
+            sum += time;
+
+        return times.empty() ? 0.0 : sum / times.size();
+    };
+
+    std::vector<double> noCacheTimes;
+    std::vector<double> coldTimes;
+    std::vector<double> warmTimes;
+
+    //Every program compiled by every renderer, as before the cache
+    OpenGLProgramCache::setSharingEnabled(false);
+    OpenGLProgramCache::setCacheDirectory(QString());
+
+    for(unsigned int i = 0; i < benchmarkSpecs.numStartupRuns; i++)
+        noCacheTimes.push_back(startup());
+
+    //Programs shared within the group, binaries written to an empty directory
+    OpenGLProgramCache::setSharingEnabled(true);
+    OpenGLProgramCache::setCacheDirectory(directory);
+
+    for(unsigned int i = 0; i < benchmarkSpecs.numStartupRuns; i++)
+    {
+        QDir(directory).removeRecursively();
+        coldTimes.push_back(startup());
+    }
+
+    //Binaries loaded from the directory the last cold run filled
+    OpenGLProgramCache::resetStats();
+
+    std::chrono::time_point<std::chrono::high_resolution_clock> t_begin = std::chrono::high_resolution_clock::now();
+    unsigned long long allocationsBegin = allocationCount();
+
+    for(unsigned int i = 0; i < benchmarkSpecs.numStartupRuns; i++)
+        warmTimes.push_back(startup());
+
+    std::chrono::duration<double,std::milli> t_total = std::chrono::high_resolution_clock::now() - t_begin;
+
+    OpenGLProgramCache::OpenGLProgramCacheStats stats = OpenGLProgramCache::getStats();
+
+    OpenGLBenchmarkResults results = summarize(warmTimes, t_total.count(), allocationCount() - allocationsBegin);
+
+    results.metrics.push_back(std::make_pair(QString("nocache_ms"), meanOf(noCacheTimes)));
+    results.metrics.push_back(std::make_pair(QString("cold_ms"), meanOf(coldTimes)));
+    results.metrics.push_back(std::make_pair(QString("warm_ms"), meanOf(warmTimes)));
+    results.metrics.push_back(std::make_pair(QString("warm_compiles"), static_cast<double>(stats.compiles)));
+    results.metrics.push_back(std::make_pair(QString("warm_disk_hits"), static_cast<double>(stats.diskHits)));
+    results.metrics.push_back(std::make_pair(QString("warm_shared_hits"), static_cast<double>(stats.sharedHits)));
+    results.metrics.push_back(std::make_pair(QString("warm_disk_rejects"), static_cast<double>(stats.diskRejects)));
+    results.metrics.push_back(std::make_pair(QString("warm_load_ms"), stats.loadTime));
+
+    return results;
+}
+
+OpenGLBenchmark::OpenGLBenchmarkResults OpenGLBenchmark::runMailbox()
+{
+    OpenGLRenderSurface* producer = new OpenGLRenderSurface(nullptr,
+                                                            nullptr,
+                                                            benchmarkSpecs.renderSpecs,
+                                                            QSurfaceFormat::defaultFormat(),
+                                                            nullptr,
+                                                            benchmarkSpecs.numOutputBuffers);
+
+    //Consumers only stand in for a display stuck in a swap; they never touch GL
+    std::chrono::duration<double,std::milli> consumerDelay(benchmarkSpecs.consumerDelay);
+
+    QThread* signalThread = new QThread();
+    QObject* signalConsumer = new QObject();
+    signalConsumer->moveToThread(signalThread);
+
+    QThread* mailboxThread = new QThread();
+    QObject* mailboxConsumer = new QObject();
+    mailboxConsumer->moveToThread(mailboxThread);
+
+    //Queued signals: every frame becomes an event, so the backlog is emitted - handled
+    std::atomic<unsigned long long> signalsEmitted(0);
+    std::atomic<unsigned long long> signalsHandled(0);
+    unsigned long long maxSignalBacklog = 0;
+
+    QObject::connect(producer,&OpenGLRenderSurface::frameReady,signalConsumer,[&](OpenGLOutputRing::OpenGLOutputFrame)
+    {
+        std::this_thread::sleep_for(consumerDelay);
+        signalsHandled.fetch_add(1);
+    },Qt::QueuedConnection);
+
+    QObject::connect(producer,&OpenGLRenderSurface::frameReady,[&](OpenGLOutputRing::OpenGLOutputFrame)
+    {
+        unsigned long long backlog = signalsEmitted.fetch_add(1) + 1 - signalsHandled.load();
+        maxSignalBacklog = std::max(maxSignalBacklog, backlog);
+    });
+
+    //Mailbox: at most one wake-up outstanding, the consumer takes whatever is newest
+    OpenGLFrameMailbox* mailbox = new OpenGLFrameMailbox();
+    std::atomic<unsigned long long> mailboxTaken(0);
+    int reader = -1;
+
+    reader = mailbox->addReader([&]()
+    {
+        QMetaObject::invokeMethod(mailboxConsumer,[&]()
+        {
+            OpenGLFrameMailbox::OpenGLFrameDescriptor frame;
+            if(mailbox->takeFrame(reader, frame))
+            {
+                std::this_thread::sleep_for(consumerDelay);
+                mailboxTaken.fetch_add(1);
+
+                OpenGLOutputRing::release(frame.frame);
+            }
+        },Qt::QueuedConnection);
+    });
+
+    QObject::connect(producer,&OpenGLRenderSurface::frameReady,mailbox,&OpenGLFrameMailbox::publish,Qt::DirectConnection);
+
+    signalThread->start();
+    mailboxThread->start();
+
+    unsigned long long publishedBegin = 0;
+    unsigned long long droppedBegin = 0;
+    unsigned long long takenBegin = 0;
+
+    OpenGLBenchmarkResults results = measure([&]()
+    {
+        producer->renderFrame();
+    },
+    [&]()
+    {
+        publishedBegin = mailbox->getPublishedCount();
+        droppedBegin = mailbox->getDroppedFrameCount(reader);
+        takenBegin = mailboxTaken.load();
+        maxSignalBacklog = 0;
+    },
+    [&]()
+    {
+        if(producer->getOpenGLContext()->makeCurrent(producer))
+        {
+            producer->glFinish();
+            producer->getOpenGLContext()->doneCurrent();
+        }
+    });
+
+    //Whatever the signal consumer has not got to yet is still queued; quitting drops it
+    unsigned long long signalBacklog = signalsEmitted.load() - signalsHandled.load();
+
+    signalThread->quit();
+    mailboxThread->quit();
+    signalThread->wait();
+    mailboxThread->wait();
+
+    results.metrics.push_back(std::make_pair(QString("consumer_delay_ms"), benchmarkSpecs.consumerDelay));
+    results.metrics.push_back(std::make_pair(QString("signal_max_backlog"), static_cast<double>(maxSignalBacklog)));
+    results.metrics.push_back(std::make_pair(QString("signal_final_backlog"), static_cast<double>(signalBacklog)));
+    results.metrics.push_back(std::make_pair(QString("mailbox_max_pending"), static_cast<double>(mailbox->getMaxPendingWakeCount(reader))));
+    results.metrics.push_back(std::make_pair(QString("mailbox_published"), static_cast<double>(mailbox->getPublishedCount() - publishedBegin)));
+    results.metrics.push_back(std::make_pair(QString("mailbox_taken"), static_cast<double>(mailboxTaken.load() - takenBegin)));
+    results.metrics.push_back(std::make_pair(QString("mailbox_dropped"), static_cast<double>(mailbox->getDroppedFrameCount(reader) - droppedBegin)));
+
+    //The mailbox never queues a second wake-up for a reader, however slow it is
+    if(mailbox->getMaxPendingWakeCount(reader) > 1)
+        results.failures.push_back(QString("mailbox_max_pending=%1, expected at most 1").arg(mailbox->getMaxPendingWakeCount(reader)));
+
+    delete signalConsumer;
+    delete mailboxConsumer;
+    delete signalThread;
+    delete mailboxThread;
+
+    delete mailbox;
+    delete producer;
+
+    return results;
+}
+
+OpenGLBenchmark::OpenGLBenchmarkResults OpenGLBenchmark::runPresent()
+{
+    //Only offscreen displays; native ones are presented by MainWindow's pool the same way
+    OpenGLBenchmarkSpecs specs = benchmarkSpecs;
+    specs.nativeDisplays = false;
+    specs.outputCache = false;
+
+    OpenGLBenchmark presentBenchmark(specs);
+
+    auto sumPresented = [](const std::vector<OpenGLBenchmarkDisplay*>& displays)
+    {
+        unsigned long long presented = 0;
+        foreach(OpenGLBenchmarkDisplay* display, displays)
+            presented += display->getPresentedFrameCount();
+
+        return presented;
+    };
+
+    //Inline: every display presents on the producer's thread, so each blocking swap holds up the next frame
+    double inlineFPS = 0.0;
+    double inlinePresentsPerSecond = 0.0;
+    {
+        OpenGLRenderSurface* producer = new OpenGLRenderSurface(nullptr,
+                                                                nullptr,
+                                                                specs.renderSpecs,
+                                                                QSurfaceFormat::defaultFormat(),
+                                                                nullptr,
+                                                                specs.numOutputBuffers);
+
+        std::vector<OpenGLBenchmarkDisplay*> displays;
+        std::vector<OpenGLNativeRenderWindow*> nativeDisplays;
+
+        presentBenchmark.createDisplays(producer, nullptr, displays, nativeDisplays);
+
+        foreach(OpenGLBenchmarkDisplay* display, displays)
+            display->setSwapDelay(specs.swapDelay);
+
+        unsigned long long presentedBegin = 0;
+
+        OpenGLBenchmarkResults inlineResults = presentBenchmark.measure([&]()
+        {
+            producer->renderFrame();
+
+            foreach(OpenGLBenchmarkDisplay* display, displays)
+                display->renderFrame();
+        },
+        [&]()
+        {
+            presentedBegin = sumPresented(displays);
+        },
+        [&]()
+        {
+            if(producer->getOpenGLContext()->makeCurrent(producer))
+            {
+                producer->glFinish();
+                producer->getOpenGLContext()->doneCurrent();
+            }
+        });
+
+        inlineFPS = inlineResults.framesPerSecond;
+        inlinePresentsPerSecond = inlineResults.framesPerSecond * (sumPresented(displays) - presentedBegin) / specs.numFrames;
+
+        foreach(OpenGLBenchmarkDisplay* display, displays)
+            delete display;
+
+        delete producer;
+    }
+
+    //Threaded: displays take the newest frame from a mailbox on their own threads; the producer never waits for them
+    OpenGLRenderSurface* producer = new OpenGLRenderSurface(nullptr,
+                                                            nullptr,
+                                                            specs.renderSpecs,
+                                                            QSurfaceFormat::defaultFormat(),
+                                                            nullptr,
+                                                            specs.numOutputBuffers);
+
+    std::vector<OpenGLBenchmarkDisplay*> displays;
+    std::vector<OpenGLNativeRenderWindow*> nativeDisplays;
+
+    presentBenchmark.createDisplays(producer, nullptr, displays, nativeDisplays);
+
+    //One reader per display, however many the benchmark asks for
+    OpenGLFrameMailbox* mailbox = new OpenGLFrameMailbox(nullptr, 0, 0, std::max(static_cast<unsigned int>(displays.size()), 1u));
+    QObject::connect(producer,&OpenGLRenderSurface::frameReady,mailbox,&OpenGLFrameMailbox::publish,Qt::DirectConnection);
+
+    OpenGLPresenterPool* pool = new OpenGLPresenterPool(nullptr, specs.numPresenterThreads);
+
+    foreach(OpenGLBenchmarkDisplay* display, displays)
+    {
+        //Frames come from the mailbox instead of the producer's signal
+        QObject::disconnect(producer, nullptr, display, nullptr);
+
+        display->setSwapDelay(specs.swapDelay);
+        display->setFrameMailbox(mailbox);
+
+        pool->addDisplay(display);
+    }
+
+    pool->start();
+
+    unsigned long long presentedBegin = 0;
+    unsigned long long droppedBegin = 0;
+    std::chrono::time_point<std::chrono::high_resolution_clock> t_begin;
+
+    OpenGLBenchmarkResults results = presentBenchmark.measure([&]()
+    {
+        producer->renderFrame();
+    },
+    [&]()
+    {
+        presentedBegin = sumPresented(displays);
+        droppedBegin = mailbox->getDroppedFrameCount();
+        t_begin = std::chrono::high_resolution_clock::now();
+    },
+    [&]()
+    {
+        if(producer->getOpenGLContext()->makeCurrent(producer))
+        {
+            producer->glFinish();
+            producer->getOpenGLContext()->doneCurrent();
+        }
+    });
+
+    std::chrono::duration<double> t_total = std::chrono::high_resolution_clock::now() - t_begin;
+
+    unsigned long long presented = sumPresented(displays) - presentedBegin;
+    unsigned long long dropped = mailbox->getDroppedFrameCount() - droppedBegin;
+
+    pool->stop();
+
+    results.metrics.push_back(std::make_pair(QString("presenter_threads"), static_cast<double>(pool->getThreadCount())));
+    results.metrics.push_back(std::make_pair(QString("swap_delay_ms"), specs.swapDelay));
+    results.metrics.push_back(std::make_pair(QString("presents_per_s"), (t_total.count() > 0.0) ? presented / t_total.count() : 0.0));
+    results.metrics.push_back(std::make_pair(QString("dropped"), static_cast<double>(dropped)));
+    results.metrics.push_back(std::make_pair(QString("inline_fps"), inlineFPS));
+    results.metrics.push_back(std::make_pair(QString("inline_presents_per_s"), inlinePresentsPerSecond));
+
+    //The presentation threads are gone; nothing else touches the displays' contexts
+    foreach(OpenGLBenchmarkDisplay* display, displays)
+        delete display;
+
+    delete pool;
+    delete mailbox;
+    delete producer;
+
+    return results;
+}
+
+OpenGLBenchmark::OpenGLBenchmarkResults OpenGLBenchmark::runQuads()
+{
+    OpenGLRenderSurface* producer = new OpenGLRenderSurface(nullptr,
+                                                            nullptr,
+                                                            benchmarkSpecs.renderSpecs,
+                                                            QSurfaceFormat::defaultFormat(),
+                                                            nullptr,
+                                                            benchmarkSpecs.numOutputBuffers);
+
+    if(benchmarkSpecs.profile)
+        producer->setProfilingEnabled(true, QString("producer"));
+
+    producer->setOverlaySortEnabled(!benchmarkSpecs.unsortedQuads);
+
+    const unsigned int width = benchmarkSpecs.renderSpecs.frameType.width;
+    const unsigned int height = benchmarkSpecs.renderSpecs.frameType.height;
+
+    //Fixed pseudo random layout so every run draws the same thing
+    std::vector<OpenGLQuadBatch::OpenGLQuad> layout(benchmarkSpecs.numQuads);
+
+    unsigned int seed = 12345;
+    auto random = [&seed]()
+    {
+        seed = seed * 1664525u + 1013904223u;
+        return (seed >> 8) / 16777216.0f;
+    };
+
+    for(OpenGLQuadBatch::OpenGLQuad& quad : layout)
+    {
+        GLfloat size = 4.0f + 28.0f * random();
+
+        quad = OpenGLQuadBatch::OpenGLQuad{random() * width, random() * height, size, size,
+                                           0.0f, 0.0f, 1.0f, 1.0f,
+                                           random(), random(), random(), 0.75f};
+    }
+
+    //Textures are created on the render context the first time the overlay runs
+    std::vector<GLuint> textures;
+
+    producer->setOverlay([&](OpenGLQuadBatch& batch)
+    {
+        if(textures.empty())
+        {
+            QOpenGLExtraFunctions* f = QOpenGLContext::currentContext()->extraFunctions();
+
+            std::vector<unsigned char> pixels(64 * 64 * 4, 255);
+
+            textures.resize(std::max(benchmarkSpecs.numQuadTextures, 1u));
+            f->glGenTextures(static_cast<GLsizei>(textures.size()), textures.data());
+
+            for(GLuint texture : textures)
+            {
+                f->glBindTexture(GL_TEXTURE_2D, texture);
+                f->glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 64, 64, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+                f->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+                f->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            }
+
+            f->glBindTexture(GL_TEXTURE_2D, 0);
+        }
+
+        //Neighbouring quads use different textures, the worst case for an unsorted batch
+        for(size_t i = 0; i < layout.size(); i++)
+            batch.addQuad(textures[i % textures.size()], layout[i]);
+    });
+
+    OpenGLBenchmarkResults results = measure([&]()
+    {
+        producer->renderFrame();
+    },
+    [&]()
+    {
+        producer->resetOverlayStats();
+        producer->resetStreamBufferStats();
+
+        if(producer->getProfiler())
+            producer->getProfiler()->resetStats();
+    },
+    [&]()
+    {
+        if(producer->getOpenGLContext()->makeCurrent(producer))
+        {
+            producer->glFinish();
+            producer->getOpenGLContext()->doneCurrent();
+        }
+    });
+
+    OpenGLQuadBatch::OpenGLQuadBatchStats stats = producer->getOverlayStats();
+
+    double frames = std::max(static_cast<double>(stats.batches), 1.0);
+    double seconds = benchmarkSpecs.numFrames / std::max(results.framesPerSecond, 1e-9);
+
+    results.metrics.push_back(std::make_pair(QString("quads"), stats.quads / frames));
+    results.metrics.push_back(std::make_pair(QString("textures"), static_cast<double>(textures.size())));
+    results.metrics.push_back(std::make_pair(QString("sorted"), benchmarkSpecs.unsortedQuads ? 0.0 : 1.0));
+    results.metrics.push_back(std::make_pair(QString("draw_calls"), stats.drawCalls / frames));
+    results.metrics.push_back(std::make_pair(QString("texture_binds"), stats.textureBinds / frames));
+    results.metrics.push_back(std::make_pair(QString("program_binds"), stats.programBinds / frames));
+    results.metrics.push_back(std::make_pair(QString("mquads_per_s"), stats.quads / seconds / 1e6));
+    results.metrics.push_back(std::make_pair(QString("upload_mb_per_s"), stats.uploadedBytes / (1024.0 * 1024.0) / seconds));
+    results.metrics.push_back(std::make_pair(QString("ring_waits"), static_cast<double>(stats.ringWaits)));
+
+    //Uniform uploads and bindings through the surface's stream buffer
+    OpenGLStreamBuffer::OpenGLStreamBufferStats streamStats = producer->getStreamBufferStats();
+
+    results.metrics.push_back(std::make_pair(QString("uniform_uploads"), streamStats.allocations / frames));
+    results.metrics.push_back(std::make_pair(QString("uniform_uploads_elided"), streamStats.elidedUploads / frames));
+    results.metrics.push_back(std::make_pair(QString("uniform_binds"), streamStats.bindings / frames));
+    results.metrics.push_back(std::make_pair(QString("uniform_binds_elided"), streamStats.elidedBindings / frames));
+    results.metrics.push_back(std::make_pair(QString("stream_waits"), static_cast<double>(streamStats.ringWaits)));
+    results.metrics.push_back(std::make_pair(QString("stream_orphans"), static_cast<double>(streamStats.orphans)));
+
+    if(benchmarkSpecs.profile)
+        addProfileMetrics(results, {producer}, QString("quads"));
+
+    if(!textures.empty() && producer->getOpenGLContext()->makeCurrent(producer))
+    {
+        producer->glDeleteTextures(static_cast<GLsizei>(textures.size()), textures.data());
+        producer->getOpenGLContext()->doneCurrent();
+    }
+
+    delete producer;
+
+    return results;
+}
+
+OpenGLBenchmark::OpenGLBenchmarkResults OpenGLBenchmark::runTransforms()
+{
+    //The producer only provides a context for the matrix buffer; it never renders here
+    OpenGLRenderSurface* producer = new OpenGLRenderSurface(nullptr,
+                                                            nullptr,
+                                                            benchmarkSpecs.renderSpecs,
+                                                            QSurfaceFormat::defaultFormat(),
+                                                            nullptr,
+                                                            benchmarkSpecs.numOutputBuffers);
+
+    const unsigned int count = benchmarkSpecs.numTransforms;
+
+    //Fixed pseudo random scene so every run computes the same thing
+    auto createScene = [count](OpenGLTransformSystem& system)
+    {
+        unsigned int seed = 12345;
+        auto random = [&seed]()
+        {
+            seed = seed * 1664525u + 1013904223u;
+            return (seed >> 8) / 16777216.0f;
+        };
+
+        system.resize(count);
+
+        for(unsigned int i = 0; i < count; i++)
+        {
+            float angle = 6.2831853f * random();
+
+            system.setPosition(i, 200.0f * random() - 100.0f, 200.0f * random() - 100.0f, -200.0f * random());
+            system.setRotation(i, 0.0f, std::sin(angle / 2.0f), 0.0f, std::cos(angle / 2.0f));
+            system.setScale(i, 0.5f + random(), 0.5f + random(), 0.5f + random());
+        }
+    };
+
+    OpenGLTransformSystem transforms;
+    createScene(transforms);
+
+    QMatrix4x4 viewProjection;
+    viewProjection.perspective(60.0f,
+                               static_cast<float>(benchmarkSpecs.renderSpecs.frameType.width) / benchmarkSpecs.renderSpecs.frameType.height,
+                               0.1f,
+                               1000.0f);
+    viewProjection.translate(0.0f, 0.0f, -50.0f);
+
+    //CPU-only variants, timed over the same number of frames as the main run
+    std::vector<float> matrices(static_cast<size_t>(count) * 16);
+
+    auto throughput = [&](bool simd, unsigned int workers)
+    {
+        OpenGLTransformSystem variant(workers);
+        createScene(variant);
+        variant.setSimdEnabled(simd);
+
+        for(unsigned int i = 0; i < benchmarkSpecs.numWarmupFrames; i++)
+            variant.update(viewProjection, matrices.data());
+
+        std::chrono::time_point<std::chrono::high_resolution_clock> t_start = std::chrono::high_resolution_clock::now();
+
+        for(unsigned int i = 0; i < benchmarkSpecs.numFrames; i++)
+            variant.update(viewProjection, matrices.data());
+
+        std::chrono::duration<double> t_total = std::chrono::high_resolution_clock::now() - t_start;
+
+        return static_cast<double>(count) * benchmarkSpecs.numFrames / std::max(t_total.count(), 1e-9) / 1e6;
+    };
+
+    double scalarSingle = throughput(false, 1);
+    double simdSingle = throughput(true, 1);
+    double scalarThreaded = throughput(false, 0);
+    double simdThreaded = throughput(true, 0);
+
+    //Main run: SIMD, all workers, written straight into a mapped buffer of the producer's context
+    GLuint bufferID = 0;
+    unsigned int mapFailures = 0;
+
+    if(!producer->getOpenGLContext()->makeCurrent(producer))
+    {
+        delete producer;
+        return OpenGLBenchmarkResults();
+    }
+
+    QOpenGLExtraFunctions* f = QOpenGLContext::currentContext()->extraFunctions();
+
+    f->glGenBuffers(1, &bufferID);
+    f->glBindBuffer(GL_ARRAY_BUFFER, bufferID);
+    f->glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(matrices.size() * sizeof(GLfloat)), nullptr, GL_STREAM_DRAW);
+    f->glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    OpenGLBenchmarkResults results = measure([&]()
+    {
+        if(!transforms.updateBuffer(f, GL_ARRAY_BUFFER, bufferID, viewProjection))
+            mapFailures++;
+    },
+    [&]()
+    {
+        mapFailures = 0;
+    },
+    [&]()
+    {
+        f->glFinish();
+    });
+
+    f->glDeleteBuffers(1, &bufferID);
+    producer->getOpenGLContext()->doneCurrent();
+
+    results.metrics.push_back(std::make_pair(QString("transforms"), static_cast<double>(count)));
+    results.metrics.push_back(std::make_pair(QString("workers"), static_cast<double>(transforms.getWorkerCount())));
+    results.metrics.push_back(std::make_pair(QString("mtransforms_per_s"), count * results.framesPerSecond / 1e6));
+    results.metrics.push_back(std::make_pair(QString("scalar_1t_mtransforms_per_s"), scalarSingle));
+    results.metrics.push_back(std::make_pair(QString(transforms.getSimdName()) + QString("_1t_mtransforms_per_s"), simdSingle));
+    results.metrics.push_back(std::make_pair(QString("scalar_mt_mtransforms_per_s"), scalarThreaded));
+    results.metrics.push_back(std::make_pair(QString(transforms.getSimdName()) + QString("_mt_mtransforms_per_s"), simdThreaded));
+    results.metrics.push_back(std::make_pair(QString("map_failures"), static_cast<double>(mapFailures)));
+
+    delete producer;
+
+    return results;
+}
+
+OpenGLBenchmark::OpenGLBenchmarkResults OpenGLBenchmark::runKernels()
+{
+    const unsigned int width = benchmarkSpecs.renderSpecs.frameType.width;
+    const unsigned int height = benchmarkSpecs.renderSpecs.frameType.height;
+
+    const size_t pixels = static_cast<size_t>(width) * height;
+
+    auto specs = [width, height](GLenum format, GLenum dataType, OpenGLRenderer::OpenGLPlaneLayout planeLayout)
+    {
+        OpenGLRenderer::OpenGLTextureSpecs textureSpecs = {width, height, 4, GL_TEXTURE_2D, GL_RGBA8, format, dataType, planeLayout, OpenGLRenderer::OpenGLColorBT709, false};
+        if(dataType == GL_UNSIGNED_SHORT)
+            textureSpecs.internalFormat = GL_RGBA16;
+        return textureSpecs;
+    };
+
+    const OpenGLRenderer::OpenGLTextureSpecs rgba8 = specs(GL_RGBA, GL_UNSIGNED_BYTE, OpenGLRenderer::OpenGLPlanesPacked);
+    const OpenGLRenderer::OpenGLTextureSpecs bgra8 = specs(GL_BGRA, GL_UNSIGNED_BYTE, OpenGLRenderer::OpenGLPlanesPacked);
+    const OpenGLRenderer::OpenGLTextureSpecs rgba16 = specs(GL_RGBA, GL_UNSIGNED_SHORT, OpenGLRenderer::OpenGLPlanesPacked);
+    const OpenGLRenderer::OpenGLTextureSpecs nv12 = specs(GL_RED, GL_UNSIGNED_BYTE, OpenGLRenderer::OpenGLPlanesNV12);
+    const OpenGLRenderer::OpenGLTextureSpecs i420 = specs(GL_RED, GL_UNSIGNED_BYTE, OpenGLRenderer::OpenGLPlanesI420);
+
+    //Fixed pseudo random frames, 16 bit so the narrowing kernel sees every value
+    std::vector<unsigned char> source(OpenGLRenderer::getFrameSize(rgba16));
+
+    unsigned int seed = 12345;
+    for(unsigned char& value : source)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        value = static_cast<unsigned char>(seed >> 24);
+    }
+
+    std::vector<unsigned char> reference(source.size());
+    std::vector<unsigned char> output(source.size());
+
+    typedef struct Kernel
+    {
+        const char* name;
+        const OpenGLRenderer::OpenGLTextureSpecs* srcSpecs;
+        const OpenGLRenderer::OpenGLTextureSpecs* dstSpecs;
+    }
+    Kernel;
+
+    //A null destination premultiplies the source specs in place
+    const Kernel kernels[] = {{"swizzle", &rgba8, &bgra8},
+                              {"widen", &rgba8, &rgba16},
+                              {"narrow", &rgba16, &rgba8},
+                              {"nv12", &rgba8, &nv12},
+                              {"i420", &bgra8, &i420},
+                              {"premultiply", &rgba8, nullptr}};
+
+    auto run = [&](OpenGLPixelKernels& pixelKernels, const Kernel& kernel, std::vector<unsigned char>& dst)
+    {
+        if(kernel.dstSpecs)
+        {
+            pixelKernels.convert(source.data(), *kernel.srcSpecs, dst.data(), *kernel.dstSpecs);
+            return;
+        }
+
+        std::copy(source.begin(), source.begin() + OpenGLRenderer::getFrameSize(*kernel.srcSpecs), dst.begin());
+        pixelKernels.premultiply(dst.data(), *kernel.srcSpecs);
+    };
+
+    auto throughput = [&](const Kernel& kernel, OpenGLPixelKernels::OpenGLKernelISA isa, unsigned int workers)
+    {
+        OpenGLPixelKernels pixelKernels(workers);
+        pixelKernels.setISA(isa);
+
+        for(unsigned int i = 0; i < benchmarkSpecs.numWarmupFrames; i++)
+            run(pixelKernels, kernel, output);
+
+        std::chrono::time_point<std::chrono::high_resolution_clock> t_start = std::chrono::high_resolution_clock::now();
+
+        for(unsigned int i = 0; i < benchmarkSpecs.numFrames; i++)
+            run(pixelKernels, kernel, output);
+
+        std::chrono::duration<double> t_total = std::chrono::high_resolution_clock::now() - t_start;
+
+        return static_cast<double>(pixels) * benchmarkSpecs.numFrames / std::max(t_total.count(), 1e-9) / 1e6;
+    };
+
+    const OpenGLPixelKernels::OpenGLKernelISA widest = OpenGLPixelKernels::detectISA();
+
+    std::vector<std::pair<QString,double>> kernelMetrics;
+    unsigned int mismatches = 0;
+
+    for(const Kernel& kernel : kernels)
+    {
+        //Every SIMD result has to match the scalar reference byte for byte
+        OpenGLPixelKernels check(1);
+        check.setISA(OpenGLPixelKernels::OpenGLKernelScalar);
+        run(check, kernel, reference);
+
+        for(int isa = OpenGLPixelKernels::OpenGLKernelScalar; isa <= widest; isa++)
+        {
+            OpenGLPixelKernels::OpenGLKernelISA kernelISA = static_cast<OpenGLPixelKernels::OpenGLKernelISA>(isa);
+
+            check.setISA(kernelISA);
+            std::fill(output.begin(), output.end(), 0);
+            run(check, kernel, output);
+
+            if(output != reference)
+            {
+                std::fprintf(stderr, "%s %s differs from scalar\n", kernel.name, OpenGLPixelKernels::getISAName(kernelISA));
+                mismatches++;
+            }
+
+            kernelMetrics.push_back(std::make_pair(QString(kernel.name) + QString("_") + QString(OpenGLPixelKernels::getISAName(kernelISA)) + QString("_1t_mpixels_per_s"),
+                                                   throughput(kernel, kernelISA, 1)));
+        }
+
+        kernelMetrics.push_back(std::make_pair(QString(kernel.name) + QString("_") + QString(OpenGLPixelKernels::getISAName(widest)) + QString("_mt_mpixels_per_s"),
+                                               throughput(kernel, widest, 0)));
+    }
+
+    //Main run: the readback path of an encoder, RGBA8 frames to NV12 on every worker
+    OpenGLPixelKernels pixelKernels;
+
+    OpenGLBenchmarkResults results = measure([&]()
+    {
+        pixelKernels.convert(source.data(), rgba8, output.data(), nv12);
+    },
+    []()
+    {
+    },
+    []()
+    {
+    });
+
+    results.metrics.push_back(std::make_pair(QString("isa"), static_cast<double>(widest)));
+    results.metrics.push_back(std::make_pair(QString("workers"), static_cast<double>(pixelKernels.getWorkerCount())));
+    results.metrics.push_back(std::make_pair(QString("nv12_mpixels_per_s"), pixels * results.framesPerSecond / 1e6));
+    results.metrics.insert(results.metrics.end(), kernelMetrics.begin(), kernelMetrics.end());
+    results.metrics.push_back(std::make_pair(QString("mismatches"), static_cast<double>(mismatches)));
+
+    return results;
+}
+
+OpenGLBenchmark::OpenGLBenchmarkResults OpenGLBenchmark::runOffline()
+{
+    OpenGLRenderSurface* producer = new OpenGLRenderSurface(nullptr,
+                                                            nullptr,
+                                                            benchmarkSpecs.renderSpecs,
+                                                            QSurfaceFormat::defaultFormat(),
+                                                            nullptr,
+                                                            benchmarkSpecs.numOutputBuffers);
+
+    QString directory = benchmarkSpecs.outputDirectory.isEmpty() ? QDir::tempPath() + QString("/WinGLBenchmark/offline") :
+                                                                   benchmarkSpecs.outputDirectory;
+
+    //Warm up without writing; the offline run restarts the animation anyway
+    producer->renderOffline(benchmarkSpecs.numWarmupFrames, nullptr);
+
+    std::vector<double> frameTimes;
+    frameTimes.reserve(benchmarkSpecs.numFrames);
+
+    std::chrono::time_point<std::chrono::high_resolution_clock> t_lastFrame;
+    bool firstFrame = true;
+
+    //Both signals are emitted on the producer's thread, inside renderOffline
+    QObject::connect(producer,&OpenGLRenderSurface::frameReady,[&]()
+    {
+        std::chrono::time_point<std::chrono::high_resolution_clock> t_frame = std::chrono::high_resolution_clock::now();
+
+        if(!firstFrame)
+            frameTimes.push_back(std::chrono::duration<double,std::milli>(t_frame - t_lastFrame).count());
+
+        firstFrame = false;
+        t_lastFrame = t_frame;
+    });
+
+    //FNV-1a of every frame, per run
+    std::vector<unsigned long long> hashes[2];
+    unsigned int run = 0;
+
+    QObject::connect(producer,&OpenGLRenderSurface::frameRead,[&](const unsigned char* data, size_t size)
+    {
+        unsigned long long hash = 14695981039346656037ull;
+        for(size_t i = 0; i < size; i++)
+            hash = (hash ^ data[i]) * 1099511628211ull;
+
+        hashes[run].push_back(hash);
+    });
+
+    OpenGLFrameWriter writer(directory);
+
+    unsigned long long droppedBegin = producer->getDroppedReadbackFrames();
+    unsigned long long allocationsBegin = allocationCount();
+
+    std::chrono::time_point<std::chrono::high_resolution_clock> t_begin = std::chrono::high_resolution_clock::now();
+
+    producer->renderOffline(benchmarkSpecs.numFrames, &writer);
+
+    std::chrono::duration<double,std::milli> t_total = std::chrono::high_resolution_clock::now() - t_begin;
+
+    OpenGLBenchmarkResults results = summarize(frameTimes, t_total.count(), allocationCount() - allocationsBegin);
+
+    OpenGLFrameWriter::OpenGLFrameWriterStats stats = writer.getStats();
+
+    //Same frames again, overwriting the files
+    run = 1;
+    producer->renderOffline(benchmarkSpecs.numFrames, &writer);
+
+    bool deterministic = (hashes[0] == hashes[1]) && (hashes[0].size() == benchmarkSpecs.numFrames);
+
+    results.metrics.push_back(std::make_pair(QString("frames_written"), static_cast<double>(stats.framesWritten)));
+    results.metrics.push_back(std::make_pair(QString("written_mb_per_s"), stats.bytesWritten / 1e6 / std::max(t_total.count() / 1000.0, 1e-9)));
+    results.metrics.push_back(std::make_pair(QString("writer_stalls"), static_cast<double>(stats.stalls)));
+    results.metrics.push_back(std::make_pair(QString("write_failures"), static_cast<double>(stats.failures)));
+    results.metrics.push_back(std::make_pair(QString("dropped_frames"), static_cast<double>(producer->getDroppedReadbackFrames() - droppedBegin)));
+    results.metrics.push_back(std::make_pair(QString("deterministic"), deterministic ? 1.0 : 0.0));
+
+    delete producer;
+
+    if(benchmarkSpecs.outputDirectory.isEmpty())
+        QDir(directory).removeRecursively();
+
+    return results;
+}
+
+OpenGLBenchmark::OpenGLBenchmarkResults OpenGLBenchmark::runReplay()
+{
+    const OpenGLRenderer::OpenGLTextureSpecs& frameSpecs = benchmarkSpecs.renderSpecs.frameType;
+
+    QString directory = benchmarkSpecs.outputDirectory.isEmpty() ? QDir::tempPath() + QString("/WinGLBenchmark/replay") :
+                                                                   benchmarkSpecs.outputDirectory;
+    QDir().mkpath(directory);
+
+    QString fileName = QDir(directory).filePath(QString("replay.wglf"));
+
+    //Capture: a different pattern per frame, timestamps at the render frame rate
+    std::vector<unsigned char> frame(OpenGLRenderer::getFrameSize(frameSpecs));
+
+    OpenGLFrameAppender appender;
+    if(!appender.open(fileName, frameSpecs))
+    {
+        std::fprintf(stderr, "Cannot create %s\n", fileName.toLatin1().constData());
+        return OpenGLBenchmarkResults();
+    }
+
+    std::chrono::time_point<std::chrono::high_resolution_clock> t_appendBegin = std::chrono::high_resolution_clock::now();
+
+    for(unsigned int i = 0; i < benchmarkSpecs.numFrames; i++)
+    {
+        for(size_t j = 0; j < frame.size(); j += 64)
+            frame[j] = static_cast<unsigned char>(i + j);
+
+        appender.append(frame.data(), static_cast<qint64>(i * 1e6 / std::max(benchmarkSpecs.renderSpecs.frameRate, 1.0)));
+    }
+
+    appender.finish();
+
+    std::chrono::duration<double> t_append = std::chrono::high_resolution_clock::now() - t_appendBegin;
+
+    OpenGLFrameAppender::OpenGLFrameAppenderStats appendStats = appender.getStats();
+
+    //Replay, looping so warmup + measured frames never run out
+    OpenGLInputSource* source = new OpenGLInputSource(nullptr,
+                                                      nullptr,
+                                                      benchmarkSpecs.renderSpecs,
+                                                      QSurfaceFormat::defaultFormat(),
+                                                      nullptr,
+                                                      benchmarkSpecs.numOutputBuffers);
+    source->setPersistentMapping(!benchmarkSpecs.orphanUploads);
+
+    OpenGLFrameReplay* replay = new OpenGLFrameReplay(source);
+    replay->setLooping(true);
+
+    if(!replay->open(fileName))
+    {
+        std::fprintf(stderr, "Cannot open %s\n", fileName.toLatin1().constData());
+
+        delete replay;
+        delete source;
+
+        return OpenGLBenchmarkResults();
+    }
+
+    OpenGLFrameReplay::OpenGLFrameReplayStats statsBegin = replay->getStats();
+
+    OpenGLBenchmarkResults results = measure([&]()
+    {
+        replay->nextFrame();
+    },
+    [&]()
+    {
+        statsBegin = replay->getStats();
+    },
+    [&]()
+    {
+        if(source->getOpenGLContext()->makeCurrent(source))
+        {
+            source->glFinish();
+            source->getOpenGLContext()->doneCurrent();
+        }
+    });
+
+    OpenGLFrameReplay::OpenGLFrameReplayStats stats = replay->getStats();
+
+    //Random access: seek to a pseudo random frame and upload it
+    const unsigned int numSeeks = 100;
+    unsigned int seed = 12345;
+
+    std::chrono::time_point<std::chrono::high_resolution_clock> t_seekBegin = std::chrono::high_resolution_clock::now();
+
+    for(unsigned int i = 0; i < numSeeks; i++)
+    {
+        seed = seed * 1664525u + 1013904223u;
+
+        replay->seek((seed >> 8) % std::max(replay->getFile().getFrameCount(), 1ull));
+
+        //A dropped upload leaves the position where it is; offer the frame again a few times
+        for(unsigned int attempt = 0; attempt < 16; attempt++)
+        {
+            if(replay->nextFrame())
+                break;
+        }
+    }
+
+    std::chrono::duration<double,std::milli> t_seek = std::chrono::high_resolution_clock::now() - t_seekBegin;
+
+    double seconds = benchmarkSpecs.numFrames / std::max(results.framesPerSecond, 1e-9);
+    double replayed = static_cast<double>(stats.framesReplayed - statsBegin.framesReplayed);
+
+    results.metrics.push_back(std::make_pair(QString("file_frames"), static_cast<double>(replay->getFile().getFrameCount())));
+    results.metrics.push_back(std::make_pair(QString("append_mb_per_s"), appendStats.bytesWritten / (1024.0 * 1024.0) / std::max(t_append.count(), 1e-9)));
+    results.metrics.push_back(std::make_pair(QString("append_stalls"), static_cast<double>(appendStats.stalls)));
+    results.metrics.push_back(std::make_pair(QString("append_failures"), static_cast<double>(appendStats.failures)));
+    results.metrics.push_back(std::make_pair(QString("replay_fps"), replayed / seconds));
+    results.metrics.push_back(std::make_pair(QString("replay_mb_per_s"), (stats.bytesReplayed - statsBegin.bytesReplayed) / (1024.0 * 1024.0) / seconds));
+    results.metrics.push_back(std::make_pair(QString("replay_dropped"), static_cast<double>(stats.droppedUploads - statsBegin.droppedUploads)));
+    results.metrics.push_back(std::make_pair(QString("seek_ms"), t_seek.count() / numSeeks));
+    results.metrics.push_back(std::make_pair(QString("persistent"), source->isPersistentlyMapped() ? 1.0 : 0.0));
+
+    delete replay;
+    delete source;
+
+    if(benchmarkSpecs.outputDirectory.isEmpty())
+        QDir(directory).removeRecursively();
+    else
+        QFile::remove(fileName);
+
+    return results;
+}
+
+OpenGLBenchmark::OpenGLBenchmarkResults OpenGLBenchmark::runGovernor()
+{
+    OpenGLRenderSurface* producer = new OpenGLRenderSurface(nullptr,
+                                                            nullptr,
+                                                            benchmarkSpecs.renderSpecs,
+                                                            QSurfaceFormat::defaultFormat(),
+                                                            nullptr,
+                                                            benchmarkSpecs.numOutputBuffers);
+
+    std::vector<OpenGLBenchmarkDisplay*> displays;
+    std::vector<OpenGLNativeRenderWindow*> nativeDisplays;
+
+    createDisplays(producer, nullptr, displays, nativeDisplays);
+
+    //Effects are the load that has to be shed
+    for(unsigned int i = 0; i < benchmarkSpecs.numEffects; i++)
+        producer->addEffect(QString(":/GLSL/passFragment.glsl"));
+
+    std::vector<double> frameTimes;
+    frameTimes.reserve(benchmarkSpecs.numFrames);
+
+    unsigned int numFrames = 0;
+    unsigned long long allocationsBegin = 0;
+
+    std::chrono::time_point<std::chrono::high_resolution_clock> t_begin;
+    std::chrono::time_point<std::chrono::high_resolution_clock> t_lastFrame;
+
+    QEventLoop eventLoop;
+
+    //Same frame loop as pacing runs; only the second run's intervals are kept
+    QObject::connect(producer,&OpenGLRenderSurface::frameReady,[&]()
+    {
+        foreach(OpenGLBenchmarkDisplay* display, displays)
+            display->renderFrame();
+
+        std::chrono::time_point<std::chrono::high_resolution_clock> t_frame = std::chrono::high_resolution_clock::now();
+
+        numFrames++;
+
+        if(numFrames == benchmarkSpecs.numWarmupFrames + 1)
+        {
+            producer->getFrameScheduler()->resetStats();
+            producer->getResolutionGovernor().resetStats();
+
+            frameTimes.clear();
+
+            t_begin = t_frame;
+            allocationsBegin = allocationCount();
+        }
+        else if(numFrames > benchmarkSpecs.numWarmupFrames + 1)
+        {
+            frameTimes.push_back(std::chrono::duration<double,std::milli>(t_frame - t_lastFrame).count());
+        }
+
+        t_lastFrame = t_frame;
+
+        if(numFrames > benchmarkSpecs.numWarmupFrames + benchmarkSpecs.numFrames)
+        {
+            producer->stop();
+            eventLoop.quit();
+        }
+    });
+
+    auto runPaced = [&](bool dynamicResolution)
+    {
+        producer->setDynamicResolutionEnabled(dynamicResolution);
+
+        numFrames = 0;
+
+        producer->start();
+        eventLoop.exec();
+
+        return producer->getFrameScheduler()->getStats();
+    };
+
+    OpenGLFrameScheduler::OpenGLFrameSchedulerStats fixedStats = runPaced(false);
+    OpenGLFrameScheduler::OpenGLFrameSchedulerStats governedStats = runPaced(true);
+
+    std::chrono::duration<double,std::milli> t_total = t_lastFrame - t_begin;
+
+    OpenGLBenchmarkResults results = summarize(frameTimes, t_total.count(), allocationCount() - allocationsBegin);
+
+    OpenGLResolutionGovernor::OpenGLResolutionGovernorStats stats = producer->getResolutionGovernor().getStats();
+
+    results.metrics.push_back(std::make_pair(QString("target_fps"), benchmarkSpecs.renderSpecs.frameRate));
+    results.metrics.push_back(std::make_pair(QString("fixed_fps"), fixedStats.actualFrameRate));
+    results.metrics.push_back(std::make_pair(QString("fixed_missed_deadlines"), static_cast<double>(fixedStats.missedDeadlines)));
+    results.metrics.push_back(std::make_pair(QString("governed_fps"), governedStats.actualFrameRate));
+    results.metrics.push_back(std::make_pair(QString("governed_missed_deadlines"), static_cast<double>(governedStats.missedDeadlines)));
+    results.metrics.push_back(std::make_pair(QString("scale"), stats.scale));
+    results.metrics.push_back(std::make_pair(QString("mean_scale"), stats.meanScale));
+    results.metrics.push_back(std::make_pair(QString("scale_downs"), static_cast<double>(stats.scaleDowns)));
+    results.metrics.push_back(std::make_pair(QString("scale_ups"), static_cast<double>(stats.scaleUps)));
+    results.metrics.push_back(std::make_pair(QString("frames_over_budget"), static_cast<double>(stats.framesOverBudget)));
+    results.metrics.push_back(std::make_pair(QString("cpu_ms"), stats.cpuFrameTime));
+    results.metrics.push_back(std::make_pair(QString("gpu_ms"), stats.gpuFrameTime));
+
+    foreach(OpenGLBenchmarkDisplay* display, displays)
+        delete display;
+
+    foreach(OpenGLNativeRenderWindow* display, nativeDisplays)
+        delete display;
+
+    delete producer;
+
+    return results;
+}
+
+OpenGLBenchmark::OpenGLBenchmarkResults OpenGLBenchmark::runWall()
+{
+    const unsigned int displayWidth = benchmarkSpecs.renderSpecs.frameType.width;
+    const unsigned int displayHeight = benchmarkSpecs.renderSpecs.frameType.height;
+
+    unsigned int canvasWidth = 0;
+    unsigned int canvasHeight = 0;
+
+    OpenGLVideoWall::getGridCanvasSize(benchmarkSpecs.wallColumns, benchmarkSpecs.wallRows,
+                                       displayWidth, displayHeight,
+                                       benchmarkSpecs.wallBezel, benchmarkSpecs.wallBezel,
+                                       canvasWidth, canvasHeight);
+
+    unsigned int tileSize = std::max(benchmarkSpecs.tileSize, 1u);
+
+    OpenGLVideoWall wall(canvasWidth, canvasHeight, tileSize, tileSize);
+    wall.addDisplayGrid(benchmarkSpecs.wallColumns, benchmarkSpecs.wallRows,
+                        displayWidth, displayHeight,
+                        benchmarkSpecs.wallBezel, benchmarkSpecs.wallBezel);
+
+    //The largest single FBO this context can render, asked while the tiled run's context is current
+    GLint maxTextureSize = 0;
+
+    //Both producers render the same effects at their own size
+    auto runProducer = [&](OpenGLRenderer::OpenGLRenderSpecs specs, OpenGLVideoWall* videoWall)
+    {
+        OpenGLRenderSurface* producer = new OpenGLRenderSurface(nullptr,
+                                                                nullptr,
+                                                                specs,
+                                                                QSurfaceFormat::defaultFormat(),
+                                                                nullptr,
+                                                                benchmarkSpecs.numOutputBuffers);
+
+        for(unsigned int i = 0; i < benchmarkSpecs.numEffects; i++)
+            producer->addEffect(QString(":/GLSL/passFragment.glsl"));
+
+        if(videoWall)
+            producer->setVideoWall(videoWall);
+
+        OpenGLBenchmarkResults results = measure([&]()
+        {
+            producer->renderFrame();
+        },
+        [&]()
+        {
+        },
+        [&]()
+        {
+            if(producer->getOpenGLContext()->makeCurrent(producer))
+            {
+                producer->glFinish();
+                producer->glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxTextureSize);
+                producer->getOpenGLContext()->doneCurrent();
+            }
+        });
+
+        delete producer;
+
+        return results;
+    };
+
+    OpenGLBenchmarkResults results = runProducer(benchmarkSpecs.renderSpecs, &wall);
+
+    //The baseline canvas is shrunk to the maximum texture size if need be, keeping the aspect ratio
+    double fit = std::min(1.0, static_cast<double>(maxTextureSize) / std::max(canvasWidth, canvasHeight));
+
+    OpenGLRenderer::OpenGLRenderSpecs baselineSpecs = benchmarkSpecs.renderSpecs;
+    baselineSpecs.frameType.width = std::max(static_cast<unsigned int>(canvasWidth * fit), 1u);
+    baselineSpecs.frameType.height = std::max(static_cast<unsigned int>(canvasHeight * fit), 1u);
+
+    OpenGLBenchmarkResults baseline = runProducer(baselineSpecs, nullptr);
+
+    double tilePixels = static_cast<double>(wall.getTileWidth()) * wall.getTileHeight();
+    double baselinePixels = static_cast<double>(baselineSpecs.frameType.width) * baselineSpecs.frameType.height;
+
+    double tiledRate = wall.getMappedTileCount() * tilePixels * results.framesPerSecond;
+    double baselineRate = baselinePixels * baseline.framesPerSecond;
+
+    results.metrics.push_back(std::make_pair(QString("canvas_width"), static_cast<double>(canvasWidth)));
+    results.metrics.push_back(std::make_pair(QString("canvas_height"), static_cast<double>(canvasHeight)));
+    results.metrics.push_back(std::make_pair(QString("tile_size"), static_cast<double>(tileSize)));
+    results.metrics.push_back(std::make_pair(QString("tiles"), static_cast<double>(wall.getTileCount())));
+    results.metrics.push_back(std::make_pair(QString("tiles_skipped"), static_cast<double>(wall.getTileCount() - wall.getMappedTileCount())));
+    results.metrics.push_back(std::make_pair(QString("tiles_per_s"), wall.getMappedTileCount() * results.framesPerSecond));
+    results.metrics.push_back(std::make_pair(QString("mpixels_per_s"), tiledRate / 1e6));
+    results.metrics.push_back(std::make_pair(QString("max_texture_size"), static_cast<double>(maxTextureSize)));
+    results.metrics.push_back(std::make_pair(QString("baseline_width"), static_cast<double>(baselineSpecs.frameType.width)));
+    results.metrics.push_back(std::make_pair(QString("baseline_height"), static_cast<double>(baselineSpecs.frameType.height)));
+    results.metrics.push_back(std::make_pair(QString("baseline_fps"), baseline.framesPerSecond));
+    results.metrics.push_back(std::make_pair(QString("baseline_tiles_per_s"), baselinePixels / tilePixels * baseline.framesPerSecond));
+    results.metrics.push_back(std::make_pair(QString("baseline_mpixels_per_s"), baselineRate / 1e6));
+    results.metrics.push_back(std::make_pair(QString("tiled_vs_baseline"), baselineRate > 0.0 ? tiledRate / baselineRate : 0.0));
+
+    return results;
+}
+
+OpenGLBenchmark::OpenGLBenchmarkResults OpenGLBenchmark::runLayers()
+{
+    //Rates around the compositor's that do not divide each other, so layer frames land at every phase of its ticks
+    static const double layerRates[] = {60.0, 30.0, 24.0, 50.0, 120.0, 59.94, 25.0, 48.0};
+    static const unsigned int numLayerRates = sizeof(layerRates) / sizeof(layerRates[0]);
+
+    unsigned int numLayers = std::min(std::max(benchmarkSpecs.numLayers, 1u), OpenGLLayerCompositor::maxLayers);
+
+    const float width = static_cast<float>(benchmarkSpecs.renderSpecs.frameType.width);
+    const float height = static_cast<float>(benchmarkSpecs.renderSpecs.frameType.height);
+
+    std::vector<OpenGLRenderSurface*> producers;
+    std::vector<OpenGLFrameMailbox*> mailboxes;
+    std::vector<QThread*> threads;
+
+    for(unsigned int i = 0; i < numLayers; i++)
+    {
+        OpenGLRenderer::OpenGLRenderSpecs specs = benchmarkSpecs.renderSpecs;
+        specs.frameRate = layerRates[i % numLayerRates];
+
+        //Everything shares with the first producer, so all contexts are in one share group. Three buffers at least: the
+        //compositor shows a frame behind the newest while the next one is being rendered
+        OpenGLRenderSurface* producer = new OpenGLRenderSurface(nullptr,
+                                                                nullptr,
+                                                                specs,
+                                                                QSurfaceFormat::defaultFormat(),
+                                                                producers.empty() ? nullptr : producers.front()->getOpenGLContext(),
+                                                                std::max(benchmarkSpecs.numOutputBuffers, 3u));
+
+        for(unsigned int j = 0; j < benchmarkSpecs.numEffects; j++)
+            producer->addEffect(QString(":/GLSL/passFragment.glsl"));
+
+        OpenGLFrameMailbox* mailbox = new OpenGLFrameMailbox();
+        QObject::connect(producer,&OpenGLRenderSurface::frameReady,mailbox,&OpenGLFrameMailbox::publish,Qt::DirectConnection);
+
+        producers.push_back(producer);
+        mailboxes.push_back(mailbox);
+    }
+
+    OpenGLLayerCompositor* compositor = new OpenGLLayerCompositor(nullptr,
+                                                                  nullptr,
+                                                                  benchmarkSpecs.renderSpecs,
+                                                                  QSurfaceFormat::defaultFormat(),
+                                                                  producers.front()->getOpenGLContext(),
+                                                                  benchmarkSpecs.numOutputBuffers);
+
+    //The first layer fills the output underneath; the others are cascaded, rotated and translucent, added bottom up but
+    //ordered top down so the z-order has to be applied
+    for(unsigned int i = 0; i < numLayers; i++)
+    {
+        int layer = compositor->addLayer(mailboxes[i]);
+
+        if(i == 0)
+        {
+            compositor->setLayerZOrder(layer, -1);
+            continue;
+        }
+
+        float offset = (numLayers > 2) ? static_cast<float>(i - 1) / (numLayers - 2) : 0.5f;
+
+        compositor->setLayerTransform(layer, OpenGLLayerCompositor::OpenGLLayerTransform{width * (0.25f + 0.5f * offset),
+                                                                                         height * (0.25f + 0.5f * offset),
+                                                                                         width * 0.5f,
+                                                                                         height * 0.5f,
+                                                                                         5.0f * i});
+        compositor->setLayerOpacity(layer, 0.8f);
+        compositor->setLayerZOrder(layer, static_cast<int>(numLayers - i));
+    }
+
+    std::vector<double> frameTimes;
+    frameTimes.reserve(benchmarkSpecs.numFrames);
+
+    unsigned int numFrames = 0;
+    unsigned long long allocationsBegin = 0;
+    unsigned long long allocationsEnd = 0;
+
+    std::vector<unsigned long long> publishedBegin(numLayers, 0);
+    std::vector<unsigned long long> publishedEnd(numLayers, 0);
+    std::vector<unsigned long long> droppedBegin(numLayers, 0);
+    std::vector<unsigned long long> droppedEnd(numLayers, 0);
+
+    OpenGLLayerCompositor::OpenGLLayerCompositorStats stats = OpenGLLayerCompositor::OpenGLLayerCompositorStats();
+
+    std::chrono::time_point<std::chrono::high_resolution_clock> t_begin;
+    std::chrono::time_point<std::chrono::high_resolution_clock> t_lastFrame;
+
+    QEventLoop eventLoop;
+
+    //Runs on the compositor's thread; the event loop only learns about the end through the queued quit
+    QObject::connect(compositor,&OpenGLLayerCompositor::frameReady,compositor,[&]()
+    {
+        std::chrono::time_point<std::chrono::high_resolution_clock> t_frame = std::chrono::high_resolution_clock::now();
+
+        numFrames++;
+
+        if(numFrames == benchmarkSpecs.numWarmupFrames + 1)
+        {
+            compositor->resetStats();
+
+            for(unsigned int i = 0; i < numLayers; i++)
+            {
+                publishedBegin[i] = mailboxes[i]->getPublishedCount();
+                droppedBegin[i] = compositor->getDroppedFrameCount(static_cast<int>(i));
+            }
+
+            t_begin = t_frame;
+            allocationsBegin = allocationCount();
+        }
+        else if(numFrames > benchmarkSpecs.numWarmupFrames + 1)
+        {
+            frameTimes.push_back(std::chrono::duration<double,std::milli>(t_frame - t_lastFrame).count());
+        }
+
+        t_lastFrame = t_frame;
+
+        if(numFrames == benchmarkSpecs.numWarmupFrames + benchmarkSpecs.numFrames + 1)
+        {
+            compositor->stop();
+
+            stats = compositor->getStats();
+
+            for(unsigned int i = 0; i < numLayers; i++)
+            {
+                publishedEnd[i] = mailboxes[i]->getPublishedCount();
+                droppedEnd[i] = compositor->getDroppedFrameCount(static_cast<int>(i));
+            }
+
+            allocationsEnd = allocationCount();
+
+            QMetaObject::invokeMethod(&eventLoop, "quit", Qt::QueuedConnection);
+        }
+    },Qt::DirectConnection);
+
+    for(OpenGLRenderSurface* producer : producers)
+    {
+        QThread* thread = new QThread();
+        producer->moveToThread(thread);
+        QObject::connect(thread,&QThread::started,producer,&OpenGLRenderSurface::start);
+
+        threads.push_back(thread);
+    }
+
+    QThread* compositorThread = new QThread();
+    compositor->moveToThread(compositorThread);
+    QObject::connect(compositorThread,&QThread::started,compositor,&OpenGLLayerCompositor::start);
+
+    threads.push_back(compositorThread);
+
+    foreach(QThread* thread, threads)
+        thread->start();
+
+    eventLoop.exec();
+
+    foreach(OpenGLRenderSurface* producer, producers)
+        QMetaObject::invokeMethod(producer, "stop", Qt::BlockingQueuedConnection);
+
+    foreach(QThread* thread, threads)
+    {
+        thread->quit();
+        thread->wait();
+    }
+
+    std::chrono::duration<double,std::milli> t_total = t_lastFrame - t_begin;
+    double seconds = std::max(t_total.count() / 1000.0, 1e-9);
+
+    OpenGLBenchmarkResults results = summarize(frameTimes, t_total.count(), allocationsEnd - allocationsBegin);
+
+    double frames = std::max(static_cast<double>(stats.frames), 1.0);
+
+    results.metrics.push_back(std::make_pair(QString("layers"), static_cast<double>(numLayers)));
+    results.metrics.push_back(std::make_pair(QString("target_fps"), benchmarkSpecs.renderSpecs.frameRate));
+    results.metrics.push_back(std::make_pair(QString("skipped_ticks"), static_cast<double>(stats.skippedFrames)));
+    results.metrics.push_back(std::make_pair(QString("draw_calls"), stats.drawCalls / frames));
+    results.metrics.push_back(std::make_pair(QString("layer_frames_per_s"), stats.layerFrames / seconds));
+    results.metrics.push_back(std::make_pair(QString("layer_frames_not_ready"), static_cast<double>(stats.layerFramesNotReady)));
+
+    for(unsigned int i = 0; i < numLayers; i++)
+    {
+        results.metrics.push_back(std::make_pair(QString("layer%1_target_fps").arg(i), layerRates[i % numLayerRates]));
+        results.metrics.push_back(std::make_pair(QString("layer%1_fps").arg(i), (publishedEnd[i] - publishedBegin[i]) / seconds));
+        results.metrics.push_back(std::make_pair(QString("layer%1_dropped").arg(i), static_cast<double>(droppedEnd[i] - droppedBegin[i])));
+    }
+
+    delete compositor;
+
+    foreach(OpenGLRenderSurface* producer, producers)
+        delete producer;
+
+    foreach(OpenGLFrameMailbox* mailbox, mailboxes)
+        delete mailbox;
+
+    foreach(QThread* thread, threads)
+        delete thread;
+
+    return results;
+}
+
+void OpenGLBenchmark::addProfileMetrics(OpenGLBenchmark::OpenGLBenchmarkResults &results,
+                                        const std::vector<const OpenGLRenderer *> &renderers,
+                                        const QString &name) const
+{
+    std::vector<const OpenGLProfiler*> profilers;
+    for(const OpenGLRenderer* renderer : renderers)
+    {
+        if(renderer->getProfiler() && renderer->getProfiler()->isInitialized())
+            profilers.push_back(renderer->getProfiler());
+    }
+
+    if(profilers.empty())
+    {
+        std::fprintf(stderr, "GPU timer queries are not supported by this context\n");
+        return;
+    }
+
+    //Passes of the same name (one per display) are averaged; the worst display sets the max
+    typedef struct PassTotals
+    {
+        QString name;
+        unsigned int count;
+        double meanSum;
+        double max;
+    }
+    PassTotals;
+
+    std::vector<PassTotals> passes;
+    unsigned long long droppedFrames = 0;
+
+    for(const OpenGLProfiler* profiler : profilers)
+    {
+        droppedFrames += profiler->getDroppedFrameCount();
+
+        for(const OpenGLProfiler::OpenGLPassStats& stats : profiler->getStats())
+        {
+            auto it = std::find_if(passes.begin(), passes.end(), [&stats](const PassTotals& p) { return p.name == stats.name; });
+            if(it == passes.end())
+            {
+                passes.push_back(PassTotals{stats.name, 0, 0.0, 0.0});
+                it = passes.end() - 1;
+            }
+
+            it->count++;
+            it->meanSum += stats.meanGPUTime;
+            it->max = std::max(it->max, stats.maxGPUTime);
+        }
+    }
+
+    for(const PassTotals& pass : passes)
+    {
+        QString key = QString(pass.name).replace(QString(" "), QString("_"));
+
+        results.metrics.push_back(std::make_pair(QString("gpu_%1_us").arg(key), 1000.0 * pass.meanSum / pass.count));
+        results.metrics.push_back(std::make_pair(QString("gpu_%1_max_us").arg(key), 1000.0 * pass.max));
+    }
+
+    results.metrics.push_back(std::make_pair(QString("gpu_profile_dropped"), static_cast<double>(droppedFrames)));
+
+    if(benchmarkSpecs.traceFileName.isEmpty())
+        return;
+
+    //One trace per run: trace.json becomes trace_pipeline_rgba8_d1_b2.json
+    QString suffix = QString("_%1_%2_d%3_b%4").arg(name).arg(benchmarkSpecs.formatName).arg(benchmarkSpecs.numDisplays).arg(benchmarkSpecs.numOutputBuffers);
+
+    QString fileName = benchmarkSpecs.traceFileName;
+    int extension = fileName.lastIndexOf(QString("."));
+    if(extension > 0)
+        fileName.insert(extension, suffix);
+    else
+        fileName.append(suffix);
+
+    if(!OpenGLProfiler::writeChromeTrace(fileName, profilers))
+        std::fprintf(stderr, "Could not write trace %s\n", fileName.toLatin1().constData());
+}
+
+bool OpenGLBenchmark::printResults(const QString &name, const OpenGLBenchmark::OpenGLBenchmarkResults &results) const
+{
+    //One key=value line per run so regression scripts can parse it
+    std::printf("%s width=%u height=%u format=%s present=%s skip=%d displays=%u native=%d buffers=%u frames=%u "
+                "p50_ms=%.3f p95_ms=%.3f p99_ms=%.3f mean_ms=%.3f fps=%.1f allocs_per_frame=%.2f",
+                name.toLatin1().constData(),
+                benchmarkSpecs.renderSpecs.frameType.width,
+                benchmarkSpecs.renderSpecs.frameType.height,
+                benchmarkSpecs.formatName.toLatin1().constData(),
+                benchmarkSpecs.presentModeName.toLatin1().constData(),
+                benchmarkSpecs.skipUnchanged ? 1 : 0,
+                benchmarkSpecs.numDisplays,
+                benchmarkSpecs.nativeDisplays ? 1 : 0,
+                benchmarkSpecs.numOutputBuffers,
+                benchmarkSpecs.numFrames,
+                results.p50FrameTime,
+                results.p95FrameTime,
+                results.p99FrameTime,
+                results.meanFrameTime,
+                results.framesPerSecond,
+                results.allocationsPerFrame);
+
+    for(const std::pair<QString,double>& metric : results.metrics)
+        std::printf(" %s=%.2f", metric.first.toLatin1().constData(), metric.second);
+
+    std::printf("\n");
+    std::fflush(stdout);
+
+    foreach(const QString& failure, results.failures)
+        std::fprintf(stderr, "%s: FAILED %s\n", name.toLatin1().constData(), failure.toLatin1().constData());
+
+    return results.failures.empty();
+}
+
+OpenGLBenchmark::OpenGLBenchmarkResults OpenGLBenchmark::runPacing()
+{
+    OpenGLRenderSurface* producer = new OpenGLRenderSurface(nullptr,
+                                                            nullptr,
+                                                            benchmarkSpecs.renderSpecs,
+                                                            QSurfaceFormat::defaultFormat(),
+                                                            nullptr,
+                                                            benchmarkSpecs.numOutputBuffers);
+
+    std::vector<OpenGLBenchmarkDisplay*> displays;
+    std::vector<OpenGLNativeRenderWindow*> nativeDisplays;
+
+    createDisplays(producer, nullptr, displays, nativeDisplays);
+
+    std::vector<double> frameTimes;
+    frameTimes.reserve(benchmarkSpecs.numFrames);
+
+    unsigned int numFrames = 0;
+    unsigned long long allocationsBegin = 0;
+
+    std::chrono::time_point<std::chrono::high_resolution_clock> t_begin;
+    std::chrono::time_point<std::chrono::high_resolution_clock> t_lastFrame;
+
+    QEventLoop eventLoop;
+
+    //Offscreen displays present as soon as the frame is ready
+    QObject::connect(producer,&OpenGLRenderSurface::frameReady,[&]()
+    {
+        foreach(OpenGLBenchmarkDisplay* display, displays)
+            display->renderFrame();
+
+        std::chrono::time_point<std::chrono::high_resolution_clock> t_frame = std::chrono::high_resolution_clock::now();
+
+        numFrames++;
+
+        if(numFrames == benchmarkSpecs.numWarmupFrames + 1)
+        {
+            producer->getFrameScheduler()->resetStats();
+
+            t_begin = t_frame;
+            allocationsBegin = allocationCount();
+        }
+        else if(numFrames > benchmarkSpecs.numWarmupFrames + 1)
+        {
+            frameTimes.push_back(std::chrono::duration<double,std::milli>(t_frame - t_lastFrame).count());
+        }
+
+        t_lastFrame = t_frame;
+
+        if(numFrames > benchmarkSpecs.numWarmupFrames + benchmarkSpecs.numFrames)
+        {
+            producer->stop();
+            eventLoop.quit();
+        }
+    });
+
+    producer->start();
+    eventLoop.exec();
+
+    std::chrono::duration<double,std::milli> t_total = t_lastFrame - t_begin;
+
+    OpenGLBenchmarkResults results = summarize(frameTimes, t_total.count(), allocationCount() - allocationsBegin);
+
+    OpenGLFrameScheduler::OpenGLFrameSchedulerStats stats = producer->getFrameScheduler()->getStats();
+
+    results.metrics.push_back(std::make_pair(QString("target_fps"), benchmarkSpecs.renderSpecs.frameRate));
+    results.metrics.push_back(std::make_pair(QString("scheduler_fps"), stats.actualFrameRate));
+    results.metrics.push_back(std::make_pair(QString("jitter_mean_ms"), stats.meanJitter));
+    results.metrics.push_back(std::make_pair(QString("jitter_max_ms"), stats.maxJitter));
+    results.metrics.push_back(std::make_pair(QString("missed_deadlines"), static_cast<double>(stats.missedDeadlines)));
+
+    foreach(OpenGLBenchmarkDisplay* display, displays)
+        delete display;
+
+    foreach(OpenGLNativeRenderWindow* display, nativeDisplays)
+        delete display;
+
+    delete producer;
+
+    return results;
+}
+
+void OpenGLBenchmark::createDisplays(OpenGLRenderSurface *producer,
+                                     OpenGLOutputCache *cache,
+                                     std::vector<OpenGLBenchmarkDisplay *> &displays,
+                                     std::vector<OpenGLNativeRenderWindow *> &nativeDisplays) const
+{
+    for(unsigned int i = 0; i < benchmarkSpecs.numDisplays; i++)
+    {
+        OpenGLRenderer::OpenGLRenderSpecs displaySpecs = benchmarkSpecs.renderSpecs;
+        if(!benchmarkSpecs.outputSizes.empty())
+        {
+            displaySpecs.frameType.width = benchmarkSpecs.outputSizes[i % benchmarkSpecs.outputSizes.size()].first;
+            displaySpecs.frameType.height = benchmarkSpecs.outputSizes[i % benchmarkSpecs.outputSizes.size()].second;
+        }
+
+        if(cache)
+            cache->addOutputSize(displaySpecs.frameType.width, displaySpecs.frameType.height);
+
+        if(benchmarkSpecs.nativeDisplays)
+        {
+            //Native windows render from setFrame through their backend (directly on EGL, via WM_PAINT on WGL)
+            OpenGLNativeRenderWindow* display = new OpenGLNativeRenderWindow(nullptr,
+                                                                             displaySpecs,
+                                                                             QSurfaceFormat::defaultFormat(),
+                                                                             producer->getOpenGLContext());
+            if(cache)
+            {
+                display->setCachedInput(true);
+                QObject::connect(cache,&OpenGLOutputCache::frameReady,display,&OpenGLNativeRenderWindow::setFrame,Qt::DirectConnection);
+                QObject::connect(display,&OpenGLNativeRenderWindow::outputSizeChanged,cache,&OpenGLOutputCache::moveOutputSize);
+            }
+            else
+                QObject::connect(producer,&OpenGLRenderSurface::frameReady,display,&OpenGLNativeRenderWindow::setFrame,Qt::DirectConnection);
+
+            if(benchmarkSpecs.profile)
+                display->setProfilingEnabled(true, QString("display %1").arg(i));
+
+            display->setPresentMode(benchmarkSpecs.presentMode);
+            display->setSkipUnchanged(benchmarkSpecs.skipUnchanged);
+
+            display->showNative();
+            nativeDisplays.push_back(display);
+        }
+        else
+        {
+            OpenGLBenchmarkDisplay* display = new OpenGLBenchmarkDisplay(nullptr,
+                                                                         displaySpecs,
+                                                                         QSurfaceFormat::defaultFormat(),
+                                                                         producer->getOpenGLContext());
+            if(cache)
+            {
+                display->setCachedInput(true);
+                QObject::connect(cache,&OpenGLOutputCache::frameReady,display,&OpenGLBenchmarkDisplay::setFrame,Qt::DirectConnection);
+            }
+            else
+                QObject::connect(producer,&OpenGLRenderSurface::frameReady,display,&OpenGLBenchmarkDisplay::setFrame,Qt::DirectConnection);
+
+            if(benchmarkSpecs.profile)
+                display->setProfilingEnabled(true, QString("display %1").arg(i));
+
+            display->setPresentMode(benchmarkSpecs.presentMode);
+            display->setSkipUnchanged(benchmarkSpecs.skipUnchanged);
+
+            displays.push_back(display);
+        }
+    }
+}
+
+OpenGLBenchmark::OpenGLBenchmarkResults OpenGLBenchmark::measure(const std::function<void ()> &frame,
+                                                                 const std::function<void ()> &begin,
+                                                                 const std::function<void ()> &finish)
+{
+    std::vector<double> frameTimes;
+    frameTimes.reserve(benchmarkSpecs.numFrames);
+
+    unsigned long long allocations = 0;
+
+    std::chrono::time_point<std::chrono::high_resolution_clock> t_begin = std::chrono::high_resolution_clock::now();
+
+    unsigned int numFrames = benchmarkSpecs.numWarmupFrames + benchmarkSpecs.numFrames;
+
+    for(unsigned int i = 0; i < numFrames; i++)
+    {
+        if(i == benchmarkSpecs.numWarmupFrames)
+        {
+            begin();
+            t_begin = std::chrono::high_resolution_clock::now();
+        }
+
+        unsigned long long allocationsBefore = allocationCount();
+        std::chrono::time_point<std::chrono::high_resolution_clock> t_frameStart = std::chrono::high_resolution_clock::now();
+
+        frame();
+
+        std::chrono::duration<double,std::milli> t_frame = std::chrono::high_resolution_clock::now() - t_frameStart;
+
+        if(i >= benchmarkSpecs.numWarmupFrames)
+        {
+            frameTimes.push_back(t_frame.count());
+            allocations += allocationCount() - allocationsBefore;
+        }
+    }
+
+    finish();
+
+    std::chrono::duration<double,std::milli> t_total = std::chrono::high_resolution_clock::now() - t_begin;
+
+    return summarize(frameTimes, t_total.count(), allocations);
+}
+
+OpenGLBenchmark::OpenGLBenchmarkResults OpenGLBenchmark::summarize(std::vector<double> &frameTimes,
+                                                                   double totalTime,
+                                                                   unsigned long long allocations)
+{
+    OpenGLBenchmarkResults results = OpenGLBenchmarkResults();
+
+    if(frameTimes.empty())
+        return results;
+
+    std::sort(frameTimes.begin(), frameTimes.end());
+
+    //Nearest-rank percentile
+    auto percentile = [&frameTimes](double p)
+    {
+        size_t rank = static_cast<size_t>(std::ceil(p * frameTimes.size()));
+        return frameTimes[std::min(std::max(rank, size_t(1)), frameTimes.size()) - 1];
+    };
+
+    double sum = 0.0;
+    for(double frameTime : frameTimes)
+        sum += frameTime;
+
+    results.p50FrameTime = percentile(0.50);
+    results.p95FrameTime = percentile(0.95);
+    results.p99FrameTime = percentile(0.99);
+    results.meanFrameTime = sum / frameTimes.size();
+
+    results.framesPerSecond = (totalTime > 0.0) ? (1000.0 * frameTimes.size() / totalTime) : 0.0;
+    results.allocationsPerFrame = static_cast<double>(allocations) / frameTimes.size();
+
+    return results;
+}
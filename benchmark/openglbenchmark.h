@@ -0,0 +1,220 @@
+#ifndef OPENGLBENCHMARK_H
+#define OPENGLBENCHMARK_H
+
+#include <openglrendersurface.h>
+#include <opengloutputcache.h>
+#include <openglinputsource.h>
+#include <openglframeappender.h>
+#include <openglframereplay.h>
+#include <openglbenchmarkdisplay.h>
+#include <openglnativerenderwindow.h>
+#include <openglframemailbox.h>
+#include <openglpresenterpool.h>
+#include <opengllayercompositor.h>
+#include <openglpixelkernels.h>
+#include <opengltransformsystem.h>
+
+#include <QString>
+
+#include <functional>
+#include <utility>
+#include <vector>
+
+class OpenGLBenchmark
+{
+public:
+    //Defines a benchmark run
+    typedef struct OpenGLBenchmarkSpecs
+    {
+        OpenGLRenderer::OpenGLRenderSpecs renderSpecs;
+        QString formatName;
+
+        unsigned int numDisplays;
+        unsigned int numOutputBuffers;
+
+        //Present through OpenGLNativeRenderWindow and its native backend instead of offscreen displays
+        bool nativeDisplays;
+
+        //Pass-through effects chained after the producer's triangle (OpenGLRenderSurface::addEffect)
+        unsigned int numEffects;
+
+        //Resize requests per frame in resize runs, as WM_SIZE delivers them during a drag
+        unsigned int resizesPerFrame;
+
+        //How displays present (copy / sample / blit) and whether they skip paints without a new frame
+        OpenGLRenderer::OpenGLPresentMode presentMode;
+        QString presentModeName;
+        bool skipUnchanged;
+
+        //Display paints per producer frame in pipeline runs; more than one stands in for WM_PAINT outpacing the producer
+        unsigned int paintsPerFrame;
+
+        //Feed displays through OpenGLOutputCache; each display then presents in a single pass
+        bool outputCache;
+
+        //Display sizes, assigned round robin; empty means every display uses the render size
+        std::vector<std::pair<unsigned int,unsigned int>> outputSizes;
+
+        //Read every frame back to the CPU through OpenGLFrameReader
+        bool readback;
+
+        //Upload through orphaned buffers even where persistent mapping is available
+        bool orphanUploads;
+
+        //Time every pass on the GPU through OpenGLProfiler; a non-empty trace file name also writes a Chrome trace
+        bool profile;
+        QString traceFileName;
+
+        //Where startup runs keep program binaries (OpenGLProgramCache); empty uses a directory under the temp path
+        QString programCacheDirectory;
+        unsigned int numStartupRuns;
+
+        //Time a slowed consumer spends per frame in mailbox runs, in milliseconds
+        double consumerDelay;
+
+        //Presentation threads in present runs (0 gives every display its own) and how long each display's swap blocks
+        unsigned int numPresenterThreads;
+        double swapDelay;
+
+        //Overlay quads per frame in quads runs, spread over this many textures; unsorted keeps submission order
+        unsigned int numQuads;
+        unsigned int numQuadTextures;
+        bool unsortedQuads;
+
+        //Objects updated per frame in transforms runs
+        unsigned int numTransforms;
+
+        //Where offline and replay runs write their frames; empty uses a directory under the temp path, removed afterwards
+        QString outputDirectory;
+
+        //Video wall of wall runs: columns x rows displays of the render size, the canvas pixels hidden by each bezel and
+        //the (square) tile size
+        unsigned int wallColumns;
+        unsigned int wallRows;
+        unsigned int wallBezel;
+        unsigned int tileSize;
+
+        //Producers composited by layers runs, each on its own thread at its own frame rate
+        unsigned int numLayers;
+
+        unsigned int numWarmupFrames;
+        unsigned int numFrames;
+    }
+    OpenGLBenchmarkSpecs;
+
+    //Results of a benchmark run; times are in milliseconds
+    typedef struct OpenGLBenchmarkResults
+    {
+        double p50FrameTime;
+        double p95FrameTime;
+        double p99FrameTime;
+        double meanFrameTime;
+
+        double framesPerSecond;
+        double allocationsPerFrame;
+
+        //Mode specific figures, printed as key=value after the common ones
+        std::vector<std::pair<QString,double>> metrics;
+
+        //Checks the run failed; printed to stderr, and the benchmark exits non-zero
+        std::vector<QString> failures;
+    }
+    OpenGLBenchmarkResults;
+
+    OpenGLBenchmark(OpenGLBenchmarkSpecs specs);
+
+    virtual ~OpenGLBenchmark();
+
+    //Looks up internalFormat / format / dataType / channels for a format name such as "rgba8" or "rgba16f"
+    static bool textureSpecsFromName(const QString& name, OpenGLRenderer::OpenGLTextureSpecs& specs);
+
+    //Looks up a present mode by name: "copy", "sample" or "blit"
+    static bool presentModeFromName(const QString& name, OpenGLRenderer::OpenGLPresentMode& mode);
+
+    //Number of heap allocations made by the process so far
+    static unsigned long long allocationCount();
+
+    //Producer + display passes, timer uncapped
+    OpenGLBenchmarkResults runPipeline();
+
+    //CPU frames streamed into OpenGLInputSource
+    OpenGLBenchmarkResults runUpload();
+
+    //Producer paced by OpenGLFrameScheduler at renderSpecs.frameRate; frame times are intervals between frames
+    OpenGLBenchmarkResults runPacing();
+
+    //Producer and displays resized several times per frame, oscillating between full and half size
+    OpenGLBenchmarkResults runResize();
+
+    //Producer (with its effects) and displays created and drawn once, without the program cache, with an empty disk cache
+    //and with a warm one; frame times are warm startup times
+    OpenGLBenchmarkResults runStartup();
+
+    //Producer feeding two slowed consumers on their own threads, one through queued frameReady signals and one through
+    //OpenGLFrameMailbox; reports how deep each consumer's backlog gets
+    OpenGLBenchmarkResults runMailbox();
+
+    //Offscreen displays presented inline on the producer's thread, then on OpenGLPresenterPool threads fed by a mailbox;
+    //frame times are the producer's in the threaded run
+    OpenGLBenchmarkResults runPresent();
+
+    //Producer drawing numQuads overlay quads per frame through OpenGLQuadBatch, textures interleaved so sorting matters
+    OpenGLBenchmarkResults runQuads();
+
+    //numTransforms MVP matrices computed by OpenGLTransformSystem straight into a mapped buffer every frame; the scalar,
+    //single threaded and CPU-only variants are reported as metrics
+    OpenGLBenchmarkResults runTransforms();
+
+    //Frames of the render size converted by OpenGLPixelKernels on the CPU: every kernel is checked against the scalar
+    //reference and timed per instruction set; frame times are RGBA8 -> NV12 on all workers
+    OpenGLBenchmarkResults runKernels();
+
+    //Producer rendering numFrames frames through renderOffline into OpenGLFrameWriter, twice; frame times are intervals
+    //between frames of the first run and the second checks every frame came out the same
+    OpenGLBenchmarkResults runOffline();
+
+    //numFrames CPU frames captured into a frame file by OpenGLFrameAppender, then replayed from the mapping into
+    //OpenGLInputSource through OpenGLFrameReplay; frame times are replayed frames, random seeks are reported as metrics
+    OpenGLBenchmarkResults runReplay();
+
+    //Producer (with its effects) paced at renderSpecs.frameRate, first at a fixed resolution and then with dynamic
+    //resolution; frame times are intervals between frames of the second run, the fixed run's misses are a metric
+    OpenGLBenchmarkResults runGovernor();
+
+    //Producer (with its effects) rendering a video wall canvas tile by tile, then the same canvas into a single FBO,
+    //shrunk to the maximum texture size if it does not fit; frame times are the tiled run's, displays are not presented
+    OpenGLBenchmarkResults runWall();
+
+    //numLayers producers on their own threads, at different frame rates, composited by OpenGLLayerCompositor on another
+    //at renderSpecs.frameRate; frame times are intervals between composited frames, per layer rates are metrics
+    OpenGLBenchmarkResults runLayers();
+
+    //Returns false if any check of the run failed
+    bool printResults(const QString& name, const OpenGLBenchmarkResults& results) const;
+
+protected:
+    //Creates numDisplays displays sharing with the producer, fed by the cache if there is one and by the producer otherwise
+    void createDisplays(OpenGLRenderSurface* producer,
+                        OpenGLOutputCache* cache,
+                        std::vector<OpenGLBenchmarkDisplay*>& displays,
+                        std::vector<OpenGLNativeRenderWindow*>& nativeDisplays) const;
+
+    //Runs warmup + measured frames; begin is called once warmup is over, finish drains the GPU
+    OpenGLBenchmarkResults measure(const std::function<void()>& frame,
+                                   const std::function<void()>& begin,
+                                   const std::function<void()>& finish);
+
+    //Adds mean / max GPU time of every profiled pass (displays averaged together) and writes the trace if requested
+    void addProfileMetrics(OpenGLBenchmarkResults& results,
+                           const std::vector<const OpenGLRenderer*>& renderers,
+                           const QString& name) const;
+
+    //Computes percentiles / throughput from per-frame times
+    static OpenGLBenchmarkResults summarize(std::vector<double>& frameTimes,
+                                            double totalTime,
+                                            unsigned long long allocations);
+
+    OpenGLBenchmarkSpecs benchmarkSpecs;
+};
+
+#endif // OPENGLBENCHMARK_H
@@ -0,0 +1,273 @@
+#include "openglbenchmarkdisplay.h"
+
+#include <QMutexLocker>
+
+#include <thread>
+
+OpenGLBenchmarkDisplay::OpenGLBenchmarkDisplay(QScreen *outputScreen,
+                                               OpenGLRenderer::OpenGLRenderSpecs specs,
+                                               const QSurfaceFormat &surfaceFormat,
+                                               QOpenGLContext *sharedContext) :
+    QOffscreenSurface(outputScreen,nullptr),
+    OpenGLRenderer(specs),
+    openGLFormat(surfaceFormat),
+    openGLContext(nullptr),
+    inputFrame{0,0,0,0,nullptr,nullptr,0,0},
+    inputMutex(),
+    inputSerial(0),
+    presentedSerial(0),
+    skippedFrames(0),
+    presentMode(OpenGLRenderer::OpenGLPresentCopy),
+    skipUnchanged(false),
+    presentFBO(0),
+    cachedInput(false),
+    frameMailbox(nullptr),
+    mailboxReader(-1),
+    swapDelay(0.0),
+    presentedFrames(0)
+{
+    //Create offscreen surface
+    setFormat(openGLFormat);
+    create();
+
+    //Allocate memory for the context object and prepare to create it
+    openGLContext = new QOpenGLContext(this);
+    openGLContext->setFormat(openGLFormat);
+    if(sharedContext)
+        openGLContext->setShareContext(sharedContext);
+
+    //Make sure the context is created & is sharing resources with the shared context
+    bool contextCreated = openGLContext->create();
+    assert(contextCreated);
+
+    if(sharedContext)
+    {
+        bool sharing = QOpenGLContext::areSharing(openGLContext,sharedContext);
+        assert(sharing);
+    }
+}
+
+OpenGLBenchmarkDisplay::~OpenGLBenchmarkDisplay()
+{
+
+}
+
+QOpenGLContext *OpenGLBenchmarkDisplay::getOpenGLContext()
+{
+    return openGLContext;
+}
+
+unsigned long long OpenGLBenchmarkDisplay::getPresentedFrameCount() const
+{
+    return presentedFrames.load(std::memory_order_relaxed);
+}
+
+unsigned long long OpenGLBenchmarkDisplay::getSkippedFrameCount() const
+{
+    return skippedFrames.load(std::memory_order_relaxed);
+}
+
+void OpenGLBenchmarkDisplay::setSwapDelay(double delay)
+{
+    swapDelay = delay;
+}
+
+void OpenGLBenchmarkDisplay::setCachedInput(bool enabled)
+{
+    cachedInput = enabled;
+}
+
+void OpenGLBenchmarkDisplay::setPresentMode(OpenGLRenderer::OpenGLPresentMode mode)
+{
+    presentMode = mode;
+    presentedSerial = inputSerial - 1;
+}
+
+void OpenGLBenchmarkDisplay::setSkipUnchanged(bool enabled)
+{
+    skipUnchanged = enabled;
+}
+
+bool OpenGLBenchmarkDisplay::setFrameMailbox(OpenGLFrameMailbox *mailbox)
+{
+    int reader = mailbox->addReader([this]()
+    {
+        QMetaObject::invokeMethod(this, "takeFrame", Qt::QueuedConnection);
+    });
+
+    if(reader < 0)
+        return false;
+
+    frameMailbox = mailbox;
+    mailboxReader = reader;
+
+    return true;
+}
+
+void OpenGLBenchmarkDisplay::takeFrame()
+{
+    OpenGLFrameMailbox::OpenGLFrameDescriptor frame;
+
+    if(!frameMailbox || !frameMailbox->takeFrame(mailboxReader, frame))
+        return;
+
+    setFrame(frame.frame);
+    renderFrame();
+
+    //Held by the mailbox for the duration of the present
+    OpenGLOutputRing::release(frame.frame);
+}
+
+void OpenGLBenchmarkDisplay::setFrame(OpenGLOutputRing::OpenGLOutputFrame frame)
+{
+    //A cache emits every output size; keep ours only
+    if(cachedInput && (frame.width != renderSpecs.frameType.width || frame.height != renderSpecs.frameType.height))
+        return;
+
+    {
+        QMutexLocker locker(&inputMutex);
+        inputFrame = frame;
+    }
+
+    inputSerial++;
+}
+
+void OpenGLBenchmarkDisplay::renderFrame()
+{
+    updateStartTime();
+
+    if(skipUnchanged && initialized && !specsPending && presentedSerial == inputSerial)
+    {
+        skippedFrames.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    OpenGLOutputRing::OpenGLOutputFrame frame;
+    {
+        QMutexLocker locker(&inputMutex);
+        frame = inputFrame;
+    }
+
+    //Dropped if the producer has already moved on from it
+    if(!OpenGLOutputRing::acquire(frame))
+    {
+        skippedFrames.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    if(!makeContextCurrent())
+    {
+        OpenGLOutputRing::release(frame);
+        return;
+    }
+
+    initialize();
+
+    beginFrame();
+
+    stateCache.bindVertexArray(vaoID);
+
+    stateCache.useProgram(shader->programId());
+
+    //Make the GPU wait until the producer has finished the frame
+    if(frame.fence)
+        glWaitSync(frame.fence, 0, GL_TIMEOUT_IGNORED);
+
+    presentedSerial = inputSerial;
+
+    OpenGLRenderer::OpenGLPresentMode mode = presentMode;
+    if(cachedInput && mode == OpenGLRenderer::OpenGLPresentCopy)
+        mode = OpenGLRenderer::OpenGLPresentSample;
+
+    stateCache.activeTexture(GL_TEXTURE0 + textureUnit);
+
+    GLuint presentTextureID = outputTextureID;
+
+    if(mode != OpenGLRenderer::OpenGLPresentCopy)
+        presentTextureID = frame.textureID;
+    else
+    {
+        //Render to FBO
+        beginPass("display FBO pass");
+
+        stateCache.bindFramebuffer(GL_FRAMEBUFFER,fboID);
+
+        glClearColor(0.0f,0.0f,0.0f,1.0f);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        stateCache.disable(GL_DEPTH_TEST);
+
+        stateCache.bindTexture(GL_TEXTURE_2D, frame.textureID);
+
+        stateCache.viewport(0,0,renderSpecs.frameType.width,renderSpecs.frameType.height);
+
+        glDrawBuffers(1, &GL_outputColorAttachment);
+        glDrawArrays(GL_TRIANGLES, 0, 6);
+
+        endPass();
+    }
+
+    //Render to the surface's default FBO, as the native window does
+    beginPass("display default framebuffer pass");
+
+    if(mode == OpenGLRenderer::OpenGLPresentBlit)
+    {
+        if(!presentFBO)
+            glGenFramebuffers(1, &presentFBO);
+
+        stateCache.bindFramebuffer(GL_READ_FRAMEBUFFER, presentFBO);
+        glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, frame.textureID, 0);
+
+        stateCache.bindFramebuffer(GL_DRAW_FRAMEBUFFER, openGLContext->defaultFramebufferObject());
+
+        unsigned int sourceWidth = frame.width ? frame.width : renderSpecs.frameType.width;
+        unsigned int sourceHeight = frame.height ? frame.height : renderSpecs.frameType.height;
+
+        glBlitFramebuffer(0, 0, sourceWidth, sourceHeight,
+                          0, 0, renderSpecs.frameType.width, renderSpecs.frameType.height,
+                          GL_COLOR_BUFFER_BIT,
+                          (sourceWidth == renderSpecs.frameType.width && sourceHeight == renderSpecs.frameType.height) ? GL_NEAREST : GL_LINEAR);
+    }
+    else
+    {
+        stateCache.bindFramebuffer(GL_FRAMEBUFFER, openGLContext->defaultFramebufferObject());
+
+        glClearColor(0.0f,0.0f,0.0f,1.0f);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        stateCache.disable(GL_DEPTH_TEST);
+
+        stateCache.bindTexture(GL_TEXTURE_2D, presentTextureID);
+
+        stateCache.viewport(0,0,renderSpecs.frameType.width,renderSpecs.frameType.height);
+        glDrawArrays(GL_TRIANGLES, 0, 6);
+    }
+
+    endPass();
+    endProfiledFrame();
+
+    OpenGLOutputRing::release(frame);
+
+    //Left current, like the native window
+    openGLContext->swapBuffers(this);
+
+    if(swapDelay > 0.0)
+        std::this_thread::sleep_for(std::chrono::duration<double,std::milli>(swapDelay));
+
+    presentedFrames.fetch_add(1, std::memory_order_relaxed);
+
+    updateEndTime();
+}
+
+void OpenGLBenchmarkDisplay::stop()
+{
+    doneContextCurrent();
+}
+
+bool OpenGLBenchmarkDisplay::makeContextCurrent()
+{
+    return stateCache.makeCurrent(openGLContext, this);
+}
+
+void OpenGLBenchmarkDisplay::doneContextCurrent()
+{
+    stateCache.doneCurrent(openGLContext);
+}
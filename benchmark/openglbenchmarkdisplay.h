@@ -0,0 +1,85 @@
+#ifndef OPENGLBENCHMARKDISPLAY_H
+#define OPENGLBENCHMARKDISPLAY_H
+
+#include <openglrenderer.h>
+#include <openglframemailbox.h>
+#include <opengloutputring.h>
+
+#include <QMutex>
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+
+#include <atomic>
+
+//Headless stand-in for OpenGLNativeRenderWindow; runs the same two display passes on an offscreen surface
+class OpenGLBenchmarkDisplay : public QOffscreenSurface, public OpenGLRenderer
+{
+    Q_OBJECT
+public:
+    OpenGLBenchmarkDisplay(QScreen* outputScreen,
+                           OpenGLRenderer::OpenGLRenderSpecs specs,
+                           const QSurfaceFormat& surfaceFormat,
+                           QOpenGLContext* sharedContext);
+
+    virtual ~OpenGLBenchmarkDisplay();
+
+    QOpenGLContext* getOpenGLContext();
+
+    unsigned long long getPresentedFrameCount() const;
+    unsigned long long getSkippedFrameCount() const;
+
+    //Time to block after every swap, standing in for a swap that waits for vsync; in milliseconds
+    void setSwapDelay(double delay);
+
+public slots:
+    //Present the input directly, as OpenGLNativeRenderWindow::setCachedInput
+    void setCachedInput(bool enabled);
+
+    //As OpenGLNativeRenderWindow::setPresentMode / setSkipUnchanged
+    void setPresentMode(OpenGLRenderer::OpenGLPresentMode mode);
+    void setSkipUnchanged(bool enabled);
+
+    //Present every frame taken from the mailbox as it arrives, on this display's thread. Returns false if the mailbox has
+    //no room for another reader
+    bool setFrameMailbox(OpenGLFrameMailbox* mailbox);
+    void takeFrame();
+
+    //Render methods
+    void setFrame(OpenGLOutputRing::OpenGLOutputFrame frame);
+    virtual void renderFrame() override;
+
+    //Releases the context, which stays current between frames; called by OpenGLPresenterPool::stop on this thread
+    virtual void stop() override;
+
+protected:
+    bool makeContextCurrent();
+    void doneContextCurrent();
+
+    QSurfaceFormat openGLFormat;
+    QOpenGLContext* openGLContext;
+
+    //Held for the duration of a paint, as in the native window
+    OpenGLOutputRing::OpenGLOutputFrame inputFrame;
+    QMutex inputMutex;
+
+    unsigned long long inputSerial;
+    unsigned long long presentedSerial;
+
+    std::atomic<unsigned long long> skippedFrames;
+
+    OpenGLRenderer::OpenGLPresentMode presentMode;
+    bool skipUnchanged;
+
+    GLuint presentFBO;
+
+    bool cachedInput;
+
+    OpenGLFrameMailbox* frameMailbox;
+    int mailboxReader;
+
+    double swapDelay;
+
+    std::atomic<unsigned long long> presentedFrames;
+};
+
+#endif // OPENGLBENCHMARKDISPLAY_H
@@ -8,6 +8,7 @@
 #define OPENGL_SWAP_INTERVAL 1
 #define OPENGL_SWAP_BEHAVIOUR 0
 #define OPENGL_NUM_DISPLAY_WINDOWS 1
+#define OPENGL_NUM_OUTPUT_BUFFERS 2
 
 int main(int argc, char *argv[])
 {
@@ -47,7 +48,10 @@ int main(int argc, char *argv[])
             GL_TEXTURE_2D,
             GL_RGBA8,
             GL_RGBA,
-            GL_UNSIGNED_BYTE
+            GL_UNSIGNED_BYTE,
+            OpenGLRenderer::OpenGLPlanesPacked,
+            OpenGLRenderer::OpenGLColorBT601,
+            false
     };
 
     OpenGLRenderer::OpenGLRenderSpecs videoSpecs = OpenGLRenderer::OpenGLRenderSpecs
@@ -61,7 +65,8 @@ int main(int argc, char *argv[])
     MainWindow w(nullptr,
                  nullptr,
                  videoSpecs,
-                 OPENGL_NUM_DISPLAY_WINDOWS);
+                 OPENGL_NUM_DISPLAY_WINDOWS,
+                 OPENGL_NUM_OUTPUT_BUFFERS);
     w.show();
 
     return a.exec();
@@ -3,14 +3,19 @@
 
 MainWindow::MainWindow(QWidget *parent, QScreen *outputScreen,
                        OpenGLRenderer::OpenGLRenderSpecs specs,
-                       unsigned int numDisplayWindows) :
+                       unsigned int numDisplayWindows,
+                       unsigned int numOutputBuffers) :
     QMainWindow(parent),
     ui(new Ui::MainWindow),
     videoSpecs(specs),
     mainOutputScreen(outputScreen),
     textureRenderer(nullptr),
     renderThread(nullptr),
+    numRenderBuffers(numOutputBuffers),
+    outputCache(nullptr),
+    frameMailboxes(),
     numDisplays(numDisplayWindows),
+    presenterPool(nullptr),
     textRefreshTime(150)
 {
     ui->setupUi(this);
@@ -21,7 +26,31 @@ MainWindow::MainWindow(QWidget *parent, QScreen *outputScreen,
 
 MainWindow::~MainWindow()
 {
+    //Displays first, so none of them is presenting while the renderer's resources go away. Contexts stay current between
+    //frames, so every object lets go of its own on the thread that owns it before that thread exits
+    presenterPool->stop();
+
+    if(renderThread->isRunning())
+    {
+        QMetaObject::invokeMethod(textureRenderer, "stop", Qt::BlockingQueuedConnection);
+        QMetaObject::invokeMethod(outputCache, "stop", Qt::BlockingQueuedConnection);
+    }
+
     renderThread->quit();
+    renderThread->wait();
+
+    //No context is current anywhere now
+    delete textureRenderer;
+    delete outputCache;
+
+    foreach(OpenGLNativeRenderWindow* display, textureDisplay)
+        delete display;
+
+    foreach(OpenGLFrameMailbox* mailbox, frameMailboxes)
+        delete mailbox;
+
+    delete presenterPool;
+    delete renderThread;
 
     delete ui;
 }
@@ -34,7 +63,8 @@ bool MainWindow::initialize()
                                               nullptr,
                                               videoSpecs,
                                               QSurfaceFormat::defaultFormat(),
-                                              nullptr);
+                                              nullptr,
+                                              numRenderBuffers);
 
     textureRenderer->moveToThread(renderThread);
 
@@ -62,31 +92,66 @@ bool MainWindow::initialize()
     });
 
     QObject::connect(renderThread,&QThread::started,textureRenderer,&OpenGLRenderSurface::start);
-    QObject::connect(renderThread,&QThread::finished,this,[=]()
-    {
-        delete textureRenderer;
-        textureRenderer = nullptr;
 
-        foreach(OpenGLNativeRenderWindow* display, textureDisplay)
-        {
-            delete display;
-            display = nullptr;
-        }
-    });
+    //Output cache; lives on the render thread so the renderer feeds it directly
+    outputCache = new OpenGLOutputCache(mainOutputScreen,
+                                        nullptr,
+                                        videoSpecs,
+                                        QSurfaceFormat::defaultFormat(),
+                                        textureRenderer->getOpenGLContext(),
+                                        numRenderBuffers);
+
+    QObject::connect(textureRenderer,&OpenGLRenderSurface::frameReady,outputCache,&OpenGLOutputCache::setFrame);
+
+    outputCache->moveToThread(renderThread);
+
+    //Displays; a display blocked in a swap only holds up its own thread, never the renderer
+    presenterPool = new OpenGLPresenterPool();
 
-    //Displays
     textureDisplay.assign(numDisplays,nullptr);
-    foreach(OpenGLNativeRenderWindow* display, textureDisplay)
+    for(OpenGLNativeRenderWindow*& display : textureDisplay)
     {
         display = new OpenGLNativeRenderWindow(mainOutputScreen,
                                                videoSpecs,
                                                QSurfaceFormat::defaultFormat(),
                                                textureRenderer->getOpenGLContext());
-        QObject::connect(textureRenderer,&OpenGLRenderSurface::frameReady,display,&OpenGLNativeRenderWindow::setFrame);
+        //Each display presents its size straight from the cache
+        outputCache->addOutputSize(videoSpecs.frameType.width,videoSpecs.frameType.height);
+        display->setCachedInput(true);
+
+        //Published from the render thread as the cache emits; the display is only woken, never sent the frame itself
+        OpenGLFrameMailbox* mailbox = new OpenGLFrameMailbox(nullptr,
+                                                             videoSpecs.frameType.width,
+                                                             videoSpecs.frameType.height);
+        frameMailboxes.push_back(mailbox);
+
+        QObject::connect(outputCache,&OpenGLOutputCache::frameReady,mailbox,&OpenGLFrameMailbox::publish,Qt::DirectConnection);
+
+        bool readerAdded = display->setFrameMailbox(mailbox);
+        assert(readerAdded);
+
+        //A resized display moves its size in the cache (queued to the render thread, so it applies from the next frame).
+        //Its mailbox keeps passing frames of the old size until the new one arrives, and the display stretches them
+        QObject::connect(display,&OpenGLNativeRenderWindow::outputSizeChanged,outputCache,&OpenGLOutputCache::moveOutputSize);
+        QObject::connect(display,&OpenGLNativeRenderWindow::outputSizeChanged,mailbox,[mailbox](unsigned int,
+                                                                                               unsigned int,
+                                                                                               unsigned int width,
+                                                                                               unsigned int height)
+        {
+            mailbox->setFrameSize(width,height);
+        },Qt::DirectConnection);
+
+        //The first display's swaps can pace the renderer (OpenGLRenderSurface::setSwapDriven)
+        if(&display == &textureDisplay.front())
+            QObject::connect(display,&OpenGLNativeRenderWindow::frameSwapped,textureRenderer->getFrameScheduler(),&OpenGLFrameScheduler::swapCompleted);
+
         QObject::connect(this,&MainWindow::showNativeDisplay,display,&OpenGLNativeRenderWindow::showNative);
 
-        display->moveToThread(renderThread);
+        presenterPool->addDisplay(display);
     }
+    presenterPool->start();
+
+    //Queued to every presentation thread, so each display creates its native window and context there
     emit showNativeDisplay();
 
     renderThread->start();
@@ -5,6 +5,9 @@
 #include <QThread>
 
 #include <openglrendersurface.h>
+#include <opengloutputcache.h>
+#include <openglframemailbox.h>
+#include <openglpresenterpool.h>
 #include <openglnativerenderwindow.h>
 
 namespace Ui {
@@ -26,11 +29,15 @@ public:
             GL_TEXTURE_2D,
             GL_RGBA8,
             GL_RGBA,
-            GL_UNSIGNED_BYTE
+            GL_UNSIGNED_BYTE,
+            OpenGLRenderer::OpenGLPlanesPacked,
+            OpenGLRenderer::OpenGLColorBT601,
+            false
             },
             60.0
             },
-            unsigned int numDisplayWindows = 1);
+            unsigned int numDisplayWindows = 1,
+            unsigned int numOutputBuffers = 2);
 
     ~MainWindow();
 
@@ -53,10 +60,21 @@ private:
 
     QThread* renderThread;
 
-    //Displays the texture rendered by textureRenderer on the GUI thread
+    //Number of output textures the renderer cycles through
+    unsigned int numRenderBuffers;
+
+    //Computes every distinct display size once per frame and feeds all displays
+    OpenGLOutputCache* outputCache;
+
+    //Hand the cache's frames at each display's size to that display; a slow display drops frames instead of queueing them
+    std::vector<OpenGLFrameMailbox*> frameMailboxes;
+
+    //Displays the texture rendered by textureRenderer, each on its own presentation thread
     unsigned int numDisplays;
     std::vector<OpenGLNativeRenderWindow*> textureDisplay;
 
+    OpenGLPresenterPool* presenterPool;
+
     //Used for timing
     std::chrono::time_point<std::chrono::high_resolution_clock> t_startRender;
     std::chrono::time_point<std::chrono::high_resolution_clock> t_endRender;
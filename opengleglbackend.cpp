@@ -0,0 +1,238 @@
+#include "opengleglbackend.h"
+
+#include <openglnativerenderwindow.h>
+
+#include <QDebug>
+#include <QMutex>
+#include <QMutexLocker>
+
+#include <algorithm>
+#include <cstring>
+
+//All backends without a share context use the same surfaceless display; the last one to go terminates it
+static QMutex surfacelessMutex;
+static unsigned int surfacelessUsers = 0;
+
+OpenGLEGLBackend::OpenGLEGLBackend(OpenGLNativeRenderWindow *window,
+                                   const QSurfaceFormat &surfaceFormat,
+                                   QOpenGLContext *sharedContext) :
+    OpenGLNativeBackend(window,surfaceFormat,sharedContext),
+    eglDisplay(EGL_NO_DISPLAY),
+    eglConfig(nullptr),
+    eglContext(EGL_NO_CONTEXT),
+    eglSurface(EGL_NO_SURFACE),
+    surfaceWidth(0),
+    surfaceHeight(0),
+    ownsDisplay(false)
+{
+
+}
+
+OpenGLEGLBackend::~OpenGLEGLBackend()
+{
+    if(eglDisplay == EGL_NO_DISPLAY)
+        return;
+
+    eglMakeCurrent(eglDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+
+    if(eglSurface != EGL_NO_SURFACE)
+        eglDestroySurface(eglDisplay, eglSurface);
+    if(eglContext != EGL_NO_CONTEXT)
+        eglDestroyContext(eglDisplay, eglContext);
+
+    //Qt owns the shared context's display and terminates it itself
+    if(ownsDisplay)
+        releaseSurfacelessDisplay();
+}
+
+EGLDisplay OpenGLEGLBackend::getDisplay() const
+{
+    return eglDisplay;
+}
+
+EGLContext OpenGLEGLBackend::getContext() const
+{
+    return eglContext;
+}
+
+EGLSurface OpenGLEGLBackend::getSurface() const
+{
+    return eglSurface;
+}
+
+bool OpenGLEGLBackend::createNative(unsigned int width, unsigned int height)
+{
+    //Share with the producer's context; this requires Qt itself to run on EGL (eglfs, minimalegl, wayland, xcb_egl).
+    //Without sharing the window could never sample the producer's frames, so a non EGL platform is fatal
+    EGLContext eglShareContext = EGL_NO_CONTEXT;
+    if(sharedOpenGLContext)
+    {
+        QEGLNativeContext sharedNativeContext = qvariant_cast<QEGLNativeContext>(sharedOpenGLContext->nativeHandle());
+
+        eglDisplay = sharedNativeContext.display();
+        eglShareContext = sharedNativeContext.context();
+
+        if(eglShareContext == EGL_NO_CONTEXT || eglDisplay == EGL_NO_DISPLAY)
+            qFatal("OpenGLEGLBackend: shared context is not an EGL context; run Qt on an EGL platform (QT_QPA_PLATFORM=eglfs / minimalegl / wayland-egl / xcb with QT_XCB_GL_INTEGRATION=xcb_egl)");
+    }
+    else
+    {
+        //Standalone drawable (nothing to share frames with), e.g. for probing the EGL driver
+        eglDisplay = acquireSurfacelessDisplay();
+        ownsDisplay = eglDisplay != EGL_NO_DISPLAY;
+    }
+
+    if(eglDisplay == EGL_NO_DISPLAY || !eglInitialize(eglDisplay, nullptr, nullptr))
+        return false;
+
+    if(!eglBindAPI(EGL_OPENGL_API))
+        return false;
+
+    //Pick a pbuffer capable config matching the requested format
+    const EGLint configAttributes[] =
+    {
+        EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_RED_SIZE, openGLFormat.redBufferSize(),
+        EGL_GREEN_SIZE, openGLFormat.greenBufferSize(),
+        EGL_BLUE_SIZE, openGLFormat.blueBufferSize(),
+        EGL_ALPHA_SIZE, openGLFormat.alphaBufferSize(),
+        EGL_DEPTH_SIZE, std::min(openGLFormat.depthBufferSize(), 24),
+        EGL_STENCIL_SIZE, openGLFormat.stencilBufferSize(),
+        EGL_NONE
+    };
+
+    EGLint numConfigs = 0;
+    if(!eglChooseConfig(eglDisplay, configAttributes, &eglConfig, 1, &numConfigs) || numConfigs < 1)
+        return false;
+
+    const EGLint contextAttributes[] =
+    {
+        EGL_CONTEXT_MAJOR_VERSION, openGLFormat.majorVersion(),
+        EGL_CONTEXT_MINOR_VERSION, openGLFormat.minorVersion(),
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_NONE
+    };
+
+    eglContext = eglCreateContext(eglDisplay, eglConfig, eglShareContext, contextAttributes);
+    if(eglContext == EGL_NO_CONTEXT)
+        return false;
+
+    return createSurface(width, height);
+}
+
+bool OpenGLEGLBackend::showNative()
+{
+    //There is nothing to show; the render window is ready as soon as the drawable exists
+    return eglSurface != EGL_NO_SURFACE;
+}
+
+void OpenGLEGLBackend::resizeNative(unsigned int width, unsigned int height)
+{
+    if(width == surfaceWidth && height == surfaceHeight)
+        return;
+
+    if(eglSurface != EGL_NO_SURFACE)
+    {
+        eglDestroySurface(eglDisplay, eglSurface);
+        eglSurface = EGL_NO_SURFACE;
+    }
+
+    createSurface(width, height);
+}
+
+QVariant OpenGLEGLBackend::getNativeContext() const
+{
+    return QVariant::fromValue(QEGLNativeContext(eglContext,eglDisplay));
+}
+
+bool OpenGLEGLBackend::makeContextCurrent()
+{
+    return eglMakeCurrent(eglDisplay, eglSurface, eglSurface, eglContext);
+}
+
+void OpenGLEGLBackend::doneContextCurrent()
+{
+    eglMakeCurrent(eglDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+}
+
+bool OpenGLEGLBackend::isContextCurrent() const
+{
+    return eglGetCurrentContext() == eglContext &&
+           eglGetCurrentSurface(EGL_DRAW) == eglSurface;
+}
+
+void OpenGLEGLBackend::swapBuffers()
+{
+    //No-op for pbuffers, but keeps the present pass identical to the windowed backends
+    eglSwapBuffers(eglDisplay, eglSurface);
+}
+
+void OpenGLEGLBackend::requestUpdate()
+{
+    //No message loop to go through; render right away on the window's thread
+    if(renderWindow->isVisible())
+        renderWindow->renderFrame();
+}
+
+EGLDisplay OpenGLEGLBackend::acquireSurfacelessDisplay()
+{
+    EGLDisplay display = surfacelessDisplay();
+    if(display == EGL_NO_DISPLAY)
+        return display;
+
+    QMutexLocker locker(&surfacelessMutex);
+    surfacelessUsers++;
+
+    return display;
+}
+
+void OpenGLEGLBackend::releaseSurfacelessDisplay()
+{
+    QMutexLocker locker(&surfacelessMutex);
+
+    //eglInitialize is not reference counted, so only the last user may terminate
+    if(surfacelessUsers > 0 && --surfacelessUsers == 0)
+    {
+        eglTerminate(eglDisplay);
+        eglReleaseThread();
+    }
+
+    ownsDisplay = false;
+}
+
+EGLDisplay OpenGLEGLBackend::surfacelessDisplay()
+{
+    //Prefer Mesa's surfaceless platform so no display server or GPU node is needed
+    const char* clientExtensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+
+    if(clientExtensions && std::strstr(clientExtensions, "EGL_MESA_platform_surfaceless"))
+    {
+        PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+                reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(eglGetProcAddress("eglGetPlatformDisplayEXT"));
+
+        if(getPlatformDisplay)
+            return getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+    }
+
+    return eglGetDisplay(EGL_DEFAULT_DISPLAY);
+}
+
+bool OpenGLEGLBackend::createSurface(unsigned int width, unsigned int height)
+{
+    const EGLint surfaceAttributes[] =
+    {
+        EGL_WIDTH, static_cast<EGLint>(width),
+        EGL_HEIGHT, static_cast<EGLint>(height),
+        EGL_NONE
+    };
+
+    eglSurface = eglCreatePbufferSurface(eglDisplay, eglConfig, surfaceAttributes);
+    if(eglSurface == EGL_NO_SURFACE)
+        return false;
+
+    surfaceWidth = width;
+    surfaceHeight = height;
+
+    return true;
+}
@@ -0,0 +1,63 @@
+#ifndef OPENGLEGLBACKEND_H
+#define OPENGLEGLBACKEND_H
+
+#include <openglnativebackend.h>
+
+#include <QtPlatformHeaders/QEGLNativeContext>
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+//Headless EGL output: a pbuffer drawable on the shared context's display. The shared context must be an EGL one
+//(Qt on an EGL platform), anything else is fatal. Without a share context the drawable lives on Mesa's surfaceless
+//platform, which is only good for probing the driver. Frames are rendered as soon as they arrive and swaps never block
+class OpenGLEGLBackend : public OpenGLNativeBackend
+{
+public:
+    OpenGLEGLBackend(OpenGLNativeRenderWindow* window,
+                     const QSurfaceFormat& surfaceFormat,
+                     QOpenGLContext* sharedContext);
+
+    virtual ~OpenGLEGLBackend();
+
+    //EGL resource access
+    EGLDisplay getDisplay() const;
+    EGLContext getContext() const;
+    EGLSurface getSurface() const;
+
+    virtual bool createNative(unsigned int width, unsigned int height) override;
+    virtual bool showNative() override;
+
+    virtual void resizeNative(unsigned int width, unsigned int height) override;
+
+    virtual QVariant getNativeContext() const override;
+
+    //EGL context methods
+    virtual bool makeContextCurrent() override;
+    virtual void doneContextCurrent() override;
+    virtual void swapBuffers() override;
+
+    virtual bool isContextCurrent() const override;
+
+    virtual void requestUpdate() override;
+
+protected:
+    EGLDisplay surfacelessDisplay();
+    EGLDisplay acquireSurfacelessDisplay();
+    void releaseSurfacelessDisplay();
+    bool createSurface(unsigned int width, unsigned int height);
+
+    //EGL resources
+    EGLDisplay eglDisplay;
+    EGLConfig eglConfig;
+    EGLContext eglContext;
+    EGLSurface eglSurface;
+
+    unsigned int surfaceWidth;
+    unsigned int surfaceHeight;
+
+    //Whether eglDisplay is the surfaceless display this backend has to release
+    bool ownsDisplay;
+};
+
+#endif // OPENGLEGLBACKEND_H
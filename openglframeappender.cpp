@@ -0,0 +1,173 @@
+#include "openglframeappender.h"
+
+#include <QRunnable>
+
+#include <algorithm>
+#include <cstring>
+
+//Writes one queued frame and hands its buffer back
+class OpenGLFrameAppendTask : public QRunnable
+{
+public:
+    OpenGLFrameAppendTask(OpenGLFrameAppender* appender,
+                          unsigned int bufferIndex,
+                          qint64 timestamp) :
+        appender(appender),
+        bufferIndex(bufferIndex),
+        timestamp(timestamp)
+    {
+        setAutoDelete(true);
+    }
+
+    void run() override
+    {
+        appender->writeFrame(bufferIndex, timestamp);
+    }
+
+protected:
+    OpenGLFrameAppender* appender;
+
+    unsigned int bufferIndex;
+    qint64 timestamp;
+};
+
+OpenGLFrameAppender::OpenGLFrameAppender(unsigned int maxQueuedFrames) :
+    file(),
+    header(),
+    buffers(std::max(maxQueuedFrames,1u)),
+    freeBuffers(),
+    timestamps(),
+    stats(OpenGLFrameAppenderStats{0,0,0,0})
+{
+    writerThread.setMaxThreadCount(1);
+}
+
+OpenGLFrameAppender::~OpenGLFrameAppender()
+{
+    finish();
+}
+
+bool OpenGLFrameAppender::open(const QString &fileName, const OpenGLRenderer::OpenGLTextureSpecs &specs)
+{
+    finish();
+
+    header = OpenGLFrameFile::createHeader(specs);
+
+    file.setFileName(fileName);
+    if(!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        return false;
+
+    //Header padded to a page, so the first frame is page aligned
+    std::vector<char> headerPage(header.headerSize, 0);
+    std::memcpy(headerPage.data(), &header, sizeof(header));
+
+    if(file.write(headerPage.data(), static_cast<qint64>(headerPage.size())) != static_cast<qint64>(headerPage.size()))
+    {
+        file.close();
+        return false;
+    }
+
+    //Stride sized buffers; the padding stays zero
+    freeBuffers.clear();
+    for(unsigned int i = 0; i < buffers.size(); i++)
+    {
+        buffers[i].assign(static_cast<size_t>(header.frameStride), 0);
+        freeBuffers.push_back(i);
+    }
+
+    timestamps.clear();
+    stats = OpenGLFrameAppenderStats{0,0,0,0};
+
+    return true;
+}
+
+bool OpenGLFrameAppender::isOpen() const
+{
+    return file.isOpen();
+}
+
+bool OpenGLFrameAppender::append(const unsigned char *data, qint64 timestamp)
+{
+    if(!data || !file.isOpen())
+        return false;
+
+    unsigned int bufferIndex = 0;
+
+    {
+        QMutexLocker locker(&mutex);
+
+        if(freeBuffers.empty())
+        {
+            stats.stalls++;
+
+            while(freeBuffers.empty())
+                bufferFreed.wait(&mutex);
+        }
+
+        bufferIndex = freeBuffers.back();
+        freeBuffers.pop_back();
+    }
+
+    std::memcpy(buffers[bufferIndex].data(), data, static_cast<size_t>(header.frameSize));
+
+    writerThread.start(new OpenGLFrameAppendTask(this, bufferIndex, timestamp));
+
+    return true;
+}
+
+bool OpenGLFrameAppender::finish()
+{
+    if(!file.isOpen())
+        return false;
+
+    writerThread.waitForDone();
+
+    //Index right after the last frame, which keeps it page aligned too
+    header.frameCount = timestamps.size();
+    header.indexOffset = header.headerSize + header.frameCount * header.frameStride;
+
+    qint64 indexSize = static_cast<qint64>(timestamps.size() * sizeof(qint64));
+
+    bool finished = file.seek(static_cast<qint64>(header.indexOffset)) &&
+                    file.write(reinterpret_cast<const char*>(timestamps.data()), indexSize) == indexSize &&
+                    file.seek(0) &&
+                    file.write(reinterpret_cast<const char*>(&header), sizeof(header)) == static_cast<qint64>(sizeof(header));
+
+    file.close();
+
+    return finished;
+}
+
+OpenGLFrameAppender::OpenGLFrameAppenderStats OpenGLFrameAppender::getStats() const
+{
+    QMutexLocker locker(&mutex);
+    return stats;
+}
+
+void OpenGLFrameAppender::writeFrame(unsigned int bufferIndex, qint64 timestamp)
+{
+    //Whole strides, so a failed frame leaves no gap; frame N is always at headerSize + N * frameStride
+    qint64 stride = static_cast<qint64>(header.frameStride);
+    qint64 position = static_cast<qint64>(header.headerSize + timestamps.size() * header.frameStride);
+
+    bool written = file.seek(position) &&
+                   file.write(reinterpret_cast<const char*>(buffers[bufferIndex].data()), stride) == stride;
+
+    if(written)
+        timestamps.push_back(timestamp);
+
+    QMutexLocker locker(&mutex);
+
+    if(written)
+    {
+        stats.framesAppended++;
+        stats.bytesWritten += static_cast<unsigned long long>(stride);
+    }
+    else
+    {
+        stats.failures++;
+    }
+
+    freeBuffers.push_back(bufferIndex);
+    bufferFreed.wakeOne();
+}
@@ -0,0 +1,73 @@
+#ifndef OPENGLFRAMEAPPENDER_H
+#define OPENGLFRAMEAPPENDER_H
+
+#include <openglframefile.h>
+
+#include <QFile>
+#include <QMutex>
+#include <QThreadPool>
+#include <QWaitCondition>
+
+#include <vector>
+
+//Appends frames to an OpenGLFrameFile container on a background thread. Frames are copied into a fixed set of recycled
+//buffers and written in order by a single worker; once all buffers are queued append blocks until one is free, so a
+//capture runs at disk speed and never drops a frame. finish writes the timestamp index and completes the header
+class OpenGLFrameAppender
+{
+public:
+    //Totals since open
+    typedef struct OpenGLFrameAppenderStats
+    {
+        unsigned long long framesAppended;
+        unsigned long long bytesWritten;
+
+        unsigned long long failures;
+
+        //Calls to append that had to wait for a free buffer
+        unsigned long long stalls;
+    }
+    OpenGLFrameAppenderStats;
+
+    OpenGLFrameAppender(unsigned int maxQueuedFrames = 8);
+
+    virtual ~OpenGLFrameAppender();
+
+    //Creates (or truncates) the file for frames of these specs and writes an unfinished header
+    bool open(const QString& fileName, const OpenGLRenderer::OpenGLTextureSpecs& specs);
+
+    bool isOpen() const;
+
+    //Copies getFrameSize(specs) bytes and returns once they are queued; timestamps are in microseconds and should grow
+    bool append(const unsigned char* data, qint64 timestamp);
+
+    //Waits for every queued frame, then writes the index and the final header and closes the file
+    bool finish();
+
+    OpenGLFrameAppenderStats getStats() const;
+
+protected:
+    friend class OpenGLFrameAppendTask;
+
+    //Called on the worker, in append order
+    void writeFrame(unsigned int bufferIndex, qint64 timestamp);
+
+    QFile file;
+    OpenGLFrameFile::OpenGLFrameFileHeader header;
+
+    //One thread, so frames land in the order they were appended
+    QThreadPool writerThread;
+
+    std::vector<std::vector<unsigned char>> buffers;
+    std::vector<unsigned int> freeBuffers;
+
+    //Only touched by the worker until finish
+    std::vector<qint64> timestamps;
+
+    mutable QMutex mutex;
+    QWaitCondition bufferFreed;
+
+    OpenGLFrameAppenderStats stats;
+};
+
+#endif // OPENGLFRAMEAPPENDER_H
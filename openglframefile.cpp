@@ -0,0 +1,224 @@
+#include "openglframefile.h"
+
+#ifdef Q_OS_WIN
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+#include <algorithm>
+#include <cstring>
+
+static const char frameFileMagic[8] = {'W','G','L','F','R','A','M','E'};
+static const quint32 frameFileVersion = 1;
+
+OpenGLFrameFile::OpenGLFrameFile() :
+    file(),
+    mapping(nullptr),
+    mappingSize(0),
+    header(),
+    specs{0,0,0,GL_TEXTURE_2D,0,0,0,OpenGLRenderer::OpenGLPlanesPacked,OpenGLRenderer::OpenGLColorBT601,false},
+    frameCount(0),
+    timestamps(nullptr)
+{
+
+}
+
+OpenGLFrameFile::~OpenGLFrameFile()
+{
+    close();
+}
+
+OpenGLFrameFile::OpenGLFrameFileHeader OpenGLFrameFile::createHeader(const OpenGLRenderer::OpenGLTextureSpecs &specs)
+{
+    OpenGLFrameFileHeader header;
+    std::memset(&header, 0, sizeof(header));
+
+    std::memcpy(header.magic, frameFileMagic, sizeof(header.magic));
+    header.version = frameFileVersion;
+    header.headerSize = static_cast<quint32>(pageSize);
+
+    header.width = specs.width;
+    header.height = specs.height;
+    header.channels = specs.channels;
+    header.target = specs.target;
+    header.internalFormat = static_cast<quint32>(specs.internalFormat);
+    header.format = specs.format;
+    header.dataType = specs.dataType;
+    header.planeLayout = specs.planeLayout;
+    header.colorMatrix = specs.colorMatrix;
+    header.fullRange = specs.fullRange ? 1 : 0;
+
+    header.frameSize = OpenGLRenderer::getFrameSize(specs);
+    header.frameStride = (header.frameSize + pageSize - 1) / pageSize * pageSize;
+
+    return header;
+}
+
+bool OpenGLFrameFile::isValidHeader(const OpenGLFrameFile::OpenGLFrameFileHeader &header)
+{
+    return std::memcmp(header.magic, frameFileMagic, sizeof(header.magic)) == 0 &&
+           header.version == frameFileVersion &&
+           header.headerSize >= sizeof(OpenGLFrameFileHeader) &&
+           header.frameSize > 0 &&
+           header.frameStride >= header.frameSize;
+}
+
+bool OpenGLFrameFile::open(const QString &fileName)
+{
+    close();
+
+    file.setFileName(fileName);
+    if(!file.open(QIODevice::ReadOnly))
+        return false;
+
+    mappingSize = file.size();
+    if(mappingSize < static_cast<qint64>(sizeof(OpenGLFrameFileHeader)))
+    {
+        close();
+        return false;
+    }
+
+    mapping = file.map(0, mappingSize);
+    if(!mapping)
+    {
+        close();
+        return false;
+    }
+
+    std::memcpy(&header, mapping, sizeof(header));
+    if(!isValidHeader(header))
+    {
+        close();
+        return false;
+    }
+
+    specs = OpenGLRenderer::OpenGLTextureSpecs{header.width,
+                                               header.height,
+                                               header.channels,
+                                               header.target,
+                                               static_cast<GLint>(header.internalFormat),
+                                               header.format,
+                                               header.dataType,
+                                               static_cast<OpenGLRenderer::OpenGLPlaneLayout>(header.planeLayout),
+                                               static_cast<OpenGLRenderer::OpenGLColorMatrix>(header.colorMatrix),
+                                               header.fullRange != 0};
+
+    quint64 indexSize = header.frameCount * sizeof(qint64);
+
+    if(header.indexOffset > 0 && header.indexOffset + indexSize <= static_cast<quint64>(mappingSize))
+    {
+        frameCount = header.frameCount;
+        timestamps = reinterpret_cast<const qint64*>(mapping + header.indexOffset);
+    }
+    else
+    {
+        //Never finished; count the frames that made it to disk
+        quint64 dataSize = static_cast<quint64>(mappingSize) - std::min<quint64>(header.headerSize, mappingSize);
+        frameCount = (dataSize + header.frameStride - header.frameSize) / header.frameStride;
+        timestamps = nullptr;
+    }
+
+    return true;
+}
+
+void OpenGLFrameFile::close()
+{
+    if(mapping)
+        file.unmap(mapping);
+
+    if(file.isOpen())
+        file.close();
+
+    mapping = nullptr;
+    mappingSize = 0;
+
+    frameCount = 0;
+    timestamps = nullptr;
+}
+
+bool OpenGLFrameFile::isOpen() const
+{
+    return mapping != nullptr;
+}
+
+const OpenGLRenderer::OpenGLTextureSpecs &OpenGLFrameFile::getSpecs() const
+{
+    return specs;
+}
+
+unsigned long long OpenGLFrameFile::getFrameCount() const
+{
+    return frameCount;
+}
+
+size_t OpenGLFrameFile::getFrameSize() const
+{
+    return mapping ? static_cast<size_t>(header.frameSize) : 0;
+}
+
+const unsigned char *OpenGLFrameFile::getFrame(unsigned long long frameIndex) const
+{
+    if(!mapping || frameIndex >= frameCount)
+        return nullptr;
+
+    return mapping + header.headerSize + frameIndex * header.frameStride;
+}
+
+qint64 OpenGLFrameFile::getTimestamp(unsigned long long frameIndex) const
+{
+    if(!timestamps || frameIndex >= frameCount)
+        return 0;
+
+    //The index is only 8 byte aligned if the file says so; copy rather than trust it
+    qint64 timestamp = 0;
+    std::memcpy(&timestamp, timestamps + frameIndex, sizeof(timestamp));
+
+    return timestamp;
+}
+
+unsigned long long OpenGLFrameFile::findFrame(qint64 timestamp) const
+{
+    if(!timestamps || frameCount == 0)
+        return 0;
+
+    //Timestamps only ever grow, so binary search for the first one past the target
+    unsigned long long first = 0;
+    unsigned long long last = frameCount;
+
+    while(first < last)
+    {
+        unsigned long long middle = first + (last - first) / 2;
+
+        if(getTimestamp(middle) <= timestamp)
+            first = middle + 1;
+        else
+            last = middle;
+    }
+
+    return (first > 0) ? first - 1 : 0;
+}
+
+void OpenGLFrameFile::prefetch(unsigned long long firstFrame, unsigned long long numFrames) const
+{
+    if(!mapping || firstFrame >= frameCount)
+        return;
+
+    numFrames = std::min(numFrames, frameCount - firstFrame);
+    if(numFrames == 0)
+        return;
+
+    //Frames are page aligned, so the range is too
+    uchar* begin = mapping + header.headerSize + firstFrame * header.frameStride;
+    size_t size = static_cast<size_t>((numFrames - 1) * header.frameStride + header.frameSize);
+
+#ifdef Q_OS_WIN
+    WIN32_MEMORY_RANGE_ENTRY range;
+    range.VirtualAddress = begin;
+    range.NumberOfBytes = size;
+
+    PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+#else
+    posix_madvise(begin, size, POSIX_MADV_WILLNEED);
+#endif
+}
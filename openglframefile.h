@@ -0,0 +1,90 @@
+#ifndef OPENGLFRAMEFILE_H
+#define OPENGLFRAMEFILE_H
+
+#include <openglrenderer.h>
+
+#include <QFile>
+#include <QString>
+#include <QtGlobal>
+
+//Raw frame container: a page sized header with the frame's texture specs, frames at a fixed page aligned stride and an
+//index of per-frame timestamps at the end. Written by OpenGLFrameAppender; read here through a memory mapping, so a frame
+//is a pointer into the page cache and nothing is copied until it is uploaded
+class OpenGLFrameFile
+{
+public:
+    //Frames and the header start on multiples of this, which keeps every frame page aligned in the mapping
+    static const quint64 pageSize = 4096;
+
+    //On-disk header, in the writer's byte order; texture specs are stored field by field so the layout never depends on
+    //the compiler
+    typedef struct OpenGLFrameFileHeader
+    {
+        char magic[8];
+        quint32 version;
+        quint32 headerSize;
+
+        quint32 width;
+        quint32 height;
+        quint32 channels;
+        quint32 target;
+        quint32 internalFormat;
+        quint32 format;
+        quint32 dataType;
+        quint32 planeLayout;
+        quint32 colorMatrix;
+        quint32 fullRange;
+
+        quint64 frameSize;
+        quint64 frameStride;
+
+        //Both 0 until the appender finishes; an unfinished file still replays, without timestamps
+        quint64 frameCount;
+        quint64 indexOffset;
+    }
+    OpenGLFrameFileHeader;
+
+    OpenGLFrameFile();
+
+    virtual ~OpenGLFrameFile();
+
+    static OpenGLFrameFileHeader createHeader(const OpenGLRenderer::OpenGLTextureSpecs& specs);
+    static bool isValidHeader(const OpenGLFrameFileHeader& header);
+
+    //Maps the whole file read only; false if it is not a frame file
+    bool open(const QString& fileName);
+    void close();
+
+    bool isOpen() const;
+
+    const OpenGLRenderer::OpenGLTextureSpecs& getSpecs() const;
+
+    unsigned long long getFrameCount() const;
+    size_t getFrameSize() const;
+
+    //Pointer into the mapping, valid until close; nullptr past the end
+    const unsigned char* getFrame(unsigned long long frameIndex) const;
+
+    //Microseconds as given to the appender; 0 for files that were never finished
+    qint64 getTimestamp(unsigned long long frameIndex) const;
+
+    //Last frame at or before the timestamp (the first frame if there is none)
+    unsigned long long findFrame(qint64 timestamp) const;
+
+    //Asks the OS to start reading these frames into the page cache without waiting for them
+    void prefetch(unsigned long long firstFrame, unsigned long long frameCount) const;
+
+protected:
+    QFile file;
+
+    uchar* mapping;
+    qint64 mappingSize;
+
+    OpenGLFrameFileHeader header;
+    OpenGLRenderer::OpenGLTextureSpecs specs;
+
+    unsigned long long frameCount;
+    const qint64* timestamps;
+};
+
+#endif // OPENGLFRAMEFILE_H
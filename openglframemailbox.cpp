@@ -0,0 +1,203 @@
+#include "openglframemailbox.h"
+
+#include <QMutexLocker>
+
+OpenGLFrameMailbox::OpenGLFrameMailbox(QObject *parent,
+                                       unsigned int width,
+                                       unsigned int height,
+                                       unsigned int maxReaders) :
+    QObject(parent),
+    frameSize((static_cast<unsigned long long>(width) << 32) | height),
+    previousFrameSize(0),
+    sequence(0),
+    latestTextureID(0),
+    latestSize(0),
+    latestInternalFormat(0),
+    latestFence(nullptr),
+    latestRing(nullptr),
+    latestSlot(0),
+    latestSlotSerial(0),
+    latestSerial(0),
+    numReaders(0),
+    maxReaderCount(maxReaders)
+{
+    readers.reserve(maxReaderCount);
+}
+
+OpenGLFrameMailbox::~OpenGLFrameMailbox()
+{
+
+}
+
+int OpenGLFrameMailbox::addReader(const std::function<void ()> &wake)
+{
+    QMutexLocker locker(&readerMutex);
+
+    //Growing past the reserved size would move the readers under a publishing producer
+    if(readers.size() >= maxReaderCount)
+        return -1;
+
+    std::unique_ptr<OpenGLMailboxReader> reader(new OpenGLMailboxReader());
+    reader->wake = wake;
+    reader->notified.store(false);
+    reader->pendingWakes.store(0);
+    reader->maxPendingWakes.store(0);
+    reader->lastSerial = latestSerial.load(std::memory_order_acquire);
+    reader->droppedFrames.store(0);
+
+    readers.push_back(std::move(reader));
+
+    //Publish the reader only once it is fully constructed
+    numReaders.store(static_cast<unsigned int>(readers.size()), std::memory_order_release);
+
+    return static_cast<int>(readers.size()) - 1;
+}
+
+bool OpenGLFrameMailbox::takeFrame(int reader, OpenGLFrameMailbox::OpenGLFrameDescriptor &frame)
+{
+    OpenGLMailboxReader& mailboxReader = *readers[reader];
+
+    //Clear the flag before reading so a frame published after the read wakes us again
+    if(mailboxReader.notified.exchange(false, std::memory_order_acq_rel))
+        mailboxReader.pendingWakes.fetch_sub(1, std::memory_order_relaxed);
+
+    unsigned long long textureID, size, slotSerial, serial;
+    GLint internalFormat;
+    GLsync fence;
+    OpenGLOutputRing* ring;
+    unsigned int slot;
+
+    while(true)
+    {
+        unsigned long long begin = sequence.load(std::memory_order_acquire);
+        if(begin & 1)
+            continue;
+
+        textureID = latestTextureID.load(std::memory_order_relaxed);
+        size = latestSize.load(std::memory_order_relaxed);
+        internalFormat = latestInternalFormat.load(std::memory_order_relaxed);
+        fence = latestFence.load(std::memory_order_relaxed);
+        ring = latestRing.load(std::memory_order_relaxed);
+        slot = latestSlot.load(std::memory_order_relaxed);
+        slotSerial = latestSlotSerial.load(std::memory_order_relaxed);
+        serial = latestSerial.load(std::memory_order_relaxed);
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+
+        if(sequence.load(std::memory_order_relaxed) == begin)
+            break;
+    }
+
+    if(serial <= mailboxReader.lastSerial)
+        return false;
+
+    OpenGLOutputRing::OpenGLOutputFrame outputFrame{static_cast<GLuint>(textureID),
+                                                    static_cast<unsigned int>(size >> 32),
+                                                    static_cast<unsigned int>(size & 0xFFFFFFFFull),
+                                                    internalFormat,
+                                                    fence,
+                                                    ring,
+                                                    slot,
+                                                    slotSerial};
+
+    //Texture and fence may already be recycled by the time the descriptor is read; only a held frame is handed out
+    bool held = OpenGLOutputRing::acquire(outputFrame);
+
+    mailboxReader.droppedFrames.fetch_add(serial - mailboxReader.lastSerial - (held ? 1 : 0), std::memory_order_relaxed);
+    mailboxReader.lastSerial = serial;
+
+    if(!held)
+        return false;
+
+    frame.frame = outputFrame;
+    frame.serial = serial;
+
+    return true;
+}
+
+unsigned long long OpenGLFrameMailbox::getPublishedCount() const
+{
+    return latestSerial.load(std::memory_order_acquire);
+}
+
+unsigned long long OpenGLFrameMailbox::getDroppedFrameCount(int reader) const
+{
+    return readers[reader]->droppedFrames.load(std::memory_order_relaxed);
+}
+
+unsigned long long OpenGLFrameMailbox::getDroppedFrameCount() const
+{
+    unsigned long long droppedFrames = 0;
+
+    unsigned int count = numReaders.load(std::memory_order_acquire);
+    for(unsigned int i = 0; i < count; i++)
+        droppedFrames += readers[i]->droppedFrames.load(std::memory_order_relaxed);
+
+    return droppedFrames;
+}
+
+unsigned int OpenGLFrameMailbox::getMaxPendingWakeCount(int reader) const
+{
+    return readers[reader]->maxPendingWakes.load(std::memory_order_relaxed);
+}
+
+void OpenGLFrameMailbox::publish(OpenGLOutputRing::OpenGLOutputFrame frame)
+{
+    unsigned long long size = frameSize.load(std::memory_order_relaxed);
+    unsigned long long publishedSize = (static_cast<unsigned long long>(frame.width) << 32) | frame.height;
+
+    if(size && size != publishedSize)
+    {
+        if(previousFrameSize.load(std::memory_order_relaxed) != publishedSize)
+            return;
+    }
+    else
+    {
+        //The new size has arrived; a compare so a resize racing this publish keeps its own previous size
+        unsigned long long previousSize = previousFrameSize.load(std::memory_order_relaxed);
+        if(previousSize)
+            previousFrameSize.compare_exchange_strong(previousSize, 0, std::memory_order_relaxed);
+    }
+
+    //Single producer, so the sequence and serial only ever change here
+    unsigned long long begin = sequence.load(std::memory_order_relaxed);
+    unsigned long long serial = latestSerial.load(std::memory_order_relaxed) + 1;
+
+    sequence.store(begin + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    latestTextureID.store(frame.textureID, std::memory_order_relaxed);
+    latestSize.store((static_cast<unsigned long long>(frame.width) << 32) | frame.height, std::memory_order_relaxed);
+    latestInternalFormat.store(frame.internalFormat, std::memory_order_relaxed);
+    latestFence.store(frame.fence, std::memory_order_relaxed);
+    latestRing.store(frame.ring, std::memory_order_relaxed);
+    latestSlot.store(frame.slot, std::memory_order_relaxed);
+    latestSlotSerial.store(frame.serial, std::memory_order_relaxed);
+    latestSerial.store(serial, std::memory_order_relaxed);
+
+    sequence.store(begin + 2, std::memory_order_release);
+
+    //Wake only the readers that have nothing outstanding; a reader that is behind finds the newest frame when it gets to it
+    unsigned int count = numReaders.load(std::memory_order_acquire);
+    for(unsigned int i = 0; i < count; i++)
+    {
+        OpenGLMailboxReader& reader = *readers[i];
+
+        if(reader.notified.exchange(true, std::memory_order_acq_rel))
+            continue;
+
+        unsigned int pendingWakes = reader.pendingWakes.fetch_add(1, std::memory_order_relaxed) + 1;
+        if(pendingWakes > reader.maxPendingWakes.load(std::memory_order_relaxed))
+            reader.maxPendingWakes.store(pendingWakes, std::memory_order_relaxed);
+
+        if(reader.wake)
+            reader.wake();
+    }
+}
+
+void OpenGLFrameMailbox::setFrameSize(unsigned int width, unsigned int height)
+{
+    unsigned long long size = (static_cast<unsigned long long>(width) << 32) | height;
+
+    previousFrameSize.store(frameSize.exchange(size, std::memory_order_relaxed), std::memory_order_relaxed);
+}
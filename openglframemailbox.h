@@ -0,0 +1,113 @@
+#ifndef OPENGLFRAMEMAILBOX_H
+#define OPENGLFRAMEMAILBOX_H
+
+#include <opengloutputring.h>
+
+#include <QObject>
+#include <QMutex>
+#include <QOpenGLFunctions>
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <vector>
+
+//Latest-wins hand-off of frame descriptors from one producer to several readers. The producer never blocks and never
+//queues more than one wake-up per reader, however far behind the reader is; a reader always takes the newest frame
+//and the frames it never saw are counted as dropped. A taken frame is held in its ring for the reader, so texture and
+//fence stay valid until the reader hands it back with OpenGLOutputRing::release. Holding and releasing take the ring's
+//mutex for a few instructions, the same one the producer takes to pick and publish a slot; a reader can delay the
+//producer that long, never for the time it keeps the frame
+class OpenGLFrameMailbox : public QObject
+{
+    Q_OBJECT
+public:
+    //Defines a published frame; serials start at 1
+    typedef struct OpenGLFrameDescriptor
+    {
+        OpenGLOutputRing::OpenGLOutputFrame frame;
+
+        unsigned long long serial;
+    }
+    OpenGLFrameDescriptor;
+
+    //A non-zero size only accepts frames of that size, as OpenGLOutputCache emits one frame per output size; a mailbox
+    //filtering by size serves the readers of that size only
+    OpenGLFrameMailbox(QObject* parent = nullptr,
+                       unsigned int width = 0,
+                       unsigned int height = 0,
+                       unsigned int maxReaders = 64);
+
+    virtual ~OpenGLFrameMailbox();
+
+    //Registers a reader and returns its index, or -1 once maxReaders are registered; wake is called on the producer's
+    //thread when a frame arrives and the reader has no wake-up outstanding, so it should only post an event (e.g. a queued
+    //QMetaObject::invokeMethod)
+    int addReader(const std::function<void()>& wake);
+
+    //Takes and holds the newest frame if the reader has not seen it yet; safe to call from the reader's thread at any
+    //time. A frame whose producer has already moved on from it cannot be held and counts as dropped
+    bool takeFrame(int reader, OpenGLFrameDescriptor& frame);
+
+    unsigned long long getPublishedCount() const;
+
+    //Frames a reader (or all readers together) never took
+    unsigned long long getDroppedFrameCount(int reader) const;
+    unsigned long long getDroppedFrameCount() const;
+
+    //Most wake-ups a reader has had outstanding at once; the mailbox keeps this at 1
+    unsigned int getMaxPendingWakeCount(int reader) const;
+
+public slots:
+    //Signature matches OpenGLRenderSurface::frameReady / OpenGLOutputCache::frameReady; connect with Qt::DirectConnection
+    void publish(OpenGLOutputRing::OpenGLOutputFrame frame);
+
+    //Changes the size filter, from any thread (e.g. as its reader's window is resized). Frames of the previous size still
+    //pass until the first one of the new size arrives, so the reader has something to stretch meanwhile
+    void setFrameSize(unsigned int width, unsigned int height);
+
+protected:
+    typedef struct OpenGLMailboxReader
+    {
+        std::function<void()> wake;
+
+        //Set by the producer when it posts a wake-up, cleared by the reader before it takes a frame
+        std::atomic<bool> notified;
+
+        std::atomic<unsigned int> pendingWakes;
+        std::atomic<unsigned int> maxPendingWakes;
+
+        //Only touched by the reader
+        unsigned long long lastSerial;
+
+        std::atomic<unsigned long long> droppedFrames;
+    }
+    OpenGLMailboxReader;
+
+    //Size filter, width in the high half; 0 accepts every size. The previous size is 0 once the new one has arrived
+    std::atomic<unsigned long long> frameSize;
+    std::atomic<unsigned long long> previousFrameSize;
+
+    //Seqlock around the latest descriptor: odd while the producer is writing. Fields are atomics so readers racing
+    //the producer read stale values rather than torn ones, and retry
+    std::atomic<unsigned long long> sequence;
+
+    std::atomic<unsigned long long> latestTextureID;
+    std::atomic<unsigned long long> latestSize;
+    std::atomic<GLint> latestInternalFormat;
+    std::atomic<GLsync> latestFence;
+    std::atomic<OpenGLOutputRing*> latestRing;
+    std::atomic<unsigned int> latestSlot;
+    std::atomic<unsigned long long> latestSlotSerial;
+    std::atomic<unsigned long long> latestSerial;
+
+    //Reserved up front so registering a reader never moves the ones the producer is walking
+    std::vector<std::unique_ptr<OpenGLMailboxReader>> readers;
+    std::atomic<unsigned int> numReaders;
+    unsigned int maxReaderCount;
+
+    //Serializes registration only; the descriptor itself is published and read without a lock
+    QMutex readerMutex;
+};
+
+#endif // OPENGLFRAMEMAILBOX_H
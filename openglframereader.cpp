@@ -0,0 +1,167 @@
+#include "openglframereader.h"
+
+#include <algorithm>
+
+OpenGLFrameReader::OpenGLFrameReader(unsigned int numBuffers) :
+    initialized(false),
+    stateCache(nullptr),
+    readBuffers(std::max(numBuffers,1u),OpenGLReadBuffer{0,nullptr,0,OpenGLRenderer::OpenGLTextureSpecs{0,0,0,GL_TEXTURE_2D,0,0,0,OpenGLRenderer::OpenGLPlanesPacked,OpenGLRenderer::OpenGLColorBT601,false}}),
+    readIndex(0),
+    writeIndex(0),
+    numPending(0),
+    bufferSize(0),
+    droppedFrames(0)
+{
+
+}
+
+OpenGLFrameReader::~OpenGLFrameReader()
+{
+
+}
+
+void OpenGLFrameReader::initialize()
+{
+    if(initialized)
+        return;
+
+    initializeOpenGLFunctions();
+
+    for(OpenGLReadBuffer& buffer : readBuffers)
+        glGenBuffers(1, &buffer.pboID);
+
+    initialized = true;
+}
+
+void OpenGLFrameReader::setStateCache(OpenGLStateCache *cache)
+{
+    stateCache = cache;
+}
+
+bool OpenGLFrameReader::readFrame(GLuint fboID, unsigned long long frameIndex, const OpenGLRenderer::OpenGLTextureSpecs &specs)
+{
+    size_t frameSize = static_cast<size_t>(specs.width) * specs.height * OpenGLRenderer::getBytesPerPixel(specs);
+    if(frameSize != bufferSize)
+        reallocate(specs);
+
+    //Never stall the producer; if the consumer side is behind, skip this frame
+    if(numPending == readBuffers.size())
+    {
+        droppedFrames++;
+        return false;
+    }
+
+    OpenGLReadBuffer& buffer = readBuffers[writeIndex];
+
+    assert(stateCache);
+
+    stateCache->bindFramebuffer(GL_READ_FRAMEBUFFER, fboID);
+    glReadBuffer(GL_COLOR_ATTACHMENT0);
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, buffer.pboID);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+
+    //Copies into the PBO on the GPU timeline; returns immediately
+    glReadPixels(0, 0, specs.width, specs.height, specs.format, specs.dataType, (GLvoid*)(nullptr));
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    buffer.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    buffer.frameIndex = frameIndex;
+    buffer.specs = specs;
+
+    writeIndex = (writeIndex + 1) % readBuffers.size();
+    numPending++;
+
+    return true;
+}
+
+unsigned int OpenGLFrameReader::processFrames(const std::function<void (const OpenGLFrameReader::OpenGLFrameData &)> &callback)
+{
+    unsigned int numProcessed = 0;
+
+    while(numPending > 0)
+    {
+        OpenGLReadBuffer& buffer = readBuffers[readIndex];
+
+        //Poll with a zero timeout; stop at the first read that has not landed yet
+        GLenum status = glClientWaitSync(buffer.fence, 0, 0);
+        if(status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+            break;
+
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, buffer.pboID);
+
+        const unsigned char* data = static_cast<const unsigned char*>(glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, bufferSize, GL_MAP_READ_BIT));
+        if(data)
+        {
+            callback(OpenGLFrameData{data, bufferSize, buffer.frameIndex, buffer.specs});
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        }
+
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+        releaseBuffer(buffer);
+
+        readIndex = (readIndex + 1) % readBuffers.size();
+        numPending--;
+        numProcessed++;
+    }
+
+    return numProcessed;
+}
+
+unsigned int OpenGLFrameReader::waitForFrames(const std::function<void (const OpenGLFrameReader::OpenGLFrameData &)> &callback, unsigned int maxPending)
+{
+    unsigned int numProcessed = processFrames(callback);
+
+    while(numPending > maxPending)
+    {
+        //Block on the oldest read only; the ones behind it have usually landed by then
+        GLenum status = glClientWaitSync(readBuffers[readIndex].fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+        if(status == GL_WAIT_FAILED)
+            break;
+
+        numProcessed += processFrames(callback);
+    }
+
+    return numProcessed;
+}
+
+unsigned int OpenGLFrameReader::getBufferCount() const
+{
+    return static_cast<unsigned int>(readBuffers.size());
+}
+
+unsigned long long OpenGLFrameReader::getDroppedFrameCount() const
+{
+    return droppedFrames;
+}
+
+void OpenGLFrameReader::reallocate(const OpenGLRenderer::OpenGLTextureSpecs &specs)
+{
+    //Frames of the old size are discarded
+    for(OpenGLReadBuffer& buffer : readBuffers)
+        releaseBuffer(buffer);
+
+    readIndex = 0;
+    writeIndex = 0;
+    numPending = 0;
+
+    bufferSize = static_cast<size_t>(specs.width) * specs.height * OpenGLRenderer::getBytesPerPixel(specs);
+
+    for(OpenGLReadBuffer& buffer : readBuffers)
+    {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, buffer.pboID);
+        glBufferData(GL_PIXEL_PACK_BUFFER, bufferSize, nullptr, GL_STREAM_READ);
+    }
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+void OpenGLFrameReader::releaseBuffer(OpenGLFrameReader::OpenGLReadBuffer &buffer)
+{
+    if(buffer.fence)
+        glDeleteSync(buffer.fence);
+
+    buffer.fence = nullptr;
+}
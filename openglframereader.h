@@ -0,0 +1,80 @@
+#ifndef OPENGLFRAMEREADER_H
+#define OPENGLFRAMEREADER_H
+
+#include <openglrenderer.h>
+#include <openglstatecache.h>
+
+#include <functional>
+#include <vector>
+
+//Reads rendered frames back to the CPU through a ring of pixel buffer objects; never waits on the GPU
+class OpenGLFrameReader : protected QOpenGLExtraFunctions
+{
+public:
+    //A frame that has landed in CPU-visible memory; data is only valid inside the callback
+    typedef struct OpenGLFrameData
+    {
+        const unsigned char* data;
+        size_t size;
+
+        unsigned long long frameIndex;
+        OpenGLRenderer::OpenGLTextureSpecs specs;
+    }
+    OpenGLFrameData;
+
+    OpenGLFrameReader(unsigned int numBuffers = 3);
+
+    virtual ~OpenGLFrameReader();
+
+    //Must be called with the producer context current
+    void initialize();
+
+    //The read framebuffer is bound through the producer's state cache; set it before the first readFrame
+    void setStateCache(OpenGLStateCache* cache);
+
+    //Starts an asynchronous read of the FBO's color attachment; returns false (frame dropped) when every PBO is still in flight
+    bool readFrame(GLuint fboID, unsigned long long frameIndex, const OpenGLRenderer::OpenGLTextureSpecs& specs);
+
+    //Maps every PBO whose read has completed, oldest first, and hands it to the callback
+    unsigned int processFrames(const std::function<void(const OpenGLFrameData&)>& callback);
+
+    //Like processFrames, but blocks on the oldest reads until at most maxPending are in flight; for offline renders,
+    //which must not drop frames. maxPending of 0 drains the ring
+    unsigned int waitForFrames(const std::function<void(const OpenGLFrameData&)>& callback, unsigned int maxPending);
+
+    unsigned int getBufferCount() const;
+
+    unsigned long long getDroppedFrameCount() const;
+
+protected:
+    //Defines one slot of the PBO ring
+    typedef struct OpenGLReadBuffer
+    {
+        GLuint pboID;
+        GLsync fence;
+
+        unsigned long long frameIndex;
+        OpenGLRenderer::OpenGLTextureSpecs specs;
+    }
+    OpenGLReadBuffer;
+
+    void reallocate(const OpenGLRenderer::OpenGLTextureSpecs& specs);
+    void releaseBuffer(OpenGLReadBuffer& buffer);
+
+    bool initialized;
+
+    OpenGLStateCache* stateCache;
+
+    std::vector<OpenGLReadBuffer> readBuffers;
+
+    //Ring indices; slots in [readIndex, writeIndex) are in flight
+    unsigned int readIndex;
+    unsigned int writeIndex;
+    unsigned int numPending;
+
+    size_t bufferSize;
+
+    unsigned long long droppedFrames;
+};
+
+#endif // OPENGLFRAMEREADER_H
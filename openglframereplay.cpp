@@ -0,0 +1,131 @@
+#include "openglframereplay.h"
+
+#include <algorithm>
+
+OpenGLFrameReplay::OpenGLFrameReplay(OpenGLInputSource *inputSource, QObject *parent, unsigned int prefetchFrames) :
+    QObject(parent),
+    source(inputSource),
+    file(),
+    position(0),
+    looping(false),
+    prefetchFrames(prefetchFrames),
+    prefetchEnd(0),
+    stats(OpenGLFrameReplayStats{0,0,0,0})
+{
+
+}
+
+OpenGLFrameReplay::~OpenGLFrameReplay()
+{
+    close();
+}
+
+bool OpenGLFrameReplay::open(const QString &fileName)
+{
+    stats = OpenGLFrameReplayStats{0,0,0,0};
+
+    position = 0;
+    prefetchEnd = 0;
+
+    if(!file.open(fileName))
+        return false;
+
+    //Start reading ahead before the first frame is asked for
+    prefetchEnd = std::min<unsigned long long>(prefetchFrames + 1, file.getFrameCount());
+    file.prefetch(0, prefetchEnd);
+
+    return true;
+}
+
+void OpenGLFrameReplay::close()
+{
+    file.close();
+
+    position = 0;
+    prefetchEnd = 0;
+}
+
+const OpenGLFrameFile &OpenGLFrameReplay::getFile() const
+{
+    return file;
+}
+
+unsigned long long OpenGLFrameReplay::getPosition() const
+{
+    return position;
+}
+
+void OpenGLFrameReplay::setLooping(bool enabled)
+{
+    looping = enabled;
+}
+
+OpenGLFrameReplay::OpenGLFrameReplayStats OpenGLFrameReplay::getStats() const
+{
+    return stats;
+}
+
+bool OpenGLFrameReplay::seek(unsigned long long frameIndex)
+{
+    if(!file.isOpen() || frameIndex >= file.getFrameCount())
+        return false;
+
+    position = frameIndex;
+
+    //Frames prefetched for the old position are of no use now
+    prefetchEnd = position;
+
+    stats.seeks++;
+
+    return true;
+}
+
+bool OpenGLFrameReplay::seekTime(qint64 timestamp)
+{
+    return seek(file.findFrame(timestamp));
+}
+
+bool OpenGLFrameReplay::nextFrame()
+{
+    if(!source || !file.isOpen())
+        return false;
+
+    if(position >= file.getFrameCount())
+    {
+        if(!looping || file.getFrameCount() == 0)
+            return false;
+
+        position = 0;
+        prefetchEnd = 0;
+    }
+
+    //Keep prefetchFrames frames requested ahead; only the newly uncovered ones are asked for
+    unsigned long long prefetchTarget = std::min(position + 1 + prefetchFrames, file.getFrameCount());
+    if(prefetchEnd < position + 1)
+        prefetchEnd = position + 1;
+
+    if(prefetchTarget > prefetchEnd)
+    {
+        file.prefetch(prefetchEnd, prefetchTarget - prefetchEnd);
+        prefetchEnd = prefetchTarget;
+    }
+
+    //Straight from the mapping; pages not resident yet fault in during the copy into the upload buffer
+    if(!source->uploadFrame(file.getFrame(position), file.getSpecs()))
+    {
+        stats.droppedUploads++;
+        return false;
+    }
+
+    stats.framesReplayed++;
+    stats.bytesReplayed += file.getFrameSize();
+
+    emit frameReplayed(position, file.getTimestamp(position));
+
+    position++;
+
+    if(position == file.getFrameCount() && !looping)
+        emit finished();
+
+    return true;
+}
@@ -0,0 +1,76 @@
+#ifndef OPENGLFRAMEREPLAY_H
+#define OPENGLFRAMEREPLAY_H
+
+#include <openglframefile.h>
+#include <openglinputsource.h>
+
+#include <QObject>
+
+//Replays an OpenGLFrameFile into an OpenGLInputSource. Frames go straight from the file mapping into uploadFrame, so the
+//only copy is the one into the upload buffer; the next frames are prefetched while the current one uploads. Lives on
+//the source's thread; whoever drives nextFrame sets the rate
+class OpenGLFrameReplay : public QObject
+{
+    Q_OBJECT
+public:
+    //Totals since open
+    typedef struct OpenGLFrameReplayStats
+    {
+        unsigned long long framesReplayed;
+        unsigned long long bytesReplayed;
+
+        //Uploads the source dropped because its ring was busy; the frame is offered again on the next call
+        unsigned long long droppedUploads;
+
+        unsigned long long seeks;
+    }
+    OpenGLFrameReplayStats;
+
+    OpenGLFrameReplay(OpenGLInputSource* inputSource,
+                      QObject* parent = nullptr,
+                      unsigned int prefetchFrames = 4);
+
+    virtual ~OpenGLFrameReplay();
+
+    bool open(const QString& fileName);
+    void close();
+
+    const OpenGLFrameFile& getFile() const;
+
+    //Index of the frame the next call to nextFrame uploads
+    unsigned long long getPosition() const;
+
+    //Start over from frame 0 at the end instead of stopping
+    void setLooping(bool enabled);
+
+    OpenGLFrameReplayStats getStats() const;
+
+public slots:
+    bool seek(unsigned long long frameIndex);
+
+    //Seeks to the last frame at or before the timestamp
+    bool seekTime(qint64 timestamp);
+
+    //Uploads the frame at the current position and moves on; false at the end or when the upload was dropped
+    bool nextFrame();
+
+signals:
+    void frameReplayed(unsigned long long frameIndex, qint64 timestamp);
+    void finished();
+
+protected:
+    OpenGLInputSource* source;
+
+    OpenGLFrameFile file;
+
+    unsigned long long position;
+    bool looping;
+
+    //Frames ahead of the position handed to the OS; prefetchEnd is the first one not requested yet
+    unsigned int prefetchFrames;
+    unsigned long long prefetchEnd;
+
+    OpenGLFrameReplayStats stats;
+};
+
+#endif // OPENGLFRAMEREPLAY_H
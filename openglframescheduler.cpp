@@ -0,0 +1,215 @@
+#include "openglframescheduler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+OpenGLFrameScheduler::OpenGLFrameScheduler(QObject *parent) :
+    QObject(parent),
+    deadlineTimer(nullptr),
+    frameRate(60.0),
+    active(false),
+    swapDriven(false),
+    frameNumber(0),
+    spinThreshold(1000),
+    numFrames(0),
+    numMissedDeadlines(0),
+    jitterSum(0.0),
+    jitterMax(0.0)
+{
+    deadlineTimer = new QTimer(this);
+    deadlineTimer->setTimerType(Qt::PreciseTimer);
+    deadlineTimer->setSingleShot(true);
+
+    QObject::connect(deadlineTimer,&QTimer::timeout,this,&OpenGLFrameScheduler::timeout);
+}
+
+OpenGLFrameScheduler::~OpenGLFrameScheduler()
+{
+
+}
+
+double OpenGLFrameScheduler::getFrameRate() const
+{
+    return frameRate;
+}
+
+bool OpenGLFrameScheduler::isActive() const
+{
+    return active;
+}
+
+bool OpenGLFrameScheduler::isSwapDriven() const
+{
+    return swapDriven;
+}
+
+OpenGLFrameScheduler::OpenGLFrameSchedulerStats OpenGLFrameScheduler::getStats() const
+{
+    OpenGLFrameSchedulerStats stats = OpenGLFrameSchedulerStats{numFrames, numMissedDeadlines, 0.0, jitterMax, 0.0};
+
+    if(numFrames > 0)
+        stats.meanJitter = jitterSum / numFrames;
+
+    std::chrono::duration<double> t_elapsed = lastFrameTime - firstFrameTime;
+    if(numFrames > 1 && t_elapsed.count() > 0.0)
+        stats.actualFrameRate = (numFrames - 1) / t_elapsed.count();
+
+    return stats;
+}
+
+void OpenGLFrameScheduler::start(double fps)
+{
+    if(fps <= 0.0)
+        return;
+
+    frameRate = fps;
+    active = true;
+
+    resetStats();
+
+    //First frame is due right away
+    baseTime = Clock::now();
+    frameNumber = 0;
+
+    if(swapDriven)
+        emit frameDue();
+    else
+        scheduleNext();
+}
+
+void OpenGLFrameScheduler::stop()
+{
+    active = false;
+    deadlineTimer->stop();
+}
+
+void OpenGLFrameScheduler::setFrameRate(double fps)
+{
+    if(fps <= 0.0 || fps == frameRate)
+        return;
+
+    //Rebase on the next deadline so the current period is honored
+    if(active)
+    {
+        baseTime = getDeadline(frameNumber);
+        frameNumber = 0;
+    }
+
+    frameRate = fps;
+
+    if(active && !swapDriven)
+        scheduleNext();
+}
+
+void OpenGLFrameScheduler::setSwapDriven(bool enabled)
+{
+    if(swapDriven == enabled)
+        return;
+
+    swapDriven = enabled;
+
+    if(!active)
+        return;
+
+    if(swapDriven)
+    {
+        //Kick off the swap / render loop
+        deadlineTimer->stop();
+        emit frameDue();
+    }
+    else
+    {
+        baseTime = Clock::now();
+        frameNumber = 0;
+
+        scheduleNext();
+    }
+}
+
+void OpenGLFrameScheduler::swapCompleted()
+{
+    if(!active || !swapDriven)
+        return;
+
+    //The swap itself is the deadline
+    updateStats(Clock::now(), 0.0);
+
+    emit frameDue();
+}
+
+void OpenGLFrameScheduler::resetStats()
+{
+    numFrames = 0;
+    numMissedDeadlines = 0;
+
+    jitterSum = 0.0;
+    jitterMax = 0.0;
+}
+
+OpenGLFrameScheduler::Clock::time_point OpenGLFrameScheduler::getDeadline(unsigned long long frame) const
+{
+    return baseTime + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(frame / frameRate));
+}
+
+void OpenGLFrameScheduler::timeout()
+{
+    if(!active || swapDriven)
+        return;
+
+    Clock::time_point deadline = getDeadline(frameNumber);
+
+    //Woke up too early (coarse timer); go back to sleep
+    if(deadline - Clock::now() > spinThreshold)
+    {
+        scheduleNext();
+        return;
+    }
+
+    //Yield for the last fraction of a millisecond
+    while(Clock::now() < deadline)
+        std::this_thread::yield();
+
+    Clock::time_point now = Clock::now();
+
+    updateStats(now, std::chrono::duration<double,std::milli>(now - deadline).count());
+
+    frameNumber++;
+
+    emit frameDue();
+
+    scheduleNext();
+}
+
+void OpenGLFrameScheduler::scheduleNext()
+{
+    Clock::time_point now = Clock::now();
+
+    //If a frame overran whole periods, skip the deadlines that have passed instead of bursting to catch up;
+    //a deadline that has just passed still fires, late
+    double elapsedFrames = std::chrono::duration<double>(now - baseTime).count() * frameRate;
+    unsigned long long currentFrame = static_cast<unsigned long long>(std::max(0.0, std::floor(elapsedFrames)));
+
+    if(currentFrame > frameNumber)
+    {
+        numMissedDeadlines += currentFrame - frameNumber;
+        frameNumber = currentFrame;
+    }
+
+    std::chrono::duration<double,std::milli> t_remaining = getDeadline(frameNumber) - now - spinThreshold;
+
+    deadlineTimer->start(std::max(0, static_cast<int>(t_remaining.count())));
+}
+
+void OpenGLFrameScheduler::updateStats(OpenGLFrameScheduler::Clock::time_point time, double jitter)
+{
+    if(numFrames == 0)
+        firstFrameTime = time;
+
+    lastFrameTime = time;
+
+    numFrames++;
+
+    jitterSum += std::abs(jitter);
+    jitterMax = std::max(jitterMax, std::abs(jitter));
+}
@@ -0,0 +1,91 @@
+#ifndef OPENGLFRAMESCHEDULER_H
+#define OPENGLFRAMESCHEDULER_H
+
+#include <QObject>
+#include <QTimer>
+
+#include <chrono>
+
+//Paces frames against absolute deadlines (start + n * period) so rounding and event loop load never accumulate into drift.
+//Optionally, a display's swap completions drive the frames instead
+class OpenGLFrameScheduler : public QObject
+{
+    Q_OBJECT
+public:
+    //Pacing statistics since start / the last reset; times are in milliseconds
+    typedef struct OpenGLFrameSchedulerStats
+    {
+        unsigned long long frames;
+        unsigned long long missedDeadlines;
+
+        double meanJitter;
+        double maxJitter;
+
+        double actualFrameRate;
+    }
+    OpenGLFrameSchedulerStats;
+
+    OpenGLFrameScheduler(QObject* parent = nullptr);
+
+    virtual ~OpenGLFrameScheduler();
+
+    double getFrameRate() const;
+
+    bool isActive() const;
+    bool isSwapDriven() const;
+
+    OpenGLFrameSchedulerStats getStats() const;
+
+public slots:
+    void start(double fps);
+    void stop();
+
+    void setFrameRate(double fps);
+
+    //When enabled, frames are emitted from swapCompleted instead of the deadline timer
+    void setSwapDriven(bool enabled);
+
+    //Connected to a display's frameSwapped signal
+    void swapCompleted();
+
+    void resetStats();
+
+signals:
+    void frameDue();
+
+protected:
+    typedef std::chrono::steady_clock Clock;
+
+    Clock::time_point getDeadline(unsigned long long frame) const;
+
+    void timeout();
+    void scheduleNext();
+
+    void updateStats(Clock::time_point time, double jitter);
+
+    QTimer* deadlineTimer;
+
+    double frameRate;
+
+    bool active;
+    bool swapDriven;
+
+    //Deadlines are counted from a base time so they never drift
+    Clock::time_point baseTime;
+    unsigned long long frameNumber;
+
+    //Wake up this early and yield for the rest; QTimer only has millisecond resolution
+    std::chrono::microseconds spinThreshold;
+
+    //Stats
+    unsigned long long numFrames;
+    unsigned long long numMissedDeadlines;
+
+    double jitterSum;
+    double jitterMax;
+
+    Clock::time_point firstFrameTime;
+    Clock::time_point lastFrameTime;
+};
+
+#endif // OPENGLFRAMESCHEDULER_H
@@ -0,0 +1,155 @@
+#include "openglframewriter.h"
+
+#include <QDir>
+#include <QFile>
+#include <QRunnable>
+#include <QThread>
+
+#include <algorithm>
+#include <cstring>
+
+//Writes one queued frame and hands its buffer back
+class OpenGLFrameWriteTask : public QRunnable
+{
+public:
+    OpenGLFrameWriteTask(OpenGLFrameWriter* writer,
+                         unsigned int bufferIndex,
+                         size_t size,
+                         const QString& fileName) :
+        writer(writer),
+        bufferIndex(bufferIndex),
+        size(size),
+        fileName(fileName)
+    {
+        setAutoDelete(true);
+    }
+
+    void run() override
+    {
+        //Only this task touches the buffer until it is handed back
+        const char* data = reinterpret_cast<const char*>(writer->buffers[bufferIndex].data());
+
+        QFile file(fileName);
+
+        bool written = file.open(QIODevice::WriteOnly | QIODevice::Truncate) &&
+                       file.write(data, static_cast<qint64>(size)) == static_cast<qint64>(size);
+
+        file.close();
+
+        writer->finishWrite(bufferIndex, size, written);
+    }
+
+protected:
+    OpenGLFrameWriter* writer;
+
+    unsigned int bufferIndex;
+    size_t size;
+
+    QString fileName;
+};
+
+OpenGLFrameWriter::OpenGLFrameWriter(const QString &directory, unsigned int maxWorkers, unsigned int maxQueuedFrames) :
+    directory(directory),
+    fileNamePrefix(QString("frame_")),
+    fileNameSuffix(QString(".raw")),
+    buffers(std::max(maxQueuedFrames,1u)),
+    freeBuffers(),
+    stats(OpenGLFrameWriterStats{0,0,0,0})
+{
+    workerPool.setMaxThreadCount((maxWorkers > 0) ? static_cast<int>(maxWorkers) : QThread::idealThreadCount());
+
+    for(unsigned int i = 0; i < buffers.size(); i++)
+        freeBuffers.push_back(i);
+
+    QDir().mkpath(directory);
+}
+
+OpenGLFrameWriter::~OpenGLFrameWriter()
+{
+    waitForDone();
+}
+
+const QString &OpenGLFrameWriter::getDirectory() const
+{
+    return directory;
+}
+
+void OpenGLFrameWriter::setFileNamePattern(const QString &prefix, const QString &suffix)
+{
+    fileNamePrefix = prefix;
+    fileNameSuffix = suffix;
+}
+
+QString OpenGLFrameWriter::getFileName(unsigned long long frameIndex) const
+{
+    return QDir(directory).filePath(fileNamePrefix + QString("%1").arg(frameIndex, 8, 10, QChar('0')) + fileNameSuffix);
+}
+
+bool OpenGLFrameWriter::write(const unsigned char *data, size_t size, unsigned long long frameIndex)
+{
+    if(!data || size == 0)
+        return false;
+
+    unsigned int bufferIndex = 0;
+
+    {
+        QMutexLocker locker(&mutex);
+
+        if(freeBuffers.empty())
+        {
+            stats.stalls++;
+
+            while(freeBuffers.empty())
+                bufferFreed.wait(&mutex);
+        }
+
+        bufferIndex = freeBuffers.back();
+        freeBuffers.pop_back();
+    }
+
+    //Buffers keep their capacity, so steady state frames are copied without allocating
+    std::vector<unsigned char>& buffer = buffers[bufferIndex];
+    if(buffer.size() < size)
+        buffer.resize(size);
+
+    std::memcpy(buffer.data(), data, size);
+
+    workerPool.start(new OpenGLFrameWriteTask(this, bufferIndex, size, getFileName(frameIndex)));
+
+    return true;
+}
+
+void OpenGLFrameWriter::waitForDone()
+{
+    workerPool.waitForDone();
+}
+
+OpenGLFrameWriter::OpenGLFrameWriterStats OpenGLFrameWriter::getStats() const
+{
+    QMutexLocker locker(&mutex);
+    return stats;
+}
+
+void OpenGLFrameWriter::resetStats()
+{
+    QMutexLocker locker(&mutex);
+    stats = OpenGLFrameWriterStats{0,0,0,0};
+}
+
+void OpenGLFrameWriter::finishWrite(unsigned int bufferIndex, size_t size, bool written)
+{
+    QMutexLocker locker(&mutex);
+
+    if(written)
+    {
+        stats.framesWritten++;
+        stats.bytesWritten += size;
+    }
+    else
+    {
+        stats.failures++;
+    }
+
+    freeBuffers.push_back(bufferIndex);
+    bufferFreed.wakeOne();
+}
@@ -0,0 +1,77 @@
+#ifndef OPENGLFRAMEWRITER_H
+#define OPENGLFRAMEWRITER_H
+
+#include <openglrenderer.h>
+
+#include <QMutex>
+#include <QString>
+#include <QThreadPool>
+#include <QWaitCondition>
+
+#include <vector>
+
+//Writes frames read back from the GPU to disk on a pool of threads, one raw file per frame named by its index. Frames are
+//copied into a fixed set of recycled buffers; once all of them are queued write blocks until one is free, so a renderer
+//feeding it runs as fast as the disk allows and never drops a frame
+class OpenGLFrameWriter
+{
+public:
+    //Totals since construction / the last reset
+    typedef struct OpenGLFrameWriterStats
+    {
+        unsigned long long framesWritten;
+        unsigned long long bytesWritten;
+
+        //Frames that could not be written
+        unsigned long long failures;
+
+        //Calls to write that had to wait for a free buffer
+        unsigned long long stalls;
+    }
+    OpenGLFrameWriterStats;
+
+    //maxWorkers of 0 uses QThread::idealThreadCount
+    OpenGLFrameWriter(const QString& directory,
+                      unsigned int maxWorkers = 0,
+                      unsigned int maxQueuedFrames = 8);
+
+    virtual ~OpenGLFrameWriter();
+
+    const QString& getDirectory() const;
+
+    //Files are named <prefix><frame index, 8 digits><suffix>
+    void setFileNamePattern(const QString& prefix, const QString& suffix);
+    QString getFileName(unsigned long long frameIndex) const;
+
+    //Copies the frame and returns once it is queued; safe to call with data that is only valid during the call
+    bool write(const unsigned char* data, size_t size, unsigned long long frameIndex);
+
+    //Blocks until every queued frame is on disk
+    void waitForDone();
+
+    OpenGLFrameWriterStats getStats() const;
+    void resetStats();
+
+protected:
+    friend class OpenGLFrameWriteTask;
+
+    //Called by a task once its buffer has been written
+    void finishWrite(unsigned int bufferIndex, size_t size, bool written);
+
+    QString directory;
+    QString fileNamePrefix;
+    QString fileNameSuffix;
+
+    QThreadPool workerPool;
+
+    //Recycled frame copies and the ones not queued
+    std::vector<std::vector<unsigned char>> buffers;
+    std::vector<unsigned int> freeBuffers;
+
+    mutable QMutex mutex;
+    QWaitCondition bufferFreed;
+
+    OpenGLFrameWriterStats stats;
+};
+
+#endif // OPENGLFRAMEWRITER_H
@@ -0,0 +1,427 @@
+#include "openglinputsource.h"
+
+#include <cstring>
+
+OpenGLInputSource::OpenGLInputSource(QScreen *outputScreen,
+                                     QObject *parent,
+                                     OpenGLRenderer::OpenGLRenderSpecs specs,
+                                     const QSurfaceFormat &surfaceFormat,
+                                     QOpenGLContext *sharedContext,
+                                     unsigned int inputBufferCount) :
+    QOffscreenSurface(outputScreen,parent),
+    OpenGLRenderer(specs),
+    openGLFormat(surfaceFormat),
+    openGLContext(nullptr),
+    inputBuffers(std::max(inputBufferCount,1u),OpenGLInputBuffer{0,{0,0,0},nullptr,nullptr}),
+    inputBufferIndex(0),
+    bufferSize(0),
+    outputRing(inputBufferCount),
+    colorMatrixUniformLocation(-1),
+    colorOffsetUniformLocation(-1),
+    interleavedChromaUniformLocation(-1),
+    conversionDirty(true),
+    persistentMappingRequested(true),
+    persistentMapping(false),
+    bufferStorage(nullptr),
+    frameIndex(0),
+    droppedFrames(0)
+{
+    //Create offscreen surface
+    setFormat(openGLFormat);
+    create();
+
+    //Allocate memory for the context object and prepare to create it
+    openGLContext = new QOpenGLContext(this);
+    openGLContext->setFormat(openGLFormat);
+    if(sharedContext)
+        openGLContext->setShareContext(sharedContext);
+
+    //Make sure the context is created & is sharing resources with the shared context
+    bool contextCreated = openGLContext->create();
+    assert(contextCreated);
+
+    if(sharedContext)
+    {
+        bool sharing = QOpenGLContext::areSharing(openGLContext,sharedContext);
+        assert(sharing);
+    }
+
+    qRegisterMetaType<GLuint>("GLuint");
+    qRegisterMetaType<GLsync>("GLsync");
+    qRegisterMetaType<OpenGLOutputRing::OpenGLOutputFrame>("OpenGLOutputRing::OpenGLOutputFrame");
+    qRegisterMetaType<OpenGLRenderer::OpenGLTextureSpecs>("OpenGLRenderer::OpenGLTextureSpecs");
+}
+
+OpenGLInputSource::~OpenGLInputSource()
+{
+    if(bufferStorage)
+        delete bufferStorage;
+
+    bufferStorage = nullptr;
+}
+
+const QSurfaceFormat &OpenGLInputSource::getOpenGLFormat()
+{
+    return openGLFormat;
+}
+
+QOpenGLContext *OpenGLInputSource::getOpenGLContext()
+{
+    return openGLContext;
+}
+
+bool OpenGLInputSource::uploadFrame(const unsigned char *data, const OpenGLRenderer::OpenGLTextureSpecs &specs)
+{
+    if(!data || specs.width == 0 || specs.height == 0)
+        return false;
+
+    if(!makeContextCurrent())
+        return false;
+
+    initialize();
+
+    stateCache.beginFrame();
+    texturePool.endFrame();
+
+    //Reallocate the ring when the incoming frame type changes, unless only the conversion does
+    if(renderSpecs.frameType != specs)
+    {
+        OpenGLTextureSpecs converted = renderSpecs.frameType;
+        converted.colorMatrix = specs.colorMatrix;
+        converted.fullRange = specs.fullRange;
+
+        renderSpecs.frameType = specs;
+
+        if(converted == specs)
+            conversionDirty = true;
+        else
+            resizeFBO();
+    }
+
+    OpenGLInputBuffer& buffer = inputBuffers[(inputBufferIndex + 1) % inputBuffers.size()];
+
+    //A persistent mapping is written in place, so never wait for a transfer that is still reading it; drop the frame
+    //instead. Orphaned storage needs no check, the driver hands out fresh storage while the old one is still read
+    if(persistentMapping && buffer.fence)
+    {
+        GLenum status = glClientWaitSync(buffer.fence, 0, 0);
+        if(status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+        {
+            droppedFrames++;
+            return false;
+        }
+
+        glDeleteSync(buffer.fence);
+        buffer.fence = nullptr;
+    }
+
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer.pboID);
+
+    if(persistentMapping)
+    {
+        //Coherent mapping; the fence above guarantees the GPU is done reading the previous contents
+        std::memcpy(buffer.mappedData, data, bufferSize);
+    }
+    else
+    {
+        //Orphan the old storage so the driver never has to synchronize with a pending transfer
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, bufferSize, nullptr, GL_STREAM_DRAW);
+
+        //Nothing to upload from an unfilled buffer; the ring has not moved on yet, so consumers keep the last frame
+        void* mappedData = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, bufferSize, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+        if(!mappedData)
+        {
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+            droppedFrames++;
+            return false;
+        }
+
+        std::memcpy(mappedData, data, bufferSize);
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+    }
+
+    //Next output slot nobody holds
+    OpenGLOutputRing::OpenGLOutputBuffer& output = outputRing.nextBuffer();
+
+    //Copy from the PBO into the preallocated texture(s) on the GPU timeline
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+    if(specs.planeLayout == OpenGLPlanesPacked)
+    {
+        stateCache.bindTexture(GL_TEXTURE_2D, output.textureID);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, specs.width, specs.height, specs.format, specs.dataType, (const GLvoid*)(nullptr));
+    }
+    else
+    {
+        for(unsigned int i = 0; i < getPlaneCount(specs); i++)
+        {
+            OpenGLPlaneSpecs plane = getPlaneSpecs(specs, i);
+
+            stateCache.bindTexture(GL_TEXTURE_2D, buffer.planeTextureIDs[i]);
+            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, plane.width, plane.height, plane.format, plane.dataType, (const GLvoid*)(plane.offset));
+        }
+    }
+
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    if(specs.planeLayout != OpenGLPlanesPacked)
+        convertFrame(buffer, output.fboID);
+
+    //The transfer fence frees a persistent PBO for the next upload, the ring's fence tells consumers the frame is finished
+    if(persistentMapping)
+        buffer.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    OpenGLOutputRing::OpenGLOutputFrame frame = outputRing.publish();
+    glFlush();
+
+    inputBufferIndex = (inputBufferIndex + 1) % inputBuffers.size();
+    outputTextureID = output.textureID;
+
+    frameIndex++;
+
+    emit frameReady(frame);
+
+    return true;
+}
+
+void OpenGLInputSource::setPersistentMapping(bool enabled)
+{
+    //Takes effect the next time the ring is allocated
+    persistentMappingRequested = enabled;
+}
+
+bool OpenGLInputSource::isPersistentlyMapped() const
+{
+    return persistentMapping;
+}
+
+unsigned long long OpenGLInputSource::getFrameIndex() const
+{
+    return frameIndex;
+}
+
+unsigned long long OpenGLInputSource::getDroppedFrameCount() const
+{
+    return droppedFrames;
+}
+
+void OpenGLInputSource::setFrame(QByteArray frame, OpenGLRenderer::OpenGLTextureSpecs specs)
+{
+    if(static_cast<size_t>(frame.size()) < getFrameSize(specs))
+        return;
+
+    uploadFrame(reinterpret_cast<const unsigned char*>(frame.constData()), specs);
+}
+
+void OpenGLInputSource::stop()
+{
+    doneContextCurrent();
+}
+
+void OpenGLInputSource::renderFrame()
+{
+    if(frameIndex == 0)
+        return;
+
+    emit frameReady(outputRing.getFrame());
+}
+
+void OpenGLInputSource::initializeFBO()
+{
+    //Persistent mapping needs GL 4.4 or GL_ARB_buffer_storage; a 4.1 context falls back to orphaning
+    if(persistentMappingRequested && !bufferStorage && openGLContext->hasExtension(QByteArrayLiteral("GL_ARB_buffer_storage")))
+    {
+        bufferStorage = new QOpenGLExtension_ARB_buffer_storage();
+        if(!bufferStorage->initializeOpenGLFunctions())
+        {
+            delete bufferStorage;
+            bufferStorage = nullptr;
+        }
+    }
+
+    persistentMapping = persistentMappingRequested && bufferStorage;
+    bufferSize = getFrameSize(renderSpecs.frameType);
+    conversionDirty = true;
+
+    for(OpenGLInputBuffer& buffer : inputBuffers)
+        initializeInputBuffer(buffer);
+
+    inputBufferIndex = 0;
+
+    //Planar frames are converted to RGBA; packed frames keep their format
+    outputRing.initialize();
+    outputRing.setTexturePool(&texturePool);
+
+    outputRing.allocate(renderSpecs.frameType.width,
+                        renderSpecs.frameType.height,
+                        renderSpecs.frameType.planeLayout != OpenGLPlanesPacked ? GL_RGBA8 : renderSpecs.frameType.internalFormat);
+
+    fboID = outputRing.getBuffer().fboID;
+    outputTextureID = outputRing.getBuffer().textureID;
+}
+
+void OpenGLInputSource::initializeShaderProgram()
+{
+    //Packed frames are uploaded, not drawn; planar ones go through the YUV conversion program. The conversion uniforms
+    //follow this source's frame type, so the program is not shared with other sources
+    shader = OpenGLProgramCache::getCache(QOpenGLContext::currentContext())->getInstanceProgram(QString(":/GLSL/yuvVertex.glsl"),
+                                                                                               QString(":/GLSL/yuvFragment.glsl"));
+
+    //Samplers never change units, so set them once
+    glProgramUniform1i(shader->programId(), glGetUniformLocation(shader->programId(), "yPlane"), 0);
+    glProgramUniform1i(shader->programId(), glGetUniformLocation(shader->programId(), "uPlane"), 1);
+    glProgramUniform1i(shader->programId(), glGetUniformLocation(shader->programId(), "vPlane"), 2);
+
+    colorMatrixUniformLocation = glGetUniformLocation(shader->programId(), "colorMatrix");
+    colorOffsetUniformLocation = glGetUniformLocation(shader->programId(), "colorOffset");
+    interleavedChromaUniformLocation = glGetUniformLocation(shader->programId(), "interleavedChroma");
+
+    conversionDirty = true;
+}
+
+void OpenGLInputSource::initializeVertexBuffers()
+{
+    //Full screen strip for the YUV conversion; attribute locations are fixed in yuvVertex.glsl
+    static const GLfloat vertexData[4][4] = {{-1.0f,-1.0f,0.0f,0.0f},
+                                             { 1.0f,-1.0f,1.0f,0.0f},
+                                             {-1.0f, 1.0f,0.0f,1.0f},
+                                             { 1.0f, 1.0f,1.0f,1.0f}};
+
+    glGenVertexArrays(1, &vaoID);
+    glBindVertexArray(vaoID);
+
+    glGenBuffers(1, &vboID);
+    glBindBuffer(GL_ARRAY_BUFFER, vboID);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(vertexData), vertexData, GL_STATIC_DRAW);
+
+    glEnableVertexAttribArray(0);
+    glEnableVertexAttribArray(1);
+
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 4*sizeof(GLfloat), (const void*)(0));
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 4*sizeof(GLfloat), (const void*)(2*sizeof(GLfloat)));
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void OpenGLInputSource::resizeFBO()
+{
+    //Immutable textures cannot be respecified, so both rings are rebuilt
+    for(OpenGLInputBuffer& buffer : inputBuffers)
+        releaseInputBuffer(buffer);
+
+    initializeFBO();
+}
+
+void OpenGLInputSource::initializeInputBuffer(OpenGLInputSource::OpenGLInputBuffer &buffer)
+{
+    const OpenGLTextureSpecs& specs = renderSpecs.frameType;
+    bool planar = (specs.planeLayout != OpenGLPlanesPacked);
+
+    //Planes are sampled with linear filtering, which upsamples chroma
+    for(unsigned int i = 0; planar && i < getPlaneCount(specs); i++)
+    {
+        OpenGLPlaneSpecs plane = getPlaneSpecs(specs, i);
+
+        glGenTextures(1, &buffer.planeTextureIDs[i]);
+        stateCache.bindTexture(GL_TEXTURE_2D, buffer.planeTextureIDs[i]);
+
+        glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+
+        glTexStorage2D(GL_TEXTURE_2D, 1, static_cast<GLenum>(plane.internalFormat), plane.width, plane.height);
+    }
+
+    stateCache.bindTexture(GL_TEXTURE_2D, 0);
+
+    //Pixel unpack buffer
+    glGenBuffers(1, &buffer.pboID);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer.pboID);
+
+    if(persistentMapping)
+    {
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+        bufferStorage->glBufferStorage(GL_PIXEL_UNPACK_BUFFER, bufferSize, nullptr, flags);
+        buffer.mappedData = static_cast<unsigned char*>(glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, bufferSize, flags));
+    }
+    else
+    {
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, bufferSize, nullptr, GL_STREAM_DRAW);
+        buffer.mappedData = nullptr;
+    }
+
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    buffer.fence = nullptr;
+}
+
+void OpenGLInputSource::releaseInputBuffer(OpenGLInputSource::OpenGLInputBuffer &buffer)
+{
+    if(buffer.mappedData)
+    {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer.pboID);
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    }
+
+    if(buffer.fence)
+        glDeleteSync(buffer.fence);
+
+    for(GLuint& planeTextureID : buffer.planeTextureIDs)
+    {
+        if(planeTextureID)
+            stateCache.deleteTextures(1, &planeTextureID);
+    }
+
+    glDeleteBuffers(1, &buffer.pboID);
+
+    buffer = OpenGLInputBuffer{0,{0,0,0},nullptr,nullptr};
+}
+
+void OpenGLInputSource::convertFrame(const OpenGLInputSource::OpenGLInputBuffer &buffer, GLuint targetFBO)
+{
+    const OpenGLTextureSpecs& specs = renderSpecs.frameType;
+
+    if(conversionDirty)
+    {
+        GLfloat matrix[9];
+        GLfloat offset[3];
+        getColorConversion(specs, matrix, offset);
+
+        glProgramUniformMatrix3fv(shader->programId(), colorMatrixUniformLocation, 1, GL_FALSE, matrix);
+        glProgramUniform3fv(shader->programId(), colorOffsetUniformLocation, 1, offset);
+        glProgramUniform1i(shader->programId(), interleavedChromaUniformLocation, specs.planeLayout != OpenGLPlanesI420);
+
+        conversionDirty = false;
+    }
+
+    stateCache.bindFramebuffer(GL_FRAMEBUFFER, targetFBO);
+    stateCache.viewport(0, 0, specs.width, specs.height);
+
+    stateCache.disable(GL_DEPTH_TEST);
+    stateCache.disable(GL_BLEND);
+
+    stateCache.useProgram(shader->programId());
+    stateCache.bindVertexArray(vaoID);
+
+    //Interleaved chroma only reads unit 1; U and V of I420 are on 1 and 2
+    for(unsigned int i = 0; i < getPlaneCount(specs); i++)
+    {
+        stateCache.activeTexture(GL_TEXTURE0 + i);
+        stateCache.bindTexture(GL_TEXTURE_2D, buffer.planeTextureIDs[i]);
+    }
+
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+}
+
+bool OpenGLInputSource::makeContextCurrent()
+{
+    return stateCache.makeCurrent(openGLContext, this);
+}
+
+void OpenGLInputSource::doneContextCurrent()
+{
+    stateCache.doneCurrent(openGLContext);
+}
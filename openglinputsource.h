@@ -0,0 +1,117 @@
+#ifndef OPENGLINPUTSOURCE_H
+#define OPENGLINPUTSOURCE_H
+
+#include <openglrenderer.h>
+#include <opengloutputring.h>
+
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+#include <QByteArray>
+
+#include <QtOpenGLExtensions/QOpenGLExtensions>
+
+#include <algorithm>
+#include <vector>
+
+//Producer fed with CPU frames (decoded video, camera buffers); frames are streamed through a ring of pixel
+//unpack buffers into preallocated textures and published through frameReady like OpenGLRenderSurface's. Planar YUV
+//frames (NV12, I420, P010) are uploaded plane by plane and converted to RGBA on the GPU, so consumers always get RGBA
+class OpenGLInputSource : public QOffscreenSurface, public OpenGLRenderer
+{
+    Q_OBJECT
+public:
+    OpenGLInputSource(QScreen* outputScreen,
+                      QObject* parent,
+                      OpenGLRenderer::OpenGLRenderSpecs specs,
+                      const QSurfaceFormat& surfaceFormat,
+                      QOpenGLContext* sharedContext,
+                      unsigned int inputBufferCount = 3);
+
+    virtual ~OpenGLInputSource();
+
+    const QSurfaceFormat& getOpenGLFormat();
+    QOpenGLContext* getOpenGLContext();
+
+    //Uploads a frame described by specs (getFrameSize bytes, planes back to back); returns false (frame dropped) if the
+    //next persistently mapped slot's transfer is still in flight or an orphaned buffer cannot be mapped. Must be called
+    //on the source's thread; data only needs to stay valid for the duration of the call
+    bool uploadFrame(const unsigned char* data, const OpenGLRenderer::OpenGLTextureSpecs& specs);
+
+    //Use persistently mapped buffers when GL_ARB_buffer_storage is available (default), otherwise orphan each upload
+    void setPersistentMapping(bool enabled);
+    bool isPersistentlyMapped() const;
+
+    unsigned long long getFrameIndex() const;
+    unsigned long long getDroppedFrameCount() const;
+
+public slots:
+    //Queued entry point for other threads; QByteArray is implicitly shared so the frame is not copied on the way
+    void setFrame(QByteArray frame, OpenGLRenderer::OpenGLTextureSpecs specs);
+
+    //Releases the context, which stays current on the source's thread from one upload to the next
+    virtual void stop() override;
+
+    //Publishes the most recent frame again
+    virtual void renderFrame() override;
+
+signals:
+    void frameReady(OpenGLOutputRing::OpenGLOutputFrame frame);
+
+protected:
+    //Defines one slot of the upload ring; the fence covers the transfer out of a persistent PBO. Packed frames are transferred
+    //straight into an output slot, planar frames land in the plane textures and are converted into one
+    typedef struct OpenGLInputBuffer
+    {
+        GLuint pboID;
+
+        GLuint planeTextureIDs[3];
+
+        unsigned char* mappedData;
+
+        GLsync fence;
+    }
+    OpenGLInputBuffer;
+
+    virtual void initializeFBO() override;
+    virtual void initializeShaderProgram() override;
+    virtual void initializeVertexBuffers() override;
+
+    virtual void resizeFBO() override;
+
+    void initializeInputBuffer(OpenGLInputBuffer& buffer);
+    void releaseInputBuffer(OpenGLInputBuffer& buffer);
+
+    //Draws a slot's planes into an RGBA output slot
+    void convertFrame(const OpenGLInputBuffer& buffer, GLuint targetFBO);
+
+    bool makeContextCurrent();
+    void doneContextCurrent();
+
+    QSurfaceFormat openGLFormat;
+    QOpenGLContext* openGLContext;
+
+    //Upload ring
+    std::vector<OpenGLInputBuffer> inputBuffers;
+    unsigned int inputBufferIndex;
+
+    size_t bufferSize;
+
+    //Uploaded frames; slots stay held while consumers sample them, as in OpenGLRenderSurface
+    OpenGLOutputRing outputRing;
+
+    //YUV conversion uniforms, set again only when the frame type changes
+    GLint colorMatrixUniformLocation;
+    GLint colorOffsetUniformLocation;
+    GLint interleavedChromaUniformLocation;
+    bool conversionDirty;
+
+    //Persistent mapping through GL_ARB_buffer_storage
+    bool persistentMappingRequested;
+    bool persistentMapping;
+    QOpenGLExtension_ARB_buffer_storage* bufferStorage;
+
+    unsigned long long frameIndex;
+    unsigned long long droppedFrames;
+};
+
+#endif // OPENGLINPUTSOURCE_H
@@ -0,0 +1,445 @@
+#include "opengllayercompositor.h"
+
+#include <algorithm>
+#include <cmath>
+
+OpenGLLayerCompositor::OpenGLLayerCompositor(QScreen *outputScreen,
+                                             QObject *parent,
+                                             OpenGLRenderer::OpenGLRenderSpecs specs,
+                                             const QSurfaceFormat &surfaceFormat,
+                                             QOpenGLContext *sharedContext,
+                                             unsigned int outputBufferCount) :
+    QOffscreenSurface(outputScreen,parent),
+    OpenGLRenderer(specs),
+    frameScheduler(nullptr),
+    openGLFormat(surfaceFormat),
+    openGLContext(nullptr),
+    outputRing(outputBufferCount),
+    layers(),
+    drawOrder(),
+    layersDirty(true),
+    layerTransformsUniformLocation(-1),
+    layerOpacitiesUniformLocation(-1),
+    layerCountUniformLocation(-1),
+    outputSizeUniformLocation(-1),
+    stats()
+{
+    layers.reserve(maxLayers);
+
+    //Create offscreen surface
+    setFormat(openGLFormat);
+    create();
+
+    //Allocate memory for the context object and prepare to create it
+    openGLContext = new QOpenGLContext(this);
+    openGLContext->setFormat(openGLFormat);
+    if(sharedContext)
+        openGLContext->setShareContext(sharedContext);
+
+    //Make sure the context is created & is sharing resources with the shared context
+    bool contextCreated = openGLContext->create();
+    assert(contextCreated);
+
+    if(sharedContext)
+    {
+        bool sharing = QOpenGLContext::areSharing(openGLContext,sharedContext);
+        assert(sharing);
+    }
+
+    initializeScheduler();
+    qRegisterMetaType<GLuint>("GLuint");
+    qRegisterMetaType<GLsync>("GLsync");
+    qRegisterMetaType<OpenGLOutputRing::OpenGLOutputFrame>("OpenGLOutputRing::OpenGLOutputFrame");
+    qRegisterMetaType<OpenGLLayerCompositor::OpenGLLayerTransform>("OpenGLLayerCompositor::OpenGLLayerTransform");
+}
+
+OpenGLLayerCompositor::~OpenGLLayerCompositor()
+{
+
+}
+
+QOpenGLContext *OpenGLLayerCompositor::getOpenGLContext()
+{
+    return openGLContext;
+}
+
+OpenGLFrameScheduler *OpenGLLayerCompositor::getFrameScheduler()
+{
+    return frameScheduler;
+}
+
+unsigned int OpenGLLayerCompositor::getLayerCount() const
+{
+    return static_cast<unsigned int>(layers.size());
+}
+
+unsigned long long OpenGLLayerCompositor::getDroppedFrameCount(int layer) const
+{
+    return layers[layer].mailbox->getDroppedFrameCount(layers[layer].reader);
+}
+
+OpenGLLayerCompositor::OpenGLLayerCompositorStats OpenGLLayerCompositor::getStats() const
+{
+    return stats;
+}
+
+void OpenGLLayerCompositor::resetStats()
+{
+    stats = OpenGLLayerCompositorStats();
+}
+
+int OpenGLLayerCompositor::addLayer(OpenGLFrameMailbox *mailbox)
+{
+    if(layers.size() >= maxLayers)
+        return -1;
+
+    //Polled every tick, so the mailbox needs no wake-up
+    int reader = mailbox->addReader(std::function<void()>());
+    if(reader < 0)
+        return -1;
+
+    OpenGLLayer layer = OpenGLLayer();
+    layer.mailbox = mailbox;
+    layer.reader = reader;
+    layer.transform = OpenGLLayerTransform{0.0f,0.0f,0.0f,0.0f,0.0f};
+    layer.opacity = 1.0f;
+    layer.z = 0;
+    layer.visible = true;
+
+    layers.push_back(layer);
+    drawOrder.push_back(static_cast<unsigned int>(layers.size() - 1));
+
+    setLayerZOrder(static_cast<int>(layers.size() - 1), 0);
+
+    return static_cast<int>(layers.size() - 1);
+}
+
+void OpenGLLayerCompositor::setLayerTransform(int layer, OpenGLLayerCompositor::OpenGLLayerTransform transform)
+{
+    layers[layer].transform = transform;
+    layersDirty = true;
+}
+
+void OpenGLLayerCompositor::setLayerOpacity(int layer, float opacity)
+{
+    layers[layer].opacity = std::min(std::max(opacity, 0.0f), 1.0f);
+    layersDirty = true;
+}
+
+void OpenGLLayerCompositor::setLayerZOrder(int layer, int z)
+{
+    layers[layer].z = z;
+
+    //Stable, so equal z keeps the order layers were added in
+    for(unsigned int i = 0; i < drawOrder.size(); i++)
+        drawOrder[i] = i;
+
+    std::stable_sort(drawOrder.begin(), drawOrder.end(), [this](unsigned int a, unsigned int b)
+    {
+        return layers[a].z < layers[b].z;
+    });
+
+    layersDirty = true;
+}
+
+void OpenGLLayerCompositor::setLayerVisible(int layer, bool visible)
+{
+    layers[layer].visible = visible;
+    layersDirty = true;
+}
+
+void OpenGLLayerCompositor::setFrameRate(float fps)
+{
+    OpenGLRenderer::setFrameRate(fps);
+
+    frameScheduler->setFrameRate(renderSpecs.frameRate);
+}
+
+void OpenGLLayerCompositor::start()
+{
+    frameScheduler->start(renderSpecs.frameRate);
+}
+
+void OpenGLLayerCompositor::stop()
+{
+    frameScheduler->stop();
+
+    //Hand the layer frames back to their producers while the context that sampled them is still current
+    for(OpenGLLayer& layer : layers)
+    {
+        if(layer.framePending)
+            OpenGLOutputRing::release(layer.pendingFrame.frame);
+        OpenGLOutputRing::release(layer.frame.frame);
+
+        layer.frame = OpenGLFrameMailbox::OpenGLFrameDescriptor();
+        layer.framePending = false;
+    }
+
+    //The context stays current between frames; let go of it so another thread can take over the compositor
+    doneContextCurrent();
+}
+
+void OpenGLLayerCompositor::renderFrame()
+{
+    updateStartTime();
+
+    //Taking needs no context; only switch contexts if some layer has a frame waiting or something else changed
+    bool framesPending = false;
+    for(OpenGLLayer& layer : layers)
+    {
+        OpenGLFrameMailbox::OpenGLFrameDescriptor frame;
+
+        //A newer frame replaces one that has not finished yet; the layer keeps showing its current one either way
+        if(layer.mailbox->takeFrame(layer.reader, frame))
+        {
+            //Never sampled, so nothing to fence
+            if(layer.framePending)
+                OpenGLOutputRing::release(layer.pendingFrame.frame);
+
+            layer.pendingFrame = frame;
+            layer.framePending = true;
+        }
+
+        framesPending = framesPending || layer.framePending;
+    }
+
+    if(!framesPending && !layersDirty && !specsPending)
+    {
+        stats.skippedFrames++;
+        return;
+    }
+
+    if(!makeContextCurrent())
+        return;
+
+    initialize();
+
+    //Apply the last resize request since the previous frame, if any
+    if(beginFrame())
+        layersDirty = true;
+
+    if(!updateLayerFrames() && !layersDirty)
+    {
+        stats.skippedFrames++;
+        return;
+    }
+
+    //Next slot nobody holds
+    OpenGLOutputRing::OpenGLOutputBuffer& buffer = outputRing.nextBuffer();
+
+    beginPass("compositor draw");
+
+    stateCache.bindFramebuffer(GL_FRAMEBUFFER, buffer.fboID);
+
+    stateCache.viewport(0,0,renderSpecs.frameType.width,renderSpecs.frameType.height);
+    stateCache.disable(GL_DEPTH_TEST);
+
+    stateCache.useProgram(shader->programId());
+
+    updateUniforms();
+
+    //Every layer on its own unit, bottom first; the shader blends them in this order and covers the whole output
+    stateCache.bindVertexArray(vaoID);
+    glDrawArrays(GL_TRIANGLES, 0, 6);
+
+    stats.drawCalls++;
+
+    endPass();
+    endProfiledFrame();
+
+    //Displays wait on this fence (on the GPU) before sampling the slot; flush so the fence is submitted
+    OpenGLOutputRing::OpenGLOutputFrame frame = outputRing.publish();
+    glFlush();
+
+    fboID = buffer.fboID;
+    outputTextureID = buffer.textureID;
+
+    layersDirty = false;
+    stats.frames++;
+
+    updateEndTime();
+
+    emit renderedFrame(1000.0f/t_delta.count());
+
+    emit frameReady(frame);
+}
+
+void OpenGLLayerCompositor::initializeFBO()
+{
+    outputRing.initialize();
+    outputRing.setTexturePool(&texturePool);
+
+    outputRing.allocate(renderSpecs.frameType.width,
+                        renderSpecs.frameType.height,
+                        renderSpecs.frameType.internalFormat);
+
+    fboID = outputRing.getBuffer().fboID;
+    outputTextureID = outputRing.getBuffer().textureID;
+}
+
+void OpenGLLayerCompositor::initializeShaderProgram()
+{
+    //Layer transforms and opacities are this compositor's own, so the program is too
+    shader = OpenGLProgramCache::getCache(QOpenGLContext::currentContext())->getInstanceProgram(QString(":/GLSL/compositorVertex.glsl"),
+                                                                                               QString(":/GLSL/compositorFragment.glsl"));
+    shader -> bind();
+
+    //Layer i always samples texture unit i
+    GLint textureUnits[maxLayers];
+    for(unsigned int unit = 0; unit < maxLayers; unit++)
+        textureUnits[unit] = static_cast<GLint>(unit);
+
+    glUniform1iv(glGetUniformLocation(shader -> programId(), "layerTextures"), maxLayers, textureUnits);
+
+    layerTransformsUniformLocation = glGetUniformLocation(shader -> programId(), "layerTransforms");
+    layerOpacitiesUniformLocation = glGetUniformLocation(shader -> programId(), "layerOpacities");
+    layerCountUniformLocation = glGetUniformLocation(shader -> programId(), "layerCount");
+    outputSizeUniformLocation = glGetUniformLocation(shader -> programId(), "outputSize");
+
+    shader->release();
+}
+
+void OpenGLLayerCompositor::initializeVertexBuffers()
+{
+    //Corners come from gl_VertexID; core profile still needs a VAO bound to draw
+    glGenVertexArrays(1, &vaoID);
+}
+
+void OpenGLLayerCompositor::initializeUniforms()
+{
+
+}
+
+void OpenGLLayerCompositor::resizeFBO()
+{
+    //Swap every slot of the ring for a pooled target of the new size
+    outputRing.allocate(renderSpecs.frameType.width,
+                        renderSpecs.frameType.height,
+                        renderSpecs.frameType.internalFormat);
+
+    fboID = outputRing.getBuffer().fboID;
+    outputTextureID = outputRing.getBuffer().textureID;
+}
+
+void OpenGLLayerCompositor::updateUniforms()
+{
+    GLfloat transforms[maxLayers * 9];
+    GLfloat opacities[maxLayers];
+    GLint count = 0;
+
+    for(unsigned int index : drawOrder)
+    {
+        const OpenGLLayer& layer = layers[index];
+        if(!layer.visible || layer.opacity <= 0.0f || !layer.frame.frame.textureID)
+            continue;
+
+        getLayerMatrix(layer, &transforms[count * 9]);
+        opacities[count] = layer.opacity;
+
+        stateCache.activeTexture(GL_TEXTURE0 + count);
+        stateCache.bindTexture(GL_TEXTURE_2D, layer.frame.frame.textureID);
+
+        count++;
+    }
+
+    glUniform2f(outputSizeUniformLocation,
+                static_cast<GLfloat>(renderSpecs.frameType.width),
+                static_cast<GLfloat>(renderSpecs.frameType.height));
+    glUniform1i(layerCountUniformLocation, count);
+
+    if(count > 0)
+    {
+        glUniformMatrix3fv(layerTransformsUniformLocation, count, GL_FALSE, transforms);
+        glUniform1fv(layerOpacitiesUniformLocation, count, opacities);
+    }
+}
+
+bool OpenGLLayerCompositor::updateLayerFrames()
+{
+    bool changed = false;
+
+    for(OpenGLLayer& layer : layers)
+    {
+        if(!layer.framePending)
+            continue;
+
+        //Polled, never waited on: an unfinished frame is picked up on a later tick. The frame is held, so its fence
+        //cannot be recycled under us
+        GLsync fence = layer.pendingFrame.frame.fence;
+        bool ready = !fence;
+
+        if(!ready)
+        {
+            GLenum status = glClientWaitSync(fence, 0, 0);
+            ready = (status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED);
+        }
+
+        if(!ready)
+        {
+            stats.layerFramesNotReady++;
+            continue;
+        }
+
+        //The previous frame was last sampled by an output already flushed, so its release fence covers it
+        OpenGLOutputRing::release(layer.frame.frame);
+
+        layer.frame = layer.pendingFrame;
+        layer.framePending = false;
+
+        stats.layerFrames++;
+
+        changed = changed || layer.visible;
+    }
+
+    return changed;
+}
+
+void OpenGLLayerCompositor::getLayerMatrix(const OpenGLLayerCompositor::OpenGLLayer &layer, GLfloat matrix[9]) const
+{
+    const OpenGLLayerTransform& transform = layer.transform;
+
+    float outputWidth = static_cast<float>(renderSpecs.frameType.width);
+    float outputHeight = static_cast<float>(renderSpecs.frameType.height);
+
+    bool fill = (transform.width <= 0.0f || transform.height <= 0.0f);
+
+    float centerX = fill ? 0.5f * outputWidth : transform.x;
+    float centerY = fill ? 0.5f * outputHeight : transform.y;
+    float width = fill ? outputWidth : transform.width;
+    float height = fill ? outputHeight : transform.height;
+    float angle = fill ? 0.0f : transform.rotation * 3.14159265f / 180.0f;
+
+    float c = std::cos(angle);
+    float s = std::sin(angle);
+
+    //Inverse of the placement: move the centre to the origin, rotate back, divide by the size and offset to the middle
+    //of the texture
+    matrix[0] = c / width;
+    matrix[1] = -s / height;
+    matrix[2] = 0.0f;
+
+    matrix[3] = s / width;
+    matrix[4] = c / height;
+    matrix[5] = 0.0f;
+
+    matrix[6] = -(c * centerX + s * centerY) / width + 0.5f;
+    matrix[7] = (s * centerX - c * centerY) / height + 0.5f;
+    matrix[8] = 1.0f;
+}
+
+void OpenGLLayerCompositor::initializeScheduler()
+{
+    frameScheduler = new OpenGLFrameScheduler(this);
+
+    QObject::connect(frameScheduler,&OpenGLFrameScheduler::frameDue,this,&OpenGLLayerCompositor::renderFrame);
+}
+
+bool OpenGLLayerCompositor::makeContextCurrent()
+{
+    return stateCache.makeCurrent(openGLContext, this);
+}
+
+void OpenGLLayerCompositor::doneContextCurrent()
+{
+    stateCache.doneCurrent(openGLContext);
+}
@@ -0,0 +1,168 @@
+#ifndef OPENGLLAYERCOMPOSITOR_H
+#define OPENGLLAYERCOMPOSITOR_H
+
+#include <openglrenderer.h>
+#include <openglframemailbox.h>
+#include <openglframescheduler.h>
+#include <opengloutputring.h>
+
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+
+#include <vector>
+
+//Composites the frames of several producers into one output, as layers placed with a transform, an opacity and a
+//z-order. Every producer publishes to its own OpenGLFrameMailbox from its own thread and context (in the same share
+//group); the compositor polls the mailboxes at its own rate, so no producer ever waits for another or for the
+//compositor. A layer's newest frame is only used once its fence has signaled, until then the layer keeps showing
+//its previous frame, so a slow producer never stalls the GPU of the others. Both frames stay held in their producer's
+//ring, so neither is recycled while the layer needs it. All layers are drawn in a single pass that samples every layer
+//texture. Producers should keep three or more output buffers, as the frame on show and the one in flight are both held
+class OpenGLLayerCompositor : public QOffscreenSurface, public OpenGLRenderer
+{
+    Q_OBJECT
+public:
+    //Must match MAX_LAYERS in compositorFragment.glsl; every layer uses a texture unit
+    static const unsigned int maxLayers = 16;
+
+    //Placement of a layer in output pixels: centre, size and a rotation about the centre in degrees. A zero size covers
+    //the whole output
+    typedef struct OpenGLLayerTransform
+    {
+        float x;
+        float y;
+
+        float width;
+        float height;
+
+        float rotation;
+    }
+    OpenGLLayerTransform;
+
+    typedef struct OpenGLLayerCompositorStats
+    {
+        //Frames composited, and ticks that found nothing new to composite
+        unsigned long long frames;
+        unsigned long long skippedFrames;
+
+        //Layer frames taken from the mailboxes and used, and times a layer kept its previous frame because the newest
+        //one was not finished yet
+        unsigned long long layerFrames;
+        unsigned long long layerFramesNotReady;
+
+        unsigned long long drawCalls;
+    }
+    OpenGLLayerCompositorStats;
+
+    OpenGLLayerCompositor(QScreen* outputScreen,
+                          QObject* parent,
+                          OpenGLRenderer::OpenGLRenderSpecs specs,
+                          const QSurfaceFormat& surfaceFormat,
+                          QOpenGLContext* sharedContext,
+                          unsigned int outputBufferCount = 2);
+
+    virtual ~OpenGLLayerCompositor();
+
+    QOpenGLContext* getOpenGLContext();
+
+    OpenGLFrameScheduler* getFrameScheduler();
+
+    unsigned int getLayerCount() const;
+
+    //Frames of a layer that were published but never composited
+    unsigned long long getDroppedFrameCount(int layer) const;
+
+    OpenGLLayerCompositorStats getStats() const;
+    void resetStats();
+
+public slots:
+
+    //Adds a layer fed by the mailbox (connect the producer's frameReady to OpenGLFrameMailbox::publish with
+    //Qt::DirectConnection); returns its index, or -1 once maxLayers are added or the mailbox has no room for another
+    //reader. Layers and their properties belong to the compositor's thread
+    int addLayer(OpenGLFrameMailbox* mailbox);
+
+    void setLayerTransform(int layer, OpenGLLayerCompositor::OpenGLLayerTransform transform);
+    void setLayerOpacity(int layer, float opacity);
+
+    //Higher z is drawn on top; layers of equal z are drawn in the order they were added
+    void setLayerZOrder(int layer, int z);
+    void setLayerVisible(int layer, bool visible);
+
+    virtual void setFrameRate(float fps) override;
+
+    virtual void start() override;
+    virtual void stop() override;
+
+    virtual void renderFrame() override;
+
+signals:
+    void frameReady(OpenGLOutputRing::OpenGLOutputFrame frame);
+    void renderedFrame(double actualFPS);
+
+protected:
+    //Defines one layer; the pending frame is the newest one taken, waiting for its fence. Both frames are held in their
+    //producer's ring until the layer moves on from them
+    typedef struct OpenGLLayer
+    {
+        OpenGLFrameMailbox* mailbox;
+        int reader;
+
+        OpenGLFrameMailbox::OpenGLFrameDescriptor frame;
+        OpenGLFrameMailbox::OpenGLFrameDescriptor pendingFrame;
+        bool framePending;
+
+        OpenGLLayerTransform transform;
+        float opacity;
+        int z;
+        bool visible;
+    }
+    OpenGLLayer;
+
+    virtual void initializeFBO() override;
+    virtual void initializeShaderProgram() override;
+    virtual void initializeVertexBuffers() override;
+    virtual void initializeUniforms() override;
+
+    virtual void resizeFBO() override;
+
+    virtual void updateUniforms() override;
+
+    //Moves pending frames whose fences have signaled to the front; returns true if any layer changed
+    bool updateLayerFrames();
+
+    //Column-major 3x3 matrix taking an output pixel to the layer's texture coordinates
+    void getLayerMatrix(const OpenGLLayer& layer, GLfloat matrix[9]) const;
+
+    virtual void initializeScheduler();
+
+    bool makeContextCurrent();
+    void doneContextCurrent();
+
+    OpenGLFrameScheduler* frameScheduler;
+
+    QSurfaceFormat openGLFormat;
+    QOpenGLContext* openGLContext;
+
+    //Output slots stay held while displays sample them, as in OpenGLRenderSurface
+    OpenGLOutputRing outputRing;
+
+    std::vector<OpenGLLayer> layers;
+
+    //Layer indices in drawing order; rebuilt when a z-order changes
+    std::vector<unsigned int> drawOrder;
+
+    //Set by anything that changes the output besides new frames
+    bool layersDirty;
+
+    GLint layerTransformsUniformLocation;
+    GLint layerOpacitiesUniformLocation;
+    GLint layerCountUniformLocation;
+    GLint outputSizeUniformLocation;
+
+    OpenGLLayerCompositorStats stats;
+};
+
+Q_DECLARE_METATYPE(OpenGLLayerCompositor::OpenGLLayerTransform)
+
+#endif // OPENGLLAYERCOMPOSITOR_H
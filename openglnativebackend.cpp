@@ -0,0 +1,45 @@
+#include "openglnativebackend.h"
+
+#ifdef Q_OS_WIN
+#include <openglwglbackend.h>
+#else
+#include <opengleglbackend.h>
+#endif
+
+OpenGLNativeBackend::OpenGLNativeBackend(OpenGLNativeRenderWindow *window,
+                                         const QSurfaceFormat &surfaceFormat,
+                                         QOpenGLContext *sharedContext) :
+    renderWindow(window),
+    openGLFormat(surfaceFormat),
+    sharedOpenGLContext(sharedContext)
+{
+
+}
+
+OpenGLNativeBackend::~OpenGLNativeBackend()
+{
+
+}
+
+OpenGLNativeBackend *OpenGLNativeBackend::create(OpenGLNativeRenderWindow *window,
+                                                 const QSurfaceFormat &surfaceFormat,
+                                                 QOpenGLContext *sharedContext)
+{
+#ifdef Q_OS_WIN
+    return new OpenGLWGLBackend(window,surfaceFormat,sharedContext);
+#else
+    return new OpenGLEGLBackend(window,surfaceFormat,sharedContext);
+#endif
+}
+
+void OpenGLNativeBackend::resizeNative(unsigned int width, unsigned int height)
+{
+    //A native window's drawable follows the window; only backends with their own surfaces (EGL pbuffers) resize here
+    Q_UNUSED(width);
+    Q_UNUSED(height);
+}
+
+bool OpenGLNativeBackend::invalidate()
+{
+    return true;
+}
@@ -0,0 +1,54 @@
+#ifndef OPENGLNATIVEBACKEND_H
+#define OPENGLNATIVEBACKEND_H
+
+#include <QOpenGLContext>
+#include <QSurfaceFormat>
+#include <QVariant>
+
+class OpenGLNativeRenderWindow;
+
+//Platform specific part of a native render window: window / drawable creation, context creation, make-current and swap
+class OpenGLNativeBackend
+{
+public:
+    OpenGLNativeBackend(OpenGLNativeRenderWindow* window,
+                        const QSurfaceFormat& surfaceFormat,
+                        QOpenGLContext* sharedContext);
+
+    virtual ~OpenGLNativeBackend();
+
+    //Creates the backend for the platform we are built for (WGL on Windows, EGL elsewhere)
+    static OpenGLNativeBackend* create(OpenGLNativeRenderWindow* window,
+                                       const QSurfaceFormat& surfaceFormat,
+                                       QOpenGLContext* sharedContext);
+
+    //Creates the native drawable and OpenGL context; must be called on the render window's thread
+    virtual bool createNative(unsigned int width, unsigned int height) = 0;
+    virtual bool showNative() = 0;
+
+    //Resizes the native drawable to match the render window
+    virtual void resizeNative(unsigned int width, unsigned int height);
+
+    //Native context handle that QOpenGLContext can adopt via setNativeHandle
+    virtual QVariant getNativeContext() const = 0;
+
+    //Context methods
+    virtual bool makeContextCurrent() = 0;
+    virtual void doneContextCurrent() = 0;
+    virtual void swapBuffers() = 0;
+
+    //True if the context is current on the calling thread with this backend's drawable
+    virtual bool isContextCurrent() const = 0;
+
+    //Schedules / validates a repaint of the render window
+    virtual void requestUpdate() = 0;
+    virtual bool invalidate();
+
+protected:
+    OpenGLNativeRenderWindow* renderWindow;
+
+    QSurfaceFormat openGLFormat;
+    QOpenGLContext* sharedOpenGLContext;
+};
+
+#endif // OPENGLNATIVEBACKEND_H
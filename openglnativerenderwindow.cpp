@@ -1,5 +1,7 @@
 #include "openglnativerenderwindow.h"
 
+#include <QMutexLocker>
+
 OpenGLNativeRenderWindow::OpenGLNativeRenderWindow(QScreen *outputScreen,
                                                    OpenGLRenderer::OpenGLRenderSpecs specs,
                                                    const QSurfaceFormat &surfaceFormat,
@@ -9,109 +11,40 @@ OpenGLNativeRenderWindow::OpenGLNativeRenderWindow(QScreen *outputScreen,
     openGLFormat(surfaceFormat),
     openGLContext(nullptr),
     sharedOpenGLContext(sharedContext),
-    inputTextureID(0),
+    nativeBackend(nullptr),
+    inputFrame{0,0,0,0,nullptr,nullptr,0,0},
+    inputMutex(),
+    inputSerial(0),
+    presentedSerial(0),
+    skippedFrames(0),
+    presentMode(OpenGLRenderer::OpenGLPresentCopy),
+    skipUnchanged(false),
+    presentFBO(0),
+    cachedInput(false),
+    cachedSize(0),
+    frameMailbox(nullptr),
+    mailboxReader(-1),
+    takenFrame{0,0,0,0,nullptr,nullptr,0,0},
+    videoWall(nullptr),
+    wallDisplay(0),
+    wallFrame{std::vector<GLuint>(),OpenGLOutputRing::OpenGLOutputFrame{0,0,0,0,nullptr,nullptr,0,0}},
     visible(false)
 {
     //Create offscreen surface
     setFormat(openGLFormat);
     create();
-}
-
-LRESULT OpenGLNativeRenderWindow::WindowProc(HWND hwnd, UINT message, WPARAM wParam, LPARAM lParam)
-{
-    HDC hdc;
-    HGLRC hglrc;
-    PIXELFORMATDESCRIPTOR pixelFormatDesc;
-    int pixelFormat;
-
-    OpenGLNativeRenderWindow* renderWindow;
-    switch (message)
-    {
-        case WM_CREATE:
-        pixelFormatDesc =
-        {
-            sizeof(PIXELFORMATDESCRIPTOR),
-            1,
-            PFD_DRAW_TO_WINDOW | PFD_SUPPORT_OPENGL | PFD_DOUBLEBUFFER, // Flags
-            PFD_TYPE_RGBA,                                              // The kind of framebuffer. RGBA or palette.
-            32,                                                         // Colordepth of the framebuffer.
-            0, 0, 0, 0, 0, 0,
-            0,
-            0,
-            0,
-            0, 0, 0, 0,
-            32,                                                         // Number of bits for the depthbuffer
-            8,                                                          // Number of bits for the stencilbuffer
-            0,                                                          // Number of Aux buffers in the framebuffer.
-            PFD_MAIN_PLANE,
-            0,
-            0, 0, 0
-        };
-
-        hdc = GetDC(hwnd);
-
-        pixelFormat = ChoosePixelFormat(hdc, &pixelFormatDesc);
-        SetPixelFormat(hdc, pixelFormat, &pixelFormatDesc);
-
-        hglrc = wglCreateContext(hdc);              //Create OpenGL context
-        wglMakeCurrent(hdc,hglrc);                  //Make the OpenGL context current
-        break;
-        case WM_DESTROY:
-        wglMakeCurrent(GetDC(hwnd),NULL);           //Deselect OpenGL context
-        wglDeleteContext(wglGetCurrentContext());   //Delete OpenGL context
-        PostQuitMessage(0);                         //Send wm_quit
-        break;
-        case WM_PAINT:
-        PAINTSTRUCT ps;
-        hdc = BeginPaint(hwnd, &ps);
-
-        //Access render window instance
-        renderWindow = reinterpret_cast<OpenGLNativeRenderWindow*>(GetWindowLongPtrW(hwnd,0));
-        if(renderWindow)
-            //Make sure the render window is created and visible on its own thread before resize / render
-            if(renderWindow->isVisible())
-                renderWindow->renderFrame();
-
-        FillRect(hdc, &ps.rcPaint, (HBRUSH)(COLOR_WINDOW+1));
-
-        EndPaint(hwnd, &ps);
-        break;
-        case WM_SIZE:
-        //Access render window instance
-        renderWindow = reinterpret_cast<OpenGLNativeRenderWindow*>(GetWindowLongPtrW(hwnd,0));
-        if(renderWindow)
-            //Make sure the render window is created and visible on its own thread before resize / render
-            if(renderWindow->isVisible())
-                    renderWindow->resize(LOWORD(lParam),HIWORD(lParam));
-        break;
-    }
 
-    return DefWindowProc(hwnd,message,wParam,lParam);
+    nativeBackend = OpenGLNativeBackend::create(this,
+                                                openGLFormat,
+                                                sharedOpenGLContext);
 }
 
-void OpenGLNativeRenderWindow::displayLastError()
+OpenGLNativeRenderWindow::~OpenGLNativeRenderWindow()
 {
-    DWORD errorMessageID = GetLastError();
-
-    LPSTR messageBuffer = nullptr;
-
-    //Ask Win32 to give us the string version of that message ID
-    //The parameters we pass in, tell Win32 to create the buffer that holds the message for us (because we don't yet know how long the message string will be)
-    size_t size = FormatMessageA(FORMAT_MESSAGE_ALLOCATE_BUFFER | FORMAT_MESSAGE_FROM_SYSTEM | FORMAT_MESSAGE_IGNORE_INSERTS,
-                                 NULL,
-                                 errorMessageID,
-                                 MAKELANGID(LANG_NEUTRAL, SUBLANG_DEFAULT),
-                                 (LPSTR)&messageBuffer,
-                                 0,
-                                 NULL);
+    if(nativeBackend)
+        delete nativeBackend;
 
-    //Copy the error message into a std::string
-    std::string message(messageBuffer, size);
-
-    //Free the Win32's string's buffer
-    LocalFree(messageBuffer);
-
-    qDebug()<<message.c_str();
+    nativeBackend = nullptr;
 }
 
 const QSurfaceFormat &OpenGLNativeRenderWindow::getOpenGLFormat()
@@ -124,71 +57,52 @@ QOpenGLContext *OpenGLNativeRenderWindow::getOpenGLContext()
     return openGLContext;
 }
 
-HWND OpenGLNativeRenderWindow::getWindowHandle() const
+OpenGLNativeBackend *OpenGLNativeRenderWindow::getNativeBackend() const
 {
-    return hwnd;
+    return nativeBackend;
 }
 
-HDC OpenGLNativeRenderWindow::getWindowRenderContext() const
+bool OpenGLNativeRenderWindow::isVisible() const
 {
-    return hdc;
+    return visible;
 }
 
-HGLRC OpenGLNativeRenderWindow::getOpenGLContextHandle() const
+bool OpenGLNativeRenderWindow::isCachedInput() const
 {
-    return hglrc;
+    return cachedInput;
 }
 
-bool OpenGLNativeRenderWindow::isVisible() const
+unsigned long long OpenGLNativeRenderWindow::getDroppedFrameCount() const
 {
-    return visible;
+    return frameMailbox ? frameMailbox->getDroppedFrameCount(mailboxReader) : 0;
 }
 
-void OpenGLNativeRenderWindow::createNative()
+OpenGLRenderer::OpenGLPresentMode OpenGLNativeRenderWindow::getPresentMode() const
 {
-    //Register the window class
-    const wchar_t CLASS_NAME[]  = L"Renderer";
-
-    WNDCLASS wc = {};
-
-    HINSTANCE hInstance = GetModuleHandle(NULL);
-
-    wc.lpfnWndProc = (WNDPROC)(&OpenGLNativeRenderWindow::WindowProc);
-    wc.hInstance = hInstance;
-    wc.lpszClassName = CLASS_NAME;
-    wc.style = CS_OWNDC;
-    wc.cbWndExtra = sizeof(OpenGLNativeRenderWindow*);
-
-    RegisterClass(&wc);
-
-    int wWid = static_cast<int>(getSpecs().frameType.width);
-    int wHei = static_cast<int>(getSpecs().frameType.height);
-
-    //Create the window
-    hwnd = CreateWindowEx(
-                0,                      //Optional window styles
-                CLASS_NAME,             //Window class
-                L"Render Window",       //Window text
-                WS_OVERLAPPEDWINDOW,    //Window style
-                CW_USEDEFAULT,          //X
-                CW_USEDEFAULT,          //Y
-                wWid,                   //W
-                wHei,                   //H
-                NULL,                   //Parent window
-                NULL,                   //Menu
-                hInstance,              //Instance handle
-                NULL                    //Additional application data
-                );
-
-    if(hwnd == NULL)
-        return;
+    return presentMode;
+}
 
-    hdc = GetDC(hwnd);                  //Get the device context for native window
-    hglrc = wglGetCurrentContext();
+bool OpenGLNativeRenderWindow::isSkipUnchanged() const
+{
+    return skipUnchanged;
+}
+
+unsigned long long OpenGLNativeRenderWindow::getSkippedFrameCount() const
+{
+    return skippedFrames;
+}
 
-    SetWindowLongPtrW(hwnd,
-                      0,
-                      reinterpret_cast<LONG_PTR>(this));
+OpenGLVideoWall *OpenGLNativeRenderWindow::getVideoWall() const
+{
+    return videoWall;
+}
+
+void OpenGLNativeRenderWindow::createNative()
+{
+    //Create the native window / drawable and its context
+    bool nativeCreated = nativeBackend->createNative(getSpecs().frameType.width,
+                                                     getSpecs().frameType.height);
+    assert(nativeCreated);
 }
 
 void OpenGLNativeRenderWindow::showNative()
@@ -201,8 +115,7 @@ void OpenGLNativeRenderWindow::showNative()
     //Allocate memory for the context object and prepare to create it
     openGLContext = new QOpenGLContext(this);
 
-    QWGLNativeContext nativeContext(hglrc,hwnd);
-    openGLContext->setNativeHandle(QVariant::fromValue(nativeContext));
+    openGLContext->setNativeHandle(nativeBackend->getNativeContext());
 
     openGLContext->setFormat(openGLFormat);
     if(sharedOpenGLContext)
@@ -218,114 +131,300 @@ void OpenGLNativeRenderWindow::showNative()
         assert(sharing);
     }
 
-    //Resize / show window
+    //Resize / show window; the first paint always draws
+    presentedSerial = inputSerial - 1;
+
     resize(renderSpecs.frameType.width,renderSpecs.frameType.height);
-    visible = !ShowWindow(hwnd,SW_SHOWNORMAL);
+    visible = nativeBackend->showNative();
 }
 
 void OpenGLNativeRenderWindow::resize(unsigned int w, unsigned int h)
 {
-    if(!makeContextCurrent())
+    //WM_SIZE arrives for every step of a drag; only record the size, the next frame applies the last one
+    OpenGLRenderer::resize(w,h);
+
+    updateCachedSize(w,h);
+
+    nativeBackend->requestUpdate();
+}
+
+void OpenGLNativeRenderWindow::updateSpecs(OpenGLRenderer::OpenGLRenderSpecs specs)
+{
+    OpenGLRenderer::updateSpecs(specs);
+
+    updateCachedSize(specs.frameType.width,specs.frameType.height);
+
+    nativeBackend->requestUpdate();
+}
+
+void OpenGLNativeRenderWindow::setCachedInput(bool enabled)
+{
+    cachedInput = enabled;
+
+    cachedSize.store((static_cast<unsigned long long>(renderSpecs.frameType.width) << 32) | renderSpecs.frameType.height);
+}
+
+void OpenGLNativeRenderWindow::setPresentMode(OpenGLRenderer::OpenGLPresentMode mode)
+{
+    presentMode = mode;
+
+    presentedSerial = inputSerial - 1;
+    nativeBackend->requestUpdate();
+}
+
+void OpenGLNativeRenderWindow::setSkipUnchanged(bool enabled)
+{
+    skipUnchanged = enabled;
+}
+
+bool OpenGLNativeRenderWindow::setFrameMailbox(OpenGLFrameMailbox *mailbox)
+{
+    //Posted to whichever thread this window lives on; the mailbox never posts a second one before we take a frame
+    int reader = mailbox->addReader([this]()
+    {
+        QMetaObject::invokeMethod(this, "takeFrame", Qt::QueuedConnection);
+    });
+
+    if(reader < 0)
+        return false;
+
+    frameMailbox = mailbox;
+    mailboxReader = reader;
+
+    return true;
+}
+
+void OpenGLNativeRenderWindow::takeFrame()
+{
+    OpenGLFrameMailbox::OpenGLFrameDescriptor frame;
+
+    if(!frameMailbox || !frameMailbox->takeFrame(mailboxReader, frame))
         return;
 
-    initialize();
+    setFrame(frame.frame);
 
-    OpenGLRenderer::resize(w,h);
+    //The new frame replaces the held one
+    OpenGLOutputRing::release(takenFrame);
+    takenFrame = frame.frame;
+}
 
-    swapSurfaceBuffers();
-    doneContextCurrent();
+void OpenGLNativeRenderWindow::setVideoWall(OpenGLVideoWall *wall, unsigned int display)
+{
+    videoWall = wall;
+    wallDisplay = display;
+
+    wallFrame.textureIDs.clear();
+
+    presentedSerial = inputSerial - 1;
+    nativeBackend->requestUpdate();
 }
 
-void OpenGLNativeRenderWindow::updateSpecs(OpenGLRenderer::OpenGLRenderSpecs specs)
+void OpenGLNativeRenderWindow::setWallFrame(OpenGLVideoWall::OpenGLWallFrame frame)
 {
-    if(!makeContextCurrent())
+    if(!videoWall)
         return;
 
-    initialize();
+    {
+        QMutexLocker locker(&inputMutex);
 
-    OpenGLRenderer::updateSpecs(specs);
+        wallFrame = frame;
+        inputSerial++;
+    }
 
-    swapSurfaceBuffers();
-    doneContextCurrent();
+    nativeBackend->requestUpdate();
 }
 
-void OpenGLNativeRenderWindow::setFrame(GLuint texID, unsigned int width, unsigned int height)
+void OpenGLNativeRenderWindow::setFrame(OpenGLOutputRing::OpenGLOutputFrame frame)
 {
-    inputTextureID = texID;
+    {
+        QMutexLocker locker(&inputMutex);
+
+        //A cache emits every output size; keep ours, or any size while ours is not there yet (it is stretched)
+        if(cachedInput)
+        {
+            unsigned long long size = cachedSize.load();
+            unsigned int width = static_cast<unsigned int>(size >> 32);
+            unsigned int height = static_cast<unsigned int>(size & 0xFFFFFFFFull);
+
+            bool matching = (frame.width == width && frame.height == height);
+            bool inputMatching = (inputFrame.width == width && inputFrame.height == height);
+
+            if(!matching && inputMatching)
+                return;
+        }
 
-    RECT rect;
-    GetWindowRect(hwnd,&rect);
+        inputFrame = frame;
+        inputSerial++;
+    }
 
-    InvalidateRect(hwnd,&rect,true);
+    nativeBackend->requestUpdate();
+}
+
+void OpenGLNativeRenderWindow::updateCachedSize(unsigned int width, unsigned int height)
+{
+    if(!cachedInput || width == 0 || height == 0)
+        return;
+
+    unsigned long long size = (static_cast<unsigned long long>(width) << 32) | height;
+    unsigned long long previousSize = cachedSize.exchange(size);
+
+    if(size == previousSize)
+        return;
+
+    emit outputSizeChanged(static_cast<unsigned int>(previousSize >> 32),
+                           static_cast<unsigned int>(previousSize & 0xFFFFFFFFull),
+                           width,
+                           height);
 }
 
 void OpenGLNativeRenderWindow::renderFrame()
 {
     updateStartTime();
 
-    RECT rect;
-    GetWindowRect(hwnd,&rect);
-    if(!InvalidateRect(hwnd,&rect,true))
+    //Nothing new since the last paint; the swapped image is still on screen. Returning before invalidate also stops WM_PAINT
+    //from re-arming itself until the next frame or resize
+    if(skipUnchanged && initialized && !specsPending && presentedSerial == inputSerial)
+    {
+        skippedFrames++;
+        return;
+    }
+
+    //Hold the input's slot while it is sampled. A frame the producer has already moved on from is dropped (a newer one
+    //is on its way); returning before invalidate keeps WM_PAINT from re-arming itself meanwhile
+    OpenGLOutputRing::OpenGLOutputFrame frame;
+    unsigned long long frameSerial;
+    {
+        QMutexLocker locker(&inputMutex);
+        frame = videoWall ? wallFrame.frame : inputFrame;
+        frameSerial = inputSerial.load();
+    }
+
+    if(!OpenGLOutputRing::acquire(frame))
+    {
+        skippedFrames++;
         return;
+    }
 
-    if(!makeContextCurrent())
+    //Both passes run with the native drawable; openGLContext adopted the native context through setNativeHandle. Qt only
+    //has to make it current when another Qt context took the thread meanwhile, so its functions and currentContext match
+    if(!nativeBackend->invalidate() ||
+            (QOpenGLContext::currentContext() != openGLContext && !makeContextCurrent()) ||
+            !makeContextCurrentNative())
+    {
+        OpenGLOutputRing::release(frame);
         return;
+    }
 
     initialize();
 
-    //Render to FBO
-    glBindFramebuffer(GL_FRAMEBUFFER,fboID);
-    glBindVertexArray(vaoID);
+    //Apply the last resize request since the previous frame, if any
+    if(beginFrame())
+        nativeBackend->resizeNative(renderSpecs.frameType.width,renderSpecs.frameType.height);
 
-    glClearColor(0.0f,0.0f,0.0f,1.0f);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-    glDisable(GL_DEPTH_TEST);
+    stateCache.bindVertexArray(vaoID);
 
-    shader->bind();
+    stateCache.useProgram(shader->programId());
 
     //Update shader uniform values
     updateUniforms();
 
-    glActiveTexture(GL_TEXTURE0 + textureUnit);
-    glBindTexture(GL_TEXTURE_2D, inputTextureID);
+    //Make the GPU wait until the producer has finished the frame; the fence lives as long as we hold the slot
+    if(frame.fence)
+        glWaitSync(frame.fence, 0, GL_TIMEOUT_IGNORED);
+
+    presentedSerial = frameSerial;
 
-    glViewport(0,0,renderSpecs.frameType.width,renderSpecs.frameType.height);
+    OpenGLRenderer::OpenGLPresentMode mode = presentMode;
 
-    glDrawBuffers(1, &GL_outputColorAttachment);
-    glDrawArrays(GL_TRIANGLES, 0, 6);
+    //Input is already at output size (OpenGLOutputCache), so it can be presented as is
+    if(cachedInput && mode == OpenGLRenderer::OpenGLPresentCopy)
+        mode = OpenGLRenderer::OpenGLPresentSample;
 
-    glBindTexture(GL_TEXTURE_2D, 0);
-    glActiveTexture(GL_TEXTURE0);
+    if(videoWall)
+        mode = OpenGLRenderer::OpenGLPresentBlit;
+
+    GLuint presentTextureID = outputTextureID;
+
+    if(mode != OpenGLRenderer::OpenGLPresentCopy)
+    {
+        presentTextureID = frame.textureID;
+    }
+    else
+    {
+        //Render to FBO
+        beginPass("display FBO pass");
+
+        stateCache.bindFramebuffer(GL_FRAMEBUFFER,fboID);
+
+        glClearColor(0.0f,0.0f,0.0f,1.0f);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        stateCache.disable(GL_DEPTH_TEST);
+
+        stateCache.activeTexture(GL_TEXTURE0 + textureUnit);
+        stateCache.bindTexture(GL_TEXTURE_2D, frame.textureID);
+
+        stateCache.viewport(0,0,renderSpecs.frameType.width,renderSpecs.frameType.height);
+
+        glDrawBuffers(1, &GL_outputColorAttachment);
+        glDrawArrays(GL_TRIANGLES, 0, 6);
+
+        endPass();
+    }
 
     //Render to default FBO
 
-    if(!makeContextCurrentNative())
-        return;
+    //Same GL context and drawable as the FBO pass, so the same profiler applies
+    beginPass("display default framebuffer pass");
 
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    if(videoWall)
+    {
+        presentWallFrame();
+    }
+    else if(mode == OpenGLRenderer::OpenGLPresentBlit)
+    {
+        //Attach the input to a read framebuffer and let the blit do the scaling; no draw, no clear
+        if(!presentFBO)
+            glGenFramebuffers(1, &presentFBO);
 
-    glClearColor(0.0f,0.0f,0.0f,1.0f);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-    glDisable(GL_DEPTH_TEST);
+        //Re-attached every time; the producer's ring can delete and recreate textures under the same name
+        stateCache.bindFramebuffer(GL_READ_FRAMEBUFFER, presentFBO);
+        glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, frame.textureID, 0);
 
-    glActiveTexture(GL_TEXTURE0 + textureUnit);
-    glBindTexture(GL_TEXTURE_2D, outputTextureID);
+        stateCache.bindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
 
-    glViewport(0,0,renderSpecs.frameType.width,renderSpecs.frameType.height);
-    glDrawArrays(GL_TRIANGLES, 0, 6);
+        unsigned int sourceWidth = frame.width ? frame.width : renderSpecs.frameType.width;
+        unsigned int sourceHeight = frame.height ? frame.height : renderSpecs.frameType.height;
 
-    glBindTexture(GL_TEXTURE_2D, 0);
-    glActiveTexture(GL_TEXTURE0);
+        glBlitFramebuffer(0, 0, sourceWidth, sourceHeight,
+                          0, 0, renderSpecs.frameType.width, renderSpecs.frameType.height,
+                          GL_COLOR_BUFFER_BIT,
+                          (sourceWidth == renderSpecs.frameType.width && sourceHeight == renderSpecs.frameType.height) ? GL_NEAREST : GL_LINEAR);
+    }
+    else
+    {
+        stateCache.bindFramebuffer(GL_FRAMEBUFFER, 0);
 
-    shader->release();
+        glClearColor(0.0f,0.0f,0.0f,1.0f);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        stateCache.disable(GL_DEPTH_TEST);
 
-    glBindVertexArray(0);
+        stateCache.activeTexture(GL_TEXTURE0 + textureUnit);
+        stateCache.bindTexture(GL_TEXTURE_2D, presentTextureID);
 
-    swapSurfaceBuffers();
-    doneContextCurrent();
+        stateCache.viewport(0,0,renderSpecs.frameType.width,renderSpecs.frameType.height);
+        glDrawArrays(GL_TRIANGLES, 0, 6);
+    }
 
+    endPass();
+    endProfiledFrame();
+
+    //Every read of the input is submitted; the producer may render into its slot again once they are done
+    OpenGLOutputRing::release(frame);
+
+    //The context is left current with the native drawable, so the next frame skips the switch
     swapSurfaceBuffersNative();
-    doneContextCurrent();
+
+    emit frameSwapped();
 
     updateEndTime();
 
@@ -334,35 +433,94 @@ void OpenGLNativeRenderWindow::renderFrame()
     emit renderedFrame(actualFPS);
 }
 
-void OpenGLNativeRenderWindow::swapSurfaceBuffers()
+void OpenGLNativeRenderWindow::stop()
 {
-    openGLContext->swapBuffers(this);
+    //Another display on this thread may have taken it since our last frame; the release fence belongs in our context
+    if(initialized)
+        makeContextCurrentNative();
+
+    OpenGLOutputRing::release(takenFrame);
+    takenFrame = OpenGLOutputRing::OpenGLOutputFrame{0,0,0,0,nullptr,nullptr,0,0};
+
+    //Qt only knows about its own make-current calls; the native drawable is released either way
+    doneContextCurrent();
+
+    if(initialized && nativeBackend->isContextCurrent())
+        doneContextCurrentNative();
 }
 
 bool OpenGLNativeRenderWindow::makeContextCurrent()
 {
-    return openGLContext->makeCurrent(this);
+    return stateCache.makeCurrent(openGLContext, this);
 }
 
 void OpenGLNativeRenderWindow::doneContextCurrent()
 {
-    openGLContext->doneCurrent();
+    stateCache.doneCurrent(openGLContext);
 }
 
 void OpenGLNativeRenderWindow::swapSurfaceBuffersNative()
 {
-    //SwapBuffers(hdc);
-    wglSwapLayerBuffers(hdc,
-                        WGL_SWAP_MAIN_PLANE);
+    nativeBackend->swapBuffers();
 }
 
 bool OpenGLNativeRenderWindow::makeContextCurrentNative()
 {
-    return wglMakeCurrent(hdc,
-                          hglrc);
+    return stateCache.makeCurrent(nativeBackend);
 }
 
 void OpenGLNativeRenderWindow::doneContextCurrentNative()
 {
-    wglMakeCurrent(hdc,NULL);
+    stateCache.doneCurrent(nativeBackend);
+}
+
+void OpenGLNativeRenderWindow::presentWallFrame()
+{
+    stateCache.bindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+
+    //Parts of the viewport past the canvas have no tile
+    glClearColor(0.0f,0.0f,0.0f,1.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+
+    if(!presentFBO)
+        glGenFramebuffers(1, &presentFBO);
+
+    stateCache.bindFramebuffer(GL_READ_FRAMEBUFFER, presentFBO);
+
+    const OpenGLVideoWall::OpenGLWallRect& viewport = videoWall->getDisplayViewport(wallDisplay);
+
+    double scaleX = static_cast<double>(renderSpecs.frameType.width) / viewport.width;
+    double scaleY = static_cast<double>(renderSpecs.frameType.height) / viewport.height;
+
+    bool stretched = (viewport.width != renderSpecs.frameType.width || viewport.height != renderSpecs.frameType.height);
+
+    for(unsigned int tile : videoWall->getDisplayTiles(wallDisplay))
+    {
+        GLuint textureID = (tile < wallFrame.textureIDs.size()) ? wallFrame.textureIDs[tile] : 0;
+        if(!textureID)
+            continue;
+
+        OpenGLVideoWall::OpenGLWallRect tileRect = videoWall->getTileRect(tile);
+        OpenGLVideoWall::OpenGLWallRect overlap;
+
+        if(!OpenGLVideoWall::intersect(viewport, tileRect, overlap))
+            continue;
+
+        //Re-attached every time, as the single frame blit
+        glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, textureID, 0);
+
+        GLint sourceX = overlap.x - tileRect.x;
+        GLint sourceY = overlap.y - tileRect.y;
+
+        //Both edges rounded from canvas positions so neighbouring tiles meet without gaps or overlap
+        GLint destinationX0 = static_cast<GLint>((overlap.x - viewport.x) * scaleX + 0.5);
+        GLint destinationY0 = static_cast<GLint>((overlap.y - viewport.y) * scaleY + 0.5);
+        GLint destinationX1 = static_cast<GLint>((overlap.x + static_cast<int>(overlap.width) - viewport.x) * scaleX + 0.5);
+        GLint destinationY1 = static_cast<GLint>((overlap.y + static_cast<int>(overlap.height) - viewport.y) * scaleY + 0.5);
+
+        glBlitFramebuffer(sourceX, sourceY, sourceX + overlap.width, sourceY + overlap.height,
+                          destinationX0, destinationY0, destinationX1, destinationY1,
+                          GL_COLOR_BUFFER_BIT,
+                          stretched ? GL_LINEAR : GL_NEAREST);
+    }
 }
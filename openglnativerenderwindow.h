@@ -2,16 +2,16 @@
 #define OPENGLNATIVERENDERWINDOW_H
 
 #include <openglrenderer.h>
+#include <openglframemailbox.h>
+#include <openglnativebackend.h>
+#include <opengloutputring.h>
+#include <openglvideowall.h>
 
-#include <QOffScreenSurface>
+#include <QMutex>
+#include <QOffscreenSurface>
 #include <QOpenGLContext>
 
-#include <QtPlatformHeaders/QWGLNativeContext>
-#include <WinUser.h>
-#include <wingdi.h>
-#include <windef.h>
-
-#include <errhandlingapi.h>
+#include <atomic>
 
 class OpenGLNativeRenderWindow : public QOffscreenSurface, public OpenGLRenderer
 {
@@ -22,21 +22,28 @@ public:
                              const QSurfaceFormat& surfaceFormat,
                              QOpenGLContext* sharedContext);
 
-    //Class window procedure
-    static LRESULT WindowProc(HWND hwnd, UINT message, WPARAM wParam, LPARAM lParam);
-
-    void displayLastError();
+    virtual ~OpenGLNativeRenderWindow();
 
     //QT OpenGL resource access
     const QSurfaceFormat& getOpenGLFormat();
     QOpenGLContext* getOpenGLContext();
 
-    //WGL resource access
-    HWND getWindowHandle() const;
-    HDC getWindowRenderContext() const;
-    HGLRC getOpenGLContextHandle() const;
+    //Native window / context access
+    OpenGLNativeBackend* getNativeBackend() const;
 
     bool isVisible() const;
+    bool isCachedInput() const;
+
+    //Frames published to the mailbox that this window never presented
+    unsigned long long getDroppedFrameCount() const;
+
+    OpenGLRenderer::OpenGLPresentMode getPresentMode() const;
+    bool isSkipUnchanged() const;
+
+    //Paints that found nothing new to present, or only a frame the producer had already moved on from
+    unsigned long long getSkippedFrameCount() const;
+
+    OpenGLVideoWall* getVideoWall() const;
 
 public slots:
 
@@ -48,38 +55,102 @@ public slots:
     virtual void resize(unsigned int w, unsigned int h) override;
     virtual void updateSpecs(OpenGLRenderer::OpenGLRenderSpecs specs) override;
 
+    //Input comes from OpenGLOutputCache at this window's size; skips the FBO pass so presenting is a single draw. The
+    //window's size stays registered with the cache through outputSizeChanged; until the cache delivers a new size, frames
+    //of the old one are stretched
+    void setCachedInput(bool enabled);
+
+    //Copy (default) keeps the intermediate FBO; sample and blit present the input texture directly. Cached input is always
+    //at window size, so copy falls back to sample there
+    void setPresentMode(OpenGLRenderer::OpenGLPresentMode mode);
+
+    //Skip the redraw when no frame arrived and nothing was resized since the last one
+    void setSkipUnchanged(bool enabled);
+
+    //Take frames from a mailbox instead of through setFrame signals; the window only ever presents the newest frame and
+    //holds it until a newer one is taken. Returns false if the mailbox has no room for another reader
+    bool setFrameMailbox(OpenGLFrameMailbox* mailbox);
+    void takeFrame();
+
+    //Shows the given display's viewport of a video wall, assembled from the tiles of frames passed to setWallFrame
+    //(connect OpenGLRenderSurface::wallFrameReady). The viewport is stretched to the window; tiles are blitted straight
+    //from the producer's textures, so the present mode is ignored. nullptr goes back to single frames
+    void setVideoWall(OpenGLVideoWall* wall, unsigned int display);
+    void setWallFrame(OpenGLVideoWall::OpenGLWallFrame frame);
+
     //Render methods
-    void setFrame(GLuint texID, unsigned int width, unsigned int height);
+    void setFrame(OpenGLOutputRing::OpenGLOutputFrame frame);
     virtual void renderFrame() override;
 
+    //Releases the context, which stays current on the window's thread from one frame to the next
+    virtual void stop() override;
+
 signals:
     void renderedFrame(double actualFPS);
 
+    //Emitted after every swap of the native window; can drive OpenGLFrameScheduler
+    void frameSwapped();
+
+    //Emitted on resize with cached input; connect to OpenGLOutputCache::moveOutputSize and the window's mailbox
+    void outputSizeChanged(unsigned int previousWidth, unsigned int previousHeight, unsigned int width, unsigned int height);
+
 protected:
     //QT context methods
-    void swapSurfaceBuffers();
-
     bool makeContextCurrent();
     void doneContextCurrent();
 
-    //WGL context methods
+    //Native context methods
     void swapSurfaceBuffersNative();
 
     bool makeContextCurrentNative();
     void doneContextCurrentNative();
 
+    //Blits this display's tiles of the wall frame into the default framebuffer
+    void presentWallFrame();
+
+    //Moves the size registered with the cache to the requested one
+    void updateCachedSize(unsigned int width, unsigned int height);
+
     //QT OpenGL resources
     QSurfaceFormat openGLFormat;
     QOpenGLContext* openGLContext;
 
     QOpenGLContext* sharedOpenGLContext;
 
-    //WGL resources
-    HWND hwnd;
-    HDC hdc;
-    HGLRC hglrc;
+    //Native window / context (WGL, EGL)
+    OpenGLNativeBackend* nativeBackend;
+
+    //Held from the start of a paint to its last read; setFrame may be called on the producer's thread
+    OpenGLOutputRing::OpenGLOutputFrame inputFrame;
+    QMutex inputMutex;
+
+    //Incremented by setFrame with inputMutex locked, read by paints without it; a paint is skipped when the presented
+    //serial matches it
+    std::atomic<unsigned long long> inputSerial;
+    unsigned long long presentedSerial;
+
+    unsigned long long skippedFrames;
+
+    OpenGLRenderer::OpenGLPresentMode presentMode;
+    bool skipUnchanged;
+
+    //Read framebuffer the input is attached to for blits
+    GLuint presentFBO;
+
+    bool cachedInput;
+
+    //Size the cache is asked for; follows resize requests right away, ahead of the specs. Read by setFrame
+    std::atomic<unsigned long long> cachedSize;
+
+    OpenGLFrameMailbox* frameMailbox;
+    int mailboxReader;
+
+    //Last frame taken from the mailbox, held so repaints can always present it; only touched on the window's thread
+    OpenGLOutputRing::OpenGLOutputFrame takenFrame;
 
-    GLuint inputTextureID;
+    OpenGLVideoWall* videoWall;
+    unsigned int wallDisplay;
+    OpenGLVideoWall::OpenGLWallFrame wallFrame;
 
     bool visible;
 };
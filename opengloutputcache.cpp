@@ -0,0 +1,422 @@
+#include "opengloutputcache.h"
+
+OpenGLOutputCache::OpenGLOutputCache(QScreen *outputScreen,
+                                     QObject *parent,
+                                     OpenGLRenderer::OpenGLRenderSpecs specs,
+                                     const QSurfaceFormat &surfaceFormat,
+                                     QOpenGLContext *sharedContext,
+                                     unsigned int outputBufferCount) :
+    QOffscreenSurface(outputScreen,parent),
+    OpenGLRenderer(specs),
+    openGLFormat(surfaceFormat),
+    openGLContext(nullptr),
+    numOutputBuffers(std::max(outputBufferCount,1u)),
+    inputFrame{0,0,0,0,nullptr,nullptr,0,0},
+    inputFBO(0),
+    pyramidTextureID(0),
+    pyramidWidth(0),
+    pyramidHeight(0),
+    pyramidInternalFormat(0),
+    scaledOutputCount(0),
+    frameIndex(0)
+{
+    //Create offscreen surface
+    setFormat(openGLFormat);
+    create();
+
+    //Allocate memory for the context object and prepare to create it
+    openGLContext = new QOpenGLContext(this);
+    openGLContext->setFormat(openGLFormat);
+    if(sharedContext)
+        openGLContext->setShareContext(sharedContext);
+
+    //Make sure the context is created & is sharing resources with the shared context
+    bool contextCreated = openGLContext->create();
+    assert(contextCreated);
+
+    if(sharedContext)
+    {
+        bool sharing = QOpenGLContext::areSharing(openGLContext,sharedContext);
+        assert(sharing);
+    }
+
+    qRegisterMetaType<GLuint>("GLuint");
+    qRegisterMetaType<GLsync>("GLsync");
+    qRegisterMetaType<OpenGLOutputRing::OpenGLOutputFrame>("OpenGLOutputRing::OpenGLOutputFrame");
+}
+
+OpenGLOutputCache::~OpenGLOutputCache()
+{
+
+}
+
+QOpenGLContext *OpenGLOutputCache::getOpenGLContext()
+{
+    return openGLContext;
+}
+
+unsigned int OpenGLOutputCache::getOutputSizeCount() const
+{
+    return static_cast<unsigned int>(std::count_if(outputs.begin(),outputs.end(),[](const OpenGLScaledOutput& output)
+    {
+        return output.refCount > 0;
+    }));
+}
+
+unsigned int OpenGLOutputCache::getScaledOutputCount() const
+{
+    return scaledOutputCount;
+}
+
+unsigned long long OpenGLOutputCache::getFrameIndex() const
+{
+    return frameIndex;
+}
+
+void OpenGLOutputCache::addOutputSize(unsigned int width, unsigned int height)
+{
+    if(width == 0 || height == 0)
+        return;
+
+    for(OpenGLScaledOutput& output : outputs)
+    {
+        if(output.width == width && output.height == height)
+        {
+            output.refCount++;
+            return;
+        }
+    }
+
+    //GL resources are created on the next frame, with the context current; a ring that has given its slots back is
+    //reused, frames still pointing at it can no longer be acquired
+    for(OpenGLScaledOutput& output : outputs)
+    {
+        if(output.refCount == 0 && !output.ring->isAllocated())
+        {
+            output.width = width;
+            output.height = height;
+            output.refCount = 1;
+            return;
+        }
+    }
+
+    outputs.push_back(OpenGLScaledOutput{width,height,1,std::unique_ptr<OpenGLOutputRing>(new OpenGLOutputRing(numOutputBuffers))});
+}
+
+void OpenGLOutputCache::removeOutputSize(unsigned int width, unsigned int height)
+{
+    //Released on the next frame once the count reaches zero
+    for(OpenGLScaledOutput& output : outputs)
+    {
+        if(output.width == width && output.height == height && output.refCount > 0)
+        {
+            output.refCount--;
+            return;
+        }
+    }
+}
+
+void OpenGLOutputCache::moveOutputSize(unsigned int previousWidth, unsigned int previousHeight, unsigned int width, unsigned int height)
+{
+    //Add first, so a size that stays registered keeps its ring
+    addOutputSize(width, height);
+    removeOutputSize(previousWidth, previousHeight);
+}
+
+void OpenGLOutputCache::setFrame(OpenGLOutputRing::OpenGLOutputFrame frame)
+{
+    inputFrame = frame;
+
+    renderFrame();
+}
+
+void OpenGLOutputCache::stop()
+{
+    doneContextCurrent();
+}
+
+void OpenGLOutputCache::renderFrame()
+{
+    if(inputFrame.textureID == 0 || inputFrame.width == 0 || inputFrame.height == 0)
+        return;
+
+    updateStartTime();
+
+    //Work out which sizes need scaling and how deep the pyramid has to go
+    unsigned int numScaled = 0;
+    int numLevels = 0;
+    bool releasePending = false;
+
+    for(const OpenGLScaledOutput& output : outputs)
+    {
+        if(output.refCount == 0)
+        {
+            releasePending = releasePending || output.ring->isAllocated();
+            continue;
+        }
+
+        if(output.width == inputFrame.width && output.height == inputFrame.height)
+            continue;
+
+        numScaled++;
+        numLevels = std::max(numLevels, pyramidLevelFor(output.width, output.height) + 1);
+    }
+
+    scaledOutputCount = numScaled;
+    bool scaled = false;
+
+    //Sizes matching the input cost nothing; only switch contexts if there is something to scale or release
+    if(numScaled > 0 || releasePending)
+    {
+        if(!makeContextCurrent())
+            return;
+
+        initialize();
+
+        stateCache.beginFrame();
+        texturePool.endFrame();
+
+        for(OpenGLScaledOutput& output : outputs)
+        {
+            if(output.refCount == 0 && output.ring->isAllocated())
+                releaseOutput(output);
+        }
+
+        //Hold the input while it is read; if the producer has already moved on from it, its next frame is right behind
+        if(numScaled > 0 && OpenGLOutputRing::acquire(inputFrame))
+        {
+            scaled = true;
+
+            beginPass("output cache");
+
+            //Make the GPU wait until the producer has finished the frame
+            if(inputFrame.fence)
+                glWaitSync(inputFrame.fence, 0, GL_TIMEOUT_IGNORED);
+
+            stateCache.bindFramebuffer(GL_READ_FRAMEBUFFER, inputFBO);
+            glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, inputFrame.textureID, 0);
+
+            updatePyramid(static_cast<unsigned int>(numLevels));
+
+            for(OpenGLScaledOutput& output : outputs)
+            {
+                if(output.refCount == 0 || (output.width == inputFrame.width && output.height == inputFrame.height))
+                    continue;
+
+                //Also reallocated when the producer's format changes; slots still held by displays are retired
+                if(!output.ring->isAllocated() || output.ring->getInternalFormat() != inputInternalFormat())
+                    initializeOutput(output);
+
+                //Next slot of this size's ring that no display holds
+                OpenGLOutputRing::OpenGLOutputBuffer& buffer = output.ring->nextBuffer();
+
+                //Start from the smallest level that is still at least the output size so the final blit never skips texels
+                int level = pyramidLevelFor(output.width, output.height);
+
+                GLuint readFBO = (level < 0) ? inputFBO : pyramidFBOs[level];
+                unsigned int readWidth = (level < 0) ? inputFrame.width : std::max(pyramidWidth >> level, 1u);
+                unsigned int readHeight = (level < 0) ? inputFrame.height : std::max(pyramidHeight >> level, 1u);
+
+                stateCache.bindFramebuffer(GL_READ_FRAMEBUFFER, readFBO);
+                stateCache.bindFramebuffer(GL_DRAW_FRAMEBUFFER, buffer.fboID);
+
+                glBlitFramebuffer(0, 0, readWidth, readHeight,
+                                  0, 0, output.width, output.height,
+                                  GL_COLOR_BUFFER_BIT, GL_LINEAR);
+
+                output.ring->publish();
+            }
+
+            //Detach so the producer's texture is not kept attached to a framebuffer of this context
+            stateCache.bindFramebuffer(GL_READ_FRAMEBUFFER, inputFBO);
+            glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, 0, 0);
+
+            endPass();
+            endProfiledFrame();
+
+            //Flushes the output fences as well
+            OpenGLOutputRing::release(inputFrame);
+        }
+    }
+
+    frameIndex++;
+
+    updateEndTime();
+
+    for(const OpenGLScaledOutput& output : outputs)
+    {
+        if(output.refCount == 0)
+            continue;
+
+        if(output.width == inputFrame.width && output.height == inputFrame.height)
+            emit frameReady(inputFrame);
+        else if(scaled && output.ring->isAllocated())
+            emit frameReady(output.ring->getFrame());
+    }
+}
+
+void OpenGLOutputCache::initializeFBO()
+{
+    //Only a read framebuffer for the input; outputs and the pyramid are created on demand
+    glGenFramebuffers(1, &inputFBO);
+}
+
+void OpenGLOutputCache::initializeShaderProgram()
+{
+    //Everything is done with framebuffer blits
+}
+
+void OpenGLOutputCache::initializeVertexBuffers()
+{
+
+}
+
+void OpenGLOutputCache::initializeUniforms()
+{
+
+}
+
+void OpenGLOutputCache::resizeFBO()
+{
+    //Sizes follow the input and the registered outputs, not the render specs
+}
+
+void OpenGLOutputCache::updateUniforms()
+{
+
+}
+
+GLint OpenGLOutputCache::inputInternalFormat() const
+{
+    return inputFrame.internalFormat ? inputFrame.internalFormat : renderSpecs.frameType.internalFormat;
+}
+
+void OpenGLOutputCache::updatePyramid(unsigned int numLevels)
+{
+    if(numLevels == 0)
+        return;
+
+    unsigned int baseWidth = std::max(inputFrame.width / 2, 1u);
+    unsigned int baseHeight = std::max(inputFrame.height / 2, 1u);
+
+    GLint internalFormat = inputInternalFormat();
+
+    //Allocate the whole chain once per input size and format; immutable storage so every level is complete up front
+    if(pyramidTextureID == 0 || pyramidWidth != baseWidth || pyramidHeight != baseHeight || pyramidInternalFormat != internalFormat)
+    {
+        releasePyramid();
+
+        pyramidWidth = baseWidth;
+        pyramidHeight = baseHeight;
+        pyramidInternalFormat = internalFormat;
+
+        unsigned int totalLevels = 1;
+        while((std::max(pyramidWidth, pyramidHeight) >> totalLevels) > 0)
+            totalLevels++;
+
+        glGenTextures(1, &pyramidTextureID);
+        stateCache.bindTexture(GL_TEXTURE_2D, pyramidTextureID);
+
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+
+        glTexStorage2D(GL_TEXTURE_2D, totalLevels, pyramidInternalFormat, pyramidWidth, pyramidHeight);
+
+        stateCache.bindTexture(GL_TEXTURE_2D, 0);
+
+        pyramidFBOs.assign(totalLevels, 0);
+        glGenFramebuffers(totalLevels, pyramidFBOs.data());
+
+        for(unsigned int level = 0; level < totalLevels; level++)
+        {
+            stateCache.bindFramebuffer(GL_DRAW_FRAMEBUFFER, pyramidFBOs[level]);
+            glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, pyramidTextureID, level);
+
+            assert(glCheckFramebufferStatus(GL_DRAW_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE);
+        }
+
+        stateCache.bindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+    }
+
+    numLevels = std::min(numLevels, static_cast<unsigned int>(pyramidFBOs.size()));
+
+    //Halve level by level; a linear blit at exactly half size averages 2x2 texels so nothing is skipped
+    GLuint readFBO = inputFBO;
+    unsigned int readWidth = inputFrame.width;
+    unsigned int readHeight = inputFrame.height;
+
+    for(unsigned int level = 0; level < numLevels; level++)
+    {
+        unsigned int levelWidth = std::max(pyramidWidth >> level, 1u);
+        unsigned int levelHeight = std::max(pyramidHeight >> level, 1u);
+
+        stateCache.bindFramebuffer(GL_READ_FRAMEBUFFER, readFBO);
+        stateCache.bindFramebuffer(GL_DRAW_FRAMEBUFFER, pyramidFBOs[level]);
+
+        glBlitFramebuffer(0, 0, readWidth, readHeight,
+                          0, 0, levelWidth, levelHeight,
+                          GL_COLOR_BUFFER_BIT, GL_LINEAR);
+
+        readFBO = pyramidFBOs[level];
+        readWidth = levelWidth;
+        readHeight = levelHeight;
+    }
+}
+
+void OpenGLOutputCache::releasePyramid()
+{
+    if(!pyramidFBOs.empty())
+        stateCache.deleteFramebuffers(static_cast<GLsizei>(pyramidFBOs.size()), pyramidFBOs.data());
+
+    pyramidFBOs.clear();
+
+    if(pyramidTextureID)
+        stateCache.deleteTextures(1, &pyramidTextureID);
+
+    pyramidTextureID = 0;
+    pyramidWidth = 0;
+    pyramidHeight = 0;
+    pyramidInternalFormat = 0;
+}
+
+int OpenGLOutputCache::pyramidLevelFor(unsigned int width, unsigned int height) const
+{
+    unsigned int baseWidth = std::max(inputFrame.width / 2, 1u);
+    unsigned int baseHeight = std::max(inputFrame.height / 2, 1u);
+
+    //Less than a halving (or upscaling) goes straight from the input
+    if(width > baseWidth || height > baseHeight)
+        return -1;
+
+    int level = 0;
+    while((baseWidth >> (level + 1)) >= width && (baseHeight >> (level + 1)) >= height)
+        level++;
+
+    return level;
+}
+
+void OpenGLOutputCache::initializeOutput(OpenGLOutputCache::OpenGLScaledOutput &output)
+{
+    //Slots come from the cache's pool, so a size that comes back (a window dragged to and fro) reuses its textures
+    output.ring->initialize();
+    output.ring->setTexturePool(&texturePool);
+
+    output.ring->allocate(output.width, output.height, inputInternalFormat());
+}
+
+void OpenGLOutputCache::releaseOutput(OpenGLOutputCache::OpenGLScaledOutput &output)
+{
+    output.ring->clear();
+}
+
+bool OpenGLOutputCache::makeContextCurrent()
+{
+    return stateCache.makeCurrent(openGLContext, this);
+}
+
+void OpenGLOutputCache::doneContextCurrent()
+{
+    stateCache.doneCurrent(openGLContext);
+}
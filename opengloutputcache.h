@@ -0,0 +1,120 @@
+#ifndef OPENGLOUTPUTCACHE_H
+#define OPENGLOUTPUTCACHE_H
+
+#include <openglrenderer.h>
+#include <opengloutputring.h>
+
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+//Fan-out stage between a producer and its displays; every distinct output size is computed once per frame and shared
+//by all displays of that size, so each display only has to present (OpenGLNativeRenderWindow::setCachedInput).
+//Sizes matching the input are passed through untouched; smaller sizes are blitted from a downscale pyramid
+class OpenGLOutputCache : public QOffscreenSurface, public OpenGLRenderer
+{
+    Q_OBJECT
+public:
+    OpenGLOutputCache(QScreen* outputScreen,
+                      QObject* parent,
+                      OpenGLRenderer::OpenGLRenderSpecs specs,
+                      const QSurfaceFormat& surfaceFormat,
+                      QOpenGLContext* sharedContext,
+                      unsigned int outputBufferCount = 2);
+
+    virtual ~OpenGLOutputCache();
+
+    QOpenGLContext* getOpenGLContext();
+
+    //Number of distinct sizes and how many of them needed scaling in the last frame
+    unsigned int getOutputSizeCount() const;
+    unsigned int getScaledOutputCount() const;
+
+    unsigned long long getFrameIndex() const;
+
+public slots:
+
+    //Sizes are reference counted so displays can register / unregister independently
+    void addOutputSize(unsigned int width, unsigned int height);
+    void removeOutputSize(unsigned int width, unsigned int height);
+
+    //A display that was resized moves its registration over (connect OpenGLNativeRenderWindow::outputSizeChanged)
+    void moveOutputSize(unsigned int previousWidth, unsigned int previousHeight, unsigned int width, unsigned int height);
+
+    //Connect to the producer's frameReady; fans the frame out immediately
+    void setFrame(OpenGLOutputRing::OpenGLOutputFrame frame);
+    virtual void renderFrame() override;
+
+    //Releases the context, which stays current on the cache's thread from one frame to the next
+    virtual void stop() override;
+
+signals:
+    //Emitted once per output size and frame; displays keep the frames that match their size
+    void frameReady(OpenGLOutputRing::OpenGLOutputFrame frame);
+
+protected:
+    //Defines one distinct output size. Frames handed out point at the ring, so an unused size only gives its textures
+    //back; the ring itself is kept and reused by the next new size
+    typedef struct OpenGLScaledOutput
+    {
+        unsigned int width;
+        unsigned int height;
+
+        unsigned int refCount;
+
+        std::unique_ptr<OpenGLOutputRing> ring;
+    }
+    OpenGLScaledOutput;
+
+    virtual void initializeFBO() override;
+    virtual void initializeShaderProgram() override;
+    virtual void initializeVertexBuffers() override;
+    virtual void initializeUniforms() override;
+
+    virtual void resizeFBO() override;
+
+    virtual void updateUniforms() override;
+
+    //Format of the input frame, so 16-bit and float producers are not narrowed; the render specs' for frames without one
+    GLint inputInternalFormat() const;
+
+    //Builds pyramid levels 0..numLevels-1 for the current input size, reallocating if the input size changed
+    void updatePyramid(unsigned int numLevels);
+    void releasePyramid();
+
+    //Deepest pyramid level that is still at least width x height; -1 if the input itself has to be used
+    int pyramidLevelFor(unsigned int width, unsigned int height) const;
+
+    void initializeOutput(OpenGLScaledOutput& output);
+    void releaseOutput(OpenGLScaledOutput& output);
+
+    bool makeContextCurrent();
+    void doneContextCurrent();
+
+    QSurfaceFormat openGLFormat;
+    QOpenGLContext* openGLContext;
+
+    unsigned int numOutputBuffers;
+    std::vector<OpenGLScaledOutput> outputs;
+
+    //Current input; held while it is scaled and passed through as is
+    OpenGLOutputRing::OpenGLOutputFrame inputFrame;
+
+    //Read FBO the input texture is attached to every frame
+    GLuint inputFBO;
+
+    //Downscale pyramid; level 0 is half the input size, in the input's format
+    GLuint pyramidTextureID;
+    std::vector<GLuint> pyramidFBOs;
+    unsigned int pyramidWidth;
+    unsigned int pyramidHeight;
+    GLint pyramidInternalFormat;
+
+    unsigned int scaledOutputCount;
+    unsigned long long frameIndex;
+};
+
+#endif // OPENGLOUTPUTCACHE_H
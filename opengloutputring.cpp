@@ -0,0 +1,368 @@
+#include "opengloutputring.h"
+
+#include <QMutexLocker>
+#include <QOpenGLContext>
+
+#include <algorithm>
+
+OpenGLOutputRing::OpenGLOutputRing(unsigned int bufferCount, unsigned int maxBuffers) :
+    initialized(false),
+    texturePool(nullptr),
+    minBufferCount(std::max(bufferCount,1u)),
+    maxBufferCount(std::max(maxBuffers,minBufferCount)),
+    bufferWidth(0),
+    bufferHeight(0),
+    bufferInternalFormat(0),
+    bufferTiles(),
+    outputSlots(),
+    slotIndex(0),
+    scratchSlot{OpenGLOutputBuffer{0,0,nullptr,{}},0,0,{}},
+    scratchAllocated(false),
+    scratchInUse(false),
+    droppedFrames(0),
+    retiredSlots(),
+    lastSerial(0),
+    mutex()
+{
+
+}
+
+OpenGLOutputRing::~OpenGLOutputRing()
+{
+
+}
+
+void OpenGLOutputRing::initialize()
+{
+    if(initialized)
+        return;
+
+    initializeOpenGLFunctions();
+
+    initialized = true;
+}
+
+void OpenGLOutputRing::setTexturePool(OpenGLTexturePool *pool)
+{
+    texturePool = pool;
+}
+
+void OpenGLOutputRing::allocate(unsigned int width,
+                                unsigned int height,
+                                GLint internalFormat,
+                                const std::vector<bool> &mappedTiles)
+{
+    assert(initialized && texturePool);
+
+    clear();
+
+    bufferWidth = width;
+    bufferHeight = height;
+    bufferInternalFormat = internalFormat;
+    bufferTiles = mappedTiles;
+
+    QMutexLocker locker(&mutex);
+
+    outputSlots.assign(minBufferCount, OpenGLOutputSlot{OpenGLOutputBuffer{0,0,nullptr,{}},0,0,{}});
+    for(OpenGLOutputSlot& slot : outputSlots)
+        initializeSlot(slot);
+
+    slotIndex = 0;
+}
+
+void OpenGLOutputRing::clear()
+{
+    QMutexLocker locker(&mutex);
+
+    //A resize must not pull textures out from under displays still presenting the old size
+    for(OpenGLOutputSlot& slot : outputSlots)
+    {
+        if(slot.holders > 0)
+        {
+            retiredSlots.push_back(slot);
+            continue;
+        }
+
+        recycleSlot(slot);
+        releaseSlotTextures(slot);
+    }
+
+    outputSlots.clear();
+    slotIndex = 0;
+
+    if(scratchAllocated)
+        releaseSlotTextures(scratchSlot);
+
+    scratchAllocated = false;
+    scratchInUse = false;
+
+    collectRetiredSlots();
+}
+
+bool OpenGLOutputRing::isAllocated() const
+{
+    return !outputSlots.empty();
+}
+
+GLint OpenGLOutputRing::getInternalFormat() const
+{
+    return bufferInternalFormat;
+}
+
+unsigned int OpenGLOutputRing::getBufferCount() const
+{
+    QMutexLocker locker(&mutex);
+
+    return static_cast<unsigned int>(outputSlots.size());
+}
+
+unsigned long long OpenGLOutputRing::getDroppedFrameCount() const
+{
+    QMutexLocker locker(&mutex);
+
+    return droppedFrames;
+}
+
+const OpenGLOutputRing::OpenGLOutputBuffer &OpenGLOutputRing::getBuffer() const
+{
+    return outputSlots[slotIndex].buffer;
+}
+
+OpenGLOutputRing::OpenGLOutputBuffer &OpenGLOutputRing::nextBuffer()
+{
+    assert(!outputSlots.empty());
+
+    QMutexLocker locker(&mutex);
+
+    collectRetiredSlots();
+
+    //Oldest frame first, skipping slots a consumer still holds
+    unsigned int count = static_cast<unsigned int>(outputSlots.size());
+    unsigned int index = count;
+
+    for(unsigned int i = 1; i <= count; i++)
+    {
+        unsigned int candidate = (slotIndex + i) % count;
+        if(outputSlots[candidate].holders == 0)
+        {
+            index = candidate;
+            break;
+        }
+    }
+
+    //Every slot is held and the ring is at its cap (a consumer has stopped releasing); render into the scratch slot and
+    //drop the frame rather than allocate without bound
+    if(index == count && count >= maxBufferCount)
+    {
+        if(!scratchAllocated)
+            initializeSlot(scratchSlot);
+
+        scratchAllocated = true;
+        scratchInUse = true;
+
+        return scratchSlot.buffer;
+    }
+
+    scratchInUse = false;
+
+    //Every slot is held (consumers keeping frames on show); grow instead of waiting for one of them
+    if(index == count)
+    {
+        outputSlots.push_back(OpenGLOutputSlot{OpenGLOutputBuffer{0,0,nullptr,{}},0,0,{}});
+        initializeSlot(outputSlots.back());
+    }
+
+    slotIndex = index;
+
+    OpenGLOutputSlot& slot = outputSlots[slotIndex];
+    slot.serial = 0;
+
+    recycleSlot(slot);
+
+    return slot.buffer;
+}
+
+OpenGLOutputRing::OpenGLOutputFrame OpenGLOutputRing::publish()
+{
+    //Only the producer touches the scratch state
+    if(scratchInUse)
+    {
+        {
+            QMutexLocker locker(&mutex);
+            droppedFrames++;
+        }
+
+        return getFrame();
+    }
+
+    GLsync fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+    QMutexLocker locker(&mutex);
+
+    OpenGLOutputSlot& slot = outputSlots[slotIndex];
+    slot.buffer.fence = fence;
+    slot.serial = ++lastSerial;
+
+    return OpenGLOutputFrame{slot.buffer.textureID, bufferWidth, bufferHeight, bufferInternalFormat, fence, this, slotIndex, slot.serial};
+}
+
+OpenGLOutputRing::OpenGLOutputFrame OpenGLOutputRing::getFrame()
+{
+    QMutexLocker locker(&mutex);
+
+    const OpenGLOutputSlot& slot = outputSlots[slotIndex];
+
+    return OpenGLOutputFrame{slot.buffer.textureID, bufferWidth, bufferHeight, bufferInternalFormat, slot.buffer.fence, this, slotIndex, slot.serial};
+}
+
+bool OpenGLOutputRing::acquire(const OpenGLOutputRing::OpenGLOutputFrame &frame)
+{
+    if(!frame.ring)
+        return true;
+
+    return frame.ring->acquireSlot(frame.slot, frame.serial);
+}
+
+void OpenGLOutputRing::release(const OpenGLOutputRing::OpenGLOutputFrame &frame)
+{
+    if(!frame.ring)
+        return;
+
+    //Fence the consumer's reads for the producer's GPU to wait on; flushed, since it is waited on from another context
+    QOpenGLContext* context = QOpenGLContext::currentContext();
+    QOpenGLExtraFunctions* functions = context ? context->extraFunctions() : nullptr;
+
+    GLsync fence = nullptr;
+    if(functions)
+    {
+        fence = functions->glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        functions->glFlush();
+    }
+
+    if(!frame.ring->releaseSlot(frame.slot, frame.serial, fence) && fence)
+        functions->glDeleteSync(fence);
+}
+
+bool OpenGLOutputRing::acquireSlot(unsigned int slot, unsigned long long serial)
+{
+    QMutexLocker locker(&mutex);
+
+    if(serial == 0 || slot >= outputSlots.size() || outputSlots[slot].serial != serial)
+        return false;
+
+    outputSlots[slot].holders++;
+
+    return true;
+}
+
+bool OpenGLOutputRing::releaseSlot(unsigned int slot, unsigned long long serial, GLsync fence)
+{
+    QMutexLocker locker(&mutex);
+
+    if(serial == 0)
+        return false;
+
+    //A held slot keeps its serial until the last holder lets go; it may have been retired meanwhile
+    OpenGLOutputSlot* outputSlot = nullptr;
+
+    if(slot < outputSlots.size() && outputSlots[slot].serial == serial)
+    {
+        outputSlot = &outputSlots[slot];
+    }
+    else
+    {
+        for(OpenGLOutputSlot& retiredSlot : retiredSlots)
+        {
+            if(retiredSlot.serial == serial)
+            {
+                outputSlot = &retiredSlot;
+                break;
+            }
+        }
+    }
+
+    if(!outputSlot || outputSlot->holders == 0)
+        return false;
+
+    outputSlot->holders--;
+
+    if(fence)
+        outputSlot->releaseFences.push_back(fence);
+
+    return true;
+}
+
+void OpenGLOutputRing::collectRetiredSlots()
+{
+    for(auto it = retiredSlots.begin(); it != retiredSlots.end();)
+    {
+        if(it->holders > 0)
+        {
+            it++;
+            continue;
+        }
+
+        //The GPU waits for the last reads before the pool hands the textures out again
+        recycleSlot(*it);
+        releaseSlotTextures(*it);
+
+        it = retiredSlots.erase(it);
+    }
+}
+
+void OpenGLOutputRing::initializeSlot(OpenGLOutputRing::OpenGLOutputSlot &slot)
+{
+    OpenGLTexturePool::OpenGLPooledTexture texture = texturePool->acquire(bufferWidth, bufferHeight, bufferInternalFormat);
+
+    slot.buffer.fboID = texture.fboID;
+    slot.buffer.textureID = texture.textureID;
+    slot.buffer.fence = nullptr;
+
+    slot.buffer.tileTextureIDs.clear();
+
+    GLuint slotTextureID = slot.buffer.textureID;
+    for(bool mapped : bufferTiles)
+    {
+        GLuint textureID = 0;
+
+        if(mapped)
+        {
+            textureID = slotTextureID ? slotTextureID : texturePool->acquire(bufferWidth, bufferHeight, bufferInternalFormat).textureID;
+            slotTextureID = 0;
+        }
+
+        slot.buffer.tileTextureIDs.push_back(textureID);
+    }
+
+    slot.serial = 0;
+    slot.holders = 0;
+    slot.releaseFences.clear();
+}
+
+void OpenGLOutputRing::recycleSlot(OpenGLOutputRing::OpenGLOutputSlot &slot)
+{
+    //Waited on by the GPU, not the CPU; deleting right away is fine, the sync objects go once the waits are done
+    for(GLsync fence : slot.releaseFences)
+    {
+        glWaitSync(fence, 0, GL_TIMEOUT_IGNORED);
+        glDeleteSync(fence);
+    }
+
+    slot.releaseFences.clear();
+
+    if(slot.buffer.fence)
+        glDeleteSync(slot.buffer.fence);
+
+    slot.buffer.fence = nullptr;
+}
+
+void OpenGLOutputRing::releaseSlotTextures(OpenGLOutputRing::OpenGLOutputSlot &slot)
+{
+    for(GLuint textureID : slot.buffer.tileTextureIDs)
+    {
+        if(textureID && textureID != slot.buffer.textureID)
+            texturePool->release(textureID);
+    }
+
+    texturePool->release(slot.buffer.textureID);
+}
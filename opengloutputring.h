@@ -0,0 +1,163 @@
+#ifndef OPENGLOUTPUTRING_H
+#define OPENGLOUTPUTRING_H
+
+#include <opengltexturepool.h>
+
+#include <QMetaType>
+#include <QMutex>
+#include <QOpenGLExtraFunctions>
+
+#include <vector>
+
+//Fenced ring of output textures a producer renders into while its consumers sample earlier frames, on other threads
+//and in other contexts of the share group. A consumer holds a frame's slot with acquire() for as long as it reads the
+//texture and hands it back with release(); the producer never renders into a held slot, nor deletes its fence, and its
+//GPU waits for the consumers' reads before it renders into a released one. If every slot is held the ring grows, up to
+//maxBufferCount slots; past that the frame is rendered into a scratch slot and dropped, so a stalled consumer cannot make
+//the producer allocate without bound
+class OpenGLOutputRing : protected QOpenGLExtraFunctions
+{
+public:
+    //A frame as handed to consumers. The fence is signaled once the frame is finished; it and the texture are only valid
+    //between a successful acquire() and the matching release(). Frames without a ring are never reused by their sender
+    //and need no hold
+    typedef struct OpenGLOutputFrame
+    {
+        GLuint textureID;
+        unsigned int width;
+        unsigned int height;
+        GLint internalFormat;
+        GLsync fence;
+
+        OpenGLOutputRing* ring;
+        unsigned int slot;
+        unsigned long long serial;
+    }
+    OpenGLOutputFrame;
+
+    //One slot as seen by the producer. With tiles the slot holds a texture per tile, 0 for unmapped tiles; the first
+    //mapped tile uses the slot's own
+    typedef struct OpenGLOutputBuffer
+    {
+        GLuint fboID;
+        GLuint textureID;
+
+        GLsync fence;
+
+        std::vector<GLuint> tileTextureIDs;
+    }
+    OpenGLOutputBuffer;
+
+    OpenGLOutputRing(unsigned int bufferCount = 2,
+                     unsigned int maxBufferCount = 16);
+
+    virtual ~OpenGLOutputRing();
+
+    //Producer side; must be called with the producer's context current
+    void initialize();
+
+    //Slot textures come from the producer's pool
+    void setTexturePool(OpenGLTexturePool* pool);
+
+    //(Re)allocates every slot at this size; mappedTiles gives each slot a texture per true entry. Slots a consumer still
+    //holds are retired rather than reused, see clear()
+    void allocate(unsigned int width,
+                  unsigned int height,
+                  GLint internalFormat,
+                  const std::vector<bool>& mappedTiles = std::vector<bool>());
+
+    //Returns every slot to the pool. A held slot is retired instead: its frame can no longer be acquired, but texture and
+    //fence stay as they are until the last holder releases it; the next producer call then hands it back
+    void clear();
+
+    bool isAllocated() const;
+
+    GLint getInternalFormat() const;
+
+    unsigned int getBufferCount() const;
+
+    //Frames rendered while every slot was held and the ring could not grow; they were never published
+    unsigned long long getDroppedFrameCount() const;
+
+    //Slot of the frame published last (the first slot before anything is published)
+    const OpenGLOutputBuffer& getBuffer() const;
+
+    //Moves on to the next slot nobody holds and makes it ready to be rendered into: frames published from it before
+    //can no longer be acquired, and the GPU waits for the reads of the consumers that released it. At the cap with
+    //every slot held, returns the scratch slot instead
+    OpenGLOutputBuffer& nextBuffer();
+
+    //Fences the current slot and returns its frame; flush before handing the frame to another context. A frame rendered
+    //into the scratch slot is dropped and the last published frame is returned again
+    OpenGLOutputFrame publish();
+
+    //The frame published last, for publishing it again
+    OpenGLOutputFrame getFrame();
+
+    //Consumer side, from any thread. acquire() fails once the producer has moved on from the frame's slot; the frame is
+    //then dropped, a newer one is on its way. release() is called with the consumer's context current after its last
+    //read of the texture (or with no context current if it never read it)
+    static bool acquire(const OpenGLOutputFrame& frame);
+    static void release(const OpenGLOutputFrame& frame);
+
+protected:
+    typedef struct OpenGLOutputSlot
+    {
+        OpenGLOutputBuffer buffer;
+
+        //Serial of the frame in the slot, 0 while it is rendered into
+        unsigned long long serial;
+
+        unsigned int holders;
+
+        //Fenced by consumers as they release the slot
+        std::vector<GLsync> releaseFences;
+    }
+    OpenGLOutputSlot;
+
+    bool acquireSlot(unsigned int slot, unsigned long long serial);
+    bool releaseSlot(unsigned int slot, unsigned long long serial, GLsync fence);
+
+    //Returns retired slots nobody holds any more to the pool; producer side, with the mutex locked
+    void collectRetiredSlots();
+
+    void initializeSlot(OpenGLOutputSlot& slot);
+
+    //Makes the GPU wait for the slot's consumers and deletes its fences
+    void recycleSlot(OpenGLOutputSlot& slot);
+    void releaseSlotTextures(OpenGLOutputSlot& slot);
+
+    bool initialized;
+
+    OpenGLTexturePool* texturePool;
+
+    unsigned int minBufferCount;
+    unsigned int maxBufferCount;
+
+    unsigned int bufferWidth;
+    unsigned int bufferHeight;
+    GLint bufferInternalFormat;
+    std::vector<bool> bufferTiles;
+
+    //Only the producer adds or removes slots; holders and release fences are shared with the consumers
+    std::vector<OpenGLOutputSlot> outputSlots;
+    unsigned int slotIndex;
+
+    //Rendered into when the ring is at its cap and every slot is held; never published, so never held
+    OpenGLOutputSlot scratchSlot;
+    bool scratchAllocated;
+    bool scratchInUse;
+
+    unsigned long long droppedFrames;
+
+    //Slots of earlier allocations still held by consumers; found by serial, which is unique across allocations
+    std::vector<OpenGLOutputSlot> retiredSlots;
+
+    unsigned long long lastSerial;
+
+    mutable QMutex mutex;
+};
+
+Q_DECLARE_METATYPE(OpenGLOutputRing::OpenGLOutputFrame)
+
+#endif // OPENGLOUTPUTRING_H
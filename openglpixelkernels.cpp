@@ -0,0 +1,849 @@
+#include "openglpixelkernels.h"
+
+#include <QRunnable>
+#include <QSemaphore>
+#include <QThread>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define OPENGLKERNELS_X86
+#endif
+
+#if defined(OPENGLKERNELS_X86) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define OPENGLKERNELS_SSE2
+#include <emmintrin.h>
+#endif
+
+//AVX2 versions are compiled for their own functions only and picked at runtime, so the build needs no -mavx2
+#if defined(OPENGLKERNELS_SSE2) && (defined(__GNUC__) || defined(__clang__) || defined(_MSC_VER))
+#define OPENGLKERNELS_AVX2
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define OPENGLKERNELS_AVX2_TARGET
+#else
+#define OPENGLKERNELS_AVX2_TARGET __attribute__((target("avx2")))
+#endif
+#endif
+
+//Fixed point RGB -> YUV weights in source channel order (channels swapped for BGRA), scaled by 2^14. Chroma sums a 2x2
+//block, so it is shifted by two more bits
+typedef struct OpenGLYUVCoefficients
+{
+    int32_t y[3];
+    int32_t u[3];
+    int32_t v[3];
+
+    int32_t yBias;
+    int32_t cBias;
+}
+OpenGLYUVCoefficients;
+
+typedef void (*OpenGLSwizzleRow)(const unsigned char* src, unsigned char* dst, size_t pixels);
+typedef void (*OpenGLWidenRow)(const unsigned char* src, uint16_t* dst, size_t components);
+typedef void (*OpenGLNarrowRow)(const uint16_t* src, unsigned char* dst, size_t components);
+typedef void (*OpenGLPremultiplyRow)(unsigned char* data, size_t pixels);
+typedef void (*OpenGLYUVRows)(const unsigned char* rowA, const unsigned char* rowB, size_t width,
+                              unsigned char* yRowA, unsigned char* yRowB,
+                              unsigned char* uRow, unsigned char* vRow, size_t chromaStep,
+                              const OpenGLYUVCoefficients& k);
+
+static inline unsigned char clampByte(int32_t value)
+{
+    return static_cast<unsigned char>(std::min(std::max(value, 0), 255));
+}
+
+//Scalar references; the SIMD versions below must produce exactly the same bytes
+
+static void swizzleRowScalar(const unsigned char* src, unsigned char* dst, size_t pixels)
+{
+    for(size_t i = 0; i < pixels; i++)
+    {
+        unsigned char c0 = src[4*i];
+
+        dst[4*i] = src[4*i + 2];
+        dst[4*i + 1] = src[4*i + 1];
+        dst[4*i + 2] = c0;
+        dst[4*i + 3] = src[4*i + 3];
+    }
+}
+
+static void widenRowScalar(const unsigned char* src, uint16_t* dst, size_t components)
+{
+    //x * 257 maps 0-255 exactly onto 0-65535
+    for(size_t i = 0; i < components; i++)
+        dst[i] = static_cast<uint16_t>(src[i] * 257);
+}
+
+static void narrowRowScalar(const uint16_t* src, unsigned char* dst, size_t components)
+{
+    //round(x * 255 / 65535)
+    for(size_t i = 0; i < components; i++)
+        dst[i] = static_cast<unsigned char>((src[i] * 255u + 32895u) >> 16);
+}
+
+static void premultiplyRowScalar(unsigned char* data, size_t pixels)
+{
+    //round(c * a / 255) without a division
+    for(size_t i = 0; i < pixels; i++)
+    {
+        unsigned int a = data[4*i + 3];
+
+        for(int c = 0; c < 3; c++)
+        {
+            unsigned int t = data[4*i + c] * a + 128;
+            data[4*i + c] = static_cast<unsigned char>((t + (t >> 8)) >> 8);
+        }
+    }
+}
+
+static void yuvRowsScalarRange(const unsigned char* rowA, const unsigned char* rowB, size_t first, size_t width,
+                               unsigned char* yRowA, unsigned char* yRowB,
+                               unsigned char* uRow, unsigned char* vRow, size_t chromaStep,
+                               const OpenGLYUVCoefficients& k)
+{
+    for(size_t x = first; x < width; x++)
+    {
+        const unsigned char* a = rowA + 4*x;
+        const unsigned char* b = rowB + 4*x;
+
+        yRowA[x] = clampByte((k.y[0]*a[0] + k.y[1]*a[1] + k.y[2]*a[2] + k.yBias) >> 14);
+        if(yRowB)
+            yRowB[x] = clampByte((k.y[0]*b[0] + k.y[1]*b[1] + k.y[2]*b[2] + k.yBias) >> 14);
+    }
+
+    //Odd widths repeat the last column into the final block
+    for(size_t x = first; x < width; x += 2)
+    {
+        size_t x1 = std::min(x + 1, width - 1);
+
+        int32_t s[3];
+        for(int c = 0; c < 3; c++)
+            s[c] = rowA[4*x + c] + rowA[4*x1 + c] + rowB[4*x + c] + rowB[4*x1 + c];
+
+        uRow[(x / 2) * chromaStep] = clampByte((k.u[0]*s[0] + k.u[1]*s[1] + k.u[2]*s[2] + k.cBias) >> 16);
+        vRow[(x / 2) * chromaStep] = clampByte((k.v[0]*s[0] + k.v[1]*s[1] + k.v[2]*s[2] + k.cBias) >> 16);
+    }
+}
+
+static void yuvRowsScalar(const unsigned char* rowA, const unsigned char* rowB, size_t width,
+                          unsigned char* yRowA, unsigned char* yRowB,
+                          unsigned char* uRow, unsigned char* vRow, size_t chromaStep,
+                          const OpenGLYUVCoefficients& k)
+{
+    yuvRowsScalarRange(rowA, rowB, 0, width, yRowA, yRowB, uRow, vRow, chromaStep, k);
+}
+
+#if defined(OPENGLKERNELS_SSE2)
+static void swizzleRowSSE2(const unsigned char* src, unsigned char* dst, size_t pixels)
+{
+    const __m128i ga = _mm_set1_epi32(static_cast<int>(0xFF00FF00u));
+    const __m128i rb = _mm_set1_epi32(0x00FF00FF);
+
+    size_t i = 0;
+    for(; i + 4 <= pixels; i += 4)
+    {
+        __m128i p = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 4*i));
+        __m128i c02 = _mm_and_si128(p, rb);
+
+        //Swap channels 0 and 2 by rotating each pixel's 0x00CC00CC half by 16 bits
+        c02 = _mm_or_si128(_mm_slli_epi32(c02, 16), _mm_srli_epi32(c02, 16));
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 4*i), _mm_or_si128(_mm_and_si128(p, ga), c02));
+    }
+
+    swizzleRowScalar(src + 4*i, dst + 4*i, pixels - i);
+}
+
+static void widenRowSSE2(const unsigned char* src, uint16_t* dst, size_t components)
+{
+    size_t i = 0;
+    for(; i + 16 <= components; i += 16)
+    {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+
+        //Interleaving a byte with itself is x * 257
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_unpacklo_epi8(v, v));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i + 8), _mm_unpackhi_epi8(v, v));
+    }
+
+    widenRowScalar(src + i, dst + i, components - i);
+}
+
+static void narrowRowSSE2(const uint16_t* src, unsigned char* dst, size_t components)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i bias = _mm_set1_epi32(32895);
+
+    size_t i = 0;
+    for(; i + 8 <= components; i += 8)
+    {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+
+        __m128i lo = _mm_unpacklo_epi16(v, zero);
+        __m128i hi = _mm_unpackhi_epi16(v, zero);
+
+        //x * 255 as (x << 8) - x
+        lo = _mm_srli_epi32(_mm_add_epi32(_mm_sub_epi32(_mm_slli_epi32(lo, 8), lo), bias), 16);
+        hi = _mm_srli_epi32(_mm_add_epi32(_mm_sub_epi32(_mm_slli_epi32(hi, 8), hi), bias), 16);
+
+        __m128i packed = _mm_packs_epi32(lo, hi);
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(dst + i), _mm_packus_epi16(packed, packed));
+    }
+
+    narrowRowScalar(src + i, dst + i, components - i);
+}
+
+static void premultiplyRowSSE2(unsigned char* data, size_t pixels)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i round = _mm_set1_epi16(128);
+
+    //Colour lanes take alpha, alpha lanes take 255 and so stay as they are
+    const __m128i colorMask = _mm_set_epi16(0, -1, -1, -1, 0, -1, -1, -1);
+    const __m128i alphaOne = _mm_set_epi16(255, 0, 0, 0, 255, 0, 0, 0);
+
+    size_t i = 0;
+    for(; i + 4 <= pixels; i += 4)
+    {
+        __m128i p = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 4*i));
+
+        __m128i halves[2] = {_mm_unpacklo_epi8(p, zero), _mm_unpackhi_epi8(p, zero)};
+
+        for(__m128i& c : halves)
+        {
+            __m128i a = _mm_shufflehi_epi16(_mm_shufflelo_epi16(c, _MM_SHUFFLE(3,3,3,3)), _MM_SHUFFLE(3,3,3,3));
+            __m128i m = _mm_or_si128(_mm_and_si128(a, colorMask), alphaOne);
+
+            __m128i t = _mm_add_epi16(_mm_mullo_epi16(c, m), round);
+            c = _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+        }
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(data + 4*i), _mm_packus_epi16(halves[0], halves[1]));
+    }
+
+    premultiplyRowScalar(data + 4*i, pixels - i);
+}
+
+//Pairs of 16 bit weights for _mm_madd_epi16: (w0, w1) against (c0, c1) and (w2, 0) against (c2, 0)
+static inline int32_t weightPair(int32_t low, int32_t high)
+{
+    return static_cast<int32_t>((static_cast<uint32_t>(high) << 16) | (static_cast<uint32_t>(low) & 0xFFFFu));
+}
+
+static void yuvRowsSSE2(const unsigned char* rowA, const unsigned char* rowB, size_t width,
+                        unsigned char* yRowA, unsigned char* yRowB,
+                        unsigned char* uRow, unsigned char* vRow, size_t chromaStep,
+                        const OpenGLYUVCoefficients& k)
+{
+    const __m128i byteMask = _mm_set1_epi32(0xFF);
+
+    const __m128i y01 = _mm_set1_epi32(weightPair(k.y[0], k.y[1]));
+    const __m128i y2 = _mm_set1_epi32(weightPair(k.y[2], 0));
+    const __m128i u01 = _mm_set1_epi32(weightPair(k.u[0], k.u[1]));
+    const __m128i u2 = _mm_set1_epi32(weightPair(k.u[2], 0));
+    const __m128i v01 = _mm_set1_epi32(weightPair(k.v[0], k.v[1]));
+    const __m128i v2 = _mm_set1_epi32(weightPair(k.v[2], 0));
+
+    const __m128i yBias = _mm_set1_epi32(k.yBias);
+    const __m128i cBias = _mm_set1_epi32(k.cBias);
+
+    auto luma = [&](__m128i p, unsigned char* yRow)
+    {
+        __m128i c0 = _mm_and_si128(p, byteMask);
+        __m128i c1 = _mm_and_si128(_mm_srli_epi32(p, 8), byteMask);
+        __m128i c2 = _mm_and_si128(_mm_srli_epi32(p, 16), byteMask);
+
+        __m128i sum = _mm_add_epi32(_mm_madd_epi16(_mm_or_si128(c0, _mm_slli_epi32(c1, 16)), y01), _mm_madd_epi16(c2, y2));
+        __m128i y = _mm_srai_epi32(_mm_add_epi32(sum, yBias), 14);
+
+        y = _mm_packs_epi32(y, y);
+        int32_t bytes = _mm_cvtsi128_si32(_mm_packus_epi16(y, y));
+        std::memcpy(yRow, &bytes, 4);
+    };
+
+    size_t x = 0;
+    for(; x + 4 <= width; x += 4)
+    {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rowA + 4*x));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rowB + 4*x));
+
+        luma(a, yRowA + x);
+        if(yRowB)
+            luma(b, yRowB + x);
+
+        //Per channel sums of the two rows, then of horizontal neighbours; lanes 0 and 2 hold the two blocks
+        __m128i s[3];
+        for(int c = 0; c < 3; c++)
+        {
+            __m128i v = _mm_add_epi32(_mm_and_si128(_mm_srli_epi32(a, 8*c), byteMask),
+                                      _mm_and_si128(_mm_srli_epi32(b, 8*c), byteMask));
+            s[c] = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(2,3,0,1)));
+        }
+
+        __m128i s01 = _mm_or_si128(s[0], _mm_slli_epi32(s[1], 16));
+
+        __m128i u = _mm_srai_epi32(_mm_add_epi32(_mm_add_epi32(_mm_madd_epi16(s01, u01), _mm_madd_epi16(s[2], u2)), cBias), 16);
+        __m128i v = _mm_srai_epi32(_mm_add_epi32(_mm_add_epi32(_mm_madd_epi16(s01, v01), _mm_madd_epi16(s[2], v2)), cBias), 16);
+
+        __m128i packed = _mm_packs_epi32(u, v);
+        packed = _mm_packus_epi16(packed, packed);
+
+        uint32_t uBytes = static_cast<uint32_t>(_mm_cvtsi128_si32(packed));
+        uint32_t vBytes = static_cast<uint32_t>(_mm_cvtsi128_si32(_mm_srli_si128(packed, 4)));
+
+        uRow[(x / 2) * chromaStep] = static_cast<unsigned char>(uBytes);
+        uRow[(x / 2 + 1) * chromaStep] = static_cast<unsigned char>(uBytes >> 16);
+        vRow[(x / 2) * chromaStep] = static_cast<unsigned char>(vBytes);
+        vRow[(x / 2 + 1) * chromaStep] = static_cast<unsigned char>(vBytes >> 16);
+    }
+
+    yuvRowsScalarRange(rowA, rowB, x, width, yRowA, yRowB, uRow, vRow, chromaStep, k);
+}
+#endif
+
+#if defined(OPENGLKERNELS_AVX2)
+OPENGLKERNELS_AVX2_TARGET
+static void swizzleRowAVX2(const unsigned char* src, unsigned char* dst, size_t pixels)
+{
+    const __m256i order = _mm256_setr_epi8(2,1,0,3, 6,5,4,7, 10,9,8,11, 14,13,12,15,
+                                           2,1,0,3, 6,5,4,7, 10,9,8,11, 14,13,12,15);
+
+    size_t i = 0;
+    for(; i + 8 <= pixels; i += 8)
+    {
+        __m256i p = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + 4*i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + 4*i), _mm256_shuffle_epi8(p, order));
+    }
+
+    swizzleRowScalar(src + 4*i, dst + 4*i, pixels - i);
+}
+
+OPENGLKERNELS_AVX2_TARGET
+static void widenRowAVX2(const unsigned char* src, uint16_t* dst, size_t components)
+{
+    size_t i = 0;
+    for(; i + 16 <= components; i += 16)
+    {
+        __m256i v = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i)));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_or_si256(v, _mm256_slli_epi16(v, 8)));
+    }
+
+    widenRowScalar(src + i, dst + i, components - i);
+}
+
+OPENGLKERNELS_AVX2_TARGET
+static void narrowRowAVX2(const uint16_t* src, unsigned char* dst, size_t components)
+{
+    const __m256i bias = _mm256_set1_epi32(32895);
+
+    size_t i = 0;
+    for(; i + 16 <= components; i += 16)
+    {
+        __m256i lo = _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i)));
+        __m256i hi = _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i + 8)));
+
+        lo = _mm256_srli_epi32(_mm256_add_epi32(_mm256_sub_epi32(_mm256_slli_epi32(lo, 8), lo), bias), 16);
+        hi = _mm256_srli_epi32(_mm256_add_epi32(_mm256_sub_epi32(_mm256_slli_epi32(hi, 8), hi), bias), 16);
+
+        //Packing works per 128 bit lane, so put the quarters back in order before the final pack
+        __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi32(lo, hi), _MM_SHUFFLE(3,1,2,0));
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i),
+                         _mm_packus_epi16(_mm256_castsi256_si128(packed), _mm256_extracti128_si256(packed, 1)));
+    }
+
+    narrowRowScalar(src + i, dst + i, components - i);
+}
+
+OPENGLKERNELS_AVX2_TARGET
+static void premultiplyRowAVX2(unsigned char* data, size_t pixels)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i round = _mm256_set1_epi16(128);
+
+    const __m256i colorMask = _mm256_set_epi16(0, -1, -1, -1, 0, -1, -1, -1, 0, -1, -1, -1, 0, -1, -1, -1);
+    const __m256i alphaOne = _mm256_set_epi16(255, 0, 0, 0, 255, 0, 0, 0, 255, 0, 0, 0, 255, 0, 0, 0);
+
+    size_t i = 0;
+    for(; i + 8 <= pixels; i += 8)
+    {
+        __m256i p = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + 4*i));
+
+        //Unpack and pack both work per lane, so pixels come back where they were
+        __m256i halves[2] = {_mm256_unpacklo_epi8(p, zero), _mm256_unpackhi_epi8(p, zero)};
+
+        for(__m256i& c : halves)
+        {
+            __m256i a = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(c, _MM_SHUFFLE(3,3,3,3)), _MM_SHUFFLE(3,3,3,3));
+            __m256i m = _mm256_or_si256(_mm256_and_si256(a, colorMask), alphaOne);
+
+            __m256i t = _mm256_add_epi16(_mm256_mullo_epi16(c, m), round);
+            c = _mm256_srli_epi16(_mm256_add_epi16(t, _mm256_srli_epi16(t, 8)), 8);
+        }
+
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(data + 4*i), _mm256_packus_epi16(halves[0], halves[1]));
+    }
+
+    premultiplyRowScalar(data + 4*i, pixels - i);
+}
+
+OPENGLKERNELS_AVX2_TARGET
+static void yuvRowsAVX2(const unsigned char* rowA, const unsigned char* rowB, size_t width,
+                        unsigned char* yRowA, unsigned char* yRowB,
+                        unsigned char* uRow, unsigned char* vRow, size_t chromaStep,
+                        const OpenGLYUVCoefficients& k)
+{
+    const __m256i byteMask = _mm256_set1_epi32(0xFF);
+
+    const __m256i y01 = _mm256_set1_epi32(weightPair(k.y[0], k.y[1]));
+    const __m256i y2 = _mm256_set1_epi32(weightPair(k.y[2], 0));
+    const __m256i u01 = _mm256_set1_epi32(weightPair(k.u[0], k.u[1]));
+    const __m256i u2 = _mm256_set1_epi32(weightPair(k.u[2], 0));
+    const __m256i v01 = _mm256_set1_epi32(weightPair(k.v[0], k.v[1]));
+    const __m256i v2 = _mm256_set1_epi32(weightPair(k.v[2], 0));
+
+    const __m256i yBias = _mm256_set1_epi32(k.yBias);
+    const __m256i cBias = _mm256_set1_epi32(k.cBias);
+
+    size_t x = 0;
+    for(; x + 8 <= width; x += 8)
+    {
+        __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(rowA + 4*x));
+        __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(rowB + 4*x));
+
+        for(int row = 0; row < 2; row++)
+        {
+            unsigned char* yRow = (row == 0) ? yRowA : yRowB;
+            if(!yRow)
+                continue;
+
+            __m256i p = (row == 0) ? a : b;
+
+            __m256i c0 = _mm256_and_si256(p, byteMask);
+            __m256i c1 = _mm256_and_si256(_mm256_srli_epi32(p, 8), byteMask);
+            __m256i c2 = _mm256_and_si256(_mm256_srli_epi32(p, 16), byteMask);
+
+            __m256i sum = _mm256_add_epi32(_mm256_madd_epi16(_mm256_or_si256(c0, _mm256_slli_epi32(c1, 16)), y01),
+                                           _mm256_madd_epi16(c2, y2));
+            __m256i y = _mm256_srai_epi32(_mm256_add_epi32(sum, yBias), 14);
+
+            y = _mm256_packs_epi32(y, y);
+            y = _mm256_packus_epi16(y, y);
+
+            int32_t low = _mm_cvtsi128_si32(_mm256_castsi256_si128(y));
+            int32_t high = _mm_cvtsi128_si32(_mm256_extracti128_si256(y, 1));
+
+            std::memcpy(yRow + x, &low, 4);
+            std::memcpy(yRow + x + 4, &high, 4);
+        }
+
+        __m256i s[3];
+        for(int c = 0; c < 3; c++)
+        {
+            __m256i v = _mm256_add_epi32(_mm256_and_si256(_mm256_srli_epi32(a, 8*c), byteMask),
+                                         _mm256_and_si256(_mm256_srli_epi32(b, 8*c), byteMask));
+            s[c] = _mm256_add_epi32(v, _mm256_shuffle_epi32(v, _MM_SHUFFLE(2,3,0,1)));
+        }
+
+        __m256i s01 = _mm256_or_si256(s[0], _mm256_slli_epi32(s[1], 16));
+
+        __m256i u = _mm256_srai_epi32(_mm256_add_epi32(_mm256_add_epi32(_mm256_madd_epi16(s01, u01), _mm256_madd_epi16(s[2], u2)), cBias), 16);
+        __m256i v = _mm256_srai_epi32(_mm256_add_epi32(_mm256_add_epi32(_mm256_madd_epi16(s01, v01), _mm256_madd_epi16(s[2], v2)), cBias), 16);
+
+        __m256i packed = _mm256_packs_epi32(u, v);
+        packed = _mm256_packus_epi16(packed, packed);
+
+        //Each lane holds u u u u v v v v for its four pixels; blocks are bytes 0 and 2
+        __m128i lanes[2] = {_mm256_castsi256_si128(packed), _mm256_extracti128_si256(packed, 1)};
+
+        for(int lane = 0; lane < 2; lane++)
+        {
+            uint32_t uBytes = static_cast<uint32_t>(_mm_cvtsi128_si32(lanes[lane]));
+            uint32_t vBytes = static_cast<uint32_t>(_mm_cvtsi128_si32(_mm_srli_si128(lanes[lane], 4)));
+
+            size_t block = x / 2 + 2 * lane;
+
+            uRow[block * chromaStep] = static_cast<unsigned char>(uBytes);
+            uRow[(block + 1) * chromaStep] = static_cast<unsigned char>(uBytes >> 16);
+            vRow[block * chromaStep] = static_cast<unsigned char>(vBytes);
+            vRow[(block + 1) * chromaStep] = static_cast<unsigned char>(vBytes >> 16);
+        }
+    }
+
+    yuvRowsScalarRange(rowA, rowB, x, width, yRowA, yRowB, uRow, vRow, chromaStep, k);
+}
+#endif
+
+//Fixed point weights for converting src's channel order into dst's matrix and range
+static OpenGLYUVCoefficients yuvCoefficients(const OpenGLRenderer::OpenGLTextureSpecs& srcSpecs,
+                                             const OpenGLRenderer::OpenGLTextureSpecs& dstSpecs)
+{
+    double kr = 0.299, kb = 0.114;
+
+    switch(dstSpecs.colorMatrix)
+    {
+        case OpenGLRenderer::OpenGLColorBT709:
+            kr = 0.2126;
+            kb = 0.0722;
+            break;
+        case OpenGLRenderer::OpenGLColorBT2020:
+            kr = 0.2627;
+            kb = 0.0593;
+            break;
+        default:
+            break;
+    }
+
+    double kg = 1.0 - kr - kb;
+
+    double lumaScale = dstSpecs.fullRange ? 1.0 : 219.0 / 255.0;
+    double chromaScale = dstSpecs.fullRange ? 1.0 : 224.0 / 255.0;
+
+    double y[3] = {kr * lumaScale, kg * lumaScale, kb * lumaScale};
+    double u[3] = {-kr / (2.0 * (1.0 - kb)) * chromaScale, -kg / (2.0 * (1.0 - kb)) * chromaScale, 0.5 * chromaScale};
+    double v[3] = {0.5 * chromaScale, -kg / (2.0 * (1.0 - kr)) * chromaScale, -kb / (2.0 * (1.0 - kr)) * chromaScale};
+
+    //Weights are given as R, G, B; BGRA frames have red in channel 2
+    bool bgra = (srcSpecs.format == GL_BGRA);
+
+    OpenGLYUVCoefficients k;
+
+    for(int c = 0; c < 3; c++)
+    {
+        int source = bgra ? 2 - c : c;
+
+        k.y[c] = static_cast<int32_t>(y[source] * 16384.0 + (y[source] < 0.0 ? -0.5 : 0.5));
+        k.u[c] = static_cast<int32_t>(u[source] * 16384.0 + (u[source] < 0.0 ? -0.5 : 0.5));
+        k.v[c] = static_cast<int32_t>(v[source] * 16384.0 + (v[source] < 0.0 ? -0.5 : 0.5));
+    }
+
+    k.yBias = ((dstSpecs.fullRange ? 0 : 16) << 14) + (1 << 13);
+    k.cBias = (128 << 16) + (1 << 15);
+
+    return k;
+}
+
+static bool isPacked8(const OpenGLRenderer::OpenGLTextureSpecs& specs)
+{
+    return specs.planeLayout == OpenGLRenderer::OpenGLPlanesPacked && specs.dataType == GL_UNSIGNED_BYTE;
+}
+
+static bool isPackedColor8(const OpenGLRenderer::OpenGLTextureSpecs& specs)
+{
+    return isPacked8(specs) && specs.channels == 4 && (specs.format == GL_RGBA || specs.format == GL_BGRA);
+}
+
+//Tiles of rows handed out to a pool thread until none are left
+class OpenGLPixelTileTask : public QRunnable
+{
+public:
+    OpenGLPixelTileTask(const std::function<void()>& work, QSemaphore* done) :
+        work(work),
+        done(done)
+    {
+        setAutoDelete(true);
+    }
+
+    void run() override
+    {
+        work();
+        done->release();
+    }
+
+protected:
+    std::function<void()> work;
+    QSemaphore* done;
+};
+
+OpenGLPixelKernels::OpenGLPixelKernels(unsigned int maxWorkers, unsigned int rowsPerTile) :
+    isa(detectISA()),
+    tileRows(std::max((rowsPerTile + 1) & ~1u, 2u)),
+    minParallelPixels(256*256)
+{
+    int workers = (maxWorkers > 0) ? static_cast<int>(maxWorkers) : QThread::idealThreadCount();
+
+    //The calling thread takes tiles too
+    workerPool.setMaxThreadCount(std::max(workers - 1, 1));
+}
+
+OpenGLPixelKernels::~OpenGLPixelKernels()
+{
+    workerPool.waitForDone();
+}
+
+OpenGLPixelKernels::OpenGLKernelISA OpenGLPixelKernels::detectISA()
+{
+#if defined(OPENGLKERNELS_AVX2)
+#if defined(_MSC_VER) && !defined(__clang__)
+    int info[4];
+
+    __cpuid(info, 0);
+    int maxLeaf = info[0];
+
+    __cpuid(info, 1);
+    bool osAVX = (info[2] & (1 << 27)) && (info[2] & (1 << 28)) && ((_xgetbv(0) & 6) == 6);
+
+    if(osAVX && maxLeaf >= 7)
+    {
+        __cpuidex(info, 7, 0);
+        if(info[1] & (1 << 5))
+            return OpenGLKernelAVX2;
+    }
+#else
+    if(__builtin_cpu_supports("avx2"))
+        return OpenGLKernelAVX2;
+#endif
+#endif
+
+#if defined(OPENGLKERNELS_SSE2)
+    return OpenGLKernelSSE2;
+#else
+    return OpenGLKernelScalar;
+#endif
+}
+
+const char *OpenGLPixelKernels::getISAName(OpenGLPixelKernels::OpenGLKernelISA isa)
+{
+    switch(isa)
+    {
+        case OpenGLKernelAVX2:
+            return "avx2";
+        case OpenGLKernelSSE2:
+            return "sse2";
+        default:
+            return "scalar";
+    }
+}
+
+void OpenGLPixelKernels::setISA(OpenGLPixelKernels::OpenGLKernelISA requested)
+{
+    isa = std::min(requested, detectISA());
+}
+
+OpenGLPixelKernels::OpenGLKernelISA OpenGLPixelKernels::getISA() const
+{
+    return isa;
+}
+
+void OpenGLPixelKernels::setMinParallelPixels(size_t pixels)
+{
+    minParallelPixels = pixels;
+}
+
+unsigned int OpenGLPixelKernels::getWorkerCount() const
+{
+    return static_cast<unsigned int>(workerPool.maxThreadCount()) + 1;
+}
+
+bool OpenGLPixelKernels::canConvert(const OpenGLRenderer::OpenGLTextureSpecs &srcSpecs, const OpenGLRenderer::OpenGLTextureSpecs &dstSpecs)
+{
+    if(srcSpecs.width != dstSpecs.width || srcSpecs.height != dstSpecs.height)
+        return false;
+
+    //RGBA8 <-> BGRA8 (or a copy)
+    if(isPackedColor8(srcSpecs) && isPackedColor8(dstSpecs))
+        return true;
+
+    //RGBA8 / BGRA8 -> NV12 / I420
+    if(isPackedColor8(srcSpecs) &&
+       (dstSpecs.planeLayout == OpenGLRenderer::OpenGLPlanesNV12 || dstSpecs.planeLayout == OpenGLRenderer::OpenGLPlanesI420))
+        return true;
+
+    //8 <-> 16 bit components of the same format
+    bool sameLayout = srcSpecs.planeLayout == OpenGLRenderer::OpenGLPlanesPacked &&
+                      dstSpecs.planeLayout == OpenGLRenderer::OpenGLPlanesPacked &&
+                      srcSpecs.channels == dstSpecs.channels &&
+                      srcSpecs.format == dstSpecs.format;
+
+    return sameLayout &&
+           ((srcSpecs.dataType == GL_UNSIGNED_BYTE && dstSpecs.dataType == GL_UNSIGNED_SHORT) ||
+            (srcSpecs.dataType == GL_UNSIGNED_SHORT && dstSpecs.dataType == GL_UNSIGNED_BYTE));
+}
+
+bool OpenGLPixelKernels::convert(const unsigned char *src, const OpenGLRenderer::OpenGLTextureSpecs &srcSpecs,
+                                 unsigned char *dst, const OpenGLRenderer::OpenGLTextureSpecs &dstSpecs)
+{
+    if(!src || !dst || !canConvert(srcSpecs, dstSpecs))
+        return false;
+
+    const size_t width = srcSpecs.width;
+    const size_t srcStride = width * OpenGLRenderer::getBytesPerPixel(srcSpecs);
+
+    if(isPackedColor8(srcSpecs) && isPackedColor8(dstSpecs))
+    {
+        if(srcSpecs.format == dstSpecs.format)
+        {
+            parallelRows(srcSpecs.height, width, [&](unsigned int first, unsigned int end)
+            {
+                std::memcpy(dst + first * srcStride, src + first * srcStride, (end - first) * srcStride);
+            });
+            return true;
+        }
+
+        OpenGLSwizzleRow swizzleRow = swizzleRowScalar;
+#if defined(OPENGLKERNELS_SSE2)
+        if(isa >= OpenGLKernelSSE2)
+            swizzleRow = swizzleRowSSE2;
+#endif
+#if defined(OPENGLKERNELS_AVX2)
+        if(isa >= OpenGLKernelAVX2)
+            swizzleRow = swizzleRowAVX2;
+#endif
+
+        parallelRows(srcSpecs.height, width, [&](unsigned int first, unsigned int end)
+        {
+            for(unsigned int row = first; row < end; row++)
+                swizzleRow(src + row * srcStride, dst + row * srcStride, width);
+        });
+        return true;
+    }
+
+    if(dstSpecs.planeLayout != OpenGLRenderer::OpenGLPlanesPacked)
+    {
+        OpenGLYUVRows yuvRows = yuvRowsScalar;
+#if defined(OPENGLKERNELS_SSE2)
+        if(isa >= OpenGLKernelSSE2)
+            yuvRows = yuvRowsSSE2;
+#endif
+#if defined(OPENGLKERNELS_AVX2)
+        if(isa >= OpenGLKernelAVX2)
+            yuvRows = yuvRowsAVX2;
+#endif
+
+        const OpenGLYUVCoefficients k = yuvCoefficients(srcSpecs, dstSpecs);
+
+        OpenGLRenderer::OpenGLPlaneSpecs lumaPlane = OpenGLRenderer::getPlaneSpecs(dstSpecs, 0);
+        OpenGLRenderer::OpenGLPlaneSpecs uPlane = OpenGLRenderer::getPlaneSpecs(dstSpecs, 1);
+
+        //NV12 interleaves V right after U; I420 has its own V plane
+        bool interleaved = (dstSpecs.planeLayout == OpenGLRenderer::OpenGLPlanesNV12);
+
+        size_t chromaStep = interleaved ? 2 : 1;
+        size_t chromaStride = static_cast<size_t>(uPlane.width) * uPlane.bytesPerPixel;
+        size_t vOffset = interleaved ? uPlane.offset + 1 : OpenGLRenderer::getPlaneSpecs(dstSpecs, 2).offset;
+
+        const unsigned int height = srcSpecs.height;
+
+        //Tiles are an even number of rows, so every tile starts on a row pair
+        parallelRows(height, width, [&](unsigned int first, unsigned int end)
+        {
+            for(unsigned int row = first; row < end; row += 2)
+            {
+                bool pair = (row + 1 < height);
+
+                yuvRows(src + row * srcStride,
+                        src + (pair ? row + 1 : row) * srcStride,
+                        width,
+                        dst + lumaPlane.offset + row * width,
+                        pair ? dst + lumaPlane.offset + (row + 1) * width : nullptr,
+                        dst + uPlane.offset + (row / 2) * chromaStride,
+                        dst + vOffset + (row / 2) * chromaStride,
+                        chromaStep,
+                        k);
+            }
+        });
+        return true;
+    }
+
+    const size_t components = width * srcSpecs.channels;
+
+    if(srcSpecs.dataType == GL_UNSIGNED_BYTE)
+    {
+        OpenGLWidenRow widenRow = widenRowScalar;
+#if defined(OPENGLKERNELS_SSE2)
+        if(isa >= OpenGLKernelSSE2)
+            widenRow = widenRowSSE2;
+#endif
+#if defined(OPENGLKERNELS_AVX2)
+        if(isa >= OpenGLKernelAVX2)
+            widenRow = widenRowAVX2;
+#endif
+
+        parallelRows(srcSpecs.height, width, [&](unsigned int first, unsigned int end)
+        {
+            for(unsigned int row = first; row < end; row++)
+                widenRow(src + row * components, reinterpret_cast<uint16_t*>(dst) + row * components, components);
+        });
+    }
+    else
+    {
+        OpenGLNarrowRow narrowRow = narrowRowScalar;
+#if defined(OPENGLKERNELS_SSE2)
+        if(isa >= OpenGLKernelSSE2)
+            narrowRow = narrowRowSSE2;
+#endif
+#if defined(OPENGLKERNELS_AVX2)
+        if(isa >= OpenGLKernelAVX2)
+            narrowRow = narrowRowAVX2;
+#endif
+
+        parallelRows(srcSpecs.height, width, [&](unsigned int first, unsigned int end)
+        {
+            for(unsigned int row = first; row < end; row++)
+                narrowRow(reinterpret_cast<const uint16_t*>(src) + row * components, dst + row * components, components);
+        });
+    }
+
+    return true;
+}
+
+bool OpenGLPixelKernels::premultiply(unsigned char *data, const OpenGLRenderer::OpenGLTextureSpecs &specs)
+{
+    if(!data || !isPackedColor8(specs))
+        return false;
+
+    OpenGLPremultiplyRow premultiplyRow = premultiplyRowScalar;
+#if defined(OPENGLKERNELS_SSE2)
+    if(isa >= OpenGLKernelSSE2)
+        premultiplyRow = premultiplyRowSSE2;
+#endif
+#if defined(OPENGLKERNELS_AVX2)
+    if(isa >= OpenGLKernelAVX2)
+        premultiplyRow = premultiplyRowAVX2;
+#endif
+
+    const size_t width = specs.width;
+
+    parallelRows(specs.height, width, [&](unsigned int first, unsigned int end)
+    {
+        for(unsigned int row = first; row < end; row++)
+            premultiplyRow(data + row * width * 4, width);
+    });
+
+    return true;
+}
+
+void OpenGLPixelKernels::parallelRows(unsigned int rows, size_t pixelsPerRow, const std::function<void (unsigned int, unsigned int)> &work)
+{
+    unsigned int tiles = (rows + tileRows - 1) / tileRows;
+
+    if(tiles <= 1 || static_cast<size_t>(rows) * pixelsPerRow < minParallelPixels)
+    {
+        work(0, rows);
+        return;
+    }
+
+    std::atomic<unsigned int> nextTile(0);
+
+    auto takeTiles = [&]()
+    {
+        for(unsigned int tile = nextTile.fetch_add(1); tile < tiles; tile = nextTile.fetch_add(1))
+            work(tile * tileRows, std::min((tile + 1) * tileRows, rows));
+    };
+
+    unsigned int helpers = std::min(static_cast<unsigned int>(workerPool.maxThreadCount()), tiles - 1);
+
+    QSemaphore done(0);
+
+    for(unsigned int i = 0; i < helpers; i++)
+        workerPool.start(new OpenGLPixelTileTask(takeTiles, &done));
+
+    takeTiles();
+
+    //Helpers that start late find no tiles left and finish at once
+    done.acquire(static_cast<int>(helpers));
+}
@@ -0,0 +1,68 @@
+#ifndef OPENGLPIXELKERNELS_H
+#define OPENGLPIXELKERNELS_H
+
+#include <openglrenderer.h>
+
+#include <QThreadPool>
+
+#include <atomic>
+#include <functional>
+
+//CPU conversions for frames entering or leaving the GPU as CPU buffers, described by the same texture specs the renderer
+//uses: RGBA8 <-> BGRA8, 8 <-> 16 bit components, RGBA8 / BGRA8 -> NV12 / I420 and alpha premultiplication. Every kernel
+//has a scalar reference and SSE2 / AVX2 versions that produce the same bytes; the widest one the CPU supports is picked
+//at runtime. Frames are cut into tiles of rows which the calling thread and a private pool take from a shared counter
+//until none are left, so a thread that finishes early keeps taking work instead of idling
+class OpenGLPixelKernels
+{
+public:
+    typedef enum OpenGLKernelISA
+    {
+        OpenGLKernelScalar,
+        OpenGLKernelSSE2,
+        OpenGLKernelAVX2
+    }
+    OpenGLKernelISA;
+
+    //maxWorkers of 0 uses QThread::idealThreadCount
+    OpenGLPixelKernels(unsigned int maxWorkers = 0,
+                       unsigned int rowsPerTile = 16);
+
+    virtual ~OpenGLPixelKernels();
+
+    //Widest instruction set of this CPU (and build)
+    static OpenGLKernelISA detectISA();
+    static const char* getISAName(OpenGLKernelISA isa);
+
+    //Caps the instruction set used, e.g. to compare against the scalar reference; clamped to what the CPU supports
+    void setISA(OpenGLKernelISA isa);
+    OpenGLKernelISA getISA() const;
+
+    //Frames below this many pixels stay on the calling thread
+    void setMinParallelPixels(size_t pixels);
+
+    unsigned int getWorkerCount() const;
+
+    //Whether convert handles this pair of specs
+    static bool canConvert(const OpenGLRenderer::OpenGLTextureSpecs& srcSpecs, const OpenGLRenderer::OpenGLTextureSpecs& dstSpecs);
+
+    //Converts a tightly packed frame (getFrameSize bytes) to another layout of the same size; false if unsupported
+    bool convert(const unsigned char* src, const OpenGLRenderer::OpenGLTextureSpecs& srcSpecs,
+                 unsigned char* dst, const OpenGLRenderer::OpenGLTextureSpecs& dstSpecs);
+
+    //Multiplies colour by alpha in place; RGBA8 / BGRA8 only
+    bool premultiply(unsigned char* data, const OpenGLRenderer::OpenGLTextureSpecs& specs);
+
+    //Runs work(firstRow, endRow) over tiles of rows on all workers; tiles are rowsPerTile rows, rounded up to even
+    void parallelRows(unsigned int rows, size_t pixelsPerRow, const std::function<void(unsigned int, unsigned int)>& work);
+
+protected:
+    OpenGLKernelISA isa;
+
+    unsigned int tileRows;
+    size_t minParallelPixels;
+
+    QThreadPool workerPool;
+};
+
+#endif // OPENGLPIXELKERNELS_H
@@ -0,0 +1,90 @@
+#include "openglpresenterpool.h"
+
+OpenGLPresenterPool::OpenGLPresenterPool(QObject *parent, unsigned int maxThreads) :
+    QObject(parent),
+    maxThreadCount(maxThreads),
+    running(false)
+{
+
+}
+
+OpenGLPresenterPool::~OpenGLPresenterPool()
+{
+    stop();
+
+    foreach(QThread* thread, threads)
+        delete thread;
+
+    threads.clear();
+}
+
+QThread *OpenGLPresenterPool::addDisplay(QObject *display)
+{
+    QThread* thread = nullptr;
+
+    if(maxThreadCount == 0 || threads.size() < maxThreadCount)
+    {
+        thread = new QThread();
+        thread->setObjectName(QString("presenter %1").arg(static_cast<unsigned int>(threads.size())));
+
+        threads.push_back(thread);
+
+        if(running)
+            thread->start();
+    }
+    else
+        thread = threads[displays.size() % threads.size()];
+
+    display->moveToThread(thread);
+    displays.push_back(display);
+
+    return thread;
+}
+
+unsigned int OpenGLPresenterPool::getThreadCount() const
+{
+    return static_cast<unsigned int>(threads.size());
+}
+
+unsigned int OpenGLPresenterPool::getDisplayCount() const
+{
+    return static_cast<unsigned int>(displays.size());
+}
+
+bool OpenGLPresenterPool::isRunning() const
+{
+    return running;
+}
+
+void OpenGLPresenterPool::start()
+{
+    if(running)
+        return;
+
+    foreach(QThread* thread, threads)
+        thread->start();
+
+    running = true;
+}
+
+void OpenGLPresenterPool::stop()
+{
+    if(!running)
+        return;
+
+    //Displays keep their context current between frames; each lets go of it on its own thread before the thread exits
+    foreach(QObject* display, displays)
+    {
+        QMetaObject::invokeMethod(display,
+                                  "stop",
+                                  (display->thread() == QThread::currentThread()) ? Qt::DirectConnection : Qt::BlockingQueuedConnection);
+    }
+
+    foreach(QThread* thread, threads)
+        thread->quit();
+
+    foreach(QThread* thread, threads)
+        thread->wait();
+
+    running = false;
+}
@@ -0,0 +1,47 @@
+#ifndef OPENGLPRESENTERPOOL_H
+#define OPENGLPRESENTERPOOL_H
+
+#include <QObject>
+#include <QThread>
+
+#include <vector>
+
+//Presentation threads for displays, so a display blocked in a vsync swap only stalls the displays sharing its thread and
+//never the producer. Displays are moved to their thread before their context is made current there (OpenGLNativeRenderWindow
+//creates its context in showNative, on that thread) and stay on it; a context is only ever current on one thread
+class OpenGLPresenterPool : public QObject
+{
+    Q_OBJECT
+public:
+    //maxThreads of 0 gives every display its own thread; otherwise displays are spread round robin
+    OpenGLPresenterPool(QObject* parent = nullptr,
+                        unsigned int maxThreads = 0);
+
+    virtual ~OpenGLPresenterPool();
+
+    //Moves the display and everything it owns to a presentation thread and returns that thread. Its context must not be
+    //current anywhere when this is called
+    QThread* addDisplay(QObject* display);
+
+    unsigned int getThreadCount() const;
+    unsigned int getDisplayCount() const;
+
+    bool isRunning() const;
+
+public slots:
+    void start();
+
+    //Calls every display's stop slot on its thread, then quits every thread and waits for it; displays must not be
+    //presented from elsewhere afterwards
+    void stop();
+
+protected:
+    unsigned int maxThreadCount;
+
+    std::vector<QThread*> threads;
+    std::vector<QObject*> displays;
+
+    bool running;
+};
+
+#endif // OPENGLPRESENTERPOOL_H
@@ -0,0 +1,326 @@
+#include "openglprofiler.h"
+
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+OpenGLProfiler::OpenGLProfiler(const QString& profilerName, unsigned int numFrames) :
+    name(profilerName),
+    initialized(false),
+    passOpen(false),
+    frames(std::max(numFrames,2u),OpenGLFrameQueries{std::vector<OpenGLPassQuery>(),0,false}),
+    frameIndex(0),
+    droppedFrames(0),
+    lastFrameGPUTime(0.0),
+    collectedFrames(0),
+    maxTraceEvents(100000),
+    cpuEpoch(Clock::now()),
+    gpuEpoch(0)
+{
+
+}
+
+OpenGLProfiler::~OpenGLProfiler()
+{
+    //Query objects belong to the profiled context; QOpenGLTimerQuery releases them if it is still alive
+    for(OpenGLFrameQueries& frame : frames)
+    {
+        for(OpenGLPassQuery& pass : frame.passes)
+        {
+            delete pass.beginQuery;
+            delete pass.endQuery;
+        }
+    }
+}
+
+bool OpenGLProfiler::initialize()
+{
+    if(initialized)
+        return true;
+
+    //Creating a throwaway query tells us whether GL_TIMESTAMP is available in this context
+    QOpenGLTimerQuery probe;
+    if(!probe.create())
+        return false;
+    probe.destroy();
+
+    initialized = true;
+    return true;
+}
+
+bool OpenGLProfiler::isInitialized() const
+{
+    return initialized;
+}
+
+const QString& OpenGLProfiler::getName() const
+{
+    return name;
+}
+
+void OpenGLProfiler::beginPass(const char* passName)
+{
+    if(!initialized || passOpen)
+        return;
+
+    OpenGLFrameQueries& frame = frames[frameIndex];
+
+    if(frame.numPasses == frame.passes.size())
+    {
+        OpenGLPassQuery pass{nullptr,nullptr,nullptr,Clock::time_point(),Clock::time_point()};
+
+        pass.beginQuery = new QOpenGLTimerQuery();
+        pass.endQuery = new QOpenGLTimerQuery();
+
+        pass.beginQuery->create();
+        pass.endQuery->create();
+
+        frame.passes.push_back(pass);
+    }
+
+    OpenGLPassQuery& pass = frame.passes[frame.numPasses];
+
+    pass.name = passName;
+    pass.cpuBegin = Clock::now();
+    pass.beginQuery->recordTimestamp();
+
+    passOpen = true;
+}
+
+void OpenGLProfiler::endPass()
+{
+    if(!initialized || !passOpen)
+        return;
+
+    OpenGLFrameQueries& frame = frames[frameIndex];
+    OpenGLPassQuery& pass = frame.passes[frame.numPasses];
+
+    pass.endQuery->recordTimestamp();
+    pass.cpuEnd = Clock::now();
+
+    frame.numPasses++;
+    passOpen = false;
+}
+
+void OpenGLProfiler::endFrame()
+{
+    if(!initialized)
+        return;
+
+    if(passOpen)
+        endPass();
+
+    frames[frameIndex].pending = (frames[frameIndex].numPasses > 0);
+
+    //Collect finished frames, oldest first; stop at the first one the GPU has not reached yet
+    for(unsigned int i = 1; i < frames.size(); i++)
+    {
+        OpenGLFrameQueries& frame = frames[(frameIndex + i) % frames.size()];
+
+        if(frame.pending && !collectFrame(frame))
+            break;
+    }
+
+    frameIndex = (frameIndex + 1) % frames.size();
+
+    //Never wait on the slot we are about to overwrite; if the GPU is that far behind, give up on its results
+    OpenGLFrameQueries& next = frames[frameIndex];
+    if(next.pending && !collectFrame(next))
+    {
+        next.pending = false;
+        droppedFrames++;
+    }
+
+    next.numPasses = 0;
+}
+
+bool OpenGLProfiler::collectFrame(OpenGLFrameQueries& frame)
+{
+    //Timestamps complete in order, so the last one landing means all of them have
+    if(!frame.passes[frame.numPasses - 1].endQuery->isResultAvailable())
+        return false;
+
+    double frameGPUTime = 0.0;
+
+    for(unsigned int i = 0; i < frame.numPasses; i++)
+    {
+        const OpenGLPassQuery& pass = frame.passes[i];
+
+        GLuint64 gpuBegin = pass.beginQuery->waitForResult();
+        GLuint64 gpuEnd = pass.endQuery->waitForResult();
+
+        if(gpuEpoch == 0)
+            gpuEpoch = gpuBegin;
+
+        double gpuTime = static_cast<double>(gpuEnd - gpuBegin) / 1000000.0;
+        double cpuTime = std::chrono::duration<double,std::milli>(pass.cpuEnd - pass.cpuBegin).count();
+
+        accumulate(pass.name,gpuTime,cpuTime);
+
+        frameGPUTime += gpuTime;
+
+        if(traceEvents.size() < maxTraceEvents)
+        {
+            OpenGLTraceEvent event;
+
+            event.name = pass.name;
+
+            event.gpuBegin = static_cast<double>(gpuBegin - std::min(gpuBegin,gpuEpoch)) / 1000.0;
+            event.gpuDuration = gpuTime * 1000.0;
+
+            event.cpuBegin = std::chrono::duration<double,std::micro>(pass.cpuBegin - cpuEpoch).count();
+            event.cpuDuration = cpuTime * 1000.0;
+
+            traceEvents.push_back(event);
+        }
+    }
+
+    lastFrameGPUTime = frameGPUTime;
+    collectedFrames++;
+
+    frame.pending = false;
+    return true;
+}
+
+void OpenGLProfiler::accumulate(const char* passName, double gpuTime, double cpuTime)
+{
+    auto it = std::find_if(accumulators.begin(),accumulators.end(),
+                           [passName](const OpenGLPassAccumulator& a) { return a.name == passName; });
+
+    if(it == accumulators.end())
+    {
+        accumulators.push_back(OpenGLPassAccumulator{passName,0,0.0,std::numeric_limits<double>::max(),0.0,0.0});
+        it = accumulators.end() - 1;
+    }
+
+    it->samples++;
+
+    it->gpuSum += gpuTime;
+    it->gpuMin = std::min(it->gpuMin,gpuTime);
+    it->gpuMax = std::max(it->gpuMax,gpuTime);
+
+    it->cpuSum += cpuTime;
+}
+
+std::vector<OpenGLProfiler::OpenGLPassStats> OpenGLProfiler::getStats() const
+{
+    std::vector<OpenGLPassStats> stats;
+
+    for(const OpenGLPassAccumulator& a : accumulators)
+    {
+        OpenGLPassStats s;
+
+        s.name = QString(a.name);
+        s.samples = a.samples;
+
+        s.meanGPUTime = a.gpuSum / a.samples;
+        s.minGPUTime = a.gpuMin;
+        s.maxGPUTime = a.gpuMax;
+
+        s.meanCPUTime = a.cpuSum / a.samples;
+
+        stats.push_back(s);
+    }
+
+    return stats;
+}
+
+unsigned long long OpenGLProfiler::getDroppedFrameCount() const
+{
+    return droppedFrames;
+}
+
+double OpenGLProfiler::getLastFrameGPUTime() const
+{
+    return lastFrameGPUTime;
+}
+
+unsigned long long OpenGLProfiler::getCollectedFrameCount() const
+{
+    return collectedFrames;
+}
+
+void OpenGLProfiler::resetStats()
+{
+    accumulators.clear();
+    traceEvents.clear();
+
+    droppedFrames = 0;
+
+    cpuEpoch = Clock::now();
+    gpuEpoch = 0;
+}
+
+bool OpenGLProfiler::writeChromeTrace(const QString& fileName) const
+{
+    return writeChromeTrace(fileName,std::vector<const OpenGLProfiler*>{this});
+}
+
+bool OpenGLProfiler::writeChromeTrace(const QString& fileName, const std::vector<const OpenGLProfiler*>& profilers)
+{
+    QFile file(fileName);
+    if(!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        return false;
+
+    //Pass and profiler names are user supplied, so let QJsonDocument do the escaping
+    QJsonArray traceEvents;
+    int pid = 1;
+
+    for(const OpenGLProfiler* profiler : profilers)
+    {
+        //Each profiler is a process with a GPU and a CPU track; the two clocks are not related so they are not mixed
+        traceEvents.append(metadataEvent(QString("process_name"),pid,0,profiler->name));
+        traceEvents.append(metadataEvent(QString("thread_name"),pid,1,QString("GPU")));
+        traceEvents.append(metadataEvent(QString("thread_name"),pid,2,QString("CPU")));
+
+        for(const OpenGLTraceEvent& event : profiler->traceEvents)
+        {
+            traceEvents.append(completeEvent(QString(event.name),pid,1,event.gpuBegin,event.gpuDuration));
+            traceEvents.append(completeEvent(QString(event.name),pid,2,event.cpuBegin,event.cpuDuration));
+        }
+
+        pid++;
+    }
+
+    QJsonObject trace;
+    trace.insert(QString("traceEvents"),traceEvents);
+
+    file.write(QJsonDocument(trace).toJson(QJsonDocument::Compact));
+
+    return file.error() == QFileDevice::NoError;
+}
+
+QJsonObject OpenGLProfiler::metadataEvent(const QString& name, int pid, int tid, const QString& value)
+{
+    QJsonObject args;
+    args.insert(QString("name"),value);
+
+    QJsonObject event;
+    event.insert(QString("name"),name);
+    event.insert(QString("ph"),QString("M"));
+    event.insert(QString("pid"),pid);
+    if(tid > 0)
+        event.insert(QString("tid"),tid);
+    event.insert(QString("args"),args);
+
+    return event;
+}
+
+QJsonObject OpenGLProfiler::completeEvent(const QString& name, int pid, int tid, double begin, double duration)
+{
+    //Microseconds, kept at the nanosecond resolution of the timer queries
+    QJsonObject event;
+    event.insert(QString("name"),name);
+    event.insert(QString("ph"),QString("X"));
+    event.insert(QString("pid"),pid);
+    event.insert(QString("tid"),tid);
+    event.insert(QString("ts"),std::round(begin*1000.0)/1000.0);
+    event.insert(QString("dur"),std::round(duration*1000.0)/1000.0);
+
+    return event;
+}
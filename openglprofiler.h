@@ -0,0 +1,145 @@
+#ifndef OPENGLPROFILER_H
+#define OPENGLPROFILER_H
+
+#include <QJsonObject>
+#include <QOpenGLTimerQuery>
+#include <QString>
+
+#include <chrono>
+#include <vector>
+
+//Measures GPU (and CPU) time of render passes with GL_TIMESTAMP queries. Queries cycle through a ring of frames and
+//are only read once their results are available, so profiling never stalls the pipeline. Query objects are not
+//shared between contexts, so every renderer owns its own profiler
+class OpenGLProfiler
+{
+public:
+    //Aggregated times of one pass, in milliseconds
+    typedef struct OpenGLPassStats
+    {
+        QString name;
+
+        unsigned long long samples;
+
+        double meanGPUTime;
+        double minGPUTime;
+        double maxGPUTime;
+
+        double meanCPUTime;
+    }
+    OpenGLPassStats;
+
+    OpenGLProfiler(const QString& profilerName, unsigned int numFrames = 4);
+
+    virtual ~OpenGLProfiler();
+
+    //Must be called with the profiled context current; returns false if timer queries are not supported
+    bool initialize();
+    bool isInitialized() const;
+
+    const QString& getName() const;
+
+    //Passes must not nest; name must stay valid for the lifetime of the profiler (use string literals)
+    void beginPass(const char* name);
+    void endPass();
+
+    //Closes the current frame and collects every older frame whose results have landed
+    void endFrame();
+
+    std::vector<OpenGLPassStats> getStats() const;
+    unsigned long long getDroppedFrameCount() const;
+
+    //GPU time of all passes of the most recently collected frame, in milliseconds, and how many frames have been collected;
+    //a changed count means a new measurement. Results land a few frames after the frame was rendered
+    double getLastFrameGPUTime() const;
+    unsigned long long getCollectedFrameCount() const;
+
+    void resetStats();
+
+    //Chrome trace (chrome://tracing, Perfetto) of the recorded passes; GPU and CPU times go on separate tracks
+    bool writeChromeTrace(const QString& fileName) const;
+    static bool writeChromeTrace(const QString& fileName, const std::vector<const OpenGLProfiler*>& profilers);
+
+protected:
+    typedef std::chrono::steady_clock Clock;
+
+    //Queries of one pass
+    typedef struct OpenGLPassQuery
+    {
+        const char* name;
+
+        QOpenGLTimerQuery* beginQuery;
+        QOpenGLTimerQuery* endQuery;
+
+        Clock::time_point cpuBegin;
+        Clock::time_point cpuEnd;
+    }
+    OpenGLPassQuery;
+
+    //One slot of the ring; query objects are kept and reused
+    typedef struct OpenGLFrameQueries
+    {
+        std::vector<OpenGLPassQuery> passes;
+        unsigned int numPasses;
+
+        bool pending;
+    }
+    OpenGLFrameQueries;
+
+    //Recorded pass for the trace; times in microseconds
+    typedef struct OpenGLTraceEvent
+    {
+        const char* name;
+
+        double gpuBegin;
+        double gpuDuration;
+
+        double cpuBegin;
+        double cpuDuration;
+    }
+    OpenGLTraceEvent;
+
+    typedef struct OpenGLPassAccumulator
+    {
+        const char* name;
+
+        unsigned long long samples;
+
+        double gpuSum;
+        double gpuMin;
+        double gpuMax;
+
+        double cpuSum;
+    }
+    OpenGLPassAccumulator;
+
+    bool collectFrame(OpenGLFrameQueries& frame);
+    void accumulate(const char* name, double gpuTime, double cpuTime);
+
+    //Trace event objects
+    static QJsonObject metadataEvent(const QString& name, int pid, int tid, const QString& value);
+    static QJsonObject completeEvent(const QString& name, int pid, int tid, double begin, double duration);
+
+    QString name;
+
+    bool initialized;
+    bool passOpen;
+
+    std::vector<OpenGLFrameQueries> frames;
+    unsigned int frameIndex;
+
+    std::vector<OpenGLPassAccumulator> accumulators;
+    unsigned long long droppedFrames;
+
+    double lastFrameGPUTime;
+    unsigned long long collectedFrames;
+
+    //Trace recording, bounded so a long run cannot grow without limit
+    std::vector<OpenGLTraceEvent> traceEvents;
+    size_t maxTraceEvents;
+
+    Clock::time_point cpuEpoch;
+    GLuint64 gpuEpoch;
+};
+
+#endif // OPENGLPROFILER_H
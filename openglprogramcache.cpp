@@ -0,0 +1,331 @@
+#include "openglprogramcache.h"
+
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+QMutex OpenGLProgramCache::settingsMutex;
+std::map<QOpenGLContextGroup*,OpenGLProgramCache*> OpenGLProgramCache::caches;
+std::set<QOpenGLShaderProgram*> OpenGLProgramCache::sharedPrograms;
+QString OpenGLProgramCache::cacheDirectory;
+bool OpenGLProgramCache::cacheDirectorySet = false;
+bool OpenGLProgramCache::sharingEnabled = true;
+OpenGLProgramCache::OpenGLProgramCacheStats OpenGLProgramCache::stats = {0,0,0,0,0.0,0.0};
+
+//Identifies the blob layout; bump when it changes
+static const quint32 programBinaryMagic = 0x574c4750;
+static const quint32 programBinaryVersion = 1;
+
+OpenGLProgramCache::OpenGLProgramCache() :
+    initialized(false)
+{
+
+}
+
+OpenGLProgramCache::~OpenGLProgramCache()
+{
+    QMutexLocker locker(&settingsMutex);
+
+    for(auto& entry : programs)
+    {
+        sharedPrograms.erase(entry.second);
+        delete entry.second;
+    }
+
+    programs.clear();
+}
+
+OpenGLProgramCache *OpenGLProgramCache::getCache(QOpenGLContext *context)
+{
+    assert(context);
+
+    QMutexLocker locker(&settingsMutex);
+
+    QOpenGLContextGroup* shareGroup = context->shareGroup();
+
+    auto it = caches.find(shareGroup);
+    if(it != caches.end())
+        return it->second;
+
+    OpenGLProgramCache* cache = new OpenGLProgramCache();
+    caches[shareGroup] = cache;
+
+    //The cache, and every program it owns, goes away with the group
+    QObject::connect(shareGroup, &QObject::destroyed, [shareGroup]()
+    {
+        OpenGLProgramCache* groupCache = nullptr;
+
+        {
+            QMutexLocker locker(&settingsMutex);
+
+            auto it = caches.find(shareGroup);
+            if(it == caches.end())
+                return;
+
+            groupCache = it->second;
+            caches.erase(it);
+        }
+
+        delete groupCache;
+    });
+
+    return cache;
+}
+
+void OpenGLProgramCache::setCacheDirectory(const QString &path)
+{
+    QMutexLocker locker(&settingsMutex);
+
+    cacheDirectory = path;
+    cacheDirectorySet = true;
+}
+
+QString OpenGLProgramCache::getCacheDirectory()
+{
+    QMutexLocker locker(&settingsMutex);
+
+    if(!cacheDirectorySet)
+    {
+        cacheDirectory = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + QString("/programs");
+        cacheDirectorySet = true;
+    }
+
+    return cacheDirectory;
+}
+
+void OpenGLProgramCache::setSharingEnabled(bool enabled)
+{
+    QMutexLocker locker(&settingsMutex);
+
+    sharingEnabled = enabled;
+}
+
+bool OpenGLProgramCache::isSharingEnabled()
+{
+    QMutexLocker locker(&settingsMutex);
+
+    return sharingEnabled;
+}
+
+OpenGLProgramCache::OpenGLProgramCacheStats OpenGLProgramCache::getStats()
+{
+    QMutexLocker locker(&settingsMutex);
+
+    return stats;
+}
+
+void OpenGLProgramCache::resetStats()
+{
+    QMutexLocker locker(&settingsMutex);
+
+    stats = OpenGLProgramCacheStats{0,0,0,0,0.0,0.0};
+}
+
+QOpenGLShaderProgram *OpenGLProgramCache::getProgram(const QString &vertexShaderFile, const QString &fragmentShaderFile)
+{
+    QMutexLocker locker(&mutex);
+
+    initializeCache();
+
+    QByteArray vertexSource = readSource(vertexShaderFile);
+    QByteArray fragmentSource = readSource(fragmentShaderFile);
+    QByteArray key = programKey(vertexSource, fragmentSource);
+
+    bool sharing = isSharingEnabled();
+
+    if(sharing)
+    {
+        auto it = programs.find(key);
+        if(it != programs.end())
+        {
+            QMutexLocker statsLocker(&settingsMutex);
+            stats.sharedHits++;
+
+            return it->second;
+        }
+    }
+
+    QOpenGLShaderProgram* program = buildProgram(vertexSource, fragmentSource, key);
+
+    if(sharing)
+    {
+        programs[key] = program;
+
+        QMutexLocker statsLocker(&settingsMutex);
+        sharedPrograms.insert(program);
+    }
+
+    return program;
+}
+
+QOpenGLShaderProgram *OpenGLProgramCache::getInstanceProgram(const QString &vertexShaderFile, const QString &fragmentShaderFile)
+{
+    QMutexLocker locker(&mutex);
+
+    initializeCache();
+
+    QByteArray vertexSource = readSource(vertexShaderFile);
+    QByteArray fragmentSource = readSource(fragmentShaderFile);
+
+    return buildProgram(vertexSource, fragmentSource, programKey(vertexSource, fragmentSource));
+}
+
+void OpenGLProgramCache::releaseProgram(QOpenGLShaderProgram *program)
+{
+    if(!program)
+        return;
+
+    {
+        QMutexLocker locker(&settingsMutex);
+
+        //Shared programs belong to their cache
+        if(sharedPrograms.count(program))
+            return;
+    }
+
+    delete program;
+}
+
+void OpenGLProgramCache::initializeCache()
+{
+    if(initialized)
+        return;
+
+    initializeOpenGLFunctions();
+
+    driverKey = QByteArray(reinterpret_cast<const char*>(glGetString(GL_VENDOR))) + QByteArray("|") +
+                QByteArray(reinterpret_cast<const char*>(glGetString(GL_RENDERER))) + QByteArray("|") +
+                QByteArray(reinterpret_cast<const char*>(glGetString(GL_VERSION)));
+
+    initialized = true;
+}
+
+QByteArray OpenGLProgramCache::programKey(const QByteArray &vertexSource, const QByteArray &fragmentSource) const
+{
+    return QCryptographicHash::hash(vertexSource + QByteArray(1,'\0') + fragmentSource + QByteArray(1,'\0') + driverKey,
+                                    QCryptographicHash::Sha1).toHex();
+}
+
+QOpenGLShaderProgram *OpenGLProgramCache::buildProgram(const QByteArray &vertexSource, const QByteArray &fragmentSource, const QByteArray &key)
+{
+    QString directory = getCacheDirectory();
+    QString fileName = directory.isEmpty() ? QString() : directory + QString("/") + QString::fromLatin1(key.constData()) + QString(".bin");
+
+    QOpenGLShaderProgram* program = new QOpenGLShaderProgram();
+
+    QElapsedTimer timer;
+    timer.start();
+
+    if(!fileName.isEmpty() && QFile::exists(fileName))
+    {
+        if(loadBinary(program, fileName, key))
+        {
+            QMutexLocker statsLocker(&settingsMutex);
+            stats.diskHits++;
+            stats.loadTime += timer.nsecsElapsed() / 1000000.0;
+
+            return program;
+        }
+
+        //Driver update or corrupt file; drop the blob and build from source below
+        QFile::remove(fileName);
+
+        delete program;
+        program = new QOpenGLShaderProgram();
+
+        QMutexLocker statsLocker(&settingsMutex);
+        stats.diskRejects++;
+    }
+
+    timer.restart();
+
+    program -> addShaderFromSourceCode(QOpenGLShader::Vertex, vertexSource);
+    program -> addShaderFromSourceCode(QOpenGLShader::Fragment, fragmentSource);
+
+    //Ask the driver to keep the binary around so it can be retrieved after linking
+    if(!fileName.isEmpty())
+        glProgramParameteri(program->programId(), GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+
+    program -> link();
+
+    {
+        QMutexLocker statsLocker(&settingsMutex);
+        stats.compiles++;
+        stats.compileTime += timer.nsecsElapsed() / 1000000.0;
+    }
+
+    if(!fileName.isEmpty() && program->isLinked())
+        saveBinary(program, fileName, key);
+
+    return program;
+}
+
+bool OpenGLProgramCache::loadBinary(QOpenGLShaderProgram *program, const QString &fileName, const QByteArray &key)
+{
+    QFile file(fileName);
+    if(!file.open(QIODevice::ReadOnly))
+        return false;
+
+    QDataStream stream(&file);
+
+    quint32 magic = 0;
+    quint32 version = 0;
+    QByteArray storedKey;
+    quint32 binaryFormat = 0;
+    QByteArray binary;
+
+    stream >> magic >> version >> storedKey >> binaryFormat >> binary;
+
+    if(stream.status() != QDataStream::Ok || magic != programBinaryMagic || version != programBinaryVersion || storedKey != key || binary.isEmpty())
+        return false;
+
+    if(!program->create())
+        return false;
+
+    glProgramBinary(program->programId(), static_cast<GLenum>(binaryFormat), binary.constData(), binary.size());
+
+    //With no shaders attached link() only checks the link status the binary left behind
+    return program->link();
+}
+
+void OpenGLProgramCache::saveBinary(QOpenGLShaderProgram *program, const QString &fileName, const QByteArray &key)
+{
+    GLint binaryLength = 0;
+    glGetProgramiv(program->programId(), GL_PROGRAM_BINARY_LENGTH, &binaryLength);
+
+    //Drivers without a binary format report zero
+    if(binaryLength <= 0)
+        return;
+
+    QByteArray binary(binaryLength, '\0');
+    GLenum binaryFormat = 0;
+    glGetProgramBinary(program->programId(), binaryLength, nullptr, &binaryFormat, binary.data());
+
+    if(!QDir().mkpath(QFileInfo(fileName).absolutePath()))
+        return;
+
+    //Written to a temporary file and renamed so another process never reads half a blob
+    QSaveFile file(fileName);
+    if(!file.open(QIODevice::WriteOnly))
+        return;
+
+    QDataStream stream(&file);
+    stream << programBinaryMagic << programBinaryVersion << key << static_cast<quint32>(binaryFormat) << binary;
+
+    file.commit();
+}
+
+QByteArray OpenGLProgramCache::readSource(const QString &fileName)
+{
+    QFile file(fileName);
+    if(!file.open(QIODevice::ReadOnly))
+        return QByteArray();
+
+    return file.readAll();
+}
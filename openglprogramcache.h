@@ -0,0 +1,96 @@
+#ifndef OPENGLPROGRAMCACHE_H
+#define OPENGLPROGRAMCACHE_H
+
+#include <QOpenGLContext>
+#include <QOpenGLExtraFunctions>
+#include <QOpenGLShaderProgram>
+#include <QMutex>
+#include <QString>
+
+#include <map>
+#include <set>
+
+//Linked shader programs shared by every context of a share group, backed by glGetProgramBinary blobs on disk.
+//Blobs are keyed by the shader sources, GL vendor / renderer and version; a blob the driver rejects is deleted
+//and the program is compiled from source again
+class OpenGLProgramCache : protected QOpenGLExtraFunctions
+{
+public:
+    typedef struct OpenGLProgramCacheStats
+    {
+        unsigned long long sharedHits;
+        unsigned long long diskHits;
+        unsigned long long diskRejects;
+        unsigned long long compiles;
+
+        //Time spent compiling / linking from source and loading binaries, in milliseconds
+        double compileTime;
+        double loadTime;
+    }
+    OpenGLProgramCacheStats;
+
+    //Cache of the current context's share group; created on first use and destroyed with the group
+    static OpenGLProgramCache* getCache(QOpenGLContext* context);
+
+    //Where binaries are stored; an empty path disables the disk cache. Defaults to the application's cache location
+    static void setCacheDirectory(const QString& path);
+    static QString getCacheDirectory();
+
+    //With sharing disabled every call compiles a new program owned by the caller, as before the cache existed
+    static void setSharingEnabled(bool enabled);
+    static bool isSharingEnabled();
+
+    //Totals over all share groups
+    static OpenGLProgramCacheStats getStats();
+    static void resetStats();
+
+    //Must be called with a context of the group current; the program is owned by the cache unless sharing is disabled.
+    //Uniform values live in the program object, so a shared program must only carry values every user sets alike
+    QOpenGLShaderProgram* getProgram(const QString& vertexShaderFile, const QString& fragmentShaderFile);
+
+    //A program of the caller's own, for users that keep per-instance uniform values in it (a transform, a colour matrix).
+    //Loaded from the disk cache like any other program but never shared; release it with releaseProgram
+    QOpenGLShaderProgram* getInstanceProgram(const QString& vertexShaderFile, const QString& fragmentShaderFile);
+
+    //Counterpart of getProgram; deletes the program if it is not shared
+    static void releaseProgram(QOpenGLShaderProgram* program);
+
+protected:
+    OpenGLProgramCache();
+    ~OpenGLProgramCache();
+
+    //Queries the driver key on first use; called with the mutex locked
+    void initializeCache();
+
+    //Binary key of a program; the key covers the sources themselves so an edited shader never picks up a stale binary
+    QByteArray programKey(const QByteArray& vertexSource, const QByteArray& fragmentSource) const;
+
+    QOpenGLShaderProgram* buildProgram(const QByteArray& vertexSource, const QByteArray& fragmentSource, const QByteArray& key);
+
+    bool loadBinary(QOpenGLShaderProgram* program, const QString& fileName, const QByteArray& key);
+    void saveBinary(QOpenGLShaderProgram* program, const QString& fileName, const QByteArray& key);
+
+    static QByteArray readSource(const QString& fileName);
+
+    bool initialized;
+
+    //Vendor, renderer and version of the group's driver
+    QByteArray driverKey;
+
+    std::map<QByteArray,QOpenGLShaderProgram*> programs;
+
+    QMutex mutex;
+
+    static QMutex settingsMutex;
+
+    //Caches are not parented to their group, which usually lives in another thread
+    static std::map<QOpenGLContextGroup*,OpenGLProgramCache*> caches;
+    static std::set<QOpenGLShaderProgram*> sharedPrograms;
+
+    static QString cacheDirectory;
+    static bool cacheDirectorySet;
+    static bool sharingEnabled;
+    static OpenGLProgramCacheStats stats;
+};
+
+#endif // OPENGLPROGRAMCACHE_H
@@ -0,0 +1,340 @@
+#include "openglquadbatch.h"
+
+#include <openglprogramcache.h>
+
+#include <QOpenGLContext>
+
+#include <algorithm>
+#include <cstring>
+
+//Attribute locations fixed in quadVertex.glsl
+static const GLuint cornerAttributeLocation = 0;
+static const GLuint rectAttributeLocation = 1;
+static const GLuint texRectAttributeLocation = 2;
+static const GLuint colorAttributeLocation = 3;
+
+//Uniform block binding point of QuadUniforms
+static const GLuint quadUniformBinding = 0;
+
+//std140 layout of QuadUniforms
+typedef struct OpenGLQuadUniforms
+{
+    GLfloat targetSize[2];
+    GLfloat padding[2];
+}
+OpenGLQuadUniforms;
+
+OpenGLQuadBatch::OpenGLQuadBatch(unsigned int segmentQuads, unsigned int numSegments) :
+    initialized(false),
+    segmentCapacity(segmentQuads),
+    vaoID(0),
+    cornerVboID(0),
+    instanceVboID(0),
+    segments(numSegments, OpenGLQuadSegment{0,nullptr}),
+    segmentIndex(0),
+    defaultProgram(nullptr),
+    configuredPrograms(),
+    streamBuffer(nullptr),
+    ownStreamBuffer(4096),
+    stateCache(nullptr),
+    sortEnabled(true),
+    stats{0,0,0,0,0,0,0}
+{
+
+}
+
+OpenGLQuadBatch::~OpenGLQuadBatch()
+{
+    OpenGLProgramCache::releaseProgram(defaultProgram);
+
+    defaultProgram = nullptr;
+}
+
+void OpenGLQuadBatch::initialize()
+{
+    if(initialized)
+        return;
+
+    initializeOpenGLFunctions();
+
+    if(!streamBuffer)
+        ownStreamBuffer.initialize();
+
+    defaultProgram = OpenGLProgramCache::getCache(QOpenGLContext::currentContext())->getProgram(QString(":/GLSL/quadVertex.glsl"),
+                                                                                               QString(":/GLSL/quadFragment.glsl"));
+
+    //Unit quad drawn as a strip; every instance scales it to its own rect
+    static const GLfloat cornerData[4][2] = {{0.0f,0.0f},{1.0f,0.0f},{0.0f,1.0f},{1.0f,1.0f}};
+
+    glGenVertexArrays(1, &vaoID);
+    glBindVertexArray(vaoID);
+
+    glGenBuffers(1, &cornerVboID);
+    glBindBuffer(GL_ARRAY_BUFFER, cornerVboID);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(cornerData), cornerData, GL_STATIC_DRAW);
+
+    glEnableVertexAttribArray(cornerAttributeLocation);
+    glVertexAttribPointer(cornerAttributeLocation, 2, GL_FLOAT, GL_FALSE, 2*sizeof(GLfloat), (const void*)(0));
+
+    //Instance ring; one segment per batch in flight
+    glGenBuffers(1, &instanceVboID);
+    glBindBuffer(GL_ARRAY_BUFFER, instanceVboID);
+    glBufferData(GL_ARRAY_BUFFER, segments.size() * segmentCapacity * sizeof(OpenGLQuad), nullptr, GL_STREAM_DRAW);
+
+    for(size_t i = 0; i < segments.size(); i++)
+        segments[i].offset = i * segmentCapacity * sizeof(OpenGLQuad);
+
+    glEnableVertexAttribArray(rectAttributeLocation);
+    glEnableVertexAttribArray(texRectAttributeLocation);
+    glEnableVertexAttribArray(colorAttributeLocation);
+
+    glVertexAttribDivisor(rectAttributeLocation, 1);
+    glVertexAttribDivisor(texRectAttributeLocation, 1);
+    glVertexAttribDivisor(colorAttributeLocation, 1);
+
+    setInstanceAttributes(0);
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    initialized = true;
+}
+
+void OpenGLQuadBatch::release()
+{
+    if(!initialized)
+        return;
+
+    for(OpenGLQuadSegment& segment : segments)
+    {
+        if(segment.fence)
+            glDeleteSync(segment.fence);
+
+        segment.fence = nullptr;
+    }
+
+    glDeleteBuffers(1, &instanceVboID);
+    glDeleteBuffers(1, &cornerVboID);
+    if(stateCache)
+        stateCache->deleteVertexArrays(1, &vaoID);
+    else
+        glDeleteVertexArrays(1, &vaoID);
+
+    instanceVboID = cornerVboID = vaoID = 0;
+
+    OpenGLProgramCache::releaseProgram(defaultProgram);
+    defaultProgram = nullptr;
+
+    configuredPrograms.clear();
+    ownStreamBuffer.release();
+
+    initialized = false;
+}
+
+bool OpenGLQuadBatch::isInitialized() const
+{
+    return initialized;
+}
+
+QOpenGLShaderProgram *OpenGLQuadBatch::getDefaultProgram() const
+{
+    return defaultProgram;
+}
+
+void OpenGLQuadBatch::setStreamBuffer(OpenGLStreamBuffer *buffer)
+{
+    streamBuffer = buffer;
+}
+
+void OpenGLQuadBatch::setStateCache(OpenGLStateCache *cache)
+{
+    stateCache = cache;
+}
+
+void OpenGLQuadBatch::setSortEnabled(bool enabled)
+{
+    sortEnabled = enabled;
+}
+
+void OpenGLQuadBatch::begin()
+{
+    //Capacity is kept from frame to frame
+    items.clear();
+    quads.clear();
+}
+
+void OpenGLQuadBatch::addQuad(GLuint textureID, const OpenGLQuadBatch::OpenGLQuad &quad, QOpenGLShaderProgram *program)
+{
+    if(!program)
+        program = defaultProgram;
+
+    items.push_back(OpenGLQuadBatchItem{(static_cast<unsigned long long>(program->programId()) << 32) | textureID, program, textureID});
+    quads.push_back(quad);
+}
+
+void OpenGLQuadBatch::end(unsigned int targetWidth, unsigned int targetHeight)
+{
+    size_t count = quads.size();
+    if(count == 0 || !initialized)
+        return;
+
+    assert(stateCache);
+
+    order.resize(count);
+    for(size_t i = 0; i < count; i++)
+        order[i] = static_cast<unsigned int>(i);
+
+    //Stable, so quads sharing a program and texture keep their submission order
+    if(sortEnabled)
+        std::stable_sort(order.begin(), order.end(), [this](unsigned int a, unsigned int b) { return items[a].key < items[b].key; });
+
+    stateCache->bindVertexArray(vaoID);
+    glBindBuffer(GL_ARRAY_BUFFER, instanceVboID);
+
+    stateCache->disable(GL_DEPTH_TEST);
+    stateCache->enable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    stateCache->viewport(0, 0, targetWidth, targetHeight);
+    stateCache->activeTexture(GL_TEXTURE0);
+
+    //Shared by every program of the batch; unchanged sizes reuse the previous upload and binding
+    OpenGLStreamBuffer* uniformBuffer = streamBuffer ? streamBuffer : &ownStreamBuffer;
+
+    if(!streamBuffer)
+        ownStreamBuffer.beginFrame();
+
+    OpenGLQuadUniforms uniforms = {{static_cast<GLfloat>(targetWidth), static_cast<GLfloat>(targetHeight)}, {0.0f, 0.0f}};
+    uniformBuffer->setUniformBlock(quadUniformBinding, &uniforms, sizeof(uniforms));
+
+    QOpenGLShaderProgram* boundProgram = nullptr;
+    GLuint boundTextureID = 0;
+    bool textureBound = false;
+
+    for(size_t first = 0; first < count; first += segmentCapacity)
+    {
+        size_t chunk = std::min(count - first, static_cast<size_t>(segmentCapacity));
+
+        OpenGLQuadSegment& segment = segments[segmentIndex];
+        waitSegment(segment);
+
+        //The fence guarantees the GPU is done with this range, so skip the driver's own synchronization
+        GLsizeiptr chunkSize = chunk * sizeof(OpenGLQuad);
+        OpenGLQuad* mappedQuads = static_cast<OpenGLQuad*>(glMapBufferRange(GL_ARRAY_BUFFER, segment.offset, chunkSize,
+                                                                             GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT));
+        if(!mappedQuads)
+            break;
+
+        //Gather in draw order while writing, so sorting never moves the quads themselves
+        for(size_t i = 0; i < chunk; i++)
+            std::memcpy(mappedQuads + i, &quads[order[first + i]], sizeof(OpenGLQuad));
+
+        glUnmapBuffer(GL_ARRAY_BUFFER);
+        stats.uploadedBytes += chunkSize;
+
+        //One instanced draw per run of equal keys
+        size_t runStart = 0;
+        for(size_t i = 1; i <= chunk; i++)
+        {
+            if(i < chunk && items[order[first + i]].key == items[order[first + runStart]].key)
+                continue;
+
+            const OpenGLQuadBatchItem& item = items[order[first + runStart]];
+
+            if(item.program != boundProgram)
+            {
+                stateCache->useProgram(item.program->programId());
+                configureProgram(item.program);
+
+                boundProgram = item.program;
+                stats.programBinds++;
+            }
+
+            if(!textureBound || item.textureID != boundTextureID)
+            {
+                stateCache->bindTexture(GL_TEXTURE_2D, item.textureID);
+
+                boundTextureID = item.textureID;
+                textureBound = true;
+                stats.textureBinds++;
+            }
+
+            //No base instance in GL 4.1 / ES 3, so the instance attributes are pointed at the run instead
+            setInstanceAttributes(segment.offset + runStart * sizeof(OpenGLQuad));
+
+            glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, static_cast<GLsizei>(i - runStart));
+            stats.drawCalls++;
+
+            runStart = i;
+        }
+
+        segment.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        segmentIndex = (segmentIndex + 1) % segments.size();
+    }
+
+    if(!streamBuffer)
+        ownStreamBuffer.endFrame();
+
+    //Blending is the one state the other passes do not set themselves; program, VAO and texture stay bound
+    stateCache->disable(GL_BLEND);
+
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    stats.batches++;
+    stats.quads += count;
+}
+
+unsigned int OpenGLQuadBatch::getQuadCount() const
+{
+    return static_cast<unsigned int>(quads.size());
+}
+
+OpenGLQuadBatch::OpenGLQuadBatchStats OpenGLQuadBatch::getStats() const
+{
+    return stats;
+}
+
+void OpenGLQuadBatch::resetStats()
+{
+    stats = OpenGLQuadBatchStats{0,0,0,0,0,0,0};
+}
+
+void OpenGLQuadBatch::waitSegment(OpenGLQuadBatch::OpenGLQuadSegment &segment)
+{
+    if(!segment.fence)
+        return;
+
+    GLenum status = glClientWaitSync(segment.fence, 0, 0);
+    if(status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+    {
+        stats.ringWaits++;
+        glClientWaitSync(segment.fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+    }
+
+    glDeleteSync(segment.fence);
+    segment.fence = nullptr;
+}
+
+void OpenGLQuadBatch::configureProgram(QOpenGLShaderProgram *program)
+{
+    GLuint programID = program->programId();
+
+    if(std::find(configuredPrograms.begin(), configuredPrograms.end(), programID) != configuredPrograms.end())
+        return;
+
+    //Block binding and sampler unit are program state, so they survive rebinding and need no per frame lookups
+    GLuint blockIndex = glGetUniformBlockIndex(programID, "QuadUniforms");
+    if(blockIndex != GL_INVALID_INDEX)
+        glUniformBlockBinding(programID, blockIndex, quadUniformBinding);
+
+    glUniform1i(glGetUniformLocation(programID, "quadTexture"), 0);
+
+    configuredPrograms.push_back(programID);
+}
+
+void OpenGLQuadBatch::setInstanceAttributes(GLintptr offset)
+{
+    glVertexAttribPointer(rectAttributeLocation, 4, GL_FLOAT, GL_FALSE, sizeof(OpenGLQuad), (const void*)(offset));
+    glVertexAttribPointer(texRectAttributeLocation, 4, GL_FLOAT, GL_FALSE, sizeof(OpenGLQuad), (const void*)(offset + 4*sizeof(GLfloat)));
+    glVertexAttribPointer(colorAttributeLocation, 4, GL_FLOAT, GL_FALSE, sizeof(OpenGLQuad), (const void*)(offset + 8*sizeof(GLfloat)));
+}
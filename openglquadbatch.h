@@ -0,0 +1,146 @@
+#ifndef OPENGLQUADBATCH_H
+#define OPENGLQUADBATCH_H
+
+#include <openglstatecache.h>
+#include <openglstreambuffer.h>
+
+#include <QOpenGLExtraFunctions>
+#include <QOpenGLShaderProgram>
+
+#include <vector>
+
+//Draws large numbers of textured quads with one instanced draw per run of quads sharing a program and texture. Per-quad
+//attributes are streamed through a ring of fenced buffer segments, so a frame never waits on the GPU unless it is a whole
+//ring ahead. Quads are sorted by program and texture; order is kept between quads of the same program and texture only
+class OpenGLQuadBatch : protected QOpenGLExtraFunctions
+{
+public:
+    //Defines one quad; position and size are in target pixels from the bottom left, texture coordinates are normalized
+    typedef struct OpenGLQuad
+    {
+        GLfloat x;
+        GLfloat y;
+        GLfloat width;
+        GLfloat height;
+
+        GLfloat texX;
+        GLfloat texY;
+        GLfloat texWidth;
+        GLfloat texHeight;
+
+        GLfloat r;
+        GLfloat g;
+        GLfloat b;
+        GLfloat a;
+    }
+    OpenGLQuad;
+
+    //Totals since the last resetStats
+    typedef struct OpenGLQuadBatchStats
+    {
+        unsigned long long batches;
+        unsigned long long quads;
+        unsigned long long drawCalls;
+        unsigned long long programBinds;
+        unsigned long long textureBinds;
+
+        //Times a segment was still in use by the GPU when it came round again
+        unsigned long long ringWaits;
+
+        unsigned long long uploadedBytes;
+    }
+    OpenGLQuadBatchStats;
+
+    //segmentQuads instances per ring segment; a batch larger than one segment spans several
+    OpenGLQuadBatch(unsigned int segmentQuads = 65536,
+                    unsigned int numSegments = 3);
+
+    virtual ~OpenGLQuadBatch();
+
+    //Must be called with the target context current; creates the ring, the corner VBO / VAO and the default program
+    void initialize();
+    void release();
+
+    bool isInitialized() const;
+
+    //Default program (quadVertex.glsl / quadFragment.glsl); custom programs use the same attribute locations, the
+    //"QuadUniforms" block and the "quadTexture" sampler
+    QOpenGLShaderProgram* getDefaultProgram() const;
+
+    //Takes QuadUniforms from a stream buffer its owner begins and ends every frame; set it before initialize. Without
+    //one the batch keeps a small buffer of its own
+    void setStreamBuffer(OpenGLStreamBuffer* buffer);
+
+    //Binds go through the owner's state cache, which must be set before the first end()
+    void setStateCache(OpenGLStateCache* cache);
+
+    void setSortEnabled(bool enabled);
+
+    //Collects quads for the next end(); a null program uses the default one
+    void begin();
+    void addQuad(GLuint textureID, const OpenGLQuad& quad, QOpenGLShaderProgram* program = nullptr);
+
+    //Uploads and draws everything added since begin() into the bound framebuffer
+    void end(unsigned int targetWidth, unsigned int targetHeight);
+
+    unsigned int getQuadCount() const;
+
+    OpenGLQuadBatchStats getStats() const;
+    void resetStats();
+
+protected:
+    typedef struct OpenGLQuadBatchItem
+    {
+        //Program id in the high half, texture in the low half
+        unsigned long long key;
+
+        QOpenGLShaderProgram* program;
+        GLuint textureID;
+    }
+    OpenGLQuadBatchItem;
+
+    //Defines one segment of the instance ring
+    typedef struct OpenGLQuadSegment
+    {
+        GLintptr offset;
+        GLsync fence;
+    }
+    OpenGLQuadSegment;
+
+    //Blocks until the GPU has finished with the segment's previous contents
+    void waitSegment(OpenGLQuadSegment& segment);
+
+    void setInstanceAttributes(GLintptr offset);
+
+    //Points a program's QuadUniforms block and sampler at their fixed binding point / unit, once per program
+    void configureProgram(QOpenGLShaderProgram* program);
+
+    bool initialized;
+
+    unsigned int segmentCapacity;
+
+    GLuint vaoID;
+    GLuint cornerVboID;
+    GLuint instanceVboID;
+
+    std::vector<OpenGLQuadSegment> segments;
+    unsigned int segmentIndex;
+
+    QOpenGLShaderProgram* defaultProgram;
+    std::vector<GLuint> configuredPrograms;
+
+    OpenGLStreamBuffer* streamBuffer;
+    OpenGLStreamBuffer ownStreamBuffer;
+
+    OpenGLStateCache* stateCache;
+
+    bool sortEnabled;
+
+    std::vector<OpenGLQuadBatchItem> items;
+    std::vector<OpenGLQuad> quads;
+    std::vector<unsigned int> order;
+
+    OpenGLQuadBatchStats stats;
+};
+
+#endif // OPENGLQUADBATCH_H
@@ -11,17 +11,28 @@ OpenGLRenderer::OpenGLRenderer(OpenGLRenderer::OpenGLRenderSpecs specs) :
     vboID(0),
     fboID(0),
     textureUnit(0),
-    outputTextureID(0)
+    outputTextureID(0),
+    outputTexture{0,0,OpenGLTexturePool::OpenGLPoolKey{0,0,GL_TEXTURE_2D,0}},
+    specsPending(false),
+    pendingSpecs(specs),
+    resizeRequests(0),
+    resizes(0),
+    profilingEnabled(false),
+    profiler(nullptr)
 {
 
 }
 
 OpenGLRenderer::~OpenGLRenderer()
 {
-    if(shader)
-        delete shader;
+    OpenGLProgramCache::releaseProgram(shader);
 
     shader = nullptr;
+
+    if(profiler)
+        delete profiler;
+
+    profiler = nullptr;
 }
 
 GLuint OpenGLRenderer::getTextureID() const
@@ -34,18 +45,202 @@ OpenGLRenderer::OpenGLRenderSpecs OpenGLRenderer::getSpecs() const
     return renderSpecs;
 }
 
+OpenGLTexturePool::OpenGLTexturePoolStats OpenGLRenderer::getTexturePoolStats() const
+{
+    return texturePool.getStats();
+}
+
+unsigned long long OpenGLRenderer::getResizeRequestCount() const
+{
+    return resizeRequests;
+}
+
+unsigned long long OpenGLRenderer::getResizeCount() const
+{
+    return resizes;
+}
+
+OpenGLStateCache::OpenGLStateCacheStats OpenGLRenderer::getStateCacheStats() const
+{
+    return stateCache.getStats();
+}
+
+void OpenGLRenderer::resetStateCacheStats()
+{
+    stateCache.resetStats();
+}
+
+void OpenGLRenderer::setProfilingEnabled(bool enabled, const QString &profilerName)
+{
+    profilingEnabled = enabled;
+    profilingName = profilerName;
+}
+
+OpenGLProfiler *OpenGLRenderer::getProfiler() const
+{
+    return profiler;
+}
+
+unsigned int OpenGLRenderer::getBytesPerPixel(const OpenGLRenderer::OpenGLTextureSpecs &specs)
+{
+    //Packed types hold a whole pixel in one value
+    switch(specs.dataType)
+    {
+        case GL_UNSIGNED_INT_2_10_10_10_REV:
+        case GL_UNSIGNED_INT_10F_11F_11F_REV:
+        case GL_UNSIGNED_INT_5_9_9_9_REV:
+        case GL_UNSIGNED_INT_24_8:
+            return 4;
+        case GL_UNSIGNED_SHORT_5_6_5:
+        case GL_UNSIGNED_SHORT_4_4_4_4:
+        case GL_UNSIGNED_SHORT_5_5_5_1:
+            return 2;
+        default:
+            break;
+    }
+
+    unsigned int componentSize = 1;
+    switch(specs.dataType)
+    {
+        case GL_UNSIGNED_SHORT:
+        case GL_SHORT:
+        case GL_HALF_FLOAT:
+            componentSize = 2;
+            break;
+        case GL_UNSIGNED_INT:
+        case GL_INT:
+        case GL_FLOAT:
+            componentSize = 4;
+            break;
+        default:
+            break;
+    }
+
+    return componentSize * specs.channels;
+}
+
+unsigned int OpenGLRenderer::getPlaneCount(const OpenGLRenderer::OpenGLTextureSpecs &specs)
+{
+    switch(specs.planeLayout)
+    {
+        case OpenGLPlanesNV12:
+        case OpenGLPlanesP010:
+            return 2;
+        case OpenGLPlanesI420:
+            return 3;
+        default:
+            return 1;
+    }
+}
+
+OpenGLRenderer::OpenGLPlaneSpecs OpenGLRenderer::getPlaneSpecs(const OpenGLRenderer::OpenGLTextureSpecs &specs, unsigned int plane)
+{
+    if(specs.planeLayout == OpenGLPlanesPacked)
+        return OpenGLPlaneSpecs{specs.width, specs.height, specs.internalFormat, specs.format, specs.dataType, getBytesPerPixel(specs), 0};
+
+    //Chroma is subsampled 2x2, rounding up for odd sizes
+    unsigned int chromaWidth = (specs.width + 1) / 2;
+    unsigned int chromaHeight = (specs.height + 1) / 2;
+
+    bool wide = (specs.planeLayout == OpenGLPlanesP010);
+    unsigned int sampleSize = wide ? 2 : 1;
+
+    size_t lumaSize = static_cast<size_t>(specs.width) * specs.height * sampleSize;
+
+    if(plane == 0)
+        return OpenGLPlaneSpecs{specs.width, specs.height,
+                                wide ? GL_R16 : GL_R8, GL_RED, static_cast<GLenum>(wide ? GL_UNSIGNED_SHORT : GL_UNSIGNED_BYTE),
+                                sampleSize, 0};
+
+    if(specs.planeLayout == OpenGLPlanesI420)
+    {
+        size_t chromaSize = static_cast<size_t>(chromaWidth) * chromaHeight;
+
+        return OpenGLPlaneSpecs{chromaWidth, chromaHeight, GL_R8, GL_RED, GL_UNSIGNED_BYTE, 1,
+                                lumaSize + (plane - 1) * chromaSize};
+    }
+
+    //Interleaved UV
+    return OpenGLPlaneSpecs{chromaWidth, chromaHeight,
+                            wide ? GL_RG16 : GL_RG8, GL_RG, static_cast<GLenum>(wide ? GL_UNSIGNED_SHORT : GL_UNSIGNED_BYTE),
+                            2 * sampleSize, lumaSize};
+}
+
+size_t OpenGLRenderer::getFrameSize(const OpenGLRenderer::OpenGLTextureSpecs &specs)
+{
+    OpenGLPlaneSpecs last = getPlaneSpecs(specs, getPlaneCount(specs) - 1);
+
+    return last.offset + static_cast<size_t>(last.width) * last.height * last.bytesPerPixel;
+}
+
+void OpenGLRenderer::getColorConversion(const OpenGLRenderer::OpenGLTextureSpecs &specs, GLfloat matrix[], GLfloat offset[])
+{
+    //Luma weights of red and blue
+    GLfloat kr = 0.299f, kb = 0.114f;
+
+    switch(specs.colorMatrix)
+    {
+        case OpenGLColorBT709:
+            kr = 0.2126f;
+            kb = 0.0722f;
+            break;
+        case OpenGLColorBT2020:
+            kr = 0.2627f;
+            kb = 0.0593f;
+            break;
+        default:
+            break;
+    }
+
+    GLfloat kg = 1.0f - kr - kb;
+
+    //Limited range puts luma in 16-235 and chroma in 16-240 (scaled by 4 for 10 bit, which normalizes the same)
+    GLfloat lumaScale = specs.fullRange ? 1.0f : 255.0f / 219.0f;
+    GLfloat chromaScale = specs.fullRange ? 1.0f : 255.0f / 224.0f;
+
+    offset[0] = specs.fullRange ? 0.0f : 16.0f / 255.0f;
+    offset[1] = 128.0f / 255.0f;
+    offset[2] = 128.0f / 255.0f;
+
+    //Columns multiply Y, Cb and Cr
+    matrix[0] = lumaScale;
+    matrix[1] = lumaScale;
+    matrix[2] = lumaScale;
+
+    matrix[3] = 0.0f;
+    matrix[4] = -2.0f * kb * (1.0f - kb) / kg * chromaScale;
+    matrix[5] = 2.0f * (1.0f - kb) * chromaScale;
+
+    matrix[6] = 2.0f * (1.0f - kr) * chromaScale;
+    matrix[7] = -2.0f * kr * (1.0f - kr) / kg * chromaScale;
+    matrix[8] = 0.0f;
+}
+
 void OpenGLRenderer::initialize()
 {
     if(initialized)
         return;
 
     initializeOpenGLFunctions();
+    stateCache.initialize();
+    texturePool.initialize();
+    texturePool.setStateCache(&stateCache);
+
+    //Requests made before the first frame need no reallocation
+    if(specsPending)
+    {
+        renderSpecs = pendingSpecs;
+        specsPending = false;
+    }
 
     initializeShaderProgram();
     initializeVertexBuffers();
     initializeFBO();
     initializeUniforms();
 
+    //Setup above binds with plain GL calls
+    stateCache.invalidate();
+
     initialized = true;
 }
 
@@ -54,33 +249,25 @@ void OpenGLRenderer::resize(unsigned int w, unsigned int h)
     if(w == 0 || h == 0)
         return;
 
-    if(renderSpecs.frameType.width != w || renderSpecs.frameType.height != h)
-    {
-        renderSpecs.frameType.width = w;
-        renderSpecs.frameType.height = h;
+    if(!specsPending)
+        pendingSpecs = renderSpecs;
 
-        resizeFBO();
-    }
+    pendingSpecs.frameType.width = w;
+    pendingSpecs.frameType.height = h;
+
+    specsPending = true;
+    resizeRequests++;
 }
 
 void OpenGLRenderer::updateSpecs(OpenGLRenderer::OpenGLRenderSpecs specs)
 {
-    if(renderSpecs.frameType.width == 0 || renderSpecs.frameType.height == 0 || renderSpecs.frameType.channels == 0)
+    if(specs.frameType.width == 0 || specs.frameType.height == 0 || specs.frameType.channels == 0)
         return;
 
-    if(
-            renderSpecs.frameType.width != specs.frameType.width ||
-            renderSpecs.frameType.height != specs.frameType.height ||
-            renderSpecs.frameType.channels != specs.frameType.channels ||
-            renderSpecs.frameRate != specs.frameRate ||
-            renderSpecs.frameType.internalFormat != specs.frameType.internalFormat ||
-            renderSpecs.frameType.format != specs.frameType.format ||
-            renderSpecs.frameType.dataType != specs.frameType.dataType)
-    {
-        renderSpecs = specs;
+    pendingSpecs = specs;
 
-        resizeFBO();
-    }
+    specsPending = true;
+    resizeRequests++;
 }
 
 void OpenGLRenderer::setFrameRate(float fps)
@@ -89,6 +276,7 @@ void OpenGLRenderer::setFrameRate(float fps)
         return;
 
     renderSpecs.frameRate = fps;
+    pendingSpecs.frameRate = fps;
 }
 
 void OpenGLRenderer::start()
@@ -102,38 +290,24 @@ void OpenGLRenderer::stop()
 void OpenGLRenderer::initializeFBO()
 {
     //Generate output FBO and texture
-    glGenFramebuffers(1, &fboID);
-    glBindFramebuffer(GL_FRAMEBUFFER, fboID);
+    outputTexture = texturePool.acquire(renderSpecs.frameType.width, renderSpecs.frameType.height, renderSpecs.frameType.internalFormat);
 
-    glGenTextures(1, &outputTextureID);
+    fboID = outputTexture.fboID;
+    outputTextureID = outputTexture.textureID;
 
-    glBindTexture(GL_TEXTURE_2D, outputTextureID);
+    stateCache.bindTexture(GL_TEXTURE_2D, outputTextureID);
 
-    glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
 
-    glTexImage2D(GL_TEXTURE_2D, 0, renderSpecs.frameType.internalFormat, renderSpecs.frameType.width, renderSpecs.frameType.height, 0, renderSpecs.frameType.format, renderSpecs.frameType.dataType, (const GLvoid*)(nullptr));
-    glGenerateMipmap(GL_TEXTURE_2D);
-
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_outputColorAttachment, GL_TEXTURE_2D, outputTextureID, 0);
-
-    assert(glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE);
-
-    glBindTexture(GL_TEXTURE_2D, 0);
-
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    stateCache.bindTexture(GL_TEXTURE_2D, 0);
 }
 
 void OpenGLRenderer::initializeShaderProgram()
 {
-    //Create main OpenGL program; add vertex and fragment shaders, link and bind
-    shader = new QOpenGLShaderProgram();
-    shader -> addShaderFromSourceFile(QOpenGLShader::Vertex, QString(":/GLSL/passVertex.glsl"));
-    shader -> addShaderFromSourceFile(QOpenGLShader::Fragment, QString(":/GLSL/passFragment.glsl"));
-
-    shader -> link();
+    //Get main OpenGL program from the share group cache and bind
+    shader = OpenGLProgramCache::getCache(QOpenGLContext::currentContext())->getProgram(QString(":/GLSL/passVertex.glsl"),
+                                                                                       QString(":/GLSL/passFragment.glsl"));
     shader -> bind();
 
     //Get locations of vertex shader attributes
@@ -177,12 +351,10 @@ void OpenGLRenderer::initializeUniforms()
 
 void OpenGLRenderer::resizeFBO()
 {
-    //Resize output texture
-    glBindTexture(GL_TEXTURE_2D, outputTextureID);
-
-        glTexImage2D(GL_TEXTURE_2D, 0, renderSpecs.frameType.internalFormat, renderSpecs.frameType.width, renderSpecs.frameType.height, 0, renderSpecs.frameType.format, renderSpecs.frameType.dataType, (const GLvoid*)(nullptr));
+    //Hand the old target back to the pool; it is reused if the size comes back (e.g. dragging a window to and fro)
+    texturePool.release(outputTexture);
 
-    glBindTexture(GL_TEXTURE_2D, 0);
+    initializeFBO();
 }
 
 void OpenGLRenderer::updateUniforms()
@@ -199,3 +371,56 @@ void OpenGLRenderer::updateEndTime()
     t_end = std::chrono::high_resolution_clock::now();
     t_delta = t_end - t_start;
 }
+
+bool OpenGLRenderer::beginFrame()
+{
+    stateCache.beginFrame();
+    texturePool.endFrame();
+
+    if(!specsPending)
+        return false;
+
+    specsPending = false;
+
+    renderSpecs.frameRate = pendingSpecs.frameRate;
+
+    //Only the last request of the burst counts; nothing to do if it brought us back where we were
+    if(renderSpecs.frameType == pendingSpecs.frameType)
+        return false;
+
+    renderSpecs = pendingSpecs;
+    resizes++;
+
+    resizeFBO();
+
+    return true;
+}
+
+void OpenGLRenderer::beginPass(const char *name)
+{
+    if(!profilingEnabled)
+        return;
+
+    if(!profiler)
+    {
+        profiler = new OpenGLProfiler(profilingName);
+
+        //Timer queries need GL 3.3 or ARB_timer_query; without them profiling quietly stays off
+        if(!profiler->initialize())
+            profilingEnabled = false;
+    }
+
+    profiler->beginPass(name);
+}
+
+void OpenGLRenderer::endPass()
+{
+    if(profilingEnabled && profiler)
+        profiler->endPass();
+}
+
+void OpenGLRenderer::endProfiledFrame()
+{
+    if(profilingEnabled && profiler)
+        profiler->endFrame();
+}
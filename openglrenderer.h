@@ -1,6 +1,11 @@
 #ifndef OPENGLRENDERER_H
 #define OPENGLRENDERER_H
 
+#include <openglprofiler.h>
+#include <openglprogramcache.h>
+#include <openglstatecache.h>
+#include <opengltexturepool.h>
+
 #include <QOpenGLShaderProgram>
 #include <QOpenGLExtraFunctions>
 #include <QTimer>
@@ -8,10 +13,35 @@
 #include <chrono>
 #include <ctime>
 
+//Allow GL fence sync objects to be passed through queued signals
+Q_DECLARE_OPAQUE_POINTER(GLsync)
+Q_DECLARE_METATYPE(GLsync)
+
 class OpenGLRenderer : public QOpenGLExtraFunctions
 {
 public:
-    //Defines an OpenGL texture
+    //How a frame's pixels are laid out in memory. Packed frames are described by the texture specs alone; planar ones
+    //store full size luma followed by half size chroma (interleaved UV for NV12 / P010, separate U and V for I420) and
+    //are converted to RGBA on the GPU. P010 keeps 10 bit samples in the high bits of 16 bit words
+    typedef enum OpenGLPlaneLayout
+    {
+        OpenGLPlanesPacked,
+        OpenGLPlanesNV12,
+        OpenGLPlanesI420,
+        OpenGLPlanesP010
+    }
+    OpenGLPlaneLayout;
+
+    //YUV to RGB matrix of planar frames
+    typedef enum OpenGLColorMatrix
+    {
+        OpenGLColorBT601,
+        OpenGLColorBT709,
+        OpenGLColorBT2020
+    }
+    OpenGLColorMatrix;
+
+    //Defines an OpenGL texture; for planar layouts the format fields describe the luma plane
     typedef struct OpenGLTextureSpecs
     {
         unsigned int width;
@@ -24,9 +54,49 @@ public:
         GLenum format;
 
         GLenum dataType;
+
+        //Left out of most initializers, which gives packed frames
+        OpenGLPlaneLayout planeLayout;
+        OpenGLColorMatrix colorMatrix;
+        bool fullRange;
+
+        //Every field counts, so a change of layout or conversion alone is still a change
+        bool operator==(const OpenGLTextureSpecs& other) const
+        {
+            return width == other.width &&
+                    height == other.height &&
+                    channels == other.channels &&
+                    target == other.target &&
+                    internalFormat == other.internalFormat &&
+                    format == other.format &&
+                    dataType == other.dataType &&
+                    planeLayout == other.planeLayout &&
+                    colorMatrix == other.colorMatrix &&
+                    fullRange == other.fullRange;
+        }
+
+        bool operator!=(const OpenGLTextureSpecs& other) const
+        {
+            return !(*this == other);
+        }
     }
     OpenGLTextureSpecs;
 
+    //Defines one plane of a frame and where it starts in the frame's memory
+    typedef struct OpenGLPlaneSpecs
+    {
+        unsigned int width;
+        unsigned int height;
+
+        GLint internalFormat;
+        GLenum format;
+        GLenum dataType;
+
+        unsigned int bytesPerPixel;
+        size_t offset;
+    }
+    OpenGLPlaneSpecs;
+
     //Defines an OpenGL renderer
     typedef struct OpenGLRenderSpecs
     {
@@ -36,6 +106,16 @@ public:
     }
     OpenGLRenderSpecs;
 
+    //How a display gets its input to the screen: copied into its own FBO and drawn from there, drawn straight from the input
+    //texture, or blitted from it with glBlitFramebuffer
+    typedef enum OpenGLPresentMode
+    {
+        OpenGLPresentCopy,
+        OpenGLPresentSample,
+        OpenGLPresentBlit
+    }
+    OpenGLPresentMode;
+
     OpenGLRenderer(OpenGLRenderSpecs specs);
 
     virtual ~OpenGLRenderer();
@@ -44,11 +124,36 @@ public:
 
     virtual OpenGLRenderSpecs getSpecs() const;
 
+    //Size of one pixel of a texture as it is transferred to / from the CPU (format + dataType)
+    static unsigned int getBytesPerPixel(const OpenGLTextureSpecs& specs);
+
+    //Planes of a frame: 1 for packed frames, 2 for NV12 / P010, 3 for I420
+    static unsigned int getPlaneCount(const OpenGLTextureSpecs& specs);
+    static OpenGLPlaneSpecs getPlaneSpecs(const OpenGLTextureSpecs& specs, unsigned int plane);
+
+    //Bytes of one whole frame on the CPU, all planes included
+    static size_t getFrameSize(const OpenGLTextureSpecs& specs);
+
+    //Column-major matrix and offset turning sampled YUV into RGB as rgb = matrix * (yuv - offset), range included
+    static void getColorConversion(const OpenGLTextureSpecs& specs, GLfloat matrix[9], GLfloat offset[3]);
+
     //These are the main functions we will use
     virtual void initialize();
+
+    //Resizes and spec changes are only recorded here and applied once at the start of the next frame (beginFrame),
+    //so a burst of requests such as a window drag costs a single reallocation
     virtual void resize(unsigned int w, unsigned int h);
     virtual void updateSpecs(OpenGLRenderSpecs specs);
 
+    OpenGLTexturePool::OpenGLTexturePoolStats getTexturePoolStats() const;
+
+    unsigned long long getResizeRequestCount() const;
+    unsigned long long getResizeCount() const;
+
+    //GL state calls and context switches sent / elided by the renderer's state cache
+    OpenGLStateCache::OpenGLStateCacheStats getStateCacheStats() const;
+    void resetStateCacheStats();
+
     virtual void setFrameRate(float fps);
 
     virtual void start();
@@ -56,6 +161,10 @@ public:
 
     virtual void renderFrame() = 0;
 
+    //GPU timing of every pass; the profiler is created on the next frame, with the renderer's context current
+    void setProfilingEnabled(bool enabled, const QString& profilerName);
+    OpenGLProfiler* getProfiler() const;
+
 protected:
     virtual void initializeFBO();
     virtual void initializeShaderProgram();
@@ -66,9 +175,18 @@ protected:
 
     virtual void updateUniforms();
 
+    //Applies pending resizes / spec changes, ages the texture pool and starts a frame of the state cache; call once per
+    //frame after initialize(). Returns true if the frame type changed
+    bool beginFrame();
+
     virtual void updateStartTime();
     virtual void updateEndTime();
 
+    //No-ops unless profiling is enabled; the context being profiled must be current
+    void beginPass(const char* name);
+    void endPass();
+    void endProfiledFrame();
+
     //Variables
     bool initialized;
 
@@ -90,11 +208,32 @@ protected:
     GLint textureUnit;
     GLuint outputTextureID;
 
+    //Bindings of this renderer's context; per frame binds and make-current calls go through it
+    OpenGLStateCache stateCache;
+
+    //Render targets are recycled across resizes
+    OpenGLTexturePool texturePool;
+    OpenGLTexturePool::OpenGLPooledTexture outputTexture;
+
+    //Coalesced resize / updateSpecs requests
+    bool specsPending;
+    OpenGLRenderSpecs pendingSpecs;
+
+    unsigned long long resizeRequests;
+    unsigned long long resizes;
+
     //Used for timing
     std::chrono::time_point<std::chrono::high_resolution_clock> t_start;
     std::chrono::time_point<std::chrono::high_resolution_clock> t_end;
 
     std::chrono::duration<double,std::milli> t_delta;
+
+    //Per pass GPU timing
+    bool profilingEnabled;
+    QString profilingName;
+    OpenGLProfiler* profiler;
 };
 
+Q_DECLARE_METATYPE(OpenGLRenderer::OpenGLTextureSpecs)
+
 #endif // OPENGLRENDERER_H
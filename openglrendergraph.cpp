@@ -0,0 +1,578 @@
+#include "openglrendergraph.h"
+
+#include <algorithm>
+
+OpenGLRenderGraph::OpenGLRenderGraph() :
+    initialized(false),
+    compiled(false),
+    stateCache(nullptr),
+    texturePool(nullptr),
+    stats{0,0,0,0,0,0,0,0,0}
+{
+
+}
+
+OpenGLRenderGraph::~OpenGLRenderGraph()
+{
+
+}
+
+void OpenGLRenderGraph::initialize()
+{
+    if(initialized)
+        return;
+
+    initializeOpenGLFunctions();
+
+    initialized = true;
+}
+
+void OpenGLRenderGraph::setStateCache(OpenGLStateCache *cache)
+{
+    stateCache = cache;
+}
+
+void OpenGLRenderGraph::setTexturePool(OpenGLTexturePool *pool)
+{
+    texturePool = pool;
+}
+
+void OpenGLRenderGraph::clear()
+{
+    textures.clear();
+    passes.clear();
+    schedule.clear();
+
+    compiled = false;
+}
+
+void OpenGLRenderGraph::addTransientTexture(const QString &name, const OpenGLRenderer::OpenGLTextureSpecs &specs)
+{
+    assert(findTexture(name) < 0);
+
+    textures.push_back(OpenGLGraphTexture{name,specs,false,0,-1,-1,-1,-1});
+    compiled = false;
+}
+
+void OpenGLRenderGraph::addImportedTexture(const QString &name, const OpenGLRenderer::OpenGLTextureSpecs &specs, GLuint textureID)
+{
+    assert(findTexture(name) < 0);
+
+    textures.push_back(OpenGLGraphTexture{name,specs,true,textureID,-1,-1,-1,-1});
+    compiled = false;
+}
+
+void OpenGLRenderGraph::setImportedTexture(const QString &name, GLuint textureID)
+{
+    int index = findTexture(name);
+    if(index < 0 || !textures[index].imported)
+        return;
+
+    textures[index].importedTextureID = textureID;
+}
+
+void OpenGLRenderGraph::addPass(const QString &name,
+                                const std::vector<QString> &inputs,
+                                const std::vector<QString> &outputs,
+                                bool clearOutputs,
+                                OpenGLRenderGraph::OpenGLRenderPassFunction function)
+{
+    OpenGLGraphPass pass{name,std::vector<int>(),std::vector<int>(),clearOutputs,function,-1};
+
+    //Unknown names are kept as -1 and rejected by compile
+    for(const QString& input : inputs)
+        pass.inputs.push_back(findTexture(input));
+
+    for(const QString& output : outputs)
+        pass.outputs.push_back(findTexture(output));
+
+    passes.push_back(pass);
+    compiled = false;
+}
+
+bool OpenGLRenderGraph::compile()
+{
+    assert(initialized && stateCache);
+
+    compiled = false;
+
+    if(!sortPasses())
+        return false;
+
+    assignStorage();
+    assignFramebuffers();
+
+    compiled = true;
+    return true;
+}
+
+bool OpenGLRenderGraph::isCompiled() const
+{
+    return compiled;
+}
+
+void OpenGLRenderGraph::execute()
+{
+    if(!compiled)
+        return;
+
+    GLuint boundFBO = 0;
+    bool framebufferBound = false;
+
+    for(int passIndex : schedule)
+    {
+        const OpenGLGraphPass& pass = passes[passIndex];
+        OpenGLGraphFramebuffer& framebuffer = framebuffers[pass.framebufferIndex];
+
+        updateAttachments(framebuffer);
+
+        //Consecutive passes writing the same storage share a framebuffer; skip the rebind
+        if(!framebufferBound || boundFBO != framebuffer.fboID)
+        {
+            stateCache->bindFramebuffer(GL_FRAMEBUFFER, framebuffer.fboID);
+
+            boundFBO = framebuffer.fboID;
+            framebufferBound = true;
+
+            stats.framebufferBinds++;
+        }
+        else
+            stats.elidedFramebufferBinds++;
+
+        const OpenGLRenderer::OpenGLTextureSpecs& outputSpecs = textures[pass.outputs.front()].specs;
+
+        stateCache->viewport(0, 0, outputSpecs.width, outputSpecs.height);
+
+        if(pass.clearOutputs)
+        {
+            glClearColor(0.0f,0.0f,0.0f,1.0f);
+            glClear(framebuffer.clearMask);
+
+            stats.clears++;
+        }
+
+        OpenGLRenderPassResources resources{std::vector<GLuint>(),framebuffer.fboID,outputSpecs.width,outputSpecs.height};
+
+        for(size_t i = 0; i < pass.inputs.size(); i++)
+        {
+            GLuint textureID = textureFor(pass.inputs[i]);
+            resources.inputTextures.push_back(textureID);
+
+            stateCache->activeTexture(GL_TEXTURE0 + static_cast<GLenum>(i));
+            stateCache->bindTexture(GL_TEXTURE_2D, textureID);
+        }
+
+        pass.function(resources);
+    }
+}
+
+GLuint OpenGLRenderGraph::getTexture(const QString &name) const
+{
+    int index = findTexture(name);
+    if(index < 0)
+        return 0;
+
+    return textureFor(index);
+}
+
+OpenGLRenderGraph::OpenGLRenderGraphStats OpenGLRenderGraph::getStats() const
+{
+    return stats;
+}
+
+int OpenGLRenderGraph::findTexture(const QString &name) const
+{
+    for(size_t i = 0; i < textures.size(); i++)
+    {
+        if(textures[i].name == name)
+            return static_cast<int>(i);
+    }
+
+    return -1;
+}
+
+bool OpenGLRenderGraph::isDepthFormat(const OpenGLRenderer::OpenGLTextureSpecs &specs) const
+{
+    return specs.format == GL_DEPTH_COMPONENT || specs.format == GL_DEPTH_STENCIL;
+}
+
+bool OpenGLRenderGraph::sameStorage(const OpenGLRenderer::OpenGLTextureSpecs &a, const OpenGLRenderer::OpenGLTextureSpecs &b) const
+{
+    return a.width == b.width &&
+           a.height == b.height &&
+           a.target == b.target &&
+           a.internalFormat == b.internalFormat;
+}
+
+GLuint OpenGLRenderGraph::textureFor(int textureIndex) const
+{
+    const OpenGLGraphTexture& texture = textures[textureIndex];
+
+    if(texture.imported)
+        return texture.importedTextureID;
+
+    if(texture.physicalIndex < 0)
+        return 0;
+
+    return physicalTextures[texture.physicalIndex].textureID;
+}
+
+bool OpenGLRenderGraph::sortPasses()
+{
+    schedule.clear();
+
+    for(OpenGLGraphTexture& texture : textures)
+    {
+        texture.writer = -1;
+        texture.firstUse = -1;
+        texture.lastUse = -1;
+        texture.physicalIndex = -1;
+    }
+
+    //Every texture has a single writer
+    for(size_t p = 0; p < passes.size(); p++)
+    {
+        if(passes[p].outputs.empty())
+            return false;
+
+        for(int output : passes[p].outputs)
+        {
+            if(output < 0 || textures[output].writer >= 0)
+                return false;
+
+            textures[output].writer = static_cast<int>(p);
+        }
+    }
+
+    //Transient inputs must be produced inside the graph; imported ones may come from outside
+    for(const OpenGLGraphPass& pass : passes)
+    {
+        for(int input : pass.inputs)
+        {
+            if(input < 0 || (!textures[input].imported && textures[input].writer < 0))
+                return false;
+        }
+    }
+
+    //Keep only passes that lead to an imported texture
+    std::vector<bool> needed(passes.size(), false);
+    std::vector<int> pending;
+
+    for(size_t p = 0; p < passes.size(); p++)
+    {
+        for(int output : passes[p].outputs)
+        {
+            if(textures[output].imported && !needed[p])
+            {
+                needed[p] = true;
+                pending.push_back(static_cast<int>(p));
+            }
+        }
+    }
+
+    while(!pending.empty())
+    {
+        int p = pending.back();
+        pending.pop_back();
+
+        for(int input : passes[p].inputs)
+        {
+            int writer = textures[input].writer;
+            if(writer >= 0 && !needed[writer])
+            {
+                needed[writer] = true;
+                pending.push_back(writer);
+            }
+        }
+    }
+
+    //Kahn's algorithm; among ready passes the earliest declared goes first so the order is stable
+    std::vector<int> inDegree(passes.size(), 0);
+    unsigned int numNeeded = 0;
+
+    for(size_t p = 0; p < passes.size(); p++)
+    {
+        if(!needed[p])
+            continue;
+
+        numNeeded++;
+
+        for(int input : passes[p].inputs)
+        {
+            if(textures[input].writer >= 0)
+                inDegree[p]++;
+        }
+    }
+
+    std::vector<bool> scheduled(passes.size(), false);
+
+    while(schedule.size() < numNeeded)
+    {
+        int next = -1;
+        for(size_t p = 0; p < passes.size(); p++)
+        {
+            if(needed[p] && !scheduled[p] && inDegree[p] == 0)
+            {
+                next = static_cast<int>(p);
+                break;
+            }
+        }
+
+        //Nothing ready but passes left: cycle
+        if(next < 0)
+            return false;
+
+        scheduled[next] = true;
+        schedule.push_back(next);
+
+        for(int output : passes[next].outputs)
+        {
+            for(size_t p = 0; p < passes.size(); p++)
+            {
+                if(!needed[p])
+                    continue;
+
+                for(int input : passes[p].inputs)
+                {
+                    if(input == output)
+                        inDegree[p]--;
+                }
+            }
+        }
+    }
+
+    stats.passes = numNeeded;
+    stats.culledPasses = static_cast<unsigned int>(passes.size()) - numNeeded;
+
+    return true;
+}
+
+void OpenGLRenderGraph::assignStorage()
+{
+    //Lifetime of every texture in schedule positions
+    for(size_t position = 0; position < schedule.size(); position++)
+    {
+        const OpenGLGraphPass& pass = passes[schedule[position]];
+
+        for(int output : pass.outputs)
+        {
+            textures[output].firstUse = static_cast<int>(position);
+            textures[output].lastUse = std::max(textures[output].lastUse, static_cast<int>(position));
+        }
+
+        for(int input : pass.inputs)
+            textures[input].lastUse = std::max(textures[input].lastUse, static_cast<int>(position));
+    }
+
+    std::vector<int> transients;
+    for(size_t i = 0; i < textures.size(); i++)
+    {
+        if(!textures[i].imported && textures[i].firstUse >= 0)
+            transients.push_back(static_cast<int>(i));
+    }
+
+    std::sort(transients.begin(), transients.end(), [this](int a, int b)
+    {
+        return textures[a].firstUse < textures[b].firstUse;
+    });
+
+    //Greedy interval colouring; storage from the previous compile is reused where the specs match
+    std::vector<OpenGLPhysicalTexture> previous;
+    previous.swap(physicalTextures);
+
+    //With a pool the previous storage goes back first and is picked up again below where the specs still match
+    if(texturePool)
+    {
+        for(OpenGLPhysicalTexture& physical : previous)
+            texturePool->release(physical.textureID);
+
+        previous.clear();
+    }
+
+    stats.transientTextures = static_cast<unsigned int>(transients.size());
+    stats.transientBytes = 0;
+    stats.allocatedBytes = 0;
+
+    for(int index : transients)
+    {
+        OpenGLGraphTexture& texture = textures[index];
+
+        size_t bytes = static_cast<size_t>(texture.specs.width) * texture.specs.height * OpenGLRenderer::getBytesPerPixel(texture.specs);
+        stats.transientBytes += bytes;
+
+        for(size_t p = 0; p < physicalTextures.size(); p++)
+        {
+            if(physicalTextures[p].lastUse < texture.firstUse && sameStorage(physicalTextures[p].specs, texture.specs))
+            {
+                texture.physicalIndex = static_cast<int>(p);
+                physicalTextures[p].lastUse = texture.lastUse;
+                break;
+            }
+        }
+
+        if(texture.physicalIndex >= 0)
+            continue;
+
+        OpenGLPhysicalTexture physical{texture.specs,0,texture.lastUse};
+
+        auto reusable = std::find_if(previous.begin(), previous.end(), [this,&texture](const OpenGLPhysicalTexture& p)
+        {
+            return sameStorage(p.specs, texture.specs);
+        });
+
+        if(texturePool)
+        {
+            physical.textureID = texturePool->acquire(texture.specs.width, texture.specs.height, texture.specs.internalFormat).textureID;
+
+            stateCache->bindTexture(GL_TEXTURE_2D, physical.textureID);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+            stateCache->bindTexture(GL_TEXTURE_2D, 0);
+        }
+        else if(reusable != previous.end())
+        {
+            physical.textureID = reusable->textureID;
+            previous.erase(reusable);
+        }
+        else
+        {
+            glGenTextures(1, &physical.textureID);
+            stateCache->bindTexture(GL_TEXTURE_2D, physical.textureID);
+
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+
+            glTexStorage2D(GL_TEXTURE_2D, 1, texture.specs.internalFormat, texture.specs.width, texture.specs.height);
+
+            stateCache->bindTexture(GL_TEXTURE_2D, 0);
+        }
+
+        stats.allocatedBytes += bytes;
+
+        texture.physicalIndex = static_cast<int>(physicalTextures.size());
+        physicalTextures.push_back(physical);
+    }
+
+    for(OpenGLPhysicalTexture& physical : previous)
+        stateCache->deleteTextures(1, &physical.textureID);
+
+    stats.physicalTextures = static_cast<unsigned int>(physicalTextures.size());
+}
+
+void OpenGLRenderGraph::assignFramebuffers()
+{
+    releaseFramebuffers();
+
+    for(int passIndex : schedule)
+    {
+        OpenGLGraphPass& pass = passes[passIndex];
+
+        //Identify attachments by storage: aliased transients map to the same framebuffer, imported ones by name
+        std::vector<int> attachments;
+        for(int output : pass.outputs)
+            attachments.push_back(textures[output].imported ? -(output + 1) : textures[output].physicalIndex);
+
+        for(size_t f = 0; f < framebuffers.size(); f++)
+        {
+            if(framebuffers[f].attachments == attachments)
+            {
+                pass.framebufferIndex = static_cast<int>(f);
+                break;
+            }
+        }
+
+        if(pass.framebufferIndex >= 0)
+            continue;
+
+        OpenGLGraphFramebuffer framebuffer{0,attachments,std::vector<GLuint>(attachments.size(),0),0};
+
+        glGenFramebuffers(1, &framebuffer.fboID);
+        stateCache->bindFramebuffer(GL_FRAMEBUFFER, framebuffer.fboID);
+
+        std::vector<GLenum> drawBuffers;
+        for(int output : pass.outputs)
+        {
+            if(isDepthFormat(textures[output].specs))
+                framebuffer.clearMask |= GL_DEPTH_BUFFER_BIT;
+            else
+            {
+                drawBuffers.push_back(GL_COLOR_ATTACHMENT0 + static_cast<GLenum>(drawBuffers.size()));
+                framebuffer.clearMask |= GL_COLOR_BUFFER_BIT;
+            }
+        }
+
+        glDrawBuffers(static_cast<GLsizei>(drawBuffers.size()), drawBuffers.data());
+
+        pass.framebufferIndex = static_cast<int>(framebuffers.size());
+        framebuffers.push_back(framebuffer);
+    }
+
+    stateCache->bindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    //Attach transient storage now; imported textures are attached on execute
+    for(OpenGLGraphFramebuffer& framebuffer : framebuffers)
+    {
+        stateCache->bindFramebuffer(GL_FRAMEBUFFER, framebuffer.fboID);
+        updateAttachments(framebuffer);
+    }
+
+    stateCache->bindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void OpenGLRenderGraph::updateAttachments(OpenGLRenderGraph::OpenGLGraphFramebuffer &framebuffer)
+{
+    bool bound = false;
+    GLenum colorAttachment = GL_COLOR_ATTACHMENT0;
+
+    for(size_t i = 0; i < framebuffer.attachments.size(); i++)
+    {
+        int attachment = framebuffer.attachments[i];
+
+        int textureIndex = -1;
+        GLuint textureID = 0;
+        if(attachment < 0)
+        {
+            textureIndex = -attachment - 1;
+            textureID = textures[textureIndex].importedTextureID;
+        }
+        else
+        {
+            textureID = physicalTextures[attachment].textureID;
+
+            //Any texture aliased onto this storage has the same specs
+            for(size_t t = 0; t < textures.size() && textureIndex < 0; t++)
+            {
+                if(!textures[t].imported && textures[t].physicalIndex == attachment)
+                    textureIndex = static_cast<int>(t);
+            }
+        }
+
+        bool depth = isDepthFormat(textures[textureIndex].specs);
+        GLenum attachmentPoint = depth ? (textures[textureIndex].specs.format == GL_DEPTH_STENCIL ? GL_DEPTH_STENCIL_ATTACHMENT : GL_DEPTH_ATTACHMENT) : colorAttachment++;
+
+        if(framebuffer.attachedTextures[i] == textureID)
+            continue;
+
+        if(!bound)
+        {
+            stateCache->bindFramebuffer(GL_FRAMEBUFFER, framebuffer.fboID);
+            bound = true;
+        }
+
+        glFramebufferTexture2D(GL_FRAMEBUFFER, attachmentPoint, GL_TEXTURE_2D, textureID, 0);
+        framebuffer.attachedTextures[i] = textureID;
+    }
+}
+
+void OpenGLRenderGraph::releaseFramebuffers()
+{
+    for(OpenGLGraphFramebuffer& framebuffer : framebuffers)
+        stateCache->deleteFramebuffers(1, &framebuffer.fboID);
+
+    framebuffers.clear();
+
+    for(OpenGLGraphPass& pass : passes)
+        pass.framebufferIndex = -1;
+}
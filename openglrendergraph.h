@@ -0,0 +1,180 @@
+#ifndef OPENGLRENDERGRAPH_H
+#define OPENGLRENDERGRAPH_H
+
+#include <openglrenderer.h>
+#include <openglstatecache.h>
+#include <opengltexturepool.h>
+
+#include <QOpenGLExtraFunctions>
+#include <QString>
+
+#include <functional>
+#include <vector>
+
+//Declarative chain of render passes. Passes name the textures they read and write; compile() orders them
+//topologically, culls passes that do not contribute to an imported texture and lets transient textures whose
+//lifetimes do not overlap share the same storage. execute() then runs the passes, binding each framebuffer only when
+//it changes and clearing only where a pass asks for it
+class OpenGLRenderGraph : protected QOpenGLExtraFunctions
+{
+public:
+    //What a pass gets to work with; its framebuffer is already bound with the viewport set and inputs bound to
+    //texture units 0..n-1 in declaration order
+    typedef struct OpenGLRenderPassResources
+    {
+        std::vector<GLuint> inputTextures;
+
+        GLuint fboID;
+
+        unsigned int width;
+        unsigned int height;
+    }
+    OpenGLRenderPassResources;
+
+    typedef std::function<void(const OpenGLRenderPassResources&)> OpenGLRenderPassFunction;
+
+    typedef struct OpenGLRenderGraphStats
+    {
+        unsigned int passes;
+        unsigned int culledPasses;
+
+        unsigned int transientTextures;
+        unsigned int physicalTextures;
+
+        //Storage transient textures would need without / with aliasing
+        size_t transientBytes;
+        size_t allocatedBytes;
+
+        unsigned long long framebufferBinds;
+        unsigned long long elidedFramebufferBinds;
+        unsigned long long clears;
+    }
+    OpenGLRenderGraphStats;
+
+    OpenGLRenderGraph();
+
+    virtual ~OpenGLRenderGraph();
+
+    //Must be called with the context current; the graph's GL objects belong to that context
+    void initialize();
+
+    //Binds go through the owning renderer's state cache; passes find their inputs bound but nothing is unbound after them
+    void setStateCache(OpenGLStateCache* cache);
+
+    //Transient storage comes from and goes back to this pool instead of being owned by the graph
+    void setTexturePool(OpenGLTexturePool* pool);
+
+    //Drops every declaration; storage is kept and reused by the next compile where the specs match
+    void clear();
+
+    //Transient textures live within one execution; imported ones belong to the caller and may change every frame.
+    //Depth formats are attached as depth, everything else as colour
+    void addTransientTexture(const QString& name, const OpenGLRenderer::OpenGLTextureSpecs& specs);
+    void addImportedTexture(const QString& name, const OpenGLRenderer::OpenGLTextureSpecs& specs, GLuint textureID = 0);
+    void setImportedTexture(const QString& name, GLuint textureID);
+
+    //Every texture is written by exactly one pass
+    void addPass(const QString& name,
+                 const std::vector<QString>& inputs,
+                 const std::vector<QString>& outputs,
+                 bool clearOutputs,
+                 OpenGLRenderPassFunction function);
+
+    //Returns false if a texture is undeclared, written twice or the passes form a cycle
+    bool compile();
+    bool isCompiled() const;
+
+    void execute();
+
+    GLuint getTexture(const QString& name) const;
+
+    OpenGLRenderGraphStats getStats() const;
+
+protected:
+    typedef struct OpenGLGraphTexture
+    {
+        QString name;
+        OpenGLRenderer::OpenGLTextureSpecs specs;
+
+        bool imported;
+        GLuint importedTextureID;
+
+        //Set by compile
+        int writer;
+        int firstUse;
+        int lastUse;
+        int physicalIndex;
+    }
+    OpenGLGraphTexture;
+
+    typedef struct OpenGLGraphPass
+    {
+        QString name;
+
+        std::vector<int> inputs;
+        std::vector<int> outputs;
+
+        bool clearOutputs;
+
+        OpenGLRenderPassFunction function;
+
+        //Set by compile
+        int framebufferIndex;
+    }
+    OpenGLGraphPass;
+
+    //Storage shared by aliased transient textures
+    typedef struct OpenGLPhysicalTexture
+    {
+        OpenGLRenderer::OpenGLTextureSpecs specs;
+        GLuint textureID;
+
+        int lastUse;
+    }
+    OpenGLPhysicalTexture;
+
+    //Framebuffers are shared by passes that write the same storage
+    typedef struct OpenGLGraphFramebuffer
+    {
+        GLuint fboID;
+
+        std::vector<int> attachments;
+        std::vector<GLuint> attachedTextures;
+
+        GLbitfield clearMask;
+    }
+    OpenGLGraphFramebuffer;
+
+    int findTexture(const QString& name) const;
+    bool isDepthFormat(const OpenGLRenderer::OpenGLTextureSpecs& specs) const;
+    bool sameStorage(const OpenGLRenderer::OpenGLTextureSpecs& a, const OpenGLRenderer::OpenGLTextureSpecs& b) const;
+
+    GLuint textureFor(int textureIndex) const;
+
+    bool sortPasses();
+    void assignStorage();
+    void assignFramebuffers();
+
+    //Re-attaches imported textures that changed since the last frame
+    void updateAttachments(OpenGLGraphFramebuffer& framebuffer);
+
+    void releaseFramebuffers();
+
+    bool initialized;
+    bool compiled;
+
+    std::vector<OpenGLGraphTexture> textures;
+    std::vector<OpenGLGraphPass> passes;
+
+    //Execution order after compile; culled passes are left out
+    std::vector<int> schedule;
+
+    std::vector<OpenGLPhysicalTexture> physicalTextures;
+    OpenGLStateCache* stateCache;
+    OpenGLTexturePool* texturePool;
+    std::vector<OpenGLGraphFramebuffer> framebuffers;
+
+    OpenGLRenderGraphStats stats;
+};
+
+#endif // OPENGLRENDERGRAPH_H
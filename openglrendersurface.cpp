@@ -1,20 +1,50 @@
 #include "openglrendersurface.h"
 
+#include <cmath>
+
 OpenGLRenderSurface::OpenGLRenderSurface(QScreen *outputScreen,
                                          QObject *parent,
                                          OpenGLRenderer::OpenGLRenderSpecs specs,
                                          const QSurfaceFormat &surfaceFormat,
-                                         QOpenGLContext *sharedContext) :
+                                         QOpenGLContext *sharedContext,
+                                         unsigned int outputBufferCount) :
     QOffscreenSurface(outputScreen,parent),
     OpenGLRenderer(specs),
+    frameScheduler(nullptr),
     openGLFormat(surfaceFormat),
     openGLContext(nullptr),
-    depthrenderbuffer(0),
+    outputRing(outputBufferCount),
+    frameIndex(0),
+    readbackEnabled(false),
+    frameReader(nullptr),
+    offlineRendering(false),
+    offlineFirstFrame(0),
+    frameWriter(nullptr),
+    renderGraphDirty(true),
+    effectVboID(0),
+    streamBuffer(),
+    quadBatch(),
+    overlay(),
     trianglePositionAttributeLocation(0),
     triangleColorAttributeLocation(0),
     triangleMatrixUniformLocation(0),
-    triangleAngle(0.0f)
+    triangleAngle(0.0f),
+    dynamicResolution(false),
+    resolutionGovernor(),
+    nominalWidth(specs.frameType.width),
+    nominalHeight(specs.frameType.height),
+    governorGPUFrames(0),
+    videoWall(nullptr),
+    videoWallDirty(false),
+    tileMatrix(),
+    fixedTimestep(0.0),
+    animationFrame(0),
+    triangleMatrix(),
+    triangleMatrixValid(false)
 {
+    quadBatch.setStreamBuffer(&streamBuffer);
+    quadBatch.setStateCache(&stateCache);
+
     //Create offscreen surface
     setFormat(openGLFormat);
     create();
@@ -35,14 +65,27 @@ OpenGLRenderSurface::OpenGLRenderSurface(QScreen *outputScreen,
         assert(sharing);
     }
 
-    //Initialize sync timer
-    initializeTimer();
+    //Initialize frame scheduler
+    initializeScheduler();
     qRegisterMetaType<GLuint>("GLuint");
+    qRegisterMetaType<GLsync>("GLsync");
+    qRegisterMetaType<OpenGLOutputRing::OpenGLOutputFrame>("OpenGLOutputRing::OpenGLOutputFrame");
+    qRegisterMetaType<OpenGLVideoWall::OpenGLWallFrame>("OpenGLVideoWall::OpenGLWallFrame");
 }
 
 OpenGLRenderSurface::~OpenGLRenderSurface()
 {
+    for(OpenGLEffect& effect : effects)
+    {
+        OpenGLProgramCache::releaseProgram(effect.shader);
+
+        effect.shader = nullptr;
+    }
 
+    if(frameReader)
+        delete frameReader;
+
+    frameReader = nullptr;
 }
 
 const QSurfaceFormat &OpenGLRenderSurface::getOpenGLFormat()
@@ -55,20 +98,200 @@ QOpenGLContext *OpenGLRenderSurface::getOpenGLContext()
     return openGLContext;
 }
 
+unsigned int OpenGLRenderSurface::getOutputBufferCount() const
+{
+    return outputRing.getBufferCount();
+}
+
+OpenGLFrameScheduler *OpenGLRenderSurface::getFrameScheduler()
+{
+    return frameScheduler;
+}
+
+unsigned long long OpenGLRenderSurface::getFrameIndex() const
+{
+    return frameIndex;
+}
+
+unsigned long long OpenGLRenderSurface::getDroppedReadbackFrames() const
+{
+    return frameReader ? frameReader->getDroppedFrameCount() : 0;
+}
+
 void OpenGLRenderSurface::setFrameRate(float fps)
 {
     OpenGLRenderer::setFrameRate(fps);
+
+    frameScheduler->setFrameRate(renderSpecs.frameRate);
+    resolutionGovernor.setFrameBudget(1000.0 / renderSpecs.frameRate);
+}
+
+void OpenGLRenderSurface::setSwapDriven(bool enabled)
+{
+    frameScheduler->setSwapDriven(enabled);
+}
+
+void OpenGLRenderSurface::setReadbackEnabled(bool enabled)
+{
+    readbackEnabled = enabled;
+}
+
+OpenGLRenderGraph::OpenGLRenderGraphStats OpenGLRenderSurface::getRenderGraphStats() const
+{
+    return renderGraph.getStats();
+}
+
+void OpenGLRenderSurface::setOverlay(const std::function<void (OpenGLQuadBatch &)> &overlayFunction)
+{
+    overlay = overlayFunction;
+}
+
+OpenGLQuadBatch::OpenGLQuadBatchStats OpenGLRenderSurface::getOverlayStats() const
+{
+    return quadBatch.getStats();
+}
+
+void OpenGLRenderSurface::resetOverlayStats()
+{
+    quadBatch.resetStats();
+}
+
+void OpenGLRenderSurface::setOverlaySortEnabled(bool enabled)
+{
+    quadBatch.setSortEnabled(enabled);
+}
+
+OpenGLStreamBuffer::OpenGLStreamBufferStats OpenGLRenderSurface::getStreamBufferStats() const
+{
+    return streamBuffer.getStats();
+}
+
+void OpenGLRenderSurface::resetStreamBufferStats()
+{
+    streamBuffer.resetStats();
+}
+
+void OpenGLRenderSurface::setFixedTimestep(double seconds)
+{
+    fixedTimestep = std::max(seconds, 0.0);
+    animationFrame = 0;
+}
+
+double OpenGLRenderSurface::getFixedTimestep() const
+{
+    return fixedTimestep;
+}
+
+void OpenGLRenderSurface::setDynamicResolutionEnabled(bool enabled)
+{
+    if(enabled == dynamicResolution)
+        return;
+
+    dynamicResolution = enabled;
+
+    resolutionGovernor.reset();
+    resolutionGovernor.setFrameBudget(1000.0 / renderSpecs.frameRate);
+
+    if(enabled && !profilingEnabled)
+        setProfilingEnabled(true, QString("producer"));
+
+    //Back to (or starting from) the full size
+    OpenGLRenderer::resize(nominalWidth, nominalHeight);
+}
+
+bool OpenGLRenderSurface::isDynamicResolutionEnabled() const
+{
+    return dynamicResolution;
+}
+
+OpenGLResolutionGovernor &OpenGLRenderSurface::getResolutionGovernor()
+{
+    return resolutionGovernor;
+}
+
+double OpenGLRenderSurface::getRenderScale() const
+{
+    return dynamicResolution ? resolutionGovernor.getScale() : 1.0;
+}
+
+unsigned int OpenGLRenderSurface::getNominalWidth() const
+{
+    return nominalWidth;
+}
+
+unsigned int OpenGLRenderSurface::getNominalHeight() const
+{
+    return nominalHeight;
+}
+
+OpenGLVideoWall *OpenGLRenderSurface::getVideoWall() const
+{
+    return videoWall;
+}
+
+void OpenGLRenderSurface::resize(unsigned int w, unsigned int h)
+{
+    if(w == 0 || h == 0)
+        return;
+
+    nominalWidth = w;
+    nominalHeight = h;
+
+    if(videoWall)
+        return;
+
+    OpenGLRenderer::resize(getScaledSize(w), getScaledSize(h));
+}
+
+void OpenGLRenderSurface::updateSpecs(OpenGLRenderer::OpenGLRenderSpecs specs)
+{
+    if(specs.frameType.width == 0 || specs.frameType.height == 0)
+        return;
+
+    nominalWidth = specs.frameType.width;
+    nominalHeight = specs.frameType.height;
+
+    specs.frameType.width = videoWall ? videoWall->getTileWidth() : getScaledSize(nominalWidth);
+    specs.frameType.height = videoWall ? videoWall->getTileHeight() : getScaledSize(nominalHeight);
+
+    OpenGLRenderer::updateSpecs(specs);
+}
+
+void OpenGLRenderSurface::addEffect(const QString &fragmentShaderFile)
+{
+    //Shaders are built with the graph, with the context current
+    effects.push_back(OpenGLEffect{fragmentShaderFile,nullptr,0});
+    renderGraphDirty = true;
+}
+
+void OpenGLRenderSurface::clearEffects()
+{
+    if(effects.empty())
+        return;
+
+    if(makeContextCurrent())
+    {
+        for(OpenGLEffect& effect : effects)
+            releaseEffect(effect);
+
+        doneContextCurrent();
+    }
+
+    effects.clear();
+    renderGraphDirty = true;
 }
 
 void OpenGLRenderSurface::start()
 {
-    float timeOut = 1000.0f/renderSpecs.frameRate;
-    syncTimer->start(timeOut);
+    frameScheduler->start(renderSpecs.frameRate);
 }
 
 void OpenGLRenderSurface::stop()
 {
-    syncTimer->stop();
+    frameScheduler->stop();
+
+    //The context stays current between frames; let go of it so another thread can take over the surface
+    doneContextCurrent();
 }
 
 void OpenGLRenderSurface::renderFrame()
@@ -81,80 +304,182 @@ void OpenGLRenderSurface::renderFrame()
 
     initialize();
 
-    glBindFramebuffer(GL_FRAMEBUFFER, fboID);
-    glBindVertexArray(vaoID);
+    //Apply the last resize request since the previous frame, if any; a new wall at the same tile size still needs its
+    //tile textures
+    if(beginFrame())
+        videoWallDirty = false;
 
-    glEnable(GL_DEPTH_TEST);
-    glClearColor(0.0f,0.0f,0.0f,1.0f);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    if(videoWallDirty)
+    {
+        resizeFBO();
+        videoWallDirty = false;
+    }
 
-    updateUniforms();
-    shader->bind();
+    //Render into a slot of the output ring no display is sampling
+    OpenGLOutputRing::OpenGLOutputBuffer& buffer = outputRing.nextBuffer();
 
-    glViewport(0, 0, renderSpecs.frameType.width, renderSpecs.frameType.height);
+    streamBuffer.beginFrame();
 
-    glDrawArrays(GL_TRIANGLES, 0, 3);
+    if(renderGraphDirty)
+        initializeRenderGraph();
 
-    shader->release();
+    updateAnimation();
 
-    glBindVertexArray(0);
-    glBindFramebuffer(GL_FRAMEBUFFER,0);
+    beginPass("producer draw");
+
+    if(videoWall)
+    {
+        //Same graph and transients for every tile; only the projection offset and the output change
+        for(unsigned int tile = 0; tile < buffer.tileTextureIDs.size(); tile++)
+        {
+            if(!buffer.tileTextureIDs[tile])
+                continue;
+
+            tileMatrix = videoWall->getTileProjection(tile);
+
+            renderGraph.setImportedTexture(QString("output"), buffer.tileTextureIDs[tile]);
+            renderGraph.execute();
+        }
+
+        tileMatrix.setToIdentity();
+    }
+    else
+    {
+        renderGraph.setImportedTexture(QString("output"), buffer.textureID);
+        renderGraph.execute();
+    }
+
+    endPass();
+
+    streamBuffer.endFrame();
+
+    //Consumers wait on the frame's fence (on the GPU) before sampling the slot; flush so the fence is submitted
+    OpenGLOutputRing::OpenGLOutputFrame frame = outputRing.publish();
+    glFlush();
+
+    fboID = buffer.fboID;
+    outputTextureID = buffer.textureID;
+
+    if(readbackEnabled && !videoWall)
+        readFrame(buffer);
+
+    frameIndex++;
+
+    endProfiledFrame();
 
     swapSurfaceBuffers();
-    doneContextCurrent();
 
     updateEndTime();
 
+    if(dynamicResolution && !videoWall)
+        updateResolution();
+
     emit renderedFrame(1000.0f/t_delta.count());
 
-    emit frameReady(outputTextureID,
-                    renderSpecs.frameType.width,
-                    renderSpecs.frameType.height);
+    if(videoWall)
+    {
+        emit wallFrameReady(OpenGLVideoWall::OpenGLWallFrame{buffer.tileTextureIDs, frame});
+        return;
+    }
+
+    emit frameReady(frame);
 }
 
-void OpenGLRenderSurface::initializeFBO()
+void OpenGLRenderSurface::renderOffline(unsigned long long frameCount, OpenGLFrameWriter *writer)
 {
-    //Generate output FBO and texture
-    glGenFramebuffers(1, &fboID);
-    glBindFramebuffer(GL_FRAMEBUFFER, fboID);
+    //Paced frames must not interleave with the offline ones
+    bool wasActive = frameScheduler->isActive();
+    frameScheduler->stop();
 
-    glGenTextures(1, &outputTextureID);
+    double previousTimestep = fixedTimestep;
+    bool previousReadback = readbackEnabled;
 
-    glBindTexture(GL_TEXTURE_2D, outputTextureID);
+    //Reads of earlier frames go out as usual, before the writer is attached
+    if(frameReader && makeContextCurrent())
+    {
+        frameReader->waitForFrames([this](const OpenGLFrameReader::OpenGLFrameData& frame)
+        {
+            handleReadFrame(frame);
+        }, 0);
 
-    glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        doneContextCurrent();
+    }
 
-    glTexImage2D(GL_TEXTURE_2D, 0, renderSpecs.frameType.internalFormat, renderSpecs.frameType.width, renderSpecs.frameType.height, 0, renderSpecs.frameType.format, renderSpecs.frameType.dataType, (const GLvoid*)(nullptr));
-    glGenerateMipmap(GL_TEXTURE_2D);
+    setFixedTimestep((fixedTimestep > 0.0) ? fixedTimestep : 1.0 / std::max(renderSpecs.frameRate, 1.0));
 
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_outputColorAttachment, GL_TEXTURE_2D, outputTextureID, 0);
+    offlineRendering = true;
+    offlineFirstFrame = frameIndex;
+    frameWriter = writer;
+    readbackEnabled = previousReadback || writer;
 
-    //Depth render buffer
-    glGenRenderbuffers(1, &depthrenderbuffer);
-    glBindRenderbuffer(GL_RENDERBUFFER, depthrenderbuffer);
-    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT, renderSpecs.frameType.width, renderSpecs.frameType.height);
+    for(unsigned long long i = 0; i < frameCount; i++)
+        renderFrame();
 
-    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthrenderbuffer);
+    //The last frames are still in flight
+    if(frameReader && makeContextCurrent())
+    {
+        frameReader->waitForFrames([this](const OpenGLFrameReader::OpenGLFrameData& frame)
+        {
+            handleReadFrame(frame);
+        }, 0);
 
-    assert(glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE);
+        doneContextCurrent();
+    }
 
-    glBindTexture(GL_TEXTURE_2D, 0);
-    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+    if(writer)
+        writer->waitForDone();
 
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    offlineRendering = false;
+    frameWriter = nullptr;
+    readbackEnabled = previousReadback;
+
+    fixedTimestep = previousTimestep;
+
+    if(wasActive)
+        start();
+
+    emit offlineFinished(frameCount);
 }
 
-void OpenGLRenderSurface::initializeShaderProgram()
+void OpenGLRenderSurface::setVideoWall(OpenGLVideoWall *wall)
 {
-    //Create debug triangle OpenGL program; add vertex and fragment shaders, link and bind
-    shader = new QOpenGLShaderProgram();
-    shader -> addShaderFromSourceFile(QOpenGLShader::Vertex, QString(":/GLSL/triangleVertex.glsl"));
-    shader -> addShaderFromSourceFile(QOpenGLShader::Fragment, QString(":/GLSL/triangleFragment.glsl"));
+    if(wall == videoWall)
+        return;
+
+    videoWall = wall;
+    videoWallDirty = true;
+
+    //Tiles are the largest textures the surface renders; the canvas itself never exists as one
+    if(videoWall)
+        OpenGLRenderer::resize(videoWall->getTileWidth(), videoWall->getTileHeight());
+    else
+        OpenGLRenderer::resize(getScaledSize(nominalWidth), getScaledSize(nominalHeight));
+}
 
-    shader -> link();
+void OpenGLRenderSurface::initializeFBO()
+{
+    //Depth and intermediate textures are transients of the render graph, drawn from the same pool
+    renderGraph.initialize();
+    renderGraph.setStateCache(&stateCache);
+    renderGraph.setTexturePool(&texturePool);
+    renderGraphDirty = true;
+
+    //Output FBO and texture for each slot of the ring, from the same pool
+    outputRing.initialize();
+    outputRing.setTexturePool(&texturePool);
+
+    initializeOutputRing();
+
+    //The slots above already have their tiles
+    videoWallDirty = false;
+}
+
+void OpenGLRenderSurface::initializeShaderProgram()
+{
+    //Get debug triangle OpenGL program through the share group cache and bind; the matrix uniform is this surface's own
+    //(animation, wall tile), so the program is not shared with other surfaces
+    shader = OpenGLProgramCache::getCache(QOpenGLContext::currentContext())->getInstanceProgram(QString(":/GLSL/triangleVertex.glsl"),
+                                                                                               QString(":/GLSL/triangleFragment.glsl"));
     shader -> bind();
 
     //Get locations of vertex shader attributes
@@ -162,6 +487,7 @@ void OpenGLRenderSurface::initializeShaderProgram()
     triangleColorAttributeLocation = glGetAttribLocation(shader -> programId(), "colorAttribute");
 
     triangleMatrixUniformLocation = glGetUniformLocation(shader -> programId(), "matrix");
+    triangleMatrixValid = false;
 
     shader->release();
 }
@@ -190,6 +516,10 @@ void OpenGLRenderSurface::initializeVertexBuffers()
 
     glBindVertexArray(0);
     glBindBuffer(GL_ARRAY_BUFFER,0);
+
+    //Overlay quads have their own VAO and instance ring; their uniforms come from the stream buffer
+    streamBuffer.initialize();
+    quadBatch.initialize();
 }
 
 void OpenGLRenderSurface::initializeUniforms()
@@ -197,29 +527,288 @@ void OpenGLRenderSurface::initializeUniforms()
 
 }
 
-void OpenGLRenderSurface::updateUniforms()
+void OpenGLRenderSurface::resizeFBO()
 {
-    shader->bind();
+    //Swap every slot of the ring for a pooled target of the new size
+    initializeOutputRing();
 
-    triangleAngle += 1.0f;
-    triangleAngle = (triangleAngle>360.0f)?(0.0f):(triangleAngle);
+    //Transients (depth, intermediates) follow the new size on the next frame
+    renderGraphDirty = true;
+}
 
-    QMatrix4x4 matrix;
+void OpenGLRenderSurface::updateUniforms()
+{
+    QMatrix4x4 matrix = tileMatrix;
     matrix.perspective(60.0f, 4.0f / 3.0f, 0.1f, 100.0f);
     matrix.translate(0.0f, 0.0f, -2.0f);
     matrix.rotate(triangleAngle, 0.0f, 1.0f, 0.0f);
 
-    shader->setUniformValue("matrix", matrix);
+    if(triangleMatrixValid && matrix == triangleMatrix)
+        return;
 
-    shader->release();
+    //Location looked up once in initializeShaderProgram; no bind needed to set it
+    glProgramUniformMatrix4fv(shader->programId(), triangleMatrixUniformLocation, 1, GL_FALSE, matrix.constData());
+
+    triangleMatrix = matrix;
+    triangleMatrixValid = true;
+}
+
+void OpenGLRenderSurface::updateAnimation()
+{
+    if(fixedTimestep > 0.0)
+    {
+        //60 degrees a second, the per tick speed at 60 fps; computed, not accumulated, so it never drifts between runs
+        triangleAngle = static_cast<float>(std::fmod(animationFrame * fixedTimestep * 60.0, 360.0));
+        animationFrame++;
+    }
+    else
+    {
+        triangleAngle += 1.0f;
+        triangleAngle = (triangleAngle>360.0f)?(0.0f):(triangleAngle);
+    }
+}
+
+void OpenGLRenderSurface::initializeOutputRing()
+{
+    std::vector<bool> mappedTiles;
+
+    if(videoWall)
+    {
+        //Tiles must fit in a texture, the canvas need not
+        GLint maxTextureSize = 0;
+        glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxTextureSize);
+
+        bool tileFits = renderSpecs.frameType.width <= static_cast<unsigned int>(maxTextureSize) &&
+                        renderSpecs.frameType.height <= static_cast<unsigned int>(maxTextureSize);
+        assert(tileFits);
+
+        for(unsigned int tile = 0; tile < videoWall->getTileCount(); tile++)
+            mappedTiles.push_back(videoWall->isTileMapped(tile));
+    }
+
+    //Colour only; the slot's FBO is used for readback, rendering goes through the render graph
+    outputRing.allocate(renderSpecs.frameType.width,
+                        renderSpecs.frameType.height,
+                        renderSpecs.frameType.internalFormat,
+                        mappedTiles);
+
+    fboID = outputRing.getBuffer().fboID;
+    outputTextureID = outputRing.getBuffer().textureID;
+}
+
+void OpenGLRenderSurface::readFrame(const OpenGLOutputRing::OpenGLOutputBuffer &buffer)
+{
+    if(!frameReader)
+    {
+        frameReader = new OpenGLFrameReader();
+        frameReader->initialize();
+        frameReader->setStateCache(&stateCache);
+    }
+
+    auto callback = [this](const OpenGLFrameReader::OpenGLFrameData& frame)
+    {
+        handleReadFrame(frame);
+    };
+
+    //Hand over frames whose reads have landed first so their buffers can be reused for this frame; offline renders wait
+    //for a free buffer instead of dropping the frame
+    if(offlineRendering)
+        frameReader->waitForFrames(callback, frameReader->getBufferCount() - 1);
+    else
+        frameReader->processFrames(callback);
+
+    frameReader->readFrame(buffer.fboID, frameIndex, renderSpecs.frameType);
+}
+
+void OpenGLRenderSurface::handleReadFrame(const OpenGLFrameReader::OpenGLFrameData &frame)
+{
+    if(frameWriter)
+        frameWriter->write(frame.data, frame.size, frame.frameIndex - offlineFirstFrame);
+
+    emit frameRead(frame.data, frame.size, frame.frameIndex, frame.specs);
+}
+
+void OpenGLRenderSurface::initializeRenderGraph()
+{
+    renderGraph.clear();
+
+    const OpenGLRenderer::OpenGLTextureSpecs& frameType = renderSpecs.frameType;
+    OpenGLRenderer::OpenGLTextureSpecs depthType{frameType.width,
+                                                 frameType.height,
+                                                 1,
+                                                 GL_TEXTURE_2D,
+                                                 GL_DEPTH_COMPONENT24,
+                                                 GL_DEPTH_COMPONENT,
+                                                 GL_UNSIGNED_INT,
+                                                 OpenGLRenderer::OpenGLPlanesPacked,
+                                                 OpenGLRenderer::OpenGLColorBT601,
+                                                 false};
+
+    renderGraph.addImportedTexture(QString("output"), frameType);
+    renderGraph.addTransientTexture(QString("depth"), depthType);
+
+    //Triangle straight into the output slot, or into the first intermediate of the effect chain
+    QString target = effects.empty() ? QString("output") : QString("scene");
+    if(!effects.empty())
+        renderGraph.addTransientTexture(target, frameType);
+
+    renderGraph.addPass(QString("triangle"), {}, {target, QString("depth")}, true, [this,target](const OpenGLRenderGraph::OpenGLRenderPassResources&)
+    {
+        drawTriangle();
+
+        if(target == QString("output"))
+            drawOverlay();
+    });
+
+    //Effects overwrite every texel so they need no clears; intermediates two passes apart share storage
+    for(size_t i = 0; i < effects.size(); i++)
+    {
+        OpenGLEffect& effect = effects[i];
+        if(!effect.shader)
+            initializeEffect(effect);
+
+        QString input = target;
+        target = (i + 1 == effects.size()) ? QString("output") : QString("effect %1").arg(static_cast<unsigned int>(i));
+
+        if(i + 1 != effects.size())
+            renderGraph.addTransientTexture(target, frameType);
+
+        renderGraph.addPass(QString("effect %1").arg(static_cast<unsigned int>(i)), {input}, {target}, false, [this,&effect,target](const OpenGLRenderGraph::OpenGLRenderPassResources&)
+        {
+            drawEffect(effect);
+
+            //Overlays go on top of the last effect rather than through a pass of their own, which would need a copy
+            if(target == QString("output"))
+                drawOverlay();
+        });
+    }
+
+    bool compiled = renderGraph.compile();
+    assert(compiled);
+
+    renderGraphDirty = false;
+}
+
+void OpenGLRenderSurface::initializeEffect(OpenGLRenderSurface::OpenGLEffect &effect)
+{
+    //Vertex and texture positions of image quad, shared by all effects
+    static const GLfloat vertexData[6][4] = {{-1.0f,-1.0f,0.0f,0.0f},{1.0f,-1.0f,1.0f,0.0f},{1.0f,1.0f,1.0f,1.0f},
+                                             {-1.0f,-1.0f,0.0f,0.0f},{1.0f,1.0f,1.0f,1.0f},{-1.0f,1.0f,0.0f,1.0f}};
+
+    if(!effectVboID)
+    {
+        glGenBuffers(1, &effectVboID);
+        glBindBuffer(GL_ARRAY_BUFFER, effectVboID);
+        glBufferData(GL_ARRAY_BUFFER, 24*sizeof(GLfloat), vertexData, GL_STATIC_DRAW);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    effect.shader = OpenGLProgramCache::getCache(QOpenGLContext::currentContext())->getProgram(QString(":/GLSL/passVertex.glsl"),
+                                                                                              effect.fragmentShaderFile);
+    stateCache.useProgram(effect.shader -> programId());
+
+    //The input is always on texture unit 0 (OpenGLRenderGraph binds inputs in order)
+    effect.shader -> setUniformValue("texture", 0);
+
+    GLint effectVertexLocation = glGetAttribLocation(effect.shader -> programId(), "vertex");
+    GLint effectTexCoordLocation = glGetAttribLocation(effect.shader -> programId(), "texCoord");
+
+    //Attribute locations differ per program, so every effect gets its own VAO
+    glGenVertexArrays(1, &effect.vaoID);
+    stateCache.bindVertexArray(effect.vaoID);
+
+    glBindBuffer(GL_ARRAY_BUFFER, effectVboID);
+
+    glEnableVertexAttribArray(effectVertexLocation);
+    glEnableVertexAttribArray(effectTexCoordLocation);
+
+    glVertexAttribPointer(effectVertexLocation, 2, GL_FLOAT, GL_TRUE, 4*sizeof(GLfloat), (const void*)(0));
+    glVertexAttribPointer(effectTexCoordLocation, 2, GL_FLOAT, GL_TRUE, 4*sizeof(GLfloat), (const void*)(2*sizeof(GLfloat)));
+
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void OpenGLRenderSurface::releaseEffect(OpenGLRenderSurface::OpenGLEffect &effect)
+{
+    OpenGLProgramCache::releaseProgram(effect.shader);
+
+    effect.shader = nullptr;
+
+    if(effect.vaoID)
+        stateCache.deleteVertexArrays(1, &effect.vaoID);
+
+    effect.vaoID = 0;
+}
+
+void OpenGLRenderSurface::updateResolution()
+{
+    //Only new GPU measurements count; they trail the CPU by the profiler's ring
+    double gpuTime = -1.0;
+    if(profiler && profiler->getCollectedFrameCount() != governorGPUFrames)
+    {
+        governorGPUFrames = profiler->getCollectedFrameCount();
+        gpuTime = profiler->getLastFrameGPUTime();
+    }
+
+    //Applied at the start of the next frame; the same few sizes keep coming back, so the texture pool usually has them
+    if(resolutionGovernor.addFrame(t_delta.count(), gpuTime))
+        OpenGLRenderer::resize(getScaledSize(nominalWidth), getScaledSize(nominalHeight));
+}
+
+unsigned int OpenGLRenderSurface::getScaledSize(unsigned int size) const
+{
+    if(!dynamicResolution)
+        return size;
+
+    //Even sizes so chroma subsampled readback and half size passes stay exact
+    unsigned int scaled = static_cast<unsigned int>(size * resolutionGovernor.getScale() + 0.5) & ~1u;
+
+    return std::max(scaled, std::min(size, 2u));
+}
+
+void OpenGLRenderSurface::drawTriangle()
+{
+    stateCache.bindVertexArray(vaoID);
+
+    stateCache.enable(GL_DEPTH_TEST);
+
+    updateUniforms();
+    stateCache.useProgram(shader->programId());
+
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+}
+
+void OpenGLRenderSurface::drawEffect(const OpenGLRenderSurface::OpenGLEffect &effect)
+{
+    stateCache.bindVertexArray(effect.vaoID);
+
+    stateCache.disable(GL_DEPTH_TEST);
+
+    stateCache.useProgram(effect.shader->programId());
+
+    glDrawArrays(GL_TRIANGLES, 0, 6);
+}
+
+void OpenGLRenderSurface::drawOverlay()
+{
+    //Overlay quads are placed in frame pixels, which a tile is not
+    if(!overlay || videoWall)
+        return;
+
+    quadBatch.begin();
+    overlay(quadBatch);
+
+    //The overlay function may have bound things itself
+    stateCache.invalidate();
+
+    quadBatch.end(renderSpecs.frameType.width, renderSpecs.frameType.height);
 }
 
-void OpenGLRenderSurface::initializeTimer()
+void OpenGLRenderSurface::initializeScheduler()
 {
-    syncTimer = new QTimer(this);
-    syncTimer->setTimerType(Qt::PreciseTimer);
+    frameScheduler = new OpenGLFrameScheduler(this);
 
-    QObject::connect(syncTimer,&QTimer::timeout,this,&OpenGLRenderSurface::renderFrame);
+    QObject::connect(frameScheduler,&OpenGLFrameScheduler::frameDue,this,&OpenGLRenderSurface::renderFrame);
 }
 
 void OpenGLRenderSurface::swapSurfaceBuffers()
@@ -229,10 +818,10 @@ void OpenGLRenderSurface::swapSurfaceBuffers()
 
 bool OpenGLRenderSurface::makeContextCurrent()
 {
-    return openGLContext->makeCurrent(this);
+    return stateCache.makeCurrent(openGLContext, this);
 }
 
 void OpenGLRenderSurface::doneContextCurrent()
 {
-    openGLContext->doneCurrent();
+    stateCache.doneCurrent(openGLContext);
 }
@@ -2,10 +2,23 @@
 #define OPENGLRENDERSURFACE_H
 
 #include <openglrenderer.h>
+#include <openglframereader.h>
+#include <openglframewriter.h>
+#include <openglresolutiongovernor.h>
+#include <openglframescheduler.h>
+#include <opengloutputring.h>
+#include <openglrendergraph.h>
+#include <openglquadbatch.h>
+#include <openglstreambuffer.h>
+#include <openglvideowall.h>
 
 #include <QOffscreenSurface>
 #include <QOpenGLContext>
 
+#include <algorithm>
+#include <functional>
+#include <vector>
+
 class OpenGLRenderSurface : public QOffscreenSurface, public OpenGLRenderer
 {
     Q_OBJECT
@@ -14,56 +27,214 @@ public:
                         QObject* parent,
                         OpenGLRenderer::OpenGLRenderSpecs specs,
                         const QSurfaceFormat& surfaceFormat,
-                        QOpenGLContext* sharedContext);
+                        QOpenGLContext* sharedContext,
+                        unsigned int outputBufferCount = 2);
 
     virtual ~OpenGLRenderSurface();
 
     const QSurfaceFormat& getOpenGLFormat();
     QOpenGLContext* getOpenGLContext();
 
+    unsigned int getOutputBufferCount() const;
+
+    OpenGLFrameScheduler* getFrameScheduler();
+
+    unsigned long long getFrameIndex() const;
+    unsigned long long getDroppedReadbackFrames() const;
+
+    OpenGLRenderGraph::OpenGLRenderGraphStats getRenderGraphStats() const;
+
+    //Called on the render thread once per frame, between begin() and end() of the batch, to add overlay quads; they are
+    //drawn over the finished frame in the last pass. Set it before the renderer starts
+    void setOverlay(const std::function<void(OpenGLQuadBatch&)>& overlayFunction);
+
+    OpenGLQuadBatch::OpenGLQuadBatchStats getOverlayStats() const;
+    void resetOverlayStats();
+    void setOverlaySortEnabled(bool enabled);
+
+    //Per-frame uniform / dynamic data ring shared by the surface's passes
+    OpenGLStreamBuffer::OpenGLStreamBufferStats getStreamBufferStats() const;
+    void resetStreamBufferStats();
+
+    //Advances the animation by this many seconds per frame instead of a step per tick, computed from the frame number so
+    //frame N looks the same in every run; 0 goes back to per tick steps
+    void setFixedTimestep(double seconds);
+    double getFixedTimestep() const;
+
+    //Renders at a fraction of the requested size when frames run over the budget of the frame rate, as decided by the
+    //governor from CPU and GPU frame times. GPU times come from the profiler, which is switched on for this if it is off.
+    //frameReady carries the scaled size; displays stretch it to theirs
+    void setDynamicResolutionEnabled(bool enabled);
+    bool isDynamicResolutionEnabled() const;
+
+    OpenGLResolutionGovernor& getResolutionGovernor();
+    double getRenderScale() const;
+
+    //Requested size, before scaling
+    unsigned int getNominalWidth() const;
+    unsigned int getNominalHeight() const;
+
+    OpenGLVideoWall* getVideoWall() const;
+
+    //Sizes given here are the nominal ones; the governor's scale is applied on top. While a video wall is set they are
+    //only recorded, for when it is removed
+    virtual void resize(unsigned int w, unsigned int h) override;
+    virtual void updateSpecs(OpenGLRenderer::OpenGLRenderSpecs specs) override;
+
 public slots:    
 
     virtual void setFrameRate(float fps) override;
 
+    //Lets a display's swap completions (OpenGLNativeRenderWindow::frameSwapped) pace the producer instead of the deadline timer
+    void setSwapDriven(bool enabled);
+
+    //Reads every frame back to the CPU asynchronously; frames arrive through frameRead a frame or two later
+    void setReadbackEnabled(bool enabled);
+
+    //Appends a full screen effect after the triangle; the fragment shader samples "texture" like passFragment.glsl
+    void addEffect(const QString& fragmentShaderFile);
+    void clearEffects();
+
     virtual void start() override;
     virtual void stop() override;
 
     virtual void renderFrame() override;
 
+    //Renders frameCount frames back to back, bypassing the scheduler, with a fixed timestep (one period of the frame rate
+    //unless setFixedTimestep set one) and the animation started from zero. Every frame is read back without drops and
+    //handed to the writer (if any) numbered from 0, so the run is only limited by the GPU and the disk. Blocks until the
+    //last frame is written, then resumes pacing if it was active
+    void renderOffline(unsigned long long frameCount, OpenGLFrameWriter* writer);
+
+    //Renders the wall's canvas tile by tile instead of a single frame: every mapped tile goes into a texture of its own,
+    //at the wall's tile size, and frames are published through wallFrameReady instead of frameReady. Effects run per tile
+    //(so only per pixel ones are seamless); overlays, readback and dynamic resolution are not applied. nullptr goes back
+    //to single frames at the nominal size. The wall must outlive the surface's use of it
+    void setVideoWall(OpenGLVideoWall* wall);
+
 signals:
-    void frameReady(GLuint texID, unsigned int width, unsigned int height);
+    void frameReady(OpenGLOutputRing::OpenGLOutputFrame frame);
     void renderedFrame(double actualFPS);
 
+    //Emitted while the frame's pixel buffer is mapped; data is only valid during the emission so connect with Qt::DirectConnection
+    void frameRead(const unsigned char* data, size_t size, unsigned long long frameIndex, OpenGLRenderer::OpenGLTextureSpecs specs);
+
+    void offlineFinished(unsigned long long frameCount);
+
+    //Displays wait on the fence before sampling any of the tiles
+    void wallFrameReady(OpenGLVideoWall::OpenGLWallFrame frame);
+
 protected:
+    //Defines one effect of the chain
+    typedef struct OpenGLEffect
+    {
+        QString fragmentShaderFile;
+
+        QOpenGLShaderProgram* shader;
+        GLuint vaoID;
+    }
+    OpenGLEffect;
 
     virtual void initializeFBO() override;
     virtual void initializeShaderProgram() override;
     virtual void initializeVertexBuffers() override;
     virtual void initializeUniforms() override;
 
+    virtual void resizeFBO() override;
+
     virtual void updateUniforms() override;
 
-    virtual void initializeTimer();
+    //Steps the triangle's animation once per frame, however many tiles it is drawn into
+    void updateAnimation();
+
+    //Allocates the ring at the render size, with a texture per mapped tile of the video wall
+    virtual void initializeOutputRing();
+
+    void readFrame(const OpenGLOutputRing::OpenGLOutputBuffer& buffer);
+    void handleReadFrame(const OpenGLFrameReader::OpenGLFrameData& frame);
+
+    //Declares the triangle and effect passes; intermediate textures are transient so the graph can alias them
+    virtual void initializeRenderGraph();
+    void initializeEffect(OpenGLEffect& effect);
+    void releaseEffect(OpenGLEffect& effect);
+
+    //Feeds the frame's times to the governor and requests the scaled size if it changed its mind
+    void updateResolution();
+    unsigned int getScaledSize(unsigned int size) const;
+
+    void drawTriangle();
+    void drawEffect(const OpenGLEffect& effect);
+    void drawOverlay();
+
+    virtual void initializeScheduler();
 
     void swapSurfaceBuffers();
 
+    //The context is left current after a frame, so the next one usually skips the switch; stop() releases it
     bool makeContextCurrent();
     void doneContextCurrent();
 
-    //Sync timer
-    QTimer* syncTimer;
+    //Deadline based frame pacing
+    OpenGLFrameScheduler* frameScheduler;
 
     QSurfaceFormat openGLFormat;
     QOpenGLContext* openGLContext;
 
-    //For rendering a debug triangle
-    GLuint depthrenderbuffer;
+    //Output ring; the producer renders frame N+1 into a free slot while displays still sample frame N
+    OpenGLOutputRing outputRing;
+
+    //Number of frames rendered so far
+    unsigned long long frameIndex;
+
+    //Optional asynchronous readback stage
+    bool readbackEnabled;
+    OpenGLFrameReader* frameReader;
+
+    //Offline renders; frames are written relative to the first one
+    bool offlineRendering;
+    unsigned long long offlineFirstFrame;
+    OpenGLFrameWriter* frameWriter;
+
+    //Passes of a frame; the current output slot is imported as "output"
+    OpenGLRenderGraph renderGraph;
+    bool renderGraphDirty;
 
+    std::vector<OpenGLEffect> effects;
+    GLuint effectVboID;
+
+    //Uniform blocks and dynamic data, fenced per frame
+    OpenGLStreamBuffer streamBuffer;
+
+    //Instanced overlay quads
+    OpenGLQuadBatch quadBatch;
+    std::function<void(OpenGLQuadBatch&)> overlay;
+
+    //For rendering a debug triangle
     GLint trianglePositionAttributeLocation;
     GLint triangleColorAttributeLocation;
     GLint triangleMatrixUniformLocation;
 
     float triangleAngle;
+
+    //Dynamic resolution; the nominal size is what was asked for, the render specs hold the scaled one
+    bool dynamicResolution;
+    OpenGLResolutionGovernor resolutionGovernor;
+    unsigned int nominalWidth;
+    unsigned int nominalHeight;
+    unsigned long long governorGPUFrames;
+
+    //Tiled canvas; the tile matrix is applied on top of the projection while a tile is drawn
+    OpenGLVideoWall* videoWall;
+    bool videoWallDirty;
+    QMatrix4x4 tileMatrix;
+
+    //Fixed timestep animation; 0 steps once per tick
+    double fixedTimestep;
+    unsigned long long animationFrame;
+
+    //Last matrix uploaded; the upload is skipped while it is unchanged
+    QMatrix4x4 triangleMatrix;
+    bool triangleMatrixValid;
 };
 
 #endif // OPENGLRENDERSURFACE_H
@@ -0,0 +1,177 @@
+#include "openglresolutiongovernor.h"
+
+#include <algorithm>
+
+//Weight of a new frame in the moving averages; about the last ten frames count
+static const double smoothing = 0.1;
+
+OpenGLResolutionGovernor::OpenGLResolutionGovernor(const std::vector<double> &scaleSteps) :
+    scales(scaleSteps),
+    step(0),
+    frameBudget(1000.0 / 60.0),
+    highThreshold(0.95),
+    lowThreshold(0.75),
+    downDelay(4),
+    upDelay(60),
+    cooldownDelay(30),
+    cpuTime(-1.0),
+    gpuTime(-1.0),
+    framesOver(0),
+    framesUnder(0),
+    cooldown(0),
+    numFrames(0),
+    numFramesOverBudget(0),
+    numScaleDowns(0),
+    numScaleUps(0),
+    scaleSum(0.0)
+{
+    if(scales.empty())
+        scales.push_back(1.0);
+
+    std::sort(scales.begin(), scales.end(), [](double a, double b) { return a > b; });
+}
+
+OpenGLResolutionGovernor::~OpenGLResolutionGovernor()
+{
+
+}
+
+void OpenGLResolutionGovernor::setFrameBudget(double milliseconds)
+{
+    if(milliseconds > 0.0)
+        frameBudget = milliseconds;
+}
+
+double OpenGLResolutionGovernor::getFrameBudget() const
+{
+    return frameBudget;
+}
+
+void OpenGLResolutionGovernor::setThresholds(double high, double low)
+{
+    highThreshold = high;
+    lowThreshold = std::min(low, high);
+}
+
+void OpenGLResolutionGovernor::setDelays(unsigned int downFrames, unsigned int upFrames, unsigned int cooldownFrames)
+{
+    downDelay = std::max(downFrames, 1u);
+    upDelay = std::max(upFrames, 1u);
+    cooldownDelay = cooldownFrames;
+}
+
+bool OpenGLResolutionGovernor::addFrame(double frameCPUTime, double frameGPUTime)
+{
+    cpuTime = (cpuTime < 0.0) ? frameCPUTime : cpuTime + smoothing * (frameCPUTime - cpuTime);
+
+    if(frameGPUTime >= 0.0)
+        gpuTime = (gpuTime < 0.0) ? frameGPUTime : gpuTime + smoothing * (frameGPUTime - gpuTime);
+
+    double frameTime = predictFrameTime(step);
+
+    numFrames++;
+    scaleSum += scales[step];
+
+    bool overBudget = frameTime > frameBudget * highThreshold;
+    if(overBudget)
+        numFramesOverBudget++;
+
+    framesOver = overBudget ? framesOver + 1 : 0;
+    framesUnder = (step > 0 && predictFrameTime(step - 1) < frameBudget * lowThreshold) ? framesUnder + 1 : 0;
+
+    if(cooldown > 0)
+    {
+        cooldown--;
+        return false;
+    }
+
+    if(framesOver >= downDelay && step + 1 < scales.size())
+    {
+        //Go straight to the largest step predicted to land between the thresholds rather than creeping down
+        double target = frameBudget * (highThreshold + lowThreshold) / 2.0;
+
+        unsigned int targetStep = step + 1;
+        while(targetStep + 1 < scales.size() && predictFrameTime(targetStep) > target)
+            targetStep++;
+
+        numScaleDowns++;
+        setStep(targetStep);
+
+        return true;
+    }
+
+    if(framesUnder >= upDelay)
+    {
+        numScaleUps++;
+        setStep(step - 1);
+
+        return true;
+    }
+
+    return false;
+}
+
+double OpenGLResolutionGovernor::getScale() const
+{
+    return scales[step];
+}
+
+unsigned int OpenGLResolutionGovernor::getStep() const
+{
+    return step;
+}
+
+void OpenGLResolutionGovernor::reset()
+{
+    step = 0;
+
+    cpuTime = -1.0;
+    gpuTime = -1.0;
+
+    framesOver = 0;
+    framesUnder = 0;
+    cooldown = 0;
+}
+
+OpenGLResolutionGovernor::OpenGLResolutionGovernorStats OpenGLResolutionGovernor::getStats() const
+{
+    return OpenGLResolutionGovernorStats{numFrames,
+                                         numFramesOverBudget,
+                                         numScaleDowns,
+                                         numScaleUps,
+                                         std::max(cpuTime, 0.0),
+                                         std::max(gpuTime, 0.0),
+                                         scales[step],
+                                         (numFrames > 0) ? scaleSum / numFrames : scales[step]};
+}
+
+void OpenGLResolutionGovernor::resetStats()
+{
+    numFrames = 0;
+    numFramesOverBudget = 0;
+    numScaleDowns = 0;
+    numScaleUps = 0;
+    scaleSum = 0.0;
+}
+
+double OpenGLResolutionGovernor::predictFrameTime(unsigned int targetStep) const
+{
+    double ratio = scales[targetStep] / scales[step];
+
+    //The CPU and GPU work on different frames, so the slower of the two sets the pace
+    return std::max(std::max(cpuTime, 0.0), std::max(gpuTime, 0.0) * ratio * ratio);
+}
+
+void OpenGLResolutionGovernor::setStep(unsigned int targetStep)
+{
+    //Carry the GPU estimate over to the new size until frames at that size have been measured
+    double ratio = scales[targetStep] / scales[step];
+    if(gpuTime > 0.0)
+        gpuTime *= ratio * ratio;
+
+    step = targetStep;
+
+    framesOver = 0;
+    framesUnder = 0;
+    cooldown = cooldownDelay;
+}
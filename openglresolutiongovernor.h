@@ -0,0 +1,94 @@
+#ifndef OPENGLRESOLUTIONGOVERNOR_H
+#define OPENGLRESOLUTIONGOVERNOR_H
+
+#include <vector>
+
+//Picks a render scale from measured frame times so a producer holds its frame rate on a slower GPU. GPU time is assumed
+//to follow the pixel count and CPU time to stay put, which predicts the cost of every step. The scale drops as soon as
+//the frame has been over budget for a few frames and only rises one step at a time, after a long stretch in which the
+//next step up is predicted to fit comfortably; every change is followed by a cooldown. The gap between the two
+//thresholds and the delays keep it from oscillating
+class OpenGLResolutionGovernor
+{
+public:
+    //Totals since construction / the last reset; times are in milliseconds
+    typedef struct OpenGLResolutionGovernorStats
+    {
+        unsigned long long frames;
+        unsigned long long framesOverBudget;
+
+        unsigned long long scaleDowns;
+        unsigned long long scaleUps;
+
+        //Smoothed times and the scale they were measured at
+        double cpuFrameTime;
+        double gpuFrameTime;
+        double scale;
+
+        //Mean scale over the frames, i.e. how much resolution was given up
+        double meanScale;
+    }
+    OpenGLResolutionGovernorStats;
+
+    //Scales from largest to smallest; the first is used when nothing is over budget
+    OpenGLResolutionGovernor(const std::vector<double>& scaleSteps = std::vector<double>{1.0, 0.875, 0.75, 0.625, 0.5});
+
+    virtual ~OpenGLResolutionGovernor();
+
+    //Time a frame may take, usually 1000 / fps
+    void setFrameBudget(double milliseconds);
+    double getFrameBudget() const;
+
+    //Fractions of the budget: above high scales down, predicted below low for the next step up scales up
+    void setThresholds(double high, double low);
+
+    //Frames over budget before scaling down, frames under the low threshold before scaling up, frames after any change
+    //before the next one
+    void setDelays(unsigned int downFrames, unsigned int upFrames, unsigned int cooldownFrames);
+
+    //Adds one frame; gpuTime < 0 if no new GPU measurement is available. Returns true if the scale changed
+    bool addFrame(double cpuTime, double gpuTime);
+
+    double getScale() const;
+    unsigned int getStep() const;
+
+    //Back to the largest scale with nothing measured
+    void reset();
+
+    OpenGLResolutionGovernorStats getStats() const;
+    void resetStats();
+
+protected:
+    //Predicted frame time at a step, from the smoothed times at the current one
+    double predictFrameTime(unsigned int targetStep) const;
+
+    void setStep(unsigned int targetStep);
+
+    std::vector<double> scales;
+    unsigned int step;
+
+    double frameBudget;
+    double highThreshold;
+    double lowThreshold;
+
+    unsigned int downDelay;
+    unsigned int upDelay;
+    unsigned int cooldownDelay;
+
+    //Exponential moving averages; a negative GPU time means none has been measured yet
+    double cpuTime;
+    double gpuTime;
+
+    unsigned int framesOver;
+    unsigned int framesUnder;
+    unsigned int cooldown;
+
+    //Stats
+    unsigned long long numFrames;
+    unsigned long long numFramesOverBudget;
+    unsigned long long numScaleDowns;
+    unsigned long long numScaleUps;
+    double scaleSum;
+};
+
+#endif // OPENGLRESOLUTIONGOVERNOR_H
@@ -0,0 +1,317 @@
+#include "openglstatecache.h"
+
+#include <openglnativebackend.h>
+
+//Native context last made current on this thread through a cache, null once a Qt make-current replaced it. Qt does not
+//see native make-current calls, so QOpenGLContext::currentContext can name a context that is no longer bound
+static thread_local OpenGLNativeBackend* nativeCurrentBackend = nullptr;
+
+OpenGLStateCache::OpenGLStateCache() :
+    initialized(false),
+    drawFramebuffer(unknownName),
+    readFramebuffer(unknownName),
+    vertexArray(unknownName),
+    program(unknownName),
+    activeUnit(unknownName),
+    viewportKnown(false),
+    viewportRect{0,0,0,0},
+    stats{0,0,0,0,0}
+{
+    forgetTextures();
+
+    for(unsigned int i = 0; i < numCapabilities; i++)
+        capabilities[i] = -1;
+}
+
+OpenGLStateCache::~OpenGLStateCache()
+{
+
+}
+
+void OpenGLStateCache::initialize()
+{
+    if(initialized)
+        return;
+
+    initializeOpenGLFunctions();
+
+    initialized = true;
+}
+
+void OpenGLStateCache::invalidate()
+{
+    drawFramebuffer = unknownName;
+    readFramebuffer = unknownName;
+    vertexArray = unknownName;
+    program = unknownName;
+    activeUnit = unknownName;
+
+    forgetTextures();
+
+    viewportKnown = false;
+
+    for(unsigned int i = 0; i < numCapabilities; i++)
+        capabilities[i] = -1;
+}
+
+void OpenGLStateCache::beginFrame()
+{
+    forgetTextures();
+
+    stats.frames++;
+}
+
+bool OpenGLStateCache::makeCurrent(QOpenGLContext *context, QSurface *surface)
+{
+    if(!nativeCurrentBackend && QOpenGLContext::currentContext() == context && context->surface() == surface)
+    {
+        stats.elidedContextSwitches++;
+        return true;
+    }
+
+    stats.contextSwitches++;
+
+    if(!context->makeCurrent(surface))
+        return false;
+
+    nativeCurrentBackend = nullptr;
+
+    return true;
+}
+
+bool OpenGLStateCache::makeCurrent(OpenGLNativeBackend *backend)
+{
+    if(backend->isContextCurrent())
+    {
+        stats.elidedContextSwitches++;
+        nativeCurrentBackend = backend;
+        return true;
+    }
+
+    stats.contextSwitches++;
+
+    //Whatever was bound before is gone even if this fails
+    nativeCurrentBackend = backend;
+
+    return backend->makeContextCurrent();
+}
+
+void OpenGLStateCache::doneCurrent(OpenGLNativeBackend *backend)
+{
+    backend->doneContextCurrent();
+
+    if(nativeCurrentBackend == backend)
+        nativeCurrentBackend = nullptr;
+}
+
+void OpenGLStateCache::doneCurrent(QOpenGLContext *context)
+{
+    //The bindings stay with the context, so the cache is still valid the next time it is made current
+    if(QOpenGLContext::currentContext() == context)
+    {
+        //Releases whatever is bound on the thread, native contexts included
+        context->doneCurrent();
+        nativeCurrentBackend = nullptr;
+    }
+}
+
+void OpenGLStateCache::bindFramebuffer(GLenum target, GLuint framebuffer)
+{
+    bool draw = (target == GL_FRAMEBUFFER || target == GL_DRAW_FRAMEBUFFER);
+    bool read = (target == GL_FRAMEBUFFER || target == GL_READ_FRAMEBUFFER);
+
+    if((!draw || drawFramebuffer == framebuffer) && (!read || readFramebuffer == framebuffer))
+    {
+        stats.elidedCalls++;
+        return;
+    }
+
+    stats.issuedCalls++;
+    glBindFramebuffer(target, framebuffer);
+
+    if(draw)
+        drawFramebuffer = framebuffer;
+    if(read)
+        readFramebuffer = framebuffer;
+}
+
+void OpenGLStateCache::bindVertexArray(GLuint array)
+{
+    if(vertexArray == array)
+    {
+        stats.elidedCalls++;
+        return;
+    }
+
+    stats.issuedCalls++;
+    glBindVertexArray(array);
+
+    vertexArray = array;
+}
+
+void OpenGLStateCache::useProgram(GLuint program)
+{
+    if(this->program == program)
+    {
+        stats.elidedCalls++;
+        return;
+    }
+
+    stats.issuedCalls++;
+    glUseProgram(program);
+
+    this->program = program;
+}
+
+void OpenGLStateCache::activeTexture(GLenum unit)
+{
+    if(activeUnit == unit - GL_TEXTURE0)
+    {
+        stats.elidedCalls++;
+        return;
+    }
+
+    stats.issuedCalls++;
+    glActiveTexture(unit);
+
+    activeUnit = unit - GL_TEXTURE0;
+}
+
+void OpenGLStateCache::bindTexture(GLenum target, GLuint texture)
+{
+    bool tracked = (target == GL_TEXTURE_2D && activeUnit < maxTextureUnits);
+
+    if(tracked && boundTextures[activeUnit] == texture)
+    {
+        stats.elidedCalls++;
+        return;
+    }
+
+    stats.issuedCalls++;
+    glBindTexture(target, texture);
+
+    if(tracked)
+        boundTextures[activeUnit] = texture;
+}
+
+void OpenGLStateCache::viewport(GLint x, GLint y, GLsizei width, GLsizei height)
+{
+    if(viewportKnown &&
+            viewportRect[0] == x && viewportRect[1] == y &&
+            viewportRect[2] == width && viewportRect[3] == height)
+    {
+        stats.elidedCalls++;
+        return;
+    }
+
+    stats.issuedCalls++;
+    glViewport(x, y, width, height);
+
+    viewportKnown = true;
+    viewportRect[0] = x;
+    viewportRect[1] = y;
+    viewportRect[2] = width;
+    viewportRect[3] = height;
+}
+
+void OpenGLStateCache::enable(GLenum capability)
+{
+    setCapability(capability, true);
+}
+
+void OpenGLStateCache::disable(GLenum capability)
+{
+    setCapability(capability, false);
+}
+
+void OpenGLStateCache::deleteFramebuffers(GLsizei n, const GLuint *framebuffers)
+{
+    for(GLsizei i = 0; i < n; i++)
+    {
+        if(drawFramebuffer == framebuffers[i])
+            drawFramebuffer = 0;
+        if(readFramebuffer == framebuffers[i])
+            readFramebuffer = 0;
+    }
+
+    glDeleteFramebuffers(n, framebuffers);
+}
+
+void OpenGLStateCache::deleteVertexArrays(GLsizei n, const GLuint *arrays)
+{
+    for(GLsizei i = 0; i < n; i++)
+    {
+        if(vertexArray == arrays[i])
+            vertexArray = 0;
+    }
+
+    glDeleteVertexArrays(n, arrays);
+}
+
+void OpenGLStateCache::deleteTextures(GLsizei n, const GLuint *textures)
+{
+    for(GLsizei i = 0; i < n; i++)
+    {
+        for(unsigned int unit = 0; unit < maxTextureUnits; unit++)
+        {
+            if(boundTextures[unit] == textures[i])
+                boundTextures[unit] = 0;
+        }
+    }
+
+    glDeleteTextures(n, textures);
+}
+
+OpenGLStateCache::OpenGLStateCacheStats OpenGLStateCache::getStats() const
+{
+    return stats;
+}
+
+void OpenGLStateCache::resetStats()
+{
+    stats = OpenGLStateCacheStats{0,0,0,0,0};
+}
+
+int OpenGLStateCache::getCapabilityIndex(GLenum capability)
+{
+    switch(capability)
+    {
+        case GL_DEPTH_TEST:
+            return 0;
+        case GL_BLEND:
+            return 1;
+        case GL_SCISSOR_TEST:
+            return 2;
+        case GL_CULL_FACE:
+            return 3;
+        default:
+            return -1;
+    }
+}
+
+void OpenGLStateCache::setCapability(GLenum capability, bool enabled)
+{
+    int index = getCapabilityIndex(capability);
+
+    if(index >= 0 && capabilities[index] == (enabled ? 1 : 0))
+    {
+        stats.elidedCalls++;
+        return;
+    }
+
+    stats.issuedCalls++;
+
+    if(enabled)
+        glEnable(capability);
+    else
+        glDisable(capability);
+
+    if(index >= 0)
+        capabilities[index] = enabled ? 1 : 0;
+}
+
+void OpenGLStateCache::forgetTextures()
+{
+    for(unsigned int unit = 0; unit < maxTextureUnits; unit++)
+        boundTextures[unit] = unknownName;
+}
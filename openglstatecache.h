@@ -0,0 +1,102 @@
+#ifndef OPENGLSTATECACHE_H
+#define OPENGLSTATECACHE_H
+
+#include <QOpenGLContext>
+#include <QOpenGLExtraFunctions>
+#include <QSurface>
+
+class OpenGLNativeBackend;
+
+//Shadow copy of the bindings of one context (framebuffers, vertex array, program, texture units, viewport and a few
+//capabilities), so a call that would not change anything is never sent to the driver. Contexts do not share this state,
+//so every renderer keeps its own cache. Whatever changes a tracked binding behind the cache's back must call invalidate()
+class OpenGLStateCache : protected QOpenGLExtraFunctions
+{
+public:
+    typedef struct OpenGLStateCacheStats
+    {
+        unsigned long long frames;
+
+        //State calls sent to GL and dropped because GL already had that state
+        unsigned long long issuedCalls;
+        unsigned long long elidedCalls;
+
+        //Make-current calls sent and dropped because the context was still current on the thread
+        unsigned long long contextSwitches;
+        unsigned long long elidedContextSwitches;
+    }
+    OpenGLStateCacheStats;
+
+    OpenGLStateCache();
+
+    virtual ~OpenGLStateCache();
+
+    //Must be called with the context current
+    void initialize();
+
+    //Forgets every binding; the next call of each kind is sent
+    void invalidate();
+
+    //Counts a frame and forgets texture bindings: producers in other contexts delete and recreate textures under the same
+    //names, and a binding kept from the last frame would still point at the deleted texture
+    void beginFrame();
+
+    //The context is kept if it is still current on this thread with the same surface (native: the same drawable). A native
+    //make-current goes around Qt, so after one the next Qt make-current on the thread is always sent
+    bool makeCurrent(QOpenGLContext* context, QSurface* surface);
+    bool makeCurrent(OpenGLNativeBackend* backend);
+
+    //Releases the context if it is current on the calling thread, so another thread can make it current
+    void doneCurrent(QOpenGLContext* context);
+    void doneCurrent(OpenGLNativeBackend* backend);
+
+    //Cached counterparts of the GL calls. GL_FRAMEBUFFER sets both framebuffer bindings; only GL_TEXTURE_2D bindings and
+    //the capabilities the renderers toggle (depth test, blend, scissor test, face culling) are tracked, others go straight through
+    void bindFramebuffer(GLenum target, GLuint framebuffer);
+    void bindVertexArray(GLuint array);
+    void useProgram(GLuint program);
+    void activeTexture(GLenum unit);
+    void bindTexture(GLenum target, GLuint texture);
+    void viewport(GLint x, GLint y, GLsizei width, GLsizei height);
+    void enable(GLenum capability);
+    void disable(GLenum capability);
+
+    //GL unbinds deleted objects and hands their names out again; deleting through the cache keeps it in step
+    void deleteFramebuffers(GLsizei n, const GLuint* framebuffers);
+    void deleteVertexArrays(GLsizei n, const GLuint* arrays);
+    void deleteTextures(GLsizei n, const GLuint* textures);
+
+    OpenGLStateCacheStats getStats() const;
+    void resetStats();
+
+protected:
+    static const GLuint unknownName = 0xFFFFFFFFu;
+    static const unsigned int maxTextureUnits = 32;
+    static const unsigned int numCapabilities = 4;
+
+    static int getCapabilityIndex(GLenum capability);
+    void setCapability(GLenum capability, bool enabled);
+
+    void forgetTextures();
+
+    bool initialized;
+
+    GLuint drawFramebuffer;
+    GLuint readFramebuffer;
+    GLuint vertexArray;
+    GLuint program;
+
+    //Texture unit offset from GL_TEXTURE0, unknownName if not known
+    GLuint activeUnit;
+    GLuint boundTextures[maxTextureUnits];
+
+    bool viewportKnown;
+    GLint viewportRect[4];
+
+    //-1 unknown, 0 disabled, 1 enabled
+    int capabilities[numCapabilities];
+
+    OpenGLStateCacheStats stats;
+};
+
+#endif // OPENGLSTATECACHE_H
@@ -0,0 +1,351 @@
+#include "openglstreambuffer.h"
+
+#include <QOpenGLContext>
+
+#include <cstring>
+
+OpenGLStreamBuffer::OpenGLStreamBuffer(GLsizeiptr frameSize, unsigned int numFrames) :
+    initialized(false),
+    regionSize(frameSize),
+    bufferID(0),
+    mappedData(nullptr),
+    regions(std::max(numFrames,1u), OpenGLStreamRegion{0,nullptr,0}),
+    regionIndex(0),
+    regionUsed(0),
+    uniformAlignment(256),
+    frame(0),
+    generation(0),
+    bindings(),
+    persistentMappingRequested(true),
+    persistentMapping(false),
+    bufferStorage(nullptr),
+    stats{0,0,0,0,0,0,0,0,0}
+{
+
+}
+
+OpenGLStreamBuffer::~OpenGLStreamBuffer()
+{
+    if(bufferStorage)
+        delete bufferStorage;
+
+    bufferStorage = nullptr;
+}
+
+void OpenGLStreamBuffer::initialize()
+{
+    if(initialized)
+        return;
+
+    initializeOpenGLFunctions();
+
+    QOpenGLContext* context = QOpenGLContext::currentContext();
+
+    //Persistent mapping needs GL 4.4 or GL_ARB_buffer_storage; a 4.1 context falls back to orphaning
+    if(persistentMappingRequested && !bufferStorage && context->hasExtension(QByteArrayLiteral("GL_ARB_buffer_storage")))
+    {
+        bufferStorage = new QOpenGLExtension_ARB_buffer_storage();
+        if(!bufferStorage->initializeOpenGLFunctions())
+        {
+            delete bufferStorage;
+            bufferStorage = nullptr;
+        }
+    }
+
+    persistentMapping = persistentMappingRequested && bufferStorage;
+
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &uniformAlignment);
+    uniformAlignment = std::max(uniformAlignment, 1);
+
+    //Keep regions aligned so offsets within them only depend on the frame's own allocations
+    regionSize = ((regionSize + uniformAlignment - 1) / uniformAlignment) * uniformAlignment;
+
+    for(size_t i = 0; i < regions.size(); i++)
+        regions[i] = OpenGLStreamRegion{static_cast<GLintptr>(i * regionSize), nullptr, 0};
+
+    GLsizeiptr bufferSize = regionSize * regions.size();
+
+    //Bound to the copy target so array / uniform bindings of the caller are left alone
+    glGenBuffers(1, &bufferID);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, bufferID);
+
+    if(persistentMapping)
+    {
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+        bufferStorage->glBufferStorage(GL_COPY_WRITE_BUFFER, bufferSize, nullptr, flags);
+        mappedData = static_cast<unsigned char*>(glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, bufferSize, flags));
+    }
+    else
+    {
+        glBufferData(GL_COPY_WRITE_BUFFER, bufferSize, nullptr, GL_STREAM_DRAW);
+        mappedData = nullptr;
+    }
+
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    regionIndex = 0;
+    regionUsed = 0;
+
+    invalidateBindings();
+
+    initialized = true;
+}
+
+void OpenGLStreamBuffer::release()
+{
+    if(!initialized)
+        return;
+
+    if(mappedData)
+    {
+        glBindBuffer(GL_COPY_WRITE_BUFFER, bufferID);
+        glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    }
+
+    for(OpenGLStreamRegion& region : regions)
+    {
+        if(region.fence)
+            glDeleteSync(region.fence);
+
+        region.fence = nullptr;
+    }
+
+    glDeleteBuffers(1, &bufferID);
+
+    bufferID = 0;
+    mappedData = nullptr;
+
+    bindings.clear();
+
+    initialized = false;
+}
+
+bool OpenGLStreamBuffer::isInitialized() const
+{
+    return initialized;
+}
+
+void OpenGLStreamBuffer::setPersistentMapping(bool enabled)
+{
+    persistentMappingRequested = enabled;
+}
+
+bool OpenGLStreamBuffer::isPersistentlyMapped() const
+{
+    return persistentMapping;
+}
+
+GLuint OpenGLStreamBuffer::getBufferID() const
+{
+    return bufferID;
+}
+
+GLint OpenGLStreamBuffer::getUniformAlignment() const
+{
+    return uniformAlignment;
+}
+
+void OpenGLStreamBuffer::beginFrame()
+{
+    if(!initialized)
+        return;
+
+    frame++;
+    stats.frames++;
+
+    regionIndex = (regionIndex + 1) % regions.size();
+    regionUsed = 0;
+
+    OpenGLStreamRegion& region = regions[regionIndex];
+
+    if(!region.fence)
+        return;
+
+    GLenum status = glClientWaitSync(region.fence, 0, 0);
+    if(status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+    {
+        stats.ringWaits++;
+
+        //A persistent buffer cannot be respecified, so wait; otherwise hand the old storage to the driver and carry on
+        if(persistentMapping)
+            glClientWaitSync(region.fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+        else
+        {
+            orphan();
+            return;
+        }
+    }
+
+    glDeleteSync(region.fence);
+    region.fence = nullptr;
+}
+
+void OpenGLStreamBuffer::endFrame()
+{
+    if(!initialized)
+        return;
+
+    //Regions read this frame, including older ones whose ranges were reused, are fenced by it
+    for(OpenGLStreamRegion& region : regions)
+    {
+        if(region.lastFrame != frame)
+            continue;
+
+        if(region.fence)
+            glDeleteSync(region.fence);
+
+        region.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+}
+
+bool OpenGLStreamBuffer::allocate(const void *data, GLsizeiptr size, GLsizeiptr alignment, OpenGLStreamBuffer::OpenGLStreamAllocation &allocation)
+{
+    if(!initialized || size <= 0)
+        return false;
+
+    alignment = std::max(alignment, static_cast<GLsizeiptr>(1));
+
+    GLintptr offset = ((regionUsed + alignment - 1) / alignment) * alignment;
+
+    if(offset + size > regionSize)
+    {
+        stats.overflows++;
+        return false;
+    }
+
+    OpenGLStreamRegion& region = regions[regionIndex];
+
+    if(persistentMapping)
+    {
+        //Coherent mapping; beginFrame made sure the GPU is done with this region
+        std::memcpy(mappedData + region.offset + offset, data, size);
+    }
+    else
+    {
+        //Likewise fenced (or orphaned), so skip the driver's own synchronization
+        glBindBuffer(GL_COPY_WRITE_BUFFER, bufferID);
+
+        void* mappedRange = glMapBufferRange(GL_COPY_WRITE_BUFFER, region.offset + offset, size,
+                                             GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+        if(mappedRange)
+        {
+            std::memcpy(mappedRange, data, size);
+            glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+        }
+
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+        if(!mappedRange)
+            return false;
+    }
+
+    regionUsed = offset + size;
+    region.lastFrame = frame;
+
+    allocation = OpenGLStreamAllocation{bufferID, region.offset + offset, size};
+
+    stats.allocations++;
+    stats.uploadedBytes += size;
+
+    return true;
+}
+
+void OpenGLStreamBuffer::bindUniformBlock(GLuint bindingPoint, const OpenGLStreamBuffer::OpenGLStreamAllocation &allocation)
+{
+    if(bindingPoint >= bindings.size())
+        bindings.resize(bindingPoint + 1, OpenGLStreamBinding{OpenGLStreamAllocation{0,0,0}, false, std::vector<unsigned char>(), 0, 0});
+
+    OpenGLStreamBinding& binding = bindings[bindingPoint];
+
+    if(binding.bound &&
+       binding.allocation.bufferID == allocation.bufferID &&
+       binding.allocation.offset == allocation.offset &&
+       binding.allocation.size == allocation.size)
+    {
+        stats.elidedBindings++;
+        return;
+    }
+
+    glBindBufferRange(GL_UNIFORM_BUFFER, bindingPoint, allocation.bufferID, allocation.offset, allocation.size);
+
+    binding.allocation = allocation;
+    binding.bound = true;
+
+    stats.bindings++;
+}
+
+bool OpenGLStreamBuffer::setUniformBlock(GLuint bindingPoint, const void *data, GLsizeiptr size)
+{
+    if(bindingPoint < bindings.size())
+    {
+        const OpenGLStreamBinding& binding = bindings[bindingPoint];
+
+        //The range stays valid until its region comes round again or the buffer is orphaned
+        if(binding.generation == generation &&
+           frame - binding.frame + 1 < regions.size() &&
+           binding.data.size() == static_cast<size_t>(size) &&
+           std::memcmp(binding.data.data(), data, size) == 0)
+        {
+            stats.elidedUploads++;
+
+            regions[binding.allocation.offset / regionSize].lastFrame = frame;
+            bindUniformBlock(bindingPoint, binding.allocation);
+            return true;
+        }
+    }
+
+    OpenGLStreamAllocation allocation;
+    if(!allocate(data, size, uniformAlignment, allocation))
+        return false;
+
+    bindUniformBlock(bindingPoint, allocation);
+
+    OpenGLStreamBinding& binding = bindings[bindingPoint];
+
+    binding.data.assign(static_cast<const unsigned char*>(data), static_cast<const unsigned char*>(data) + size);
+    binding.frame = frame;
+    binding.generation = generation;
+
+    return true;
+}
+
+void OpenGLStreamBuffer::invalidateBindings()
+{
+    for(OpenGLStreamBinding& binding : bindings)
+    {
+        binding.bound = false;
+        binding.data.clear();
+    }
+}
+
+OpenGLStreamBuffer::OpenGLStreamBufferStats OpenGLStreamBuffer::getStats() const
+{
+    return stats;
+}
+
+void OpenGLStreamBuffer::resetStats()
+{
+    stats = OpenGLStreamBufferStats{0,0,0,0,0,0,0,0,0};
+}
+
+void OpenGLStreamBuffer::orphan()
+{
+    for(OpenGLStreamRegion& region : regions)
+    {
+        if(region.fence)
+            glDeleteSync(region.fence);
+
+        region.fence = nullptr;
+    }
+
+    glBindBuffer(GL_COPY_WRITE_BUFFER, bufferID);
+    glBufferData(GL_COPY_WRITE_BUFFER, regionSize * regions.size(), nullptr, GL_STREAM_DRAW);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    //Ranges bound from the old storage now read undefined data
+    generation++;
+
+    stats.orphans++;
+}
@@ -0,0 +1,143 @@
+#ifndef OPENGLSTREAMBUFFER_H
+#define OPENGLSTREAMBUFFER_H
+
+#include <QOpenGLExtraFunctions>
+
+#include <QtOpenGLExtensions/QOpenGLExtensions>
+
+#include <vector>
+
+//Per-frame ring allocator over one large buffer object for uniform blocks and dynamic vertex data. The buffer is split
+//into one region per frame in flight; each frame sub-allocates linearly from its region and fences it at endFrame. With
+//GL_ARB_buffer_storage the buffer stays persistently mapped and a region still in use is waited for; on plain GL 4.1 every
+//allocation is written through an unsynchronized map and a region still in use orphans the whole buffer instead.
+//Uniform block bindings are cached per binding point and setUniformBlock skips uploads whose contents have not changed
+class OpenGLStreamBuffer : protected QOpenGLExtraFunctions
+{
+public:
+    //Defines a range of the buffer written this frame
+    typedef struct OpenGLStreamAllocation
+    {
+        GLuint bufferID;
+        GLintptr offset;
+        GLsizeiptr size;
+    }
+    OpenGLStreamAllocation;
+
+    //Totals since the last resetStats
+    typedef struct OpenGLStreamBufferStats
+    {
+        unsigned long long frames;
+        unsigned long long allocations;
+        unsigned long long uploadedBytes;
+
+        //setUniformBlock calls whose data matched what the binding point already holds
+        unsigned long long elidedUploads;
+
+        unsigned long long bindings;
+        unsigned long long elidedBindings;
+
+        //Times a frame's region was still in use when it came round again; persistent buffers wait, others orphan
+        unsigned long long ringWaits;
+        unsigned long long orphans;
+
+        //Allocations that did not fit in the frame's region
+        unsigned long long overflows;
+    }
+    OpenGLStreamBufferStats;
+
+    OpenGLStreamBuffer(GLsizeiptr frameSize = 256*1024,
+                       unsigned int numFrames = 3);
+
+    virtual ~OpenGLStreamBuffer();
+
+    //Must be called with the target context current
+    void initialize();
+    void release();
+
+    bool isInitialized() const;
+
+    //Use persistent mapping when GL_ARB_buffer_storage is available (default); takes effect on the next initialize
+    void setPersistentMapping(bool enabled);
+    bool isPersistentlyMapped() const;
+
+    GLuint getBufferID() const;
+
+    //Offset alignment uniform block ranges need (GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT)
+    GLint getUniformAlignment() const;
+
+    //Moves to the next frame's region, waiting for or orphaning it if the GPU still reads it
+    void beginFrame();
+
+    //Fences everything allocated since beginFrame
+    void endFrame();
+
+    //Copies size bytes into the current frame's region; false if the region is full
+    bool allocate(const void* data, GLsizeiptr size, GLsizeiptr alignment, OpenGLStreamAllocation& allocation);
+
+    //Binds a range to a uniform block binding point unless that exact range is already bound there
+    void bindUniformBlock(GLuint bindingPoint, const OpenGLStreamAllocation& allocation);
+
+    //Uploads a uniform block and binds it; data identical to the binding point's last upload reuses that range for
+    //up to numFrames - 2 later frames, so a reused region is still at least two frames old when it comes round again
+    bool setUniformBlock(GLuint bindingPoint, const void* data, GLsizeiptr size);
+
+    //Forgets cached bindings, e.g. after other code bound uniform buffers
+    void invalidateBindings();
+
+    OpenGLStreamBufferStats getStats() const;
+    void resetStats();
+
+protected:
+    //Defines one frame's region of the ring; lastFrame is the last frame that read from it
+    typedef struct OpenGLStreamRegion
+    {
+        GLintptr offset;
+        GLsync fence;
+
+        unsigned long long lastFrame;
+    }
+    OpenGLStreamRegion;
+
+    //Last range bound and uploaded for a uniform block binding point
+    typedef struct OpenGLStreamBinding
+    {
+        OpenGLStreamAllocation allocation;
+        bool bound;
+
+        std::vector<unsigned char> data;
+        unsigned long long frame;
+        unsigned long long generation;
+    }
+    OpenGLStreamBinding;
+
+    //Drops the buffer's storage and all fences; nothing written before remains valid
+    void orphan();
+
+    bool initialized;
+
+    GLsizeiptr regionSize;
+
+    GLuint bufferID;
+    unsigned char* mappedData;
+
+    std::vector<OpenGLStreamRegion> regions;
+    unsigned int regionIndex;
+    GLintptr regionUsed;
+
+    GLint uniformAlignment;
+
+    //Frames begun so far and orphans so far; cached uploads are valid only within both
+    unsigned long long frame;
+    unsigned long long generation;
+
+    std::vector<OpenGLStreamBinding> bindings;
+
+    bool persistentMappingRequested;
+    bool persistentMapping;
+    QOpenGLExtension_ARB_buffer_storage* bufferStorage;
+
+    OpenGLStreamBufferStats stats;
+};
+
+#endif // OPENGLSTREAMBUFFER_H
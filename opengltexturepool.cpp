@@ -0,0 +1,216 @@
+#include "opengltexturepool.h"
+
+#include <algorithm>
+
+OpenGLTexturePool::OpenGLTexturePool(unsigned int maxIdleFrames) :
+    initialized(false),
+    stateCache(nullptr),
+    maxIdle(maxIdleFrames),
+    stats{0,0,0,0,0,0,0}
+{
+
+}
+
+OpenGLTexturePool::~OpenGLTexturePool()
+{
+
+}
+
+void OpenGLTexturePool::initialize()
+{
+    if(initialized)
+        return;
+
+    initializeOpenGLFunctions();
+
+    initialized = true;
+}
+
+void OpenGLTexturePool::setStateCache(OpenGLStateCache *cache)
+{
+    stateCache = cache;
+}
+
+OpenGLTexturePool::OpenGLPooledTexture OpenGLTexturePool::acquire(unsigned int width, unsigned int height, GLint internalFormat, GLenum target)
+{
+    assert(initialized && stateCache);
+
+    OpenGLPoolKey key{std::max(width,1u),std::max(height,1u),target,internalFormat};
+
+    for(OpenGLPoolEntry& entry : entries)
+    {
+        if(!entry.inUse && sameKey(entry.texture.key, key))
+        {
+            entry.inUse = true;
+            entry.idleFrames = 0;
+
+            stats.hits++;
+            stats.freeTextures--;
+            stats.freeBytes -= textureBytes(key);
+
+            return entry.texture;
+        }
+    }
+
+    stats.misses++;
+
+    OpenGLPoolEntry entry{createTexture(key),true,0};
+    entries.push_back(entry);
+
+    stats.textures++;
+    stats.bytes += textureBytes(key);
+
+    return entry.texture;
+}
+
+void OpenGLTexturePool::release(const OpenGLTexturePool::OpenGLPooledTexture &texture)
+{
+    release(texture.textureID);
+}
+
+void OpenGLTexturePool::release(GLuint textureID)
+{
+    for(OpenGLPoolEntry& entry : entries)
+    {
+        if(entry.inUse && entry.texture.textureID == textureID)
+        {
+            entry.inUse = false;
+            entry.idleFrames = 0;
+
+            stats.freeTextures++;
+            stats.freeBytes += textureBytes(entry.texture.key);
+            return;
+        }
+    }
+}
+
+void OpenGLTexturePool::endFrame()
+{
+    for(auto it = entries.begin(); it != entries.end();)
+    {
+        if(!it->inUse && ++it->idleFrames > maxIdle)
+        {
+            size_t bytes = textureBytes(it->texture.key);
+
+            stats.evictions++;
+            stats.textures--;
+            stats.freeTextures--;
+            stats.bytes -= bytes;
+            stats.freeBytes -= bytes;
+
+            deleteTexture(it->texture);
+            it = entries.erase(it);
+        }
+        else
+            it++;
+    }
+}
+
+void OpenGLTexturePool::trim()
+{
+    for(auto it = entries.begin(); it != entries.end();)
+    {
+        if(!it->inUse)
+        {
+            size_t bytes = textureBytes(it->texture.key);
+
+            stats.textures--;
+            stats.freeTextures--;
+            stats.bytes -= bytes;
+            stats.freeBytes -= bytes;
+
+            deleteTexture(it->texture);
+            it = entries.erase(it);
+        }
+        else
+            it++;
+    }
+}
+
+OpenGLTexturePool::OpenGLTexturePoolStats OpenGLTexturePool::getStats() const
+{
+    return stats;
+}
+
+bool OpenGLTexturePool::sameKey(const OpenGLTexturePool::OpenGLPoolKey &a, const OpenGLTexturePool::OpenGLPoolKey &b)
+{
+    return a.width == b.width &&
+           a.height == b.height &&
+           a.target == b.target &&
+           a.internalFormat == b.internalFormat;
+}
+
+size_t OpenGLTexturePool::textureBytes(const OpenGLTexturePool::OpenGLPoolKey &key)
+{
+    //Close enough for the formats the pipeline uses
+    size_t bytesPerPixel = 4;
+    switch(key.internalFormat)
+    {
+        case GL_R8:
+            bytesPerPixel = 1;
+            break;
+        case GL_RG8:
+        case GL_R16F:
+            bytesPerPixel = 2;
+            break;
+        case GL_RGBA16F:
+        case GL_RG32F:
+            bytesPerPixel = 8;
+            break;
+        case GL_RGBA32F:
+            bytesPerPixel = 16;
+            break;
+        default:
+            break;
+    }
+
+    return static_cast<size_t>(key.width) * key.height * bytesPerPixel;
+}
+
+OpenGLTexturePool::OpenGLPooledTexture OpenGLTexturePool::createTexture(const OpenGLTexturePool::OpenGLPoolKey &key)
+{
+    OpenGLPooledTexture texture{0,0,key};
+
+    glGenTextures(1, &texture.textureID);
+    stateCache->bindTexture(key.target, texture.textureID);
+
+    glTexParameteri(key.target, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(key.target, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(key.target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(key.target, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+
+    glTexStorage2D(key.target, 1, key.internalFormat, key.width, key.height);
+
+    stateCache->bindTexture(key.target, 0);
+
+    bool depth = (key.internalFormat == GL_DEPTH_COMPONENT16 ||
+                  key.internalFormat == GL_DEPTH_COMPONENT24 ||
+                  key.internalFormat == GL_DEPTH_COMPONENT32F);
+    bool depthStencil = (key.internalFormat == GL_DEPTH24_STENCIL8 ||
+                         key.internalFormat == GL_DEPTH32F_STENCIL8);
+
+    glGenFramebuffers(1, &texture.fboID);
+    stateCache->bindFramebuffer(GL_FRAMEBUFFER, texture.fboID);
+
+    GLenum attachment = depthStencil ? GL_DEPTH_STENCIL_ATTACHMENT : (depth ? GL_DEPTH_ATTACHMENT : GL_COLOR_ATTACHMENT0);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, attachment, key.target, texture.textureID, 0);
+
+    if(depth || depthStencil)
+    {
+        GLenum none = GL_NONE;
+        glDrawBuffers(1, &none);
+        glReadBuffer(GL_NONE);
+    }
+
+    assert(glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE);
+
+    stateCache->bindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    return texture;
+}
+
+void OpenGLTexturePool::deleteTexture(const OpenGLTexturePool::OpenGLPooledTexture &texture)
+{
+    stateCache->deleteFramebuffers(1, &texture.fboID);
+    stateCache->deleteTextures(1, &texture.textureID);
+}
@@ -0,0 +1,99 @@
+#ifndef OPENGLTEXTUREPOOL_H
+#define OPENGLTEXTUREPOOL_H
+
+#include <openglstatecache.h>
+
+#include <QOpenGLExtraFunctions>
+
+#include <vector>
+
+//Recycles immutable (glTexStorage2D) textures and their framebuffers, keyed by size, target and internal format.
+//Framebuffers are not shared between contexts, so every renderer keeps its own pool
+class OpenGLTexturePool : protected QOpenGLExtraFunctions
+{
+public:
+    //Texture specs as used by OpenGLRenderer::OpenGLTextureSpecs; only the storage relevant fields are kept
+    typedef struct OpenGLPoolKey
+    {
+        unsigned int width;
+        unsigned int height;
+
+        GLenum target;
+        GLint internalFormat;
+    }
+    OpenGLPoolKey;
+
+    typedef struct OpenGLPooledTexture
+    {
+        GLuint textureID;
+        GLuint fboID;
+
+        OpenGLPoolKey key;
+    }
+    OpenGLPooledTexture;
+
+    typedef struct OpenGLTexturePoolStats
+    {
+        unsigned long long hits;
+        unsigned long long misses;
+        unsigned long long evictions;
+
+        unsigned int textures;
+        unsigned int freeTextures;
+
+        size_t bytes;
+        size_t freeBytes;
+    }
+    OpenGLTexturePoolStats;
+
+    //Free textures unused for maxIdleFrames calls to endFrame are deleted
+    OpenGLTexturePool(unsigned int maxIdleFrames = 120);
+
+    virtual ~OpenGLTexturePool();
+
+    //Must be called with the context current
+    void initialize();
+
+    //Binds and deletes go through the owning renderer's state cache
+    void setStateCache(OpenGLStateCache* cache);
+
+    //Contents of a recycled texture are undefined; the framebuffer has the texture on colour (or depth) attachment 0
+    OpenGLPooledTexture acquire(unsigned int width, unsigned int height, GLint internalFormat, GLenum target = GL_TEXTURE_2D);
+    void release(const OpenGLPooledTexture& texture);
+    void release(GLuint textureID);
+
+    //Ages free textures and evicts the stale ones
+    void endFrame();
+
+    //Deletes every free texture
+    void trim();
+
+    OpenGLTexturePoolStats getStats() const;
+
+protected:
+    typedef struct OpenGLPoolEntry
+    {
+        OpenGLPooledTexture texture;
+
+        bool inUse;
+        unsigned int idleFrames;
+    }
+    OpenGLPoolEntry;
+
+    static bool sameKey(const OpenGLPoolKey& a, const OpenGLPoolKey& b);
+    static size_t textureBytes(const OpenGLPoolKey& key);
+
+    OpenGLPooledTexture createTexture(const OpenGLPoolKey& key);
+    void deleteTexture(const OpenGLPooledTexture& texture);
+
+    bool initialized;
+
+    OpenGLStateCache* stateCache;
+
+    unsigned int maxIdle;
+    std::vector<OpenGLPoolEntry> entries;
+
+    OpenGLTexturePoolStats stats;
+};
+
+#endif // OPENGLTEXTUREPOOL_H
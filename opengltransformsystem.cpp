@@ -0,0 +1,455 @@
+#include "opengltransformsystem.h"
+
+#include <QRunnable>
+#include <QThread>
+
+#include <algorithm>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define OPENGLTRANSFORM_X86
+#endif
+
+#if defined(OPENGLTRANSFORM_X86) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define OPENGLTRANSFORM_SSE
+#include <emmintrin.h>
+#endif
+
+//The AVX path is compiled for its own function only and picked at runtime, so the build needs no -mavx
+#if defined(OPENGLTRANSFORM_SSE) && (defined(__GNUC__) || defined(__clang__) || defined(_MSC_VER))
+#define OPENGLTRANSFORM_AVX
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define OPENGLTRANSFORM_AVX_TARGET
+#else
+#define OPENGLTRANSFORM_AVX_TARGET __attribute__((target("avx")))
+#endif
+#endif
+
+//Range of objects updated on a pool thread
+class OpenGLTransformTask : public QRunnable
+{
+public:
+    OpenGLTransformTask(const OpenGLTransformSystem* system,
+                        unsigned int begin,
+                        unsigned int end,
+                        const float* viewProjection,
+                        float* destination) :
+        system(system),
+        begin(begin),
+        end(end),
+        viewProjection(viewProjection),
+        destination(destination)
+    {
+        setAutoDelete(true);
+    }
+
+    void run() override
+    {
+        system->updateRange(begin, end, viewProjection, destination);
+    }
+
+protected:
+    const OpenGLTransformSystem* system;
+
+    unsigned int begin;
+    unsigned int end;
+
+    const float* viewProjection;
+    float* destination;
+};
+
+OpenGLTransformSystem::OpenGLTransformSystem(unsigned int maxWorkers, unsigned int minObjectsPerTask) :
+    simdEnabled(true),
+    avxSupported(detectAVX()),
+    minTaskSize(minObjectsPerTask > 0 ? minObjectsPerTask : 1)
+{
+    int workers = (maxWorkers > 0) ? static_cast<int>(maxWorkers) : QThread::idealThreadCount();
+
+    //The calling thread works on one share itself
+    workerPool.setMaxThreadCount(workers > 1 ? workers - 1 : 1);
+}
+
+OpenGLTransformSystem::~OpenGLTransformSystem()
+{
+    workerPool.waitForDone();
+}
+
+bool OpenGLTransformSystem::detectAVX()
+{
+#if defined(OPENGLTRANSFORM_AVX)
+#if defined(_MSC_VER) && !defined(__clang__)
+    int info[4];
+
+    __cpuid(info, 1);
+    return (info[2] & (1 << 27)) && (info[2] & (1 << 28)) && ((_xgetbv(0) & 6) == 6);
+#else
+    return __builtin_cpu_supports("avx");
+#endif
+#else
+    return false;
+#endif
+}
+
+unsigned int OpenGLTransformSystem::add(float x, float y, float z,
+                                        float rx, float ry, float rz, float rw,
+                                        float sx, float sy, float sz)
+{
+    positionX.push_back(x);
+    positionY.push_back(y);
+    positionZ.push_back(z);
+
+    rotationX.push_back(rx);
+    rotationY.push_back(ry);
+    rotationZ.push_back(rz);
+    rotationW.push_back(rw);
+
+    scaleX.push_back(sx);
+    scaleY.push_back(sy);
+    scaleZ.push_back(sz);
+
+    return static_cast<unsigned int>(positionX.size() - 1);
+}
+
+void OpenGLTransformSystem::resize(unsigned int count)
+{
+    positionX.resize(count, 0.0f);
+    positionY.resize(count, 0.0f);
+    positionZ.resize(count, 0.0f);
+
+    rotationX.resize(count, 0.0f);
+    rotationY.resize(count, 0.0f);
+    rotationZ.resize(count, 0.0f);
+    rotationW.resize(count, 1.0f);
+
+    scaleX.resize(count, 1.0f);
+    scaleY.resize(count, 1.0f);
+    scaleZ.resize(count, 1.0f);
+}
+
+void OpenGLTransformSystem::clear()
+{
+    resize(0);
+}
+
+unsigned int OpenGLTransformSystem::size() const
+{
+    return static_cast<unsigned int>(positionX.size());
+}
+
+void OpenGLTransformSystem::setPosition(unsigned int index, float x, float y, float z)
+{
+    assert(index < size());
+
+    positionX[index] = x;
+    positionY[index] = y;
+    positionZ[index] = z;
+}
+
+void OpenGLTransformSystem::setRotation(unsigned int index, float x, float y, float z, float w)
+{
+    assert(index < size());
+
+    rotationX[index] = x;
+    rotationY[index] = y;
+    rotationZ[index] = z;
+    rotationW[index] = w;
+}
+
+void OpenGLTransformSystem::setScale(unsigned int index, float x, float y, float z)
+{
+    assert(index < size());
+
+    scaleX[index] = x;
+    scaleY[index] = y;
+    scaleZ[index] = z;
+}
+
+void OpenGLTransformSystem::setSimdEnabled(bool enabled)
+{
+    simdEnabled = enabled;
+}
+
+bool OpenGLTransformSystem::isSimdEnabled() const
+{
+    return simdEnabled;
+}
+
+const char* OpenGLTransformSystem::getSimdName() const
+{
+    if(!simdEnabled)
+        return "scalar";
+
+    if(avxSupported)
+        return "avx";
+
+#if defined(OPENGLTRANSFORM_SSE)
+    return "sse2";
+#else
+    return "scalar";
+#endif
+}
+
+unsigned int OpenGLTransformSystem::getWorkerCount() const
+{
+    return static_cast<unsigned int>(workerPool.maxThreadCount()) + 1;
+}
+
+void OpenGLTransformSystem::update(const QMatrix4x4& viewProjection, float* destination)
+{
+    unsigned int count = size();
+
+    if(count == 0)
+        return;
+
+    const float* vp = viewProjection.constData();
+
+    //Split into equal shares of at least minTaskSize objects, rounded to whole SIMD batches
+    unsigned int shares = std::min(getWorkerCount(), (count + minTaskSize - 1) / minTaskSize);
+    unsigned int shareSize = (((count + shares - 1) / shares) + 7) & ~7u;
+
+    unsigned int begin = 0;
+
+    while(count - begin > shareSize)
+    {
+        workerPool.start(new OpenGLTransformTask(this, begin, begin + shareSize, vp, destination));
+        begin += shareSize;
+    }
+
+    updateRange(begin, count, vp, destination);
+
+    workerPool.waitForDone();
+}
+
+bool OpenGLTransformSystem::updateBuffer(QOpenGLExtraFunctions* functions, GLenum target, GLuint bufferID, const QMatrix4x4& viewProjection)
+{
+    unsigned int count = size();
+
+    if(count == 0)
+        return true;
+
+    functions->glBindBuffer(target, bufferID);
+
+    //Every matrix is rewritten, so the driver need not preserve the old contents
+    float* destination = static_cast<float*>(functions->glMapBufferRange(target,
+                                                                         0,
+                                                                         static_cast<GLsizeiptr>(count)*16*sizeof(GLfloat),
+                                                                         GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT));
+    if(!destination)
+    {
+        functions->glBindBuffer(target, 0);
+        return false;
+    }
+
+    update(viewProjection, destination);
+
+    bool result = (functions->glUnmapBuffer(target) == GL_TRUE);
+
+    functions->glBindBuffer(target, 0);
+
+    return result;
+}
+
+void OpenGLTransformSystem::updateRange(unsigned int begin, unsigned int end, const float* viewProjection, float* destination) const
+{
+    if(simdEnabled)
+    {
+#if defined(OPENGLTRANSFORM_AVX)
+        if(avxSupported)
+        {
+            unsigned int simdEnd = begin + ((end - begin) & ~7u);
+            updateAVX(begin, simdEnd, viewProjection, destination);
+            begin = simdEnd;
+        }
+#endif
+#if defined(OPENGLTRANSFORM_SSE)
+        unsigned int sseEnd = begin + ((end - begin) & ~3u);
+        updateSSE(begin, sseEnd, viewProjection, destination);
+        begin = sseEnd;
+#endif
+    }
+
+    updateScalar(begin, end, viewProjection, destination);
+}
+
+void OpenGLTransformSystem::updateScalar(unsigned int begin, unsigned int end, const float* viewProjection, float* destination) const
+{
+    const float* vp = viewProjection;
+
+    for(unsigned int i = begin; i < end; i++)
+    {
+        float x = rotationX[i], y = rotationY[i], z = rotationZ[i], w = rotationW[i];
+
+        //Model matrix columns: rotation scaled per axis, then translation
+        float model[3][3] =
+        {
+            {(1.0f - 2.0f*(y*y + z*z))*scaleX[i], (2.0f*(x*y + z*w))*scaleX[i], (2.0f*(x*z - y*w))*scaleX[i]},
+            {(2.0f*(x*y - z*w))*scaleY[i], (1.0f - 2.0f*(x*x + z*z))*scaleY[i], (2.0f*(y*z + x*w))*scaleY[i]},
+            {(2.0f*(x*z + y*w))*scaleZ[i], (2.0f*(y*z - x*w))*scaleZ[i], (1.0f - 2.0f*(x*x + y*y))*scaleZ[i]}
+        };
+
+        float* out = destination + static_cast<size_t>(i)*16;
+
+        for(int column = 0; column < 3; column++)
+        {
+            for(int row = 0; row < 4; row++)
+            {
+                out[column*4 + row] = vp[row]*model[column][0] +
+                                      vp[4 + row]*model[column][1] +
+                                      vp[8 + row]*model[column][2];
+            }
+        }
+
+        for(int row = 0; row < 4; row++)
+        {
+            out[12 + row] = vp[row]*positionX[i] +
+                            vp[4 + row]*positionY[i] +
+                            vp[8 + row]*positionZ[i] +
+                            vp[12 + row];
+        }
+    }
+}
+
+#if defined(OPENGLTRANSFORM_SSE)
+void OpenGLTransformSystem::updateSSE(unsigned int begin, unsigned int end, const float* viewProjection, float* destination) const
+{
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 two = _mm_set1_ps(2.0f);
+
+    for(unsigned int i = begin; i < end; i += 4)
+    {
+        //Four objects per register, one transform component each
+        __m128 x = _mm_loadu_ps(&rotationX[i]);
+        __m128 y = _mm_loadu_ps(&rotationY[i]);
+        __m128 z = _mm_loadu_ps(&rotationZ[i]);
+        __m128 w = _mm_loadu_ps(&rotationW[i]);
+
+        __m128 sx = _mm_loadu_ps(&scaleX[i]);
+        __m128 sy = _mm_loadu_ps(&scaleY[i]);
+        __m128 sz = _mm_loadu_ps(&scaleZ[i]);
+
+        __m128 xx = _mm_mul_ps(x, x), yy = _mm_mul_ps(y, y), zz = _mm_mul_ps(z, z);
+        __m128 xy = _mm_mul_ps(x, y), xz = _mm_mul_ps(x, z), yz = _mm_mul_ps(y, z);
+        __m128 xw = _mm_mul_ps(x, w), yw = _mm_mul_ps(y, w), zw = _mm_mul_ps(z, w);
+
+        __m128 model[4][3];
+
+        model[0][0] = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(yy, zz))), sx);
+        model[0][1] = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xy, zw)), sx);
+        model[0][2] = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xz, yw)), sx);
+
+        model[1][0] = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xy, zw)), sy);
+        model[1][1] = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, zz))), sy);
+        model[1][2] = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(yz, xw)), sy);
+
+        model[2][0] = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xz, yw)), sz);
+        model[2][1] = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(yz, xw)), sz);
+        model[2][2] = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, yy))), sz);
+
+        model[3][0] = _mm_loadu_ps(&positionX[i]);
+        model[3][1] = _mm_loadu_ps(&positionY[i]);
+        model[3][2] = _mm_loadu_ps(&positionZ[i]);
+
+        float* out = destination + static_cast<size_t>(i)*16;
+
+        for(int column = 0; column < 4; column++)
+        {
+            __m128 rows[4];
+
+            for(int row = 0; row < 4; row++)
+            {
+                rows[row] = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(viewProjection[row]), model[column][0]),
+                                                  _mm_mul_ps(_mm_set1_ps(viewProjection[4 + row]), model[column][1])),
+                                       _mm_mul_ps(_mm_set1_ps(viewProjection[8 + row]), model[column][2]));
+
+                if(column == 3)
+                    rows[row] = _mm_add_ps(rows[row], _mm_set1_ps(viewProjection[12 + row]));
+            }
+
+            //Back from one element of four objects to one column of each object
+            _MM_TRANSPOSE4_PS(rows[0], rows[1], rows[2], rows[3]);
+
+            for(int object = 0; object < 4; object++)
+                _mm_storeu_ps(out + object*16 + column*4, rows[object]);
+        }
+    }
+}
+#endif
+
+#if defined(OPENGLTRANSFORM_AVX)
+OPENGLTRANSFORM_AVX_TARGET
+void OpenGLTransformSystem::updateAVX(unsigned int begin, unsigned int end, const float* viewProjection, float* destination) const
+{
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 two = _mm256_set1_ps(2.0f);
+
+    for(unsigned int i = begin; i < end; i += 8)
+    {
+        __m256 x = _mm256_loadu_ps(&rotationX[i]);
+        __m256 y = _mm256_loadu_ps(&rotationY[i]);
+        __m256 z = _mm256_loadu_ps(&rotationZ[i]);
+        __m256 w = _mm256_loadu_ps(&rotationW[i]);
+
+        __m256 sx = _mm256_loadu_ps(&scaleX[i]);
+        __m256 sy = _mm256_loadu_ps(&scaleY[i]);
+        __m256 sz = _mm256_loadu_ps(&scaleZ[i]);
+
+        __m256 xx = _mm256_mul_ps(x, x), yy = _mm256_mul_ps(y, y), zz = _mm256_mul_ps(z, z);
+        __m256 xy = _mm256_mul_ps(x, y), xz = _mm256_mul_ps(x, z), yz = _mm256_mul_ps(y, z);
+        __m256 xw = _mm256_mul_ps(x, w), yw = _mm256_mul_ps(y, w), zw = _mm256_mul_ps(z, w);
+
+        __m256 model[4][3];
+
+        model[0][0] = _mm256_mul_ps(_mm256_sub_ps(one, _mm256_mul_ps(two, _mm256_add_ps(yy, zz))), sx);
+        model[0][1] = _mm256_mul_ps(_mm256_mul_ps(two, _mm256_add_ps(xy, zw)), sx);
+        model[0][2] = _mm256_mul_ps(_mm256_mul_ps(two, _mm256_sub_ps(xz, yw)), sx);
+
+        model[1][0] = _mm256_mul_ps(_mm256_mul_ps(two, _mm256_sub_ps(xy, zw)), sy);
+        model[1][1] = _mm256_mul_ps(_mm256_sub_ps(one, _mm256_mul_ps(two, _mm256_add_ps(xx, zz))), sy);
+        model[1][2] = _mm256_mul_ps(_mm256_mul_ps(two, _mm256_add_ps(yz, xw)), sy);
+
+        model[2][0] = _mm256_mul_ps(_mm256_mul_ps(two, _mm256_add_ps(xz, yw)), sz);
+        model[2][1] = _mm256_mul_ps(_mm256_mul_ps(two, _mm256_sub_ps(yz, xw)), sz);
+        model[2][2] = _mm256_mul_ps(_mm256_sub_ps(one, _mm256_mul_ps(two, _mm256_add_ps(xx, yy))), sz);
+
+        model[3][0] = _mm256_loadu_ps(&positionX[i]);
+        model[3][1] = _mm256_loadu_ps(&positionY[i]);
+        model[3][2] = _mm256_loadu_ps(&positionZ[i]);
+
+        float* out = destination + static_cast<size_t>(i)*16;
+
+        for(int column = 0; column < 4; column++)
+        {
+            __m256 rows[4];
+
+            for(int row = 0; row < 4; row++)
+            {
+                rows[row] = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(viewProjection[row]), model[column][0]),
+                                                        _mm256_mul_ps(_mm256_set1_ps(viewProjection[4 + row]), model[column][1])),
+                                          _mm256_mul_ps(_mm256_set1_ps(viewProjection[8 + row]), model[column][2]));
+
+                if(column == 3)
+                    rows[row] = _mm256_add_ps(rows[row], _mm256_set1_ps(viewProjection[12 + row]));
+            }
+
+            //Transpose each 128-bit half separately; the low half holds objects 0-3, the high half 4-7
+            __m128 low[4], high[4];
+
+            for(int row = 0; row < 4; row++)
+            {
+                low[row] = _mm256_castps256_ps128(rows[row]);
+                high[row] = _mm256_extractf128_ps(rows[row], 1);
+            }
+
+            _MM_TRANSPOSE4_PS(low[0], low[1], low[2], low[3]);
+            _MM_TRANSPOSE4_PS(high[0], high[1], high[2], high[3]);
+
+            for(int object = 0; object < 4; object++)
+            {
+                _mm_storeu_ps(out + object*16 + column*4, low[object]);
+                _mm_storeu_ps(out + (object + 4)*16 + column*4, high[object]);
+            }
+        }
+    }
+}
+#endif
@@ -0,0 +1,78 @@
+#ifndef OPENGLTRANSFORMSYSTEM_H
+#define OPENGLTRANSFORMSYSTEM_H
+
+#include <QMatrix4x4>
+#include <QOpenGLExtraFunctions>
+#include <QThreadPool>
+
+#include <vector>
+
+//Positions, rotations (unit quaternions) and scales of many objects in structure-of-arrays layout. update computes
+//viewProjection * translate * rotate * scale for every object, four (SSE) or eight (AVX, if the CPU has it) objects at a
+//time, and writes the column-major matrices straight to their destination, usually a mapped GPU buffer. Large updates
+//are split across a private worker pool; the calling thread takes a share too
+class OpenGLTransformSystem
+{
+public:
+    //maxWorkers of 0 uses QThread::idealThreadCount; updates smaller than minObjectsPerTask stay on the calling thread
+    OpenGLTransformSystem(unsigned int maxWorkers = 0,
+                          unsigned int minObjectsPerTask = 16384);
+
+    virtual ~OpenGLTransformSystem();
+
+    //Adds an object with the given transform and returns its index
+    unsigned int add(float x, float y, float z,
+                     float rx, float ry, float rz, float rw,
+                     float sx, float sy, float sz);
+
+    //New objects are at the origin, unrotated and unscaled
+    void resize(unsigned int count);
+    void clear();
+
+    unsigned int size() const;
+
+    void setPosition(unsigned int index, float x, float y, float z);
+    void setRotation(unsigned int index, float x, float y, float z, float w);
+    void setScale(unsigned int index, float x, float y, float z);
+
+    //Whether this CPU (and build) runs the AVX path
+    static bool detectAVX();
+
+    //Off forces the scalar path, for comparison; widest path the CPU supports otherwise
+    void setSimdEnabled(bool enabled);
+    bool isSimdEnabled() const;
+
+    //"avx", "sse2" or "scalar"
+    const char* getSimdName() const;
+
+    unsigned int getWorkerCount() const;
+
+    //Writes 16 floats per object, column-major as glUniformMatrix4fv / mat4 attributes expect
+    void update(const QMatrix4x4& viewProjection, float* destination);
+
+    //Maps the first size() matrices of a buffer of the current context, updates them in place and unmaps it
+    bool updateBuffer(QOpenGLExtraFunctions* functions, GLenum target, GLuint bufferID, const QMatrix4x4& viewProjection);
+
+    //Computes objects [begin, end); called by workers with disjoint ranges
+    void updateRange(unsigned int begin, unsigned int end, const float* viewProjection, float* destination) const;
+
+protected:
+    void updateScalar(unsigned int begin, unsigned int end, const float* viewProjection, float* destination) const;
+
+    //Only defined where the build has them; updateAVX runs only if detectAVX says so
+    void updateSSE(unsigned int begin, unsigned int end, const float* viewProjection, float* destination) const;
+    void updateAVX(unsigned int begin, unsigned int end, const float* viewProjection, float* destination) const;
+
+    std::vector<float> positionX, positionY, positionZ;
+    std::vector<float> rotationX, rotationY, rotationZ, rotationW;
+    std::vector<float> scaleX, scaleY, scaleZ;
+
+    bool simdEnabled;
+    bool avxSupported;
+
+    unsigned int minTaskSize;
+
+    QThreadPool workerPool;
+};
+
+#endif // OPENGLTRANSFORMSYSTEM_H
@@ -0,0 +1,225 @@
+#include "openglvideowall.h"
+
+#include <algorithm>
+
+OpenGLVideoWall::OpenGLVideoWall(unsigned int canvasWidth,
+                                 unsigned int canvasHeight,
+                                 unsigned int tileWidth,
+                                 unsigned int tileHeight) :
+    width(std::max(canvasWidth, 1u)),
+    height(std::max(canvasHeight, 1u)),
+    tileWidth(std::max(std::min(tileWidth, width), 1u)),
+    tileHeight(std::max(std::min(tileHeight, height), 1u)),
+    tileColumns(0),
+    tileRows(0),
+    tileMapped(),
+    mappedTiles(0),
+    displayViewports(),
+    displayTiles()
+{
+    tileColumns = (width + this->tileWidth - 1) / this->tileWidth;
+    tileRows = (height + this->tileHeight - 1) / this->tileHeight;
+
+    tileMapped.assign(tileColumns * tileRows, false);
+}
+
+OpenGLVideoWall::~OpenGLVideoWall()
+{
+
+}
+
+void OpenGLVideoWall::getGridCanvasSize(unsigned int columns,
+                                        unsigned int rows,
+                                        unsigned int displayWidth,
+                                        unsigned int displayHeight,
+                                        unsigned int bezelWidth,
+                                        unsigned int bezelHeight,
+                                        unsigned int &canvasWidth,
+                                        unsigned int &canvasHeight)
+{
+    columns = std::max(columns, 1u);
+    rows = std::max(rows, 1u);
+
+    canvasWidth = columns * displayWidth + (columns - 1) * bezelWidth;
+    canvasHeight = rows * displayHeight + (rows - 1) * bezelHeight;
+}
+
+unsigned int OpenGLVideoWall::addDisplay(const OpenGLVideoWall::OpenGLWallRect &viewport)
+{
+    displayViewports.push_back(viewport);
+    displayTiles.push_back(std::vector<unsigned int>());
+
+    updateMapping();
+
+    return static_cast<unsigned int>(displayViewports.size() - 1);
+}
+
+unsigned int OpenGLVideoWall::addDisplayGrid(unsigned int columns,
+                                             unsigned int rows,
+                                             unsigned int displayWidth,
+                                             unsigned int displayHeight,
+                                             unsigned int bezelWidth,
+                                             unsigned int bezelHeight)
+{
+    unsigned int first = static_cast<unsigned int>(displayViewports.size());
+
+    for(unsigned int row = 0; row < rows; row++)
+    {
+        //Rows are counted from the top, the canvas from the bottom
+        int y = static_cast<int>(height) - static_cast<int>((row + 1) * displayHeight + row * bezelHeight);
+
+        for(unsigned int column = 0; column < columns; column++)
+        {
+            int x = static_cast<int>(column * (displayWidth + bezelWidth));
+
+            displayViewports.push_back(OpenGLWallRect{x, y, displayWidth, displayHeight});
+            displayTiles.push_back(std::vector<unsigned int>());
+        }
+    }
+
+    updateMapping();
+
+    return first;
+}
+
+unsigned int OpenGLVideoWall::getCanvasWidth() const
+{
+    return width;
+}
+
+unsigned int OpenGLVideoWall::getCanvasHeight() const
+{
+    return height;
+}
+
+unsigned int OpenGLVideoWall::getTileWidth() const
+{
+    return tileWidth;
+}
+
+unsigned int OpenGLVideoWall::getTileHeight() const
+{
+    return tileHeight;
+}
+
+unsigned int OpenGLVideoWall::getTileColumns() const
+{
+    return tileColumns;
+}
+
+unsigned int OpenGLVideoWall::getTileRows() const
+{
+    return tileRows;
+}
+
+unsigned int OpenGLVideoWall::getTileCount() const
+{
+    return tileColumns * tileRows;
+}
+
+OpenGLVideoWall::OpenGLWallRect OpenGLVideoWall::getTileRect(unsigned int tile) const
+{
+    unsigned int column = tile % tileColumns;
+    unsigned int row = tile / tileColumns;
+
+    unsigned int x = column * tileWidth;
+    unsigned int y = row * tileHeight;
+
+    return OpenGLWallRect{static_cast<int>(x),
+                          static_cast<int>(y),
+                          std::min(tileWidth, width - x),
+                          std::min(tileHeight, height - y)};
+}
+
+bool OpenGLVideoWall::isTileMapped(unsigned int tile) const
+{
+    return tile < tileMapped.size() && tileMapped[tile];
+}
+
+unsigned int OpenGLVideoWall::getMappedTileCount() const
+{
+    return mappedTiles;
+}
+
+QMatrix4x4 OpenGLVideoWall::getTileProjection(unsigned int tile) const
+{
+    //Unclipped, so edge tiles keep the scale of the others and their texels past the canvas are simply never shown
+    unsigned int column = tile % tileColumns;
+    unsigned int row = tile / tileColumns;
+
+    float scaleX = static_cast<float>(width) / tileWidth;
+    float scaleY = static_cast<float>(height) / tileHeight;
+
+    //Centre of the tile in normalized device coordinates of the canvas
+    float centerX = (2.0f * column * tileWidth + tileWidth) / width - 1.0f;
+    float centerY = (2.0f * row * tileHeight + tileHeight) / height - 1.0f;
+
+    //Works on clip coordinates; the translation is scaled by w, so it holds after the perspective divide
+    QMatrix4x4 matrix;
+    matrix.scale(scaleX, scaleY, 1.0f);
+    matrix.translate(-centerX, -centerY, 0.0f);
+
+    return matrix;
+}
+
+unsigned int OpenGLVideoWall::getDisplayCount() const
+{
+    return static_cast<unsigned int>(displayViewports.size());
+}
+
+const OpenGLVideoWall::OpenGLWallRect &OpenGLVideoWall::getDisplayViewport(unsigned int display) const
+{
+    return displayViewports[display];
+}
+
+const std::vector<unsigned int> &OpenGLVideoWall::getDisplayTiles(unsigned int display) const
+{
+    return displayTiles[display];
+}
+
+bool OpenGLVideoWall::intersect(const OpenGLVideoWall::OpenGLWallRect &a,
+                                const OpenGLVideoWall::OpenGLWallRect &b,
+                                OpenGLVideoWall::OpenGLWallRect &result)
+{
+    long long left = std::max<long long>(a.x, b.x);
+    long long bottom = std::max<long long>(a.y, b.y);
+    long long right = std::min<long long>(static_cast<long long>(a.x) + a.width, static_cast<long long>(b.x) + b.width);
+    long long top = std::min<long long>(static_cast<long long>(a.y) + a.height, static_cast<long long>(b.y) + b.height);
+
+    if(right <= left || top <= bottom)
+        return false;
+
+    result = OpenGLWallRect{static_cast<int>(left),
+                            static_cast<int>(bottom),
+                            static_cast<unsigned int>(right - left),
+                            static_cast<unsigned int>(top - bottom)};
+
+    return true;
+}
+
+void OpenGLVideoWall::updateMapping()
+{
+    std::fill(tileMapped.begin(), tileMapped.end(), false);
+    mappedTiles = 0;
+
+    for(size_t display = 0; display < displayViewports.size(); display++)
+    {
+        std::vector<unsigned int>& tiles = displayTiles[display];
+        tiles.clear();
+
+        OpenGLWallRect overlap;
+        for(unsigned int tile = 0; tile < getTileCount(); tile++)
+        {
+            if(!intersect(displayViewports[display], getTileRect(tile), overlap))
+                continue;
+
+            tiles.push_back(tile);
+
+            if(!tileMapped[tile])
+            {
+                tileMapped[tile] = true;
+                mappedTiles++;
+            }
+        }
+    }
+}
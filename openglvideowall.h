@@ -0,0 +1,120 @@
+#ifndef OPENGLVIDEOWALL_H
+#define OPENGLVIDEOWALL_H
+
+#include <opengloutputring.h>
+
+#include <QMatrix4x4>
+#include <QMetaType>
+#include <QOpenGLFunctions>
+
+#include <vector>
+
+//Layout of a canvas spread over several displays, for canvases larger than the maximum texture size. The canvas is cut
+//into a grid of tiles that the producer renders one at a time, each with its own projection offset, and every display
+//shows a viewport of the canvas assembled from the tiles it overlaps. Tiles no viewport touches (behind bezels, off the
+//edge of an irregular wall) are never rendered. Coordinates are canvas pixels with y counting up from the bottom edge,
+//as in GL; the layout is set up before it is handed to the producer and displays and is not changed afterwards
+class OpenGLVideoWall
+{
+public:
+    typedef struct OpenGLWallRect
+    {
+        int x;
+        int y;
+        unsigned int width;
+        unsigned int height;
+    }
+    OpenGLWallRect;
+
+    //One frame of the wall; textures are indexed like the tiles and are 0 for tiles that were skipped. Every texture is
+    //the frame's size (the tile size), so the tiles on the right and top edges hold a few texels past the canvas. All
+    //tiles belong to the frame's slot and are held with it
+    typedef struct OpenGLWallFrame
+    {
+        std::vector<GLuint> textureIDs;
+
+        OpenGLOutputRing::OpenGLOutputFrame frame;
+    }
+    OpenGLWallFrame;
+
+    OpenGLVideoWall(unsigned int canvasWidth,
+                    unsigned int canvasHeight,
+                    unsigned int tileWidth,
+                    unsigned int tileHeight);
+
+    virtual ~OpenGLVideoWall();
+
+    //Canvas of a columns x rows wall of identical displays; bezel sizes are the canvas pixels hidden between the active
+    //areas of two neighbouring displays, so content lines up across the gap
+    static void getGridCanvasSize(unsigned int columns,
+                                  unsigned int rows,
+                                  unsigned int displayWidth,
+                                  unsigned int displayHeight,
+                                  unsigned int bezelWidth,
+                                  unsigned int bezelHeight,
+                                  unsigned int& canvasWidth,
+                                  unsigned int& canvasHeight);
+
+    //Adds a display showing the viewport; returns its index
+    unsigned int addDisplay(const OpenGLWallRect& viewport);
+
+    //Adds the displays of such a wall row by row, starting in the top left corner of the canvas; returns the index of
+    //the first
+    unsigned int addDisplayGrid(unsigned int columns,
+                                unsigned int rows,
+                                unsigned int displayWidth,
+                                unsigned int displayHeight,
+                                unsigned int bezelWidth,
+                                unsigned int bezelHeight);
+
+    unsigned int getCanvasWidth() const;
+    unsigned int getCanvasHeight() const;
+
+    unsigned int getTileWidth() const;
+    unsigned int getTileHeight() const;
+
+    unsigned int getTileColumns() const;
+    unsigned int getTileRows() const;
+    unsigned int getTileCount() const;
+
+    //Part of the canvas the tile covers, clipped to the canvas
+    OpenGLWallRect getTileRect(unsigned int tile) const;
+
+    //True if some display's viewport overlaps the tile
+    bool isTileMapped(unsigned int tile) const;
+    unsigned int getMappedTileCount() const;
+
+    //Applied on top of the projection, maps the tile's part of clip space onto the whole of it
+    QMatrix4x4 getTileProjection(unsigned int tile) const;
+
+    unsigned int getDisplayCount() const;
+    const OpenGLWallRect& getDisplayViewport(unsigned int display) const;
+
+    //Mapped tiles overlapping the display's viewport
+    const std::vector<unsigned int>& getDisplayTiles(unsigned int display) const;
+
+    //Overlap of two rects; false if they do not overlap
+    static bool intersect(const OpenGLWallRect& a, const OpenGLWallRect& b, OpenGLWallRect& result);
+
+protected:
+    void updateMapping();
+
+    unsigned int width;
+    unsigned int height;
+
+    unsigned int tileWidth;
+    unsigned int tileHeight;
+
+    unsigned int tileColumns;
+    unsigned int tileRows;
+
+    std::vector<bool> tileMapped;
+    unsigned int mappedTiles;
+
+    std::vector<OpenGLWallRect> displayViewports;
+    std::vector<std::vector<unsigned int>> displayTiles;
+};
+
+Q_DECLARE_METATYPE(OpenGLVideoWall::OpenGLWallFrame)
+
+#endif // OPENGLVIDEOWALL_H
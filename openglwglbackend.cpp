@@ -0,0 +1,235 @@
+#include "openglwglbackend.h"
+
+#include <openglnativerenderwindow.h>
+
+#include <QDebug>
+
+#include <string>
+
+OpenGLWGLBackend::OpenGLWGLBackend(OpenGLNativeRenderWindow *window,
+                                   const QSurfaceFormat &surfaceFormat,
+                                   QOpenGLContext *sharedContext) :
+    OpenGLNativeBackend(window,surfaceFormat,sharedContext),
+    hwnd(NULL),
+    hdc(NULL),
+    hglrc(NULL)
+{
+
+}
+
+OpenGLWGLBackend::~OpenGLWGLBackend()
+{
+
+}
+
+LRESULT OpenGLWGLBackend::WindowProc(HWND hwnd, UINT message, WPARAM wParam, LPARAM lParam)
+{
+    HDC hdc;
+    HGLRC hglrc;
+    PIXELFORMATDESCRIPTOR pixelFormatDesc;
+    int pixelFormat;
+
+    OpenGLNativeRenderWindow* renderWindow;
+    switch (message)
+    {
+        case WM_CREATE:
+        pixelFormatDesc =
+        {
+            sizeof(PIXELFORMATDESCRIPTOR),
+            1,
+            PFD_DRAW_TO_WINDOW | PFD_SUPPORT_OPENGL | PFD_DOUBLEBUFFER, // Flags
+            PFD_TYPE_RGBA,                                              // The kind of framebuffer. RGBA or palette.
+            32,                                                         // Colordepth of the framebuffer.
+            0, 0, 0, 0, 0, 0,
+            0,
+            0,
+            0,
+            0, 0, 0, 0,
+            32,                                                         // Number of bits for the depthbuffer
+            8,                                                          // Number of bits for the stencilbuffer
+            0,                                                          // Number of Aux buffers in the framebuffer.
+            PFD_MAIN_PLANE,
+            0,
+            0, 0, 0
+        };
+
+        hdc = GetDC(hwnd);
+
+        pixelFormat = ChoosePixelFormat(hdc, &pixelFormatDesc);
+        SetPixelFormat(hdc, pixelFormat, &pixelFormatDesc);
+
+        hglrc = wglCreateContext(hdc);              //Create OpenGL context
+        wglMakeCurrent(hdc,hglrc);                  //Make the OpenGL context current
+        break;
+        case WM_DESTROY:
+        wglMakeCurrent(GetDC(hwnd),NULL);           //Deselect OpenGL context
+        wglDeleteContext(wglGetCurrentContext());   //Delete OpenGL context
+        PostQuitMessage(0);                         //Send wm_quit
+        break;
+        case WM_PAINT:
+        PAINTSTRUCT ps;
+        hdc = BeginPaint(hwnd, &ps);
+
+        //Access render window instance
+        renderWindow = reinterpret_cast<OpenGLNativeRenderWindow*>(GetWindowLongPtrW(hwnd,0));
+        if(renderWindow)
+            //Make sure the render window is created and visible on its own thread before resize / render
+            if(renderWindow->isVisible())
+                renderWindow->renderFrame();
+
+        FillRect(hdc, &ps.rcPaint, (HBRUSH)(COLOR_WINDOW+1));
+
+        EndPaint(hwnd, &ps);
+        break;
+        case WM_SIZE:
+        //Access render window instance
+        renderWindow = reinterpret_cast<OpenGLNativeRenderWindow*>(GetWindowLongPtrW(hwnd,0));
+        if(renderWindow)
+            //Make sure the render window is created and visible on its own thread before resize / render
+            if(renderWindow->isVisible())
+                    renderWindow->resize(LOWORD(lParam),HIWORD(lParam));
+        break;
+    }
+
+    return DefWindowProc(hwnd,message,wParam,lParam);
+}
+
+void OpenGLWGLBackend::displayLastError()
+{
+    DWORD errorMessageID = GetLastError();
+
+    LPSTR messageBuffer = nullptr;
+
+    //Ask Win32 to give us the string version of that message ID
+    //The parameters we pass in, tell Win32 to create the buffer that holds the message for us (because we don't yet know how long the message string will be)
+    size_t size = FormatMessageA(FORMAT_MESSAGE_ALLOCATE_BUFFER | FORMAT_MESSAGE_FROM_SYSTEM | FORMAT_MESSAGE_IGNORE_INSERTS,
+                                 NULL,
+                                 errorMessageID,
+                                 MAKELANGID(LANG_NEUTRAL, SUBLANG_DEFAULT),
+                                 (LPSTR)&messageBuffer,
+                                 0,
+                                 NULL);
+
+    //Copy the error message into a std::string
+    std::string message(messageBuffer, size);
+
+    //Free the Win32's string's buffer
+    LocalFree(messageBuffer);
+
+    qDebug()<<message.c_str();
+}
+
+HWND OpenGLWGLBackend::getWindowHandle() const
+{
+    return hwnd;
+}
+
+HDC OpenGLWGLBackend::getWindowRenderContext() const
+{
+    return hdc;
+}
+
+HGLRC OpenGLWGLBackend::getOpenGLContextHandle() const
+{
+    return hglrc;
+}
+
+bool OpenGLWGLBackend::createNative(unsigned int width, unsigned int height)
+{
+    //Register the window class
+    const wchar_t CLASS_NAME[]  = L"Renderer";
+
+    WNDCLASS wc = {};
+
+    HINSTANCE hInstance = GetModuleHandle(NULL);
+
+    wc.lpfnWndProc = (WNDPROC)(&OpenGLWGLBackend::WindowProc);
+    wc.hInstance = hInstance;
+    wc.lpszClassName = CLASS_NAME;
+    wc.style = CS_OWNDC;
+    wc.cbWndExtra = sizeof(OpenGLNativeRenderWindow*);
+
+    RegisterClass(&wc);
+
+    int wWid = static_cast<int>(width);
+    int wHei = static_cast<int>(height);
+
+    //Create the window
+    hwnd = CreateWindowEx(
+                0,                      //Optional window styles
+                CLASS_NAME,             //Window class
+                L"Render Window",       //Window text
+                WS_OVERLAPPEDWINDOW,    //Window style
+                CW_USEDEFAULT,          //X
+                CW_USEDEFAULT,          //Y
+                wWid,                   //W
+                wHei,                   //H
+                NULL,                   //Parent window
+                NULL,                   //Menu
+                hInstance,              //Instance handle
+                NULL                    //Additional application data
+                );
+
+    if(hwnd == NULL)
+        return false;
+
+    hdc = GetDC(hwnd);                  //Get the device context for native window
+    hglrc = wglGetCurrentContext();     //Created in WM_CREATE
+
+    SetWindowLongPtrW(hwnd,
+                      0,
+                      reinterpret_cast<LONG_PTR>(renderWindow));
+
+    return true;
+}
+
+bool OpenGLWGLBackend::showNative()
+{
+    return !ShowWindow(hwnd,SW_SHOWNORMAL);
+}
+
+QVariant OpenGLWGLBackend::getNativeContext() const
+{
+    return QVariant::fromValue(QWGLNativeContext(hglrc,hwnd));
+}
+
+bool OpenGLWGLBackend::makeContextCurrent()
+{
+    return wglMakeCurrent(hdc,
+                          hglrc);
+}
+
+void OpenGLWGLBackend::doneContextCurrent()
+{
+    wglMakeCurrent(hdc,NULL);
+}
+
+bool OpenGLWGLBackend::isContextCurrent() const
+{
+    return wglGetCurrentContext() == hglrc &&
+           wglGetCurrentDC() == hdc;
+}
+
+void OpenGLWGLBackend::swapBuffers()
+{
+    //SwapBuffers(hdc);
+    wglSwapLayerBuffers(hdc,
+                        WGL_SWAP_MAIN_PLANE);
+}
+
+void OpenGLWGLBackend::requestUpdate()
+{
+    //Repaint via WM_PAINT on the window's thread
+    RECT rect;
+    GetWindowRect(hwnd,&rect);
+
+    InvalidateRect(hwnd,&rect,true);
+}
+
+bool OpenGLWGLBackend::invalidate()
+{
+    RECT rect;
+    GetWindowRect(hwnd,&rect);
+
+    return InvalidateRect(hwnd,&rect,true);
+}
@@ -0,0 +1,55 @@
+#ifndef OPENGLWGLBACKEND_H
+#define OPENGLWGLBACKEND_H
+
+#include <openglnativebackend.h>
+
+#include <QtPlatformHeaders/QWGLNativeContext>
+#include <WinUser.h>
+#include <wingdi.h>
+#include <windef.h>
+
+#include <errhandlingapi.h>
+
+//Win32 window with a WGL context; frames are rendered from WM_PAINT
+class OpenGLWGLBackend : public OpenGLNativeBackend
+{
+public:
+    OpenGLWGLBackend(OpenGLNativeRenderWindow* window,
+                     const QSurfaceFormat& surfaceFormat,
+                     QOpenGLContext* sharedContext);
+
+    virtual ~OpenGLWGLBackend();
+
+    //Class window procedure
+    static LRESULT WindowProc(HWND hwnd, UINT message, WPARAM wParam, LPARAM lParam);
+
+    void displayLastError();
+
+    //WGL resource access
+    HWND getWindowHandle() const;
+    HDC getWindowRenderContext() const;
+    HGLRC getOpenGLContextHandle() const;
+
+    virtual bool createNative(unsigned int width, unsigned int height) override;
+    virtual bool showNative() override;
+
+    virtual QVariant getNativeContext() const override;
+
+    //WGL context methods
+    virtual bool makeContextCurrent() override;
+    virtual void doneContextCurrent() override;
+    virtual void swapBuffers() override;
+
+    virtual bool isContextCurrent() const override;
+
+    virtual void requestUpdate() override;
+    virtual bool invalidate() override;
+
+protected:
+    //WGL resources
+    HWND hwnd;
+    HDC hdc;
+    HGLRC hglrc;
+};
+
+#endif // OPENGLWGLBACKEND_H